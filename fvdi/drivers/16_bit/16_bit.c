@@ -6,7 +6,9 @@
 #undef BOTH
 #endif
 
+#include "../16_bit/16b_dirty.c"
 #include "../16_bit/16b_exp.c"
+#include "../16_bit/16b_blend.c"
 #include "../16_bit/16b_blit.c"
 #include "../16_bit/16b_line.c"
 #include "../16_bit/16b_fill.c"
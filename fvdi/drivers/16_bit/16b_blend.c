@@ -0,0 +1,411 @@
+/*
+ * A 16/32 bit coverage blend routine.
+ *
+ * The source is an 8 bit chunky coverage map (0 - nothing, 255 - solid)
+ * as produced by the anti-aliasing text renderer. Each destination pixel
+ * is mixed between the foreground and the background (replace), or
+ * between a colour and what is already on screen (transparent and
+ * reverse transparent), in proportion to the coverage.
+ *
+ * The colour pair changes rarely compared to the number of pixels
+ * drawn, so the weighted colour components are kept in small ramps
+ * indexed directly by coverage and only rebuilt when needed.
+ *
+ * 16 bit pixels are taken to be 5/6/5 RGB and 32 bit ones xRGB.
+ * Both are always compiled in, whatever DEPTH the driver is built
+ * for, since some drivers (radeon) switch between them at run time.
+ */
+
+#include "fvdi.h"
+#include "driver.h"
+#include "../bitplane/bitplane.h"
+#include "16b_pixel.h"
+
+/*
+ * 5/6/5 RGB spread out over a long (green moved up to bit 21) to
+ * leave room above each component for a 5 bit weight multiply.
+ */
+#define SPREAD_MASK     0x07e0f81fUL
+#define SPREAD(p)       ((((unsigned long)(p) << 16) | (p)) & SPREAD_MASK)
+#define UNSPREAD(s)     ((unsigned short)((s) | ((s) >> 16)))
+
+#define RB_MASK         0x00ff00ffUL
+#define G_MASK          0x0000ff00UL
+
+
+static struct mix_ramp_ {
+    short depth;
+    unsigned long foreground;
+    unsigned long background;
+    unsigned long pixel[256];       /* Ready mixed pixel for each coverage */
+} mix_ramp;
+
+static struct over_ramp_ {
+    short depth;
+    short inverse;
+    unsigned long colour;
+    unsigned long rb[256];          /* Weighted components for each coverage */
+    unsigned long g[256];           /* Green, for 32 bit only */
+    short keep[256];                /* Weight left for the destination */
+} over_ramp;
+
+
+static int full_weight(int depth)
+{
+    return depth == 16 ? 32 : 256;
+}
+
+static int weight(int coverage, int depth)
+{
+    if (depth == 16)
+        return (coverage + 4) >> 3;     /* 0 - 32 */
+    else
+        return coverage + (coverage >> 7);  /* 0 - 256 */
+}
+
+
+static void build_mix_ramp(int depth, unsigned long foreground, unsigned long background)
+{
+    int i, w, full;
+    unsigned long fg_rb, fg_g, bg_rb, bg_g, rb, g;
+
+    if ((mix_ramp.depth == depth) && (mix_ramp.foreground == foreground) &&
+        (mix_ramp.background == background))
+        return;
+
+    full = full_weight(depth);
+    if (depth == 16) {
+        fg_rb = SPREAD(foreground);
+        bg_rb = SPREAD(background);
+        for(i = 0; i < 256; i++) {
+            w = weight(i, depth);
+            rb = ((fg_rb * w + bg_rb * (full - w)) >> 5) & SPREAD_MASK;
+            mix_ramp.pixel[i] = UNSPREAD(rb);
+        }
+    } else {
+        fg_rb = foreground & RB_MASK;
+        fg_g = foreground & G_MASK;
+        bg_rb = background & RB_MASK;
+        bg_g = background & G_MASK;
+        for(i = 0; i < 256; i++) {
+            w = weight(i, depth);
+            rb = ((fg_rb * w + bg_rb * (full - w)) >> 8) & RB_MASK;
+            g = ((fg_g * w + bg_g * (full - w)) >> 8) & G_MASK;
+            mix_ramp.pixel[i] = (foreground & 0xff000000UL) | rb | g;
+        }
+    }
+
+    mix_ramp.depth = depth;
+    mix_ramp.foreground = foreground;
+    mix_ramp.background = background;
+}
+
+
+static void build_over_ramp(int depth, unsigned long colour, int inverse)
+{
+    int i, w, full;
+    unsigned long rb, g;
+
+    if ((over_ramp.depth == depth) && (over_ramp.colour == colour) &&
+        (over_ramp.inverse == inverse))
+        return;
+
+    full = full_weight(depth);
+    if (depth == 16) {
+        rb = SPREAD(colour);
+        g = 0;
+    } else {
+        rb = colour & RB_MASK;
+        g = colour & G_MASK;
+    }
+    for(i = 0; i < 256; i++) {
+        w = weight(i, depth);
+        if (inverse)
+            w = full - w;
+        over_ramp.rb[i] = rb * w;
+        over_ramp.g[i] = g * w;
+        over_ramp.keep[i] = full - w;
+    }
+
+    over_ramp.depth = depth;
+    over_ramp.colour = colour;
+    over_ramp.inverse = inverse;
+}
+
+
+/*
+ * When the screen is shadowed in FastRAM (BOTH), dst_addr_fast is
+ * non-zero and is both read from and written to along with the screen.
+ */
+
+static void replace_16(unsigned char *src_addr, int src_line_add, unsigned short *dst_addr, unsigned short *dst_addr_fast, int dst_line_add, int w, int h)
+{
+    int i, j;
+    unsigned short v;
+
+    for(i = h - 1; i >= 0; i--) {
+        for(j = w - 1; j >= 0; j--) {
+            v = (unsigned short)mix_ramp.pixel[*src_addr++];
+#ifdef BOTH
+            if (dst_addr_fast)
+                *dst_addr_fast++ = v;
+#endif
+            *dst_addr++ = v;
+        }
+        src_addr += src_line_add;
+        dst_addr += dst_line_add;
+#ifdef BOTH
+        if (dst_addr_fast)
+            dst_addr_fast += dst_line_add;
+#endif
+    }
+}
+
+static void over_16(unsigned char *src_addr, int src_line_add, unsigned short *dst_addr, unsigned short *dst_addr_fast, int dst_line_add, int w, int h)
+{
+    int i, j, keep;
+    unsigned int coverage;
+    unsigned long d;
+    unsigned short v;
+
+    for(i = h - 1; i >= 0; i--) {
+        for(j = w - 1; j >= 0; j--) {
+            coverage = *src_addr++;
+            keep = over_ramp.keep[coverage];
+            if (keep == 32) {
+                dst_addr++;
+#ifdef BOTH
+                if (dst_addr_fast)
+                    dst_addr_fast++;
+#endif
+                continue;
+            }
+#ifdef BOTH
+            v = dst_addr_fast ? *dst_addr_fast : *dst_addr;
+#else
+            v = *dst_addr;
+#endif
+            d = ((over_ramp.rb[coverage] + SPREAD(v) * keep) >> 5) & SPREAD_MASK;
+            v = UNSPREAD(d);
+#ifdef BOTH
+            if (dst_addr_fast)
+                *dst_addr_fast++ = v;
+#endif
+            *dst_addr++ = v;
+        }
+        src_addr += src_line_add;
+        dst_addr += dst_line_add;
+#ifdef BOTH
+        if (dst_addr_fast)
+            dst_addr_fast += dst_line_add;
+#endif
+    }
+}
+
+static void xor_16(unsigned char *src_addr, int src_line_add, unsigned short *dst_addr, unsigned short *dst_addr_fast, int dst_line_add, int w, int h)
+{
+    int i, j;
+    unsigned short v;
+
+    for(i = h - 1; i >= 0; i--) {
+        for(j = w - 1; j >= 0; j--) {
+            if (*src_addr++ & 0x80) {
+#ifdef BOTH
+                v = ~(dst_addr_fast ? *dst_addr_fast : *dst_addr);
+                if (dst_addr_fast)
+                    *dst_addr_fast = v;
+#else
+                v = ~*dst_addr;
+#endif
+                *dst_addr = v;
+            }
+            dst_addr++;
+#ifdef BOTH
+            if (dst_addr_fast)
+                dst_addr_fast++;
+#endif
+        }
+        src_addr += src_line_add;
+        dst_addr += dst_line_add;
+#ifdef BOTH
+        if (dst_addr_fast)
+            dst_addr_fast += dst_line_add;
+#endif
+    }
+}
+
+
+static void replace_32(unsigned char *src_addr, int src_line_add, unsigned PIXEL_32 *dst_addr, unsigned PIXEL_32 *dst_addr_fast, int dst_line_add, int w, int h)
+{
+    int i, j;
+    unsigned PIXEL_32 v;
+
+    for(i = h - 1; i >= 0; i--) {
+        for(j = w - 1; j >= 0; j--) {
+            v = mix_ramp.pixel[*src_addr++];
+#ifdef BOTH
+            if (dst_addr_fast)
+                *dst_addr_fast++ = v;
+#endif
+            *dst_addr++ = v;
+        }
+        src_addr += src_line_add;
+        dst_addr += dst_line_add;
+#ifdef BOTH
+        if (dst_addr_fast)
+            dst_addr_fast += dst_line_add;
+#endif
+    }
+}
+
+static void over_32(unsigned char *src_addr, int src_line_add, unsigned PIXEL_32 *dst_addr, unsigned PIXEL_32 *dst_addr_fast, int dst_line_add, int w, int h)
+{
+    int i, j, keep;
+    unsigned int coverage;
+    unsigned PIXEL_32 v, rb, g;
+
+    for(i = h - 1; i >= 0; i--) {
+        for(j = w - 1; j >= 0; j--) {
+            coverage = *src_addr++;
+            keep = over_ramp.keep[coverage];
+            if (keep == 256) {
+                dst_addr++;
+#ifdef BOTH
+                if (dst_addr_fast)
+                    dst_addr_fast++;
+#endif
+                continue;
+            }
+#ifdef BOTH
+            v = dst_addr_fast ? *dst_addr_fast : *dst_addr;
+#else
+            v = *dst_addr;
+#endif
+            rb = ((over_ramp.rb[coverage] + (v & RB_MASK) * keep) >> 8) & RB_MASK;
+            g = ((over_ramp.g[coverage] + (v & G_MASK) * keep) >> 8) & G_MASK;
+            v = (v & 0xff000000UL) | rb | g;
+#ifdef BOTH
+            if (dst_addr_fast)
+                *dst_addr_fast++ = v;
+#endif
+            *dst_addr++ = v;
+        }
+        src_addr += src_line_add;
+        dst_addr += dst_line_add;
+#ifdef BOTH
+        if (dst_addr_fast)
+            dst_addr_fast += dst_line_add;
+#endif
+    }
+}
+
+static void xor_32(unsigned char *src_addr, int src_line_add, unsigned PIXEL_32 *dst_addr, unsigned PIXEL_32 *dst_addr_fast, int dst_line_add, int w, int h)
+{
+    int i, j;
+    unsigned PIXEL_32 v;
+
+    for(i = h - 1; i >= 0; i--) {
+        for(j = w - 1; j >= 0; j--) {
+            if (*src_addr++ & 0x80) {
+#ifdef BOTH
+                v = ~(dst_addr_fast ? *dst_addr_fast : *dst_addr);
+                if (dst_addr_fast)
+                    *dst_addr_fast = v;
+#else
+                v = ~*dst_addr;
+#endif
+                *dst_addr = v;
+            }
+            dst_addr++;
+#ifdef BOTH
+            if (dst_addr_fast)
+                dst_addr_fast++;
+#endif
+        }
+        src_addr += src_line_add;
+        dst_addr += dst_line_add;
+#ifdef BOTH
+        if (dst_addr_fast)
+            dst_addr_fast += dst_line_add;
+#endif
+    }
+}
+
+
+/*
+ * Blend an 8 bit coverage map onto the screen.
+ * The area is already clipped by the caller.
+ * Returns 0 (not done) for anything but 16/32 bit screens.
+ */
+long CDECL c_blend_area(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour)
+{
+    Workstation *wk;
+    unsigned char *src_addr;
+    char *dst_addr, *dst_addr_fast;
+    unsigned long foreground, background;
+    int depth, pixel_size;
+    int src_line_add, dst_line_add;
+    long dst_pos;
+
+    wk = vwk->real_address;
+    depth = wk->screen.mfdb.bitplanes;
+    if (((depth != 16) && (depth != 32)) || (src->bitplanes != 8))
+        return 0;
+    if ((w <= 0) || (h <= 0))
+        return 1;
+
+    c_get_colours(vwk, colour, &foreground, &background);
+#ifdef FAST
+    mouse_keep_out(wk, dst_x, dst_y, dst_x + w - 1, dst_y + h - 1);
+#endif
+
+    pixel_size = depth >> 3;
+    src_addr = (unsigned char *)src->address + (short)src_y * (long)src->wdwidth * 2 + src_x;
+    src_line_add = src->wdwidth * 2 - w;
+
+    dst_pos = (short)dst_y * (long)wk->screen.wrap + dst_x * pixel_size;
+    dst_line_add = (wk->screen.wrap - w * pixel_size) / pixel_size;     /* Pixel count */
+    dst_addr = (char *)wk->screen.mfdb.address + dst_pos;
+
+#ifdef BOTH
+    dst_addr_fast = wk->screen.shadow.address;
+    if (dst_addr_fast)
+        dst_addr_fast += dst_pos;
+#else
+    dst_addr_fast = 0;
+#endif
+
+    switch (mode) {
+    case 1:             /* Replace */
+        build_mix_ramp(depth, foreground, background);
+        if (depth == 16)
+            replace_16(src_addr, src_line_add, (unsigned short *)dst_addr, (unsigned short *)dst_addr_fast, dst_line_add, w, h);
+        else
+            replace_32(src_addr, src_line_add, (unsigned PIXEL_32 *)dst_addr, (unsigned PIXEL_32 *)dst_addr_fast, dst_line_add, w, h);
+        break;
+    case 2:             /* Transparent */
+    case 4:             /* Reverse transparent */
+        if (mode == 2)
+            build_over_ramp(depth, foreground, 0);
+        else
+            build_over_ramp(depth, background, 1);
+        if (depth == 16)
+            over_16(src_addr, src_line_add, (unsigned short *)dst_addr, (unsigned short *)dst_addr_fast, dst_line_add, w, h);
+        else
+            over_32(src_addr, src_line_add, (unsigned PIXEL_32 *)dst_addr, (unsigned PIXEL_32 *)dst_addr_fast, dst_line_add, w, h);
+        break;
+    case 3:             /* XOR */
+        if (depth == 16)
+            xor_16(src_addr, src_line_add, (unsigned short *)dst_addr, (unsigned short *)dst_addr_fast, dst_line_add, w, h);
+        else
+            xor_32(src_addr, src_line_add, (unsigned PIXEL_32 *)dst_addr, (unsigned PIXEL_32 *)dst_addr_fast, dst_line_add, w, h);
+        break;
+    default:
+        return 0;
+    }
+#ifdef FAST
+    dirty_mark(dst_x, dst_y, dst_x + w - 1, dst_y + h - 1);
+#endif
+
+    return 1;       /* Return as completed */
+}
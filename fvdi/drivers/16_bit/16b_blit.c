@@ -15,9 +15,7 @@
 #include "driver.h"
 #include "../bitplane/bitplane.h"
 
-#define PIXEL		short
-#define PIXEL_SIZE	sizeof(PIXEL)
-#define PIXEL_32    long
+#include "16b_pixel.h"
 
 #ifdef FVDI_DEBUG
 static void debug_out(const char *text1, int w, int old_w, int h, int src_x, int src_y, int dst_x, int dst_y)
@@ -52,59 +50,201 @@ static void debug_out(const char *text1, int w, int old_w, int h, int src_x, int
 #define REGL short
 #endif
 
+#if defined(__m68k__) && (DEPTH == 16)
+#define ASM_LOOPS       /* The line loops below are in assembly */
+#endif
 
-#define DO_OP(v) \
-    switch(operation) { \
-    case 0: \
-    default: \
-        v = 0; \
-        break; \
-    case 1: \
-        v = v ## s & v ## d; \
-        break; \
-    case 2: \
-        v = v ## s & ~v ## d; \
-        break; \
-    case 3: \
-        v = v ## s; \
-        break; \
-    case 4: \
-        v = ~v ## s & v ## d; \
-        break; \
-    case 5: \
-        v = v ## d; \
-        break; \
-    case 6: \
-        v = v ## s ^ v ## d; \
-        break; \
-    case 7: \
-        v = v ## s | v ## d; \
-        break; \
-    case 8: \
-        v = ~(v ## s | v ## d); \
-        break; \
-    case 9: \
-        v = ~(v ## s ^ v ## d); \
-        break; \
-    case 10: \
-        v = ~v ## d; \
-        break; \
-    case 11: \
-        v = v ## s | ~v ## d; \
-        break; \
-    case 12: \
-        v = ~v ## s; \
-        break; \
-    case 13: \
-        v = ~v ## s | v ## d; \
-        break; \
-    case 14: \
-        v = ~(v ## s & v ## d); \
-        break; \
-    case 15: \
-        v = -1; \
-        break; \
+#ifndef ASM_LOOPS
+/*
+ * Plain C versions of the line loops below, for other hosts
+ * (see utility/bench) and for pixels that are not 16 bit.
+ * Long words are used once the destination is aligned.
+ * SHADOW is set while the s_ functions are compiled.
+ */
+#define FORWARD_LOOP(op) \
+    { \
+        int n; \
+        PIXEL v; \
+        PIXEL_32 v32, d32; \
+        for(n = x; (n > 0) && ((long)dst_addr & 3); n--) { \
+            v = *src_addr++; \
+            if (SHADOW) \
+                *dst_addr_fast++ op v; \
+            *dst_addr++ op v; \
+        } \
+        for(; n >= PIXEL_PER_LONG; n -= PIXEL_PER_LONG) { \
+            v32 = GET_LONG(src_addr); \
+            src_addr += PIXEL_PER_LONG; \
+            if (SHADOW) { \
+                d32 = GET_LONG(dst_addr_fast); \
+                d32 op v32; \
+                SET_LONG(dst_addr_fast, d32); \
+                dst_addr_fast += PIXEL_PER_LONG; \
+            } \
+            d32 = GET_LONG(dst_addr); \
+            d32 op v32; \
+            SET_LONG(dst_addr, d32); \
+            dst_addr += PIXEL_PER_LONG; \
+        } \
+        for(; n > 0; n--) { \
+            v = *src_addr++; \
+            if (SHADOW) \
+                *dst_addr_fast++ op v; \
+            *dst_addr++ op v; \
+        } \
     }
+#define BACKWARD_LOOP(op) \
+    { \
+        int n; \
+        PIXEL v; \
+        PIXEL_32 v32, d32; \
+        for(n = x; (n > 0) && ((long)dst_addr & 3); n--) { \
+            v = *--src_addr; \
+            if (SHADOW) \
+                *--dst_addr_fast op v; \
+            *--dst_addr op v; \
+        } \
+        for(; n >= PIXEL_PER_LONG; n -= PIXEL_PER_LONG) { \
+            src_addr -= PIXEL_PER_LONG; \
+            v32 = GET_LONG(src_addr); \
+            if (SHADOW) { \
+                dst_addr_fast -= PIXEL_PER_LONG; \
+                d32 = GET_LONG(dst_addr_fast); \
+                d32 op v32; \
+                SET_LONG(dst_addr_fast, d32); \
+            } \
+            dst_addr -= PIXEL_PER_LONG; \
+            d32 = GET_LONG(dst_addr); \
+            d32 op v32; \
+            SET_LONG(dst_addr, d32); \
+        } \
+        for(; n > 0; n--) { \
+            v = *--src_addr; \
+            if (SHADOW) \
+                *--dst_addr_fast op v; \
+            *--dst_addr op v; \
+        } \
+    }
+#endif
+
+
+/*
+ * Apart from copy and OR, which have their own loops below, every
+ * operation gets a forward and a backward (for blits to the right
+ * on the same lines) function of its own, generated from an
+ * expression for the new pixel in terms of the source (s) and
+ * destination (d) pixels. With SHADOW set, the destination is
+ * read from the shadow buffer and the result written to both.
+ */
+#define BLIT_FORWARD(name, op) \
+static void name(PIXEL *src_addr, int src_line_add, \
+                 PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, \
+                 short int w, short int h) \
+{ \
+    short int i, j; \
+    PIXEL_32 *src_addr32, *dst_addr32, *dst_addr_fast32; \
+ \
+    (void) dst_addr_fast; \
+    if (w <= 0 || h <= 0) \
+        unreachable(); \
+    for(i = h - 1; i >= 0; i--) { \
+        for(j = (w & (PIXEL_PER_LONG - 1)) - 1; j >= 0; j--) { \
+            PIXEL s, d; \
+            s = *src_addr++; \
+            d = SHADOW ? *dst_addr_fast : *dst_addr; \
+            (void) s; \
+            d = op; \
+            if (SHADOW) \
+                *dst_addr_fast++ = d; \
+            *dst_addr++ = d; \
+        } \
+        src_addr32 = (PIXEL_32 *)src_addr; \
+        dst_addr32 = (PIXEL_32 *)dst_addr; \
+        dst_addr_fast32 = (PIXEL_32 *)dst_addr_fast; \
+        for(j = w / PIXEL_PER_LONG - 1; j >= 0; j--) { \
+            PIXEL_32 s, d; \
+            s = GET_LONG(src_addr32++); \
+            d = SHADOW ? GET_LONG(dst_addr_fast32) : GET_LONG(dst_addr32); \
+            (void) s; \
+            d = op; \
+            if (SHADOW) \
+                SET_LONG(dst_addr_fast32++, d); \
+            SET_LONG(dst_addr32++, d); \
+        } \
+        src_addr = (PIXEL *)src_addr32 + src_line_add; \
+        dst_addr = (PIXEL *)dst_addr32 + dst_line_add; \
+        if (SHADOW) \
+            dst_addr_fast = (PIXEL *)dst_addr_fast32 + dst_line_add; \
+    } \
+}
+
+#define BLIT_BACKWARD(name, op) \
+static void name(PIXEL *src_addr, int src_line_add, \
+                 PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, \
+                 short int w, short int h) \
+{ \
+    short int i, j; \
+    PIXEL_32 *src_addr32, *dst_addr32, *dst_addr_fast32; \
+ \
+    (void) dst_addr_fast; \
+    if (w <= 0 || h <= 0) \
+        unreachable(); \
+    for(i = h - 1; i >= 0; i--) { \
+        for(j = (w & (PIXEL_PER_LONG - 1)) - 1; j >= 0; j--) { \
+            PIXEL s, d; \
+            s = *--src_addr; \
+            --dst_addr; \
+            if (SHADOW) \
+                --dst_addr_fast; \
+            d = SHADOW ? *dst_addr_fast : *dst_addr; \
+            (void) s; \
+            d = op; \
+            if (SHADOW) \
+                *dst_addr_fast = d; \
+            *dst_addr = d; \
+        } \
+        src_addr32 = (PIXEL_32 *)src_addr; \
+        dst_addr32 = (PIXEL_32 *)dst_addr; \
+        dst_addr_fast32 = (PIXEL_32 *)dst_addr_fast; \
+        for(j = w / PIXEL_PER_LONG - 1; j >= 0; j--) { \
+            PIXEL_32 s, d; \
+            s = GET_LONG(--src_addr32); \
+            --dst_addr32; \
+            if (SHADOW) \
+                --dst_addr_fast32; \
+            d = SHADOW ? GET_LONG(dst_addr_fast32) : GET_LONG(dst_addr32); \
+            (void) s; \
+            d = op; \
+            if (SHADOW) \
+                SET_LONG(dst_addr_fast32, d); \
+            SET_LONG(dst_addr32, d); \
+        } \
+        src_addr = (PIXEL *)src_addr32 + src_line_add; \
+        dst_addr = (PIXEL *)dst_addr32 + dst_line_add; \
+        if (SHADOW) \
+            dst_addr_fast = (PIXEL *)dst_addr_fast32 + dst_line_add; \
+    } \
+}
+
+#define BLIT_OP(forward, backward, op) \
+    BLIT_FORWARD(forward, op) \
+    BLIT_BACKWARD(backward, op)
+
+/* Operation 5 (D) leaves the destination as it is */
+#define BLIT_OPS(prefix) \
+    BLIT_OP(prefix ## blit_all_white,  prefix ## pan_all_white,  0) \
+    BLIT_OP(prefix ## blit_s_and_d,    prefix ## pan_s_and_d,    s & d) \
+    BLIT_OP(prefix ## blit_s_and_notd, prefix ## pan_s_and_notd, s & ~d) \
+    BLIT_OP(prefix ## blit_nots_and_d, prefix ## pan_nots_and_d, ~s & d) \
+    BLIT_OP(prefix ## blit_s_xor_d,    prefix ## pan_s_xor_d,    s ^ d) \
+    BLIT_OP(prefix ## blit_not_sord,   prefix ## pan_not_sord,   ~(s | d)) \
+    BLIT_OP(prefix ## blit_not_sxord,  prefix ## pan_not_sxord,  ~(s ^ d)) \
+    BLIT_OP(prefix ## blit_d_invert,   prefix ## pan_d_invert,   ~d) \
+    BLIT_OP(prefix ## blit_s_or_notd,  prefix ## pan_s_or_notd,  s | ~d) \
+    BLIT_OP(prefix ## blit_not_s,      prefix ## pan_not_s,      ~s) \
+    BLIT_OP(prefix ## blit_nots_or_d,  prefix ## pan_nots_or_d,  ~s | d) \
+    BLIT_OP(prefix ## blit_not_sandd,  prefix ## pan_not_sandd,  ~(s & d)) \
+    BLIT_OP(prefix ## blit_all_black,  prefix ## pan_all_black,  -1)
 
 
 /*
@@ -118,15 +258,21 @@ static void debug_out(const char *text1, int w, int old_w, int h, int src_x, int
  */
 
 #ifdef BOTH
+#define SHADOW 1
 
 static void s_blit_copy(PIXEL *src_addr, int src_line_add,
     PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
     short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
 #ifdef BOTH
     PIXEL_32 v32;
+#endif
+#endif
 
+#ifdef BOTH
 #define COPY_LOOP \
         __asm__ __volatile__( \
             MOVE_L "%[x],%[x4]\n" \
@@ -191,6 +337,11 @@ static void s_blit_copy(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP FORWARD_LOOP(=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -210,8 +361,11 @@ static void s_blit_or(PIXEL *src_addr, int src_line_add,
         PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
         short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
     PIXEL_32 v32;
+#endif
 
 #ifdef BOTH
 #define COPY_LOOP \
@@ -282,6 +436,11 @@ static void s_blit_or(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP FORWARD_LOOP(|=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -297,78 +456,20 @@ static void s_blit_or(PIXEL *src_addr, int src_line_add,
 }
 
 
-static void s_blit(PIXEL *src_addr, int src_line_add,
-     PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
-     short int w, short int h, short int operation)
-{
-    short int i, j;
-    PIXEL v, vs, vd;
-    PIXEL_32 v32, v32s, v32d;
-    PIXEL_32 *src_addr32;
-    PIXEL_32 *dst_addr32;
-#ifdef BOTH
-    PIXEL_32 *dst_addr_fast32;
-#endif
-
-    (void) dst_addr_fast;
-    /* Tell gcc that this cannot happen (already checked in c_blit_area() below) */
-    if (w <= 0 || h <= 0)
-        unreachable();
-    for (i = h - 1; i >= 0; i--)
-    {
-        if (w & 1)
-        {
-            vs = *src_addr++;
-#ifdef BOTH
-            vd = *dst_addr_fast;
-#else
-            vd = *dst_addr;
-#endif
-            DO_OP(v);
-#ifdef BOTH
-            *dst_addr_fast++ = v;
-#endif
-            *dst_addr++ = v;
-        }
-        src_addr32 = (PIXEL_32 *)src_addr;
-        dst_addr32 = (PIXEL_32 *)dst_addr;
-#ifdef BOTH
-        dst_addr_fast32 = (PIXEL_32 *)dst_addr_fast;
-#endif
-        for(j = (w >> 1) - 1; j >= 0; j--) {
-            v32s = *src_addr32++;
-#ifdef BOTH
-            v32d = *dst_addr_fast32;
-#else
-            v32d = *dst_addr32;
-#endif
-            DO_OP(v32);
-#ifdef BOTH
-            *dst_addr_fast32++ = v32;
-#endif
-            *dst_addr32++ = v32;
-        }
-        src_addr = (PIXEL *)src_addr32;
-        dst_addr = (PIXEL *)dst_addr32;
-        src_addr += src_line_add;
-        dst_addr += dst_line_add;
-#ifdef BOTH
-        dst_addr_fast = (PIXEL *)dst_addr_fast32;
-        dst_addr_fast += dst_line_add;
-#endif
-    }
-}
-
-
 static void
 s_pan_backwards_copy(PIXEL *src_addr, int src_line_add,
                      PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
                      short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
 #ifdef BOTH
     PIXEL_32 v32;
+#endif
+#endif
 
+#ifdef BOTH
 #define COPY_LOOP \
         __asm__ __volatile__( \
             MOVE_L "%[x],%[x4]\n" \
@@ -433,6 +534,11 @@ s_pan_backwards_copy(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP BACKWARD_LOOP(=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -453,8 +559,11 @@ s_pan_backwards_or(PIXEL *src_addr, int src_line_add,
                    PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
                    short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
     PIXEL_32 v32;
+#endif
 
 #ifdef BOTH
 #define COPY_LOOP \
@@ -525,6 +634,11 @@ s_pan_backwards_or(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP BACKWARD_LOOP(|=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -540,73 +654,13 @@ s_pan_backwards_or(PIXEL *src_addr, int src_line_add,
 }
 
 
-static void
-s_pan_backwards(PIXEL *src_addr, int src_line_add,
-                PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
-                short int w, short int h, short int operation)
-{
-    short int i, j;
-    PIXEL v, vs, vd;
-    PIXEL_32 v32, v32s, v32d;
-    PIXEL_32 *src_addr32;
-    PIXEL_32 *dst_addr32;
-#ifdef BOTH
-    PIXEL_32 *dst_addr_fast32;
-#endif
-    
-    (void) dst_addr_fast;
-    /* Tell gcc that this cannot happen (already checked in c_blit_area() below) */
-    if (w <= 0 || h <= 0)
-        unreachable();
-    for (i = h - 1; i >= 0; i--)
-    {
-        if (w & 1)
-        {
-            vs = *--src_addr;
-#ifdef BOTH
-            vd = *--dst_addr_fast;
-#else
-            vd = *--dst_addr;
-#endif
-            DO_OP(v);
-#ifdef BOTH
-            *dst_addr_fast = v;
-#endif
-            *dst_addr = v;
-        }
-        src_addr32 = (PIXEL_32 *)src_addr;
-        dst_addr32 = (PIXEL_32 *)dst_addr;
-#ifdef BOTH
-        dst_addr_fast32 = (PIXEL_32 *)dst_addr_fast;
-#endif
-        for (j = (w >> 1) - 1; j >= 0; j--)
-        {
-            v32s = *--src_addr;
-#ifdef BOTH
-            v32d = *--dst_addr_fast32;
-#else
-            v32d = *--dst_addr32;
-#endif
-            DO_OP(v32);
-#ifdef BOTH
-            *dst_addr_fast32 = v32;
-#endif
-            *dst_addr32 = v32;
-        }
-        src_addr = (PIXEL *)src_addr32;
-        dst_addr = (PIXEL *)dst_addr32;
-        src_addr += src_line_add;
-        dst_addr += dst_line_add;
-#ifdef BOTH
-        dst_addr_fast = (PIXEL *)dst_addr_fast32;
-        dst_addr_fast += dst_line_add;
-#endif
-    }
-}
+BLIT_OPS(s_)
 
 #define BOTH_WAS_ON
 #endif
 #undef BOTH
+#undef SHADOW
+#define SHADOW 0
 
 /*
  * The functions below are exact copies of those above.
@@ -618,10 +672,15 @@ static void blit_copy(PIXEL *src_addr, int src_line_add,
     PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
     short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
 #ifdef BOTH
     PIXEL_32 v32;
+#endif
+#endif
 
+#ifdef BOTH
 #define COPY_LOOP \
         __asm__ __volatile__( \
             MOVE_L "%[x],%[x4]\n" \
@@ -686,6 +745,11 @@ static void blit_copy(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP FORWARD_LOOP(=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -705,8 +769,11 @@ static void blit_or(PIXEL *src_addr, int src_line_add,
         PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
         short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
     PIXEL_32 v32;
+#endif
 
 #ifdef BOTH
 #define COPY_LOOP \
@@ -777,6 +844,11 @@ static void blit_or(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP FORWARD_LOOP(|=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -792,78 +864,20 @@ static void blit_or(PIXEL *src_addr, int src_line_add,
 }
 
 
-static void blit_16b(PIXEL *src_addr, int src_line_add,
-     PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
-     short int w, short int h, short int operation)
-{
-    short int i, j;
-    PIXEL v, vs, vd;
-    PIXEL_32 v32, v32s, v32d;
-    PIXEL_32 *src_addr32;
-    PIXEL_32 *dst_addr32;
-#ifdef BOTH
-    PIXEL_32 *dst_addr_fast32;
-#endif
-
-    (void) dst_addr_fast;
-    /* Tell gcc that this cannot happen (already checked in c_blit_area() below) */
-    if (w <= 0 || h <= 0)
-        unreachable();
-    for (i = h - 1; i >= 0; i--)
-    {
-        if (w & 1)
-        {
-            vs = *src_addr++;
-#ifdef BOTH
-            vd = *dst_addr_fast;
-#else
-            vd = *dst_addr;
-#endif
-            DO_OP(v);
-#ifdef BOTH
-            *dst_addr_fast++ = v;
-#endif
-            *dst_addr++ = v;
-        }
-        src_addr32 = (PIXEL_32 *)src_addr;
-        dst_addr32 = (PIXEL_32 *)dst_addr;
-#ifdef BOTH
-        dst_addr_fast32 = (PIXEL_32 *)dst_addr_fast;
-#endif
-        for(j = (w >> 1) - 1; j >= 0; j--) {
-            v32s = *src_addr32++;
-#ifdef BOTH
-            v32d = *dst_addr_fast32;
-#else
-            v32d = *dst_addr32;
-#endif
-            DO_OP(v32);
-#ifdef BOTH
-            *dst_addr_fast32++ = v32;
-#endif
-            *dst_addr32++ = v32;
-        }
-        src_addr = (PIXEL *)src_addr32;
-        dst_addr = (PIXEL *)dst_addr32;
-        src_addr += src_line_add;
-        dst_addr += dst_line_add;
-#ifdef BOTH
-        dst_addr_fast = (PIXEL *)dst_addr_fast32;
-        dst_addr_fast += dst_line_add;
-#endif
-    }
-}
-
-
 static void
 pan_backwards_copy(PIXEL *src_addr, int src_line_add,
                    PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
                    short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
 #ifdef BOTH
     PIXEL_32 v32;
+#endif
+#endif
 
+#ifdef BOTH
 #define COPY_LOOP \
         __asm__ __volatile__( \
             MOVE_L "%[x],%[x4]\n" \
@@ -928,6 +942,11 @@ pan_backwards_copy(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP BACKWARD_LOOP(=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -948,8 +967,11 @@ pan_backwards_or(PIXEL *src_addr, int src_line_add,
                  PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
                  short int w, short int h)
 {
-    REGL x, y, x4, xR;
+    REGL x, y;
+#ifdef ASM_LOOPS
+    REGL x4, xR;
     PIXEL_32 v32;
+#endif
 
 #ifdef BOTH
 #define COPY_LOOP \
@@ -1020,6 +1042,11 @@ pan_backwards_or(PIXEL *src_addr, int src_line_add,
         dst_addr += dst_line_add
 #endif
 
+#ifndef ASM_LOOPS
+#undef COPY_LOOP
+#define COPY_LOOP BACKWARD_LOOP(|=)
+#endif
+
     (void) dst_addr_fast;
 
     x = w;
@@ -1035,77 +1062,48 @@ pan_backwards_or(PIXEL *src_addr, int src_line_add,
 }
 
 
-static void
-pan_backwards(PIXEL *src_addr, int src_line_add,
-              PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
-              short int w, short int h, short int operation)
-{
-    short int i, j;
-    PIXEL v, vs, vd;
-    PIXEL_32 v32, v32s, v32d;
-    PIXEL_32 *src_addr32;
-    PIXEL_32 *dst_addr32;
-#ifdef BOTH
-    PIXEL_32 *dst_addr_fast32;
-#endif
-    
-    (void) dst_addr_fast;
-    /* Tell gcc that this cannot happen (already checked in c_blit_area() below) */
-    if (w <= 0 || h <= 0)
-        unreachable();
-    for (i = h - 1; i >= 0; i--)
-    {
-        if (w & 1)
-        {
-            vs = *--src_addr;
-#ifdef BOTH
-            vd = *--dst_addr_fast;
-#else
-            vd = *--dst_addr;
-#endif
-            DO_OP(v);
-#ifdef BOTH
-            *dst_addr_fast = v;
-#endif
-            *dst_addr = v;
-        }
-        src_addr32 = (PIXEL_32 *)src_addr;
-        dst_addr32 = (PIXEL_32 *)dst_addr;
-#ifdef BOTH
-        dst_addr_fast32 = (PIXEL_32 *)dst_addr_fast;
-#endif
-        for (j = (w >> 1) - 1; j >= 0; j--)
-        {
-            v32s = *--src_addr;
-#ifdef BOTH
-            v32d = *--dst_addr_fast32;
-#else
-            v32d = *--dst_addr32;
-#endif
-            DO_OP(v32);
-#ifdef BOTH
-            *dst_addr_fast32 = v32;
-#endif
-            *dst_addr32 = v32;
-        }
-        src_addr = (PIXEL *)src_addr32;
-        dst_addr = (PIXEL *)dst_addr32;
-        src_addr += src_line_add;
-        dst_addr += dst_line_add;
-#ifdef BOTH
-        dst_addr_fast = (PIXEL *)dst_addr_fast32;
-        dst_addr_fast += dst_line_add;
-#endif
-    }
-}
+BLIT_OPS()
 
 
+typedef void (*Blit)(PIXEL *src_addr, int src_line_add,
+                     PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add,
+                     short int w, short int h);
+
+static Blit blits[] = {
+    blit_all_white, blit_s_and_d, blit_s_and_notd, blit_copy,
+    blit_nots_and_d, 0, blit_s_xor_d, blit_or,
+    blit_not_sord, blit_not_sxord, blit_d_invert, blit_s_or_notd,
+    blit_not_s, blit_nots_or_d, blit_not_sandd, blit_all_black
+};
+
+static Blit pans[] = {
+    pan_all_white, pan_s_and_d, pan_s_and_notd, pan_backwards_copy,
+    pan_nots_and_d, 0, pan_s_xor_d, pan_backwards_or,
+    pan_not_sord, pan_not_sxord, pan_d_invert, pan_s_or_notd,
+    pan_not_s, pan_nots_or_d, pan_not_sandd, pan_all_black
+};
+
 #ifdef BOTH_WAS_ON
-#define BOTH
+static Blit s_blits[] = {
+    s_blit_all_white, s_blit_s_and_d, s_blit_s_and_notd, s_blit_copy,
+    s_blit_nots_and_d, 0, s_blit_s_xor_d, s_blit_or,
+    s_blit_not_sord, s_blit_not_sxord, s_blit_d_invert, s_blit_s_or_notd,
+    s_blit_not_s, s_blit_nots_or_d, s_blit_not_sandd, s_blit_all_black
+};
+
+static Blit s_pans[] = {
+    s_pan_all_white, s_pan_s_and_d, s_pan_s_and_notd, s_pan_backwards_copy,
+    s_pan_nots_and_d, 0, s_pan_s_xor_d, s_pan_backwards_or,
+    s_pan_not_sord, s_pan_not_sxord, s_pan_d_invert, s_pan_s_or_notd,
+    s_pan_not_s, s_pan_nots_or_d, s_pan_not_sandd, s_pan_all_black
+};
 #endif
 
-#undef DO_OP
+#undef SHADOW
 
+#ifdef BOTH_WAS_ON
+#define BOTH
+#endif
 
 long CDECL
 c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
@@ -1118,19 +1116,27 @@ c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
     int src_line_add, dst_line_add;
     unsigned long src_pos, dst_pos;
     int to_screen;
+    Blit *blit, *pan;
 
     if (w <= 0 || h <= 0)
         return 1;
 
+    if ((operation < 0) || (operation > 15) || (operation == 5))
+        return 1;       /* Unknown, or D which changes nothing */
+
     wk = vwk->real_address;
 
     if (!src || !src->address || (src->address == wk->screen.mfdb.address)) {       /* From screen? */
         src_wrap = wk->screen.wrap;
-        if (!(src_addr = wk->screen.shadow.address))
-            src_addr = wk->screen.mfdb.address;
+        if (!(src_addr = wk->screen.shadow.address)) {
+            src_addr = (PIXEL *)wk->screen.mfdb.address;
+#ifdef FAST
+            mouse_keep_out(wk, src_x, src_y, src_x + w - 1, src_y + h - 1);
+#endif
+        }
     } else {
         src_wrap = (long)src->wdwidth * 2 * src->bitplanes;
-        src_addr = src->address;
+        src_addr = (PIXEL *)src->address;
     }
     src_pos = (short)src_y * (long)src_wrap + src_x * PIXEL_SIZE;
     src_line_add = src_wrap - w * PIXEL_SIZE;
@@ -1138,11 +1144,14 @@ c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
     to_screen = 0;
     if (!dst || !dst->address || (dst->address == wk->screen.mfdb.address)) {       /* To screen? */
         dst_wrap = wk->screen.wrap;
-        dst_addr = wk->screen.mfdb.address;
+        dst_addr = (PIXEL *)wk->screen.mfdb.address;
         to_screen = 1;
+#ifdef FAST
+        mouse_keep_out(wk, dst_x, dst_y, dst_x + w - 1, dst_y + h - 1);
+#endif
     } else {
         dst_wrap = (long)dst->wdwidth * 2 * dst->bitplanes;
-        dst_addr = dst->address;
+        dst_addr = (PIXEL *)dst->address;
     }
     dst_pos = (short)dst_y * (long)dst_wrap + dst_x * PIXEL_SIZE;
     dst_line_add = dst_wrap - w * PIXEL_SIZE;
@@ -1167,75 +1176,34 @@ c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
     }
 #endif
 
+    blit = blits;
+    pan = pans;
 #ifdef BOTH
-    if (!to_screen || !dst_addr_fast) {
-#endif
-        if ((src_y == dst_y) && (src_x < dst_x)) {
-            src_addr += w;		/* To take backward copy into account */
-            dst_addr += w;
-            src_line_add += 2 * w;
-            dst_line_add += 2 * w;
-            switch(operation) {
-            case 3:
-                pan_backwards_copy(src_addr, src_line_add, dst_addr, 0, dst_line_add, w, h);
-                break;
-            case 7:
-                pan_backwards_or(src_addr, src_line_add, dst_addr, 0, dst_line_add, w, h);
-                break;
-            default:
-                pan_backwards(src_addr, src_line_add, dst_addr, 0, dst_line_add, w, h, operation);
-                break;
-            }
-        } else {
-            switch(operation) {
-            case 3:
-                blit_copy(src_addr, src_line_add, dst_addr, 0, dst_line_add, w, h);
-                break;
-            case 7:
-                blit_or(src_addr, src_line_add, dst_addr, 0, dst_line_add, w, h);
-                break;
-            default:
-                blit_16b(src_addr, src_line_add, dst_addr, 0, dst_line_add, w, h, operation);
-                break;
-            }
-        }
-#ifdef BOTH
-    } else {
+    if (to_screen && dst_addr_fast) {
         dst_addr_fast += dst_pos / PIXEL_SIZE;
-        if ((src_y == dst_y) && (src_x < dst_x)) {
-            src_addr += w;      /* To take backward copy into account */
-            dst_addr += w;
-            dst_addr_fast += w;
-            src_line_add += 2 * w;
-            dst_line_add += 2 * w;
-            switch(operation) {
-            case 3:
-                s_pan_backwards_copy(src_addr, src_line_add, dst_addr, dst_addr_fast, dst_line_add, w, h);
-                break;
-            case 7:
-                s_pan_backwards_or(src_addr, src_line_add, dst_addr, dst_addr_fast, dst_line_add, w, h);
-                break;
-            default:
-                s_pan_backwards(src_addr, src_line_add, dst_addr, dst_addr_fast, dst_line_add, w, h, operation);
-                break;
-            }
-        } else {
-            switch(operation) {
-            case 3:
-                s_blit_copy(src_addr, src_line_add, dst_addr, dst_addr_fast, dst_line_add, w, h);
-                break;
-            case 7:
-                s_blit_or(src_addr, src_line_add, dst_addr, dst_addr_fast, dst_line_add, w, h);
-                break;
-            default:
-                s_blit(src_addr, src_line_add, dst_addr, dst_addr_fast, dst_line_add, w, h, operation);
-                break;
-            }
-        }
-    }
+        blit = s_blits;
+        pan = s_pans;
+    } else
+        dst_addr_fast = 0;
 #else
     (void) to_screen;
-    (void) dst_addr_fast;
+    dst_addr_fast = 0;
+#endif
+
+    if ((src_y == dst_y) && (src_x < dst_x)) {
+        src_addr += w;		/* To take backward copy into account */
+        dst_addr += w;
+        if (dst_addr_fast)
+            dst_addr_fast += w;
+        src_line_add += 2 * w;
+        dst_line_add += 2 * w;
+        blit = pan;
+    }
+    blit[operation](src_addr, src_line_add, dst_addr, dst_addr_fast, dst_line_add, w, h);
+
+#ifdef FAST
+    if (to_screen)
+        dirty_mark(dst_x, dst_y, dst_x + w - 1, dst_y + h - 1);
 #endif
 
     return 1;   /* Return as completed */
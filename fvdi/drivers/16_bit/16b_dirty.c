@@ -0,0 +1,129 @@
+/*
+ * 16 bit write-back shadow, dirty area tracking
+ *
+ * With the 'writeback' option, the drawing routines only ever
+ * touch the FastRAM shadow, which then is what the rest of fVDI
+ * sees as the screen. What has been changed is remembered as a
+ * bitmap of screen tiles (see ../common/dirty.c), and those tiles
+ * are copied out to the real screen from the VBL queue (or on
+ * v_updwk).
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+#include "driver.h"
+#include "../bitplane/bitplane.h"
+
+#include "16b_pixel.h"
+
+#ifdef FAST
+
+#define DIRTY_PIXEL PIXEL
+
+static PIXEL *mouse_saved_area(Workstation *wk, short *x, short *y, short *w, short *h, unsigned short **drawn);   /* 16b_mouse.c */
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2);                                    /* 16b_mouse.c */
+
+#include "../common/dirty.c"
+
+/* The mouse pointer background, while flushing */
+static PIXEL *flush_saved;
+static unsigned short *flush_drawn;
+static short flush_mx, flush_my, flush_mw, flush_mh;
+
+
+/*
+ * Long word copy where possible, for the benefit of the bus.
+ */
+static void copy_pixels(PIXEL *dst, PIXEL *src, int n)
+{
+    unsigned PIXEL_32 *dst_l, *src_l;
+    int i;
+
+    for(; (n > 0) && ((long)dst & 3); n--)
+        *dst++ = *src++;
+    if (n <= 0)
+        return;
+
+    dst_l = (unsigned PIXEL_32 *)dst;
+    src_l = (unsigned PIXEL_32 *)src;
+    for(i = n / (4 * PIXEL_PER_LONG); i > 0; i--) {
+        *dst_l++ = *src_l++;
+        *dst_l++ = *src_l++;
+        *dst_l++ = *src_l++;
+        *dst_l++ = *src_l++;
+    }
+    for(i = (n / PIXEL_PER_LONG) & 3; i > 0; i--)
+        *dst_l++ = *src_l++;
+
+    dst = (PIXEL *)dst_l;
+    src = (PIXEL *)src_l;
+    for(i = n & (PIXEL_PER_LONG - 1); i > 0; i--)
+        *dst++ = *src++;
+}
+
+
+/*
+ * Copy a run of dirty tiles to the real screen.
+ * Pixels within the mouse pointer area also go to its
+ * background save buffer, and those the pointer covers
+ * only there.
+ */
+static void dirty_copy(short x1, short y1, short x2, short y2)
+{
+    PIXEL *shadow, *saved, *src, *dst;
+    unsigned short *drawn, mask;
+    int wrap;
+    short y, n, e, i;
+    short mx, my, mw, mh;
+
+    shadow = dirty_wk->screen.mfdb.address;
+    wrap = dirty_wk->screen.wrap / PIXEL_SIZE;
+    saved = flush_saved;
+    drawn = flush_drawn;
+    mx = flush_mx;
+    my = flush_my;
+    mw = flush_mw;
+    mh = flush_mh;
+
+    for(y = y1; y < y2; y++) {
+        src = shadow + (long)y * wrap + x1;
+        dst = dirty_video + (long)y * wrap + x1;
+        if (!saved || (y < my) || (y >= my + mh) || (x2 <= mx) || (x1 >= mx + mw)) {
+            copy_pixels(dst, src, x2 - x1);
+            continue;
+        }
+        n = x1;
+        if (mx > x1) {
+            copy_pixels(dst, src, mx - x1);
+            n = mx;
+        }
+        e = x2 < mx + mw ? x2 : mx + mw;
+        copy_pixels(saved + (y - my) * mw + (n - mx), src + (n - x1), e - n);
+        mask = drawn[y - my] << (n - mx);
+        for(i = n - x1; i < e - x1; i++) {
+            if (!(mask & 0x8000))
+                dst[i] = src[i];
+            mask <<= 1;
+        }
+        if (x2 > mx + mw)
+            copy_pixels(dst + (mx + mw - x1), src + (mx + mw - x1), x2 - (mx + mw));
+    }
+}
+
+
+/*
+ * Copy all dirty tiles to the real screen,
+ * minding where the mouse pointer is.
+ */
+static void dirty_flush(void)
+{
+    flush_mx = flush_my = flush_mw = flush_mh = 0;
+    flush_drawn = 0;
+    flush_saved = mouse_saved_area(dirty_wk, &flush_mx, &flush_my, &flush_mw, &flush_mh, &flush_drawn);
+
+    dirty_tiles();
+}
+
+#endif
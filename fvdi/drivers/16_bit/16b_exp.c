@@ -15,8 +15,7 @@
 #include "driver.h"
 #include "../bitplane/bitplane.h"
 
-#define PIXEL		short
-#define PIXEL_SIZE	sizeof(PIXEL)
+#include "16b_pixel.h"
 
 
 /*
@@ -29,35 +28,147 @@
  * - some compilers can't deal well with *var++ constructs
  */
 
+/*
+ * The source is expanded four bits at a time.
+ * Its bits are kept left aligned in the 32 bit 'bits',
+ * with 'count' of them still valid, and new source words
+ * are only read when needed.
+ */
+#define FETCH_BITS(n) \
+    if (count < (n)) { \
+        bits |= (unsigned PIXEL_32)*src++ << (16 - count); \
+        count += 16; \
+    }
+
+/*
+ * Four pixels at a time as long words,
+ * to an aligned destination.
+ */
+#define NIBBLE_LONGS    PIXEL_SIZE
+
+#if DEPTH == 8
+#define NIBBLE_COPY(dst, src) \
+    ((unsigned PIXEL_32 *)(dst))[0] = (src)[0]
+#define NIBBLE_FILL(dst, v) \
+    ((unsigned PIXEL_32 *)(dst))[0] = (v)
+#elif DEPTH == 16
+#define NIBBLE_COPY(dst, src) \
+    ((unsigned PIXEL_32 *)(dst))[0] = (src)[0]; \
+    ((unsigned PIXEL_32 *)(dst))[1] = (src)[1]
+#define NIBBLE_FILL(dst, v) \
+    ((unsigned PIXEL_32 *)(dst))[0] = (v); \
+    ((unsigned PIXEL_32 *)(dst))[1] = (v)
+#else
+#define NIBBLE_COPY(dst, src) \
+    ((unsigned PIXEL_32 *)(dst))[0] = (src)[0]; \
+    ((unsigned PIXEL_32 *)(dst))[1] = (src)[1]; \
+    ((unsigned PIXEL_32 *)(dst))[2] = (src)[2]; \
+    ((unsigned PIXEL_32 *)(dst))[3] = (src)[3]
+#define NIBBLE_FILL(dst, v) \
+    ((unsigned PIXEL_32 *)(dst))[0] = (v); \
+    ((unsigned PIXEL_32 *)(dst))[1] = (v); \
+    ((unsigned PIXEL_32 *)(dst))[2] = (v); \
+    ((unsigned PIXEL_32 *)(dst))[3] = (v)
+#endif
+
+static unsigned PIXEL_32 expand_nibbles[16 * NIBBLE_LONGS];
+static PIXEL expand_foreground;
+static PIXEL expand_background;
+static short expand_valid = 0;
+
+
+/*
+ * Four pre-coloured pixels (as long words) for each nibble,
+ * rebuilt only when the colours change.
+ */
+static unsigned PIXEL_32 *expand_table(PIXEL foreground, PIXEL background)
+{
+    PIXEL *pixels;
+    int i;
+
+    if (!expand_valid || (foreground != expand_foreground) || (background != expand_background)) {
+        pixels = (PIXEL *)expand_nibbles;
+        for(i = 0; i < 16; i++) {
+            *pixels++ = (i & 8) ? foreground : background;
+            *pixels++ = (i & 4) ? foreground : background;
+            *pixels++ = (i & 2) ? foreground : background;
+            *pixels++ = (i & 1) ? foreground : background;
+        }
+        expand_foreground = foreground;
+        expand_background = background;
+        expand_valid = 1;
+    }
+
+    return expand_nibbles;
+}
+
+
 #ifdef BOTH
 static void s_replace(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 *table;
+    PIXEL v;
 
-    x = 1 << (15 - (x & 0x000f));
+    (void) dst_addr_fast;
+    table = expand_table(foreground, background);
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (expand_word & mask) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            v = (bits & 0x80000000UL) ? foreground : background;
 #ifdef BOTH
-                *dst_addr_fast++ = foreground;
+            *dst_addr_fast = v;
 #endif
-                *dst_addr++ = foreground;
-            } else {
+            *dst_addr = v;
+            dst_addr++;
 #ifdef BOTH
-                *dst_addr_fast++ = background;
+            dst_addr_fast++;
 #endif
-                *dst_addr++ = background;
-            }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
-            }
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = ((bits >> 28) & 0x0f) * NIBBLE_LONGS;   /* Table index for the top four bits */
+#ifdef BOTH
+            NIBBLE_COPY(dst_addr_fast, &table[n]);
+#endif
+            NIBBLE_COPY(dst_addr, &table[n]);
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            v = (bits & 0x80000000UL) ? foreground : background;
+#ifdef BOTH
+            *dst_addr_fast = v;
+#endif
+            *dst_addr = v;
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
+        }
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -67,33 +178,98 @@ static void s_replace(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL
 
 static void s_transparent(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 solid;
 
+    (void) dst_addr_fast;
     (void) background;
-    x = 1 << (15 - (x & 0x000f));
+    solid = PIXEL_LONG(foreground);
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (expand_word & mask) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
 #ifdef BOTH
-                *dst_addr_fast++ = foreground;
+                *dst_addr_fast = foreground;
 #endif
-                *dst_addr++ = foreground;
-            } else {
+                *dst_addr = foreground;
+            }
+            dst_addr++;
 #ifdef BOTH
-                dst_addr_fast++;
+            dst_addr_fast++;
 #endif
-                dst_addr++;
+            bits <<= 1;
+            count--;
+        }
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = ((bits >> 28) & 0x0f);
+            if (n == 0x0f) {
+#ifdef BOTH
+                NIBBLE_FILL(dst_addr_fast, solid);
+#endif
+                NIBBLE_FILL(dst_addr, solid);
+            } else if (n) {
+                if (n & 8) {
+#ifdef BOTH
+                    dst_addr_fast[0] = foreground;
+#endif
+                    dst_addr[0] = foreground;
+                }
+                if (n & 4) {
+#ifdef BOTH
+                    dst_addr_fast[1] = foreground;
+#endif
+                    dst_addr[1] = foreground;
+                }
+                if (n & 2) {
+#ifdef BOTH
+                    dst_addr_fast[2] = foreground;
+#endif
+                    dst_addr[2] = foreground;
+                }
+                if (n & 1) {
+#ifdef BOTH
+                    dst_addr_fast[3] = foreground;
+#endif
+                    dst_addr[3] = foreground;
+                }
             }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
+#ifdef BOTH
+                *dst_addr_fast = foreground;
+#endif
+                *dst_addr = foreground;
             }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -103,39 +279,125 @@ static void s_transparent(short *src_addr, int src_line_add, PIXEL *dst_addr, PI
 
 static void s_xor(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j, v;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words, k;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 v_l, *src_l;
+    PIXEL v;
 
+    (void) dst_addr_fast;
     (void) foreground;
     (void) background;
-    x = 1 << (15 - (x & 0x000f));
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (expand_word & mask) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
 #ifdef BOTH
                 v = ~*dst_addr_fast;
+                *dst_addr_fast = v;
 #else
                 v = ~*dst_addr;
 #endif
+                *dst_addr = v;
+            }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
+        }
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = (bits >> 28) & 0x0f;
+            if (n == 0x0f) {
+#ifdef BOTH
+                src_l = (unsigned PIXEL_32 *)dst_addr_fast;
+#else
+                src_l = (unsigned PIXEL_32 *)dst_addr;
+#endif
+                for(k = 0; k < NIBBLE_LONGS; k++) {
+                    v_l = ~src_l[k];
 #ifdef BOTH
-                *dst_addr_fast++ = v;
+                    ((unsigned PIXEL_32 *)dst_addr_fast)[k] = v_l;
 #endif
-                *dst_addr++ = v;
-            } else {
+                    ((unsigned PIXEL_32 *)dst_addr)[k] = v_l;
+                }
+            } else if (n) {
+                if (n & 8) {
 #ifdef BOTH
-                dst_addr_fast++;
+                    v = ~dst_addr_fast[0];
+                    dst_addr_fast[0] = v;
+#else
+                    v = ~dst_addr[0];
 #endif
-                dst_addr++;
+                    dst_addr[0] = v;
+                }
+                if (n & 4) {
+#ifdef BOTH
+                    v = ~dst_addr_fast[1];
+                    dst_addr_fast[1] = v;
+#else
+                    v = ~dst_addr[1];
+#endif
+                    dst_addr[1] = v;
+                }
+                if (n & 2) {
+#ifdef BOTH
+                    v = ~dst_addr_fast[2];
+                    dst_addr_fast[2] = v;
+#else
+                    v = ~dst_addr[2];
+#endif
+                    dst_addr[2] = v;
+                }
+                if (n & 1) {
+#ifdef BOTH
+                    v = ~dst_addr_fast[3];
+                    dst_addr_fast[3] = v;
+#else
+                    v = ~dst_addr[3];
+#endif
+                    dst_addr[3] = v;
+                }
             }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
+#ifdef BOTH
+                v = ~*dst_addr_fast;
+                *dst_addr_fast = v;
+#else
+                v = ~*dst_addr;
+#endif
+                *dst_addr = v;
             }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -145,33 +407,98 @@ static void s_xor(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst
 
 static void s_revtransp(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 solid;
 
+    (void) dst_addr_fast;
     (void) background;
-    x = 1 << (15 - (x & 0x000f));
+    solid = PIXEL_LONG(foreground);
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (!(expand_word & mask)) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            if (!(bits & 0x80000000UL)) {
+#ifdef BOTH
+                *dst_addr_fast = foreground;
+#endif
+                *dst_addr = foreground;
+            }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
+        }
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = ((bits >> 28) & 0x0f) ^ 0x0f;
+            if (n == 0x0f) {
+#ifdef BOTH
+                NIBBLE_FILL(dst_addr_fast, solid);
+#endif
+                NIBBLE_FILL(dst_addr, solid);
+            } else if (n) {
+                if (n & 8) {
+#ifdef BOTH
+                    dst_addr_fast[0] = foreground;
+#endif
+                    dst_addr[0] = foreground;
+                }
+                if (n & 4) {
 #ifdef BOTH
-                *dst_addr_fast++ = foreground;
+                    dst_addr_fast[1] = foreground;
 #endif
-                *dst_addr++ = foreground;
-            } else {
+                    dst_addr[1] = foreground;
+                }
+                if (n & 2) {
 #ifdef BOTH
-                dst_addr_fast++;
+                    dst_addr_fast[2] = foreground;
 #endif
-                dst_addr++;
+                    dst_addr[2] = foreground;
+                }
+                if (n & 1) {
+#ifdef BOTH
+                    dst_addr_fast[3] = foreground;
+#endif
+                    dst_addr[3] = foreground;
+                }
             }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            if (!(bits & 0x80000000UL)) {
+#ifdef BOTH
+                *dst_addr_fast = foreground;
+#endif
+                *dst_addr = foreground;
             }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -191,33 +518,69 @@ static void s_revtransp(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXE
 
 static void replace(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 *table;
+    PIXEL v;
 
     (void) dst_addr_fast;
-    x = 1 << (15 - (x & 0x000f));
+    table = expand_table(foreground, background);
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (expand_word & mask) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            v = (bits & 0x80000000UL) ? foreground : background;
 #ifdef BOTH
-                *dst_addr_fast++ = foreground;
+            *dst_addr_fast = v;
 #endif
-                *dst_addr++ = foreground;
-            } else {
+            *dst_addr = v;
+            dst_addr++;
 #ifdef BOTH
-                *dst_addr_fast++ = background;
+            dst_addr_fast++;
 #endif
-                *dst_addr++ = background;
-            }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
-            }
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = ((bits >> 28) & 0x0f) * NIBBLE_LONGS;   /* Table index for the top four bits */
+#ifdef BOTH
+            NIBBLE_COPY(dst_addr_fast, &table[n]);
+#endif
+            NIBBLE_COPY(dst_addr, &table[n]);
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            v = (bits & 0x80000000UL) ? foreground : background;
+#ifdef BOTH
+            *dst_addr_fast = v;
+#endif
+            *dst_addr = v;
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
+        }
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -227,34 +590,98 @@ static void replace(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *d
 
 static void transparent(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 solid;
 
     (void) dst_addr_fast;
     (void) background;
-    x = 1 << (15 - (x & 0x000f));
+    solid = PIXEL_LONG(foreground);
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (expand_word & mask) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
 #ifdef BOTH
-                *dst_addr_fast++ = foreground;
+                *dst_addr_fast = foreground;
 #endif
-                *dst_addr++ = foreground;
-            } else {
+                *dst_addr = foreground;
+            }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
+        }
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = ((bits >> 28) & 0x0f);
+            if (n == 0x0f) {
+#ifdef BOTH
+                NIBBLE_FILL(dst_addr_fast, solid);
+#endif
+                NIBBLE_FILL(dst_addr, solid);
+            } else if (n) {
+                if (n & 8) {
+#ifdef BOTH
+                    dst_addr_fast[0] = foreground;
+#endif
+                    dst_addr[0] = foreground;
+                }
+                if (n & 4) {
+#ifdef BOTH
+                    dst_addr_fast[1] = foreground;
+#endif
+                    dst_addr[1] = foreground;
+                }
+                if (n & 2) {
+#ifdef BOTH
+                    dst_addr_fast[2] = foreground;
+#endif
+                    dst_addr[2] = foreground;
+                }
+                if (n & 1) {
 #ifdef BOTH
-                dst_addr_fast++;
+                    dst_addr_fast[3] = foreground;
 #endif
-                dst_addr++;
+                    dst_addr[3] = foreground;
+                }
             }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
+#ifdef BOTH
+                *dst_addr_fast = foreground;
+#endif
+                *dst_addr = foreground;
             }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -264,40 +691,125 @@ static void transparent(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXE
 
 static void xor(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j, v;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words, k;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 v_l, *src_l;
+    PIXEL v;
 
     (void) dst_addr_fast;
     (void) foreground;
     (void) background;
-    x = 1 << (15 - (x & 0x000f));
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (expand_word & mask) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
 #ifdef BOTH
                 v = ~*dst_addr_fast;
+                *dst_addr_fast = v;
 #else
                 v = ~*dst_addr;
 #endif
+                *dst_addr = v;
+            }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
+        }
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = (bits >> 28) & 0x0f;
+            if (n == 0x0f) {
+#ifdef BOTH
+                src_l = (unsigned PIXEL_32 *)dst_addr_fast;
+#else
+                src_l = (unsigned PIXEL_32 *)dst_addr;
+#endif
+                for(k = 0; k < NIBBLE_LONGS; k++) {
+                    v_l = ~src_l[k];
+#ifdef BOTH
+                    ((unsigned PIXEL_32 *)dst_addr_fast)[k] = v_l;
+#endif
+                    ((unsigned PIXEL_32 *)dst_addr)[k] = v_l;
+                }
+            } else if (n) {
+                if (n & 8) {
+#ifdef BOTH
+                    v = ~dst_addr_fast[0];
+                    dst_addr_fast[0] = v;
+#else
+                    v = ~dst_addr[0];
+#endif
+                    dst_addr[0] = v;
+                }
+                if (n & 4) {
+#ifdef BOTH
+                    v = ~dst_addr_fast[1];
+                    dst_addr_fast[1] = v;
+#else
+                    v = ~dst_addr[1];
+#endif
+                    dst_addr[1] = v;
+                }
+                if (n & 2) {
 #ifdef BOTH
-                *dst_addr_fast++ = v;
+                    v = ~dst_addr_fast[2];
+                    dst_addr_fast[2] = v;
+#else
+                    v = ~dst_addr[2];
 #endif
-                *dst_addr++ = v;
-            } else {
+                    dst_addr[2] = v;
+                }
+                if (n & 1) {
 #ifdef BOTH
-                dst_addr_fast++;
+                    v = ~dst_addr_fast[3];
+                    dst_addr_fast[3] = v;
+#else
+                    v = ~dst_addr[3];
 #endif
-                dst_addr++;
+                    dst_addr[3] = v;
+                }
             }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            if (bits & 0x80000000UL) {
+#ifdef BOTH
+                v = ~*dst_addr_fast;
+                *dst_addr_fast = v;
+#else
+                v = ~*dst_addr;
+#endif
+                *dst_addr = v;
             }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -307,34 +819,98 @@ static void xor(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_a
 
 static void revtransp(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL *dst_addr_fast, int dst_line_add, int x, int w, int h, PIXEL foreground, PIXEL background)
 {
-    int i, j;
-    unsigned int expand_word, mask;
+    int i, j, n, count, words;
+    unsigned PIXEL_32 bits;
+    unsigned short *src;
+    unsigned PIXEL_32 solid;
 
     (void) dst_addr_fast;
     (void) background;
-    x = 1 << (15 - (x & 0x000f));
+    solid = PIXEL_LONG(foreground);
+    x &= 0x000f;
+    words = ((x + w) >> 4) + 1;     /* Source words touched per line */
 
     for(i = h - 1; i >= 0; i--) {
-        expand_word = *src_addr++;
-        mask = x;
-        for(j = w - 1; j >= 0; j--) {
-            if (!(expand_word & mask)) {
+        src = (unsigned short *)src_addr;
+        bits = (unsigned PIXEL_32)*src++ << (16 + x);
+        count = 16 - x;
+        j = w;
+
+        for(; (j > 0) && ((long)dst_addr & 3); j--) {     /* Leading pixels, to get long aligned */
+            FETCH_BITS(1);
+            if (!(bits & 0x80000000UL)) {
 #ifdef BOTH
-                *dst_addr_fast++ = foreground;
+                *dst_addr_fast = foreground;
 #endif
-                *dst_addr++ = foreground;
-            } else {
+                *dst_addr = foreground;
+            }
+            dst_addr++;
 #ifdef BOTH
-                dst_addr_fast++;
+            dst_addr_fast++;
 #endif
-                dst_addr++;
+            bits <<= 1;
+            count--;
+        }
+
+        for(; j >= 4; j -= 4) {
+            FETCH_BITS(4);
+            n = ((bits >> 28) & 0x0f) ^ 0x0f;
+            if (n == 0x0f) {
+#ifdef BOTH
+                NIBBLE_FILL(dst_addr_fast, solid);
+#endif
+                NIBBLE_FILL(dst_addr, solid);
+            } else if (n) {
+                if (n & 8) {
+#ifdef BOTH
+                    dst_addr_fast[0] = foreground;
+#endif
+                    dst_addr[0] = foreground;
+                }
+                if (n & 4) {
+#ifdef BOTH
+                    dst_addr_fast[1] = foreground;
+#endif
+                    dst_addr[1] = foreground;
+                }
+                if (n & 2) {
+#ifdef BOTH
+                    dst_addr_fast[2] = foreground;
+#endif
+                    dst_addr[2] = foreground;
+                }
+                if (n & 1) {
+#ifdef BOTH
+                    dst_addr_fast[3] = foreground;
+#endif
+                    dst_addr[3] = foreground;
+                }
             }
-            if (!(mask >>= 1)) {
-                mask = 0x8000;
-                expand_word = *src_addr++;
+            dst_addr += 4;
+#ifdef BOTH
+            dst_addr_fast += 4;
+#endif
+            bits <<= 4;
+            count -= 4;
+        }
+
+        for(; j > 0; j--) {         /* Trailing pixels */
+            FETCH_BITS(1);
+            if (!(bits & 0x80000000UL)) {
+#ifdef BOTH
+                *dst_addr_fast = foreground;
+#endif
+                *dst_addr = foreground;
             }
+            dst_addr++;
+#ifdef BOTH
+            dst_addr_fast++;
+#endif
+            bits <<= 1;
+            count--;
         }
-        src_addr += src_line_add;
+
+        src_addr += words + src_line_add;
         dst_addr += dst_line_add;
 #ifdef BOTH
         dst_addr_fast += dst_line_add;
@@ -349,7 +925,8 @@ static void revtransp(short *src_addr, int src_line_add, PIXEL *dst_addr, PIXEL
 long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation, long colour)
 {
     Workstation *wk;
-    PIXEL *src_addr, *dst_addr, *dst_addr_fast;
+    short *src_addr;
+    PIXEL *dst_addr, *dst_addr_fast;
     unsigned long foreground, background;
     int src_wrap, dst_wrap;
     int src_line_add, dst_line_add;
@@ -368,11 +945,11 @@ long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *
     to_screen = 0;
     if (!dst || !dst->address || (dst->address == wk->screen.mfdb.address)) {       /* To screen? */
         dst_wrap = wk->screen.wrap;
-        dst_addr = wk->screen.mfdb.address;
+        dst_addr = (PIXEL *)wk->screen.mfdb.address;
         to_screen = 1;
     } else {
         dst_wrap = (long)dst->wdwidth * 2 * dst->bitplanes;
-        dst_addr = dst->address;
+        dst_addr = (PIXEL *)dst->address;
     }
     dst_pos = (short)dst_y * (long)dst_wrap + dst_x * PIXEL_SIZE;
     dst_line_add = dst_wrap - w * PIXEL_SIZE;
@@ -384,6 +961,10 @@ long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *
 
     dst_addr_fast = wk->screen.shadow.address;  /* May not really be to screen at all, but... */
 
+#ifdef FAST
+    if (to_screen)
+        mouse_keep_out(wk, dst_x, dst_y, dst_x + w - 1, dst_y + h - 1);
+#endif
 #ifdef BOTH
     if (!to_screen || !dst_addr_fast) {
 #endif
@@ -422,6 +1003,10 @@ long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *
 #else
     (void) to_screen;
     (void) dst_addr_fast;
+#endif
+#ifdef FAST
+    if (to_screen)
+        dirty_mark(dst_x, dst_y, dst_x + w - 1, dst_y + h - 1);
 #endif
     return 1;       /* Return as completed */
 }
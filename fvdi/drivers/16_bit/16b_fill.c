@@ -15,9 +15,7 @@
 #include "driver.h"
 #include "../bitplane/bitplane.h"
 
-#define PIXEL		short
-#define PIXEL_SIZE	sizeof(PIXEL)
-#define PIXEL_32    long
+#include "16b_pixel.h"
 
 /*
  * Make it as easy as possible for the C compiler.
@@ -29,6 +27,145 @@
  * - some compilers can't deal well with *var++ constructs
  */
 
+#define PATTERN_CACHE   8       /* Pre-coloured patterns kept */
+#define PATTERN_ROW     (32 * PIXEL_PER_LONG)
+
+/*
+ * A 16x16 pattern in two colours, as pixels.
+ * Each row holds two periods starting at each of the
+ * phases within a long word, so that any 16 pixels
+ * can be had with aligned long word reads.
+ */
+typedef struct pattern_rows_ {
+    PIXEL rows[16][PATTERN_ROW];    /* First, to keep it long aligned */
+    unsigned long used;         /* Last use, 0 for free */
+    unsigned short key;
+    PIXEL foreground, background;
+    short pattern[16];
+} PatternRows;
+
+static PatternRows pattern_cache[PATTERN_CACHE];
+static unsigned long pattern_lookups = 0;
+static unsigned long pattern_hits = 0;
+
+
+/*
+ * Returns the pre-coloured rows for a pattern and colour pair,
+ * from the cache if possible, otherwise in place of the least
+ * recently used entry.
+ * Solid patterns are not worth it and give 0.
+ */
+static PIXEL *pattern_rows(short *pattern, PIXEL foreground, PIXEL background)
+{
+    PatternRows *entry, *oldest;
+    PIXEL *row;
+    unsigned short key, solid, pattern_word, mask;
+    int i, j;
+
+    key = 0;
+    solid = 0xffff;
+    for(i = 0; i < 16; i++) {
+        solid &= pattern[i];
+        key = ((key << 1) | (key >> 15)) ^ pattern[i];
+    }
+    if (solid == 0xffff)
+        return 0;
+
+    pattern_lookups++;
+#ifdef FVDI_DEBUG
+    if ((debug > 1) && !(pattern_lookups & 0x03ff)) {
+        PRINTF(("Pattern cache: %ld hits in %ld lookups\n", pattern_hits, pattern_lookups));
+    }
+#endif
+
+    oldest = pattern_cache;
+    for(entry = pattern_cache; entry < &pattern_cache[PATTERN_CACHE]; entry++) {
+        if (entry->used && (entry->key == key) &&
+            (entry->foreground == foreground) && (entry->background == background)) {
+            for(i = 0; i < 16; i++) {
+                if (entry->pattern[i] != pattern[i])
+                    break;
+            }
+            if (i == 16) {
+                pattern_hits++;
+                entry->used = pattern_lookups;
+                return entry->rows[0];
+            }
+        }
+        if (entry->used < oldest->used)
+            oldest = entry;
+    }
+
+    entry = oldest;
+    entry->used = pattern_lookups;
+    entry->key = key;
+    entry->foreground = foreground;
+    entry->background = background;
+    for(i = 0; i < 16; i++) {
+        entry->pattern[i] = pattern_word = pattern[i];
+        row = entry->rows[i];
+        mask = 0x8000;
+        for(j = 0; j < 16; j++) {
+            row[j] = row[j + 16] = (pattern_word & mask) ? foreground : background;
+            mask >>= 1;
+        }
+        for(j = 32; j < PATTERN_ROW; j++)
+            row[j] = row[(j + (j >> 5)) & 0x1f];
+    }
+
+    return entry->rows[0];
+}
+
+
+/*
+ * Copy w pixels from a pre-coloured pattern row, the first of
+ * them at pattern phase x. The long words are aligned on both sides.
+ */
+static void copy_pattern_row(PIXEL *dst, PIXEL *row, int x, int w)
+{
+    unsigned PIXEL_32 *dst_l, *src_l;
+    int j;
+
+    x &= 0x000f;
+    for(; (w > 0) && ((long)dst & 3); w--) {
+        *dst++ = row[x];
+        x = (x + 1) & 0x000f;
+    }
+
+    src_l = (unsigned PIXEL_32 *)&row[(x & (PIXEL_PER_LONG - 1)) * 32 + (x & -PIXEL_PER_LONG)];
+    dst_l = (unsigned PIXEL_32 *)dst;
+    for(; w >= 16; w -= 16) {       /* A whole pattern period */
+        dst_l[0] = src_l[0];
+        dst_l[1] = src_l[1];
+        dst_l[2] = src_l[2];
+        dst_l[3] = src_l[3];
+#if DEPTH >= 16
+        dst_l[4] = src_l[4];
+        dst_l[5] = src_l[5];
+        dst_l[6] = src_l[6];
+        dst_l[7] = src_l[7];
+#endif
+#if DEPTH >= 32
+        dst_l[8] = src_l[8];
+        dst_l[9] = src_l[9];
+        dst_l[10] = src_l[10];
+        dst_l[11] = src_l[11];
+        dst_l[12] = src_l[12];
+        dst_l[13] = src_l[13];
+        dst_l[14] = src_l[14];
+        dst_l[15] = src_l[15];
+#endif
+        dst_l += 16 / PIXEL_PER_LONG;
+    }
+    for(j = 0; j < w / PIXEL_PER_LONG; j++)
+        *dst_l++ = src_l[j];
+    dst = (PIXEL *)dst_l;
+    row = (PIXEL *)&src_l[j];
+    for(j = 0; j < (w & (PIXEL_PER_LONG - 1)); j++)
+        *dst++ = row[j];
+}
+
+
 #ifdef BOTH
 static void s_fill_replace(PIXEL *addr, PIXEL *addr_fast, int line_add, short *pattern, int x, int y, int w, int h, PIXEL foreground, PIXEL background)
 {
@@ -86,6 +223,28 @@ static void s_fill_replace(PIXEL *addr, PIXEL *addr_fast, int line_add, short *p
     }
 }
 
+static void s_fill_replace_rows(PIXEL *addr, PIXEL *addr_fast, int line_add, short *pattern, int x, int y, int w, int h, PIXEL foreground, PIXEL background)
+{
+    PIXEL *rows;
+    int i;
+
+    (void) addr_fast;
+    (void) foreground;
+    (void) background;
+    rows = (PIXEL *)pattern;        /* Pre-coloured, see pattern_rows() */
+    i = y;
+    h = y + h;
+
+    for(; i < h; i++) {
+#ifdef BOTH
+        copy_pattern_row(addr_fast, &rows[(i & 0x000f) * PATTERN_ROW], x, w);
+        addr_fast += w + line_add;
+#endif
+        copy_pattern_row(addr, &rows[(i & 0x000f) * PATTERN_ROW], x, w);
+        addr += w + line_add;
+    }
+}
+
 static void s_fill_transparent(PIXEL *addr, PIXEL *addr_fast, int line_add, short *pattern, int x, int y, int w, int h, PIXEL foreground, PIXEL background)
 {
     int i, j;
@@ -330,6 +489,28 @@ static void fill_replace(PIXEL *addr, PIXEL *addr_fast, int line_add, short *pat
     }
 }
 
+static void fill_replace_rows(PIXEL *addr, PIXEL *addr_fast, int line_add, short *pattern, int x, int y, int w, int h, PIXEL foreground, PIXEL background)
+{
+    PIXEL *rows;
+    int i;
+
+    (void) addr_fast;
+    (void) foreground;
+    (void) background;
+    rows = (PIXEL *)pattern;        /* Pre-coloured, see pattern_rows() */
+    i = y;
+    h = y + h;
+
+    for(; i < h; i++) {
+#ifdef BOTH
+        copy_pattern_row(addr_fast, &rows[(i & 0x000f) * PATTERN_ROW], x, w);
+        addr_fast += w + line_add;
+#endif
+        copy_pattern_row(addr, &rows[(i & 0x000f) * PATTERN_ROW], x, w);
+        addr += w + line_add;
+    }
+}
+
 static void fill_transparent(PIXEL *addr, PIXEL *addr_fast, int line_add, short *pattern, int x, int y, int w, int h, PIXEL foreground, PIXEL background)
 {
     int i, j;
@@ -512,76 +693,413 @@ static void fill_revtransp(PIXEL *addr, PIXEL *addr_fast, int line_add, short *p
 #define BOTH
 #endif
 
+typedef void (*Fill)(PIXEL *addr, PIXEL *addr_fast, int line_add, short *pattern, int x, int y, int w, int h, PIXEL foreground, PIXEL background);
+
+static Fill fills[] = { 0, fill_replace, fill_transparent, fill_xor, fill_revtransp };
+#ifdef BOTH
+static Fill s_fills[] = { 0, s_fill_replace, s_fill_transparent, s_fill_xor, s_fill_revtransp };
+#endif
+
+
+/*
+ * Table operations:
+ * 0 - y/x1/x2 spans
+ * 1 - x1/y1/x2/y2 rectangles
+ * The table entries are expected to be clipped already.
+ * Colours and fill routine are only looked up once per table.
+ * Patterned replace fills use pre-coloured rows from a cache.
+ */
 long CDECL c_fill_area(Virtual *vwk, long x, long y, long w, long h,
                        short *pattern, long colour, long mode, long interior_style)
 {
     Workstation *wk;
-    PIXEL *addr, *addr_fast;
+    PIXEL *screen, *shadow;
     unsigned long foreground, background;
-    long line_add;
-    unsigned long pos;
+    int wrap;
+    long pos;
     short *table;
-
-    if (w <= 0 || h <= 0)
-        return 1;
+    int type, n;
+    Fill fill;
+    PIXEL *rows;
+#ifdef FAST
+    long x1 = 0x7fff, y1 = 0x7fff, x2 = -1, y2 = -1;
+#endif
 
     (void) interior_style;
     table = 0;
+    type = n = 0;
     if ((long) vwk & 1) {
-        if ((y & 0xffff) != 0)
+        type = y & 0xffff;
+        if ((type < 0) || (type > 1))   /* Negative with 16 bit int */
             return -1;      /* Don't know about this kind of table operation */
         table = (short *)x;
-        (void) table;
-        h = (y >> 16) & 0xffff;
+        n = (y >> 16) & 0xffff;
         vwk = (Virtual *)((long)vwk - 1);
-        return -1;          /* Don't know about anything yet */
-    }
+    } else if (w <= 0 || h <= 0)
+        return 1;
+
+    if ((mode < 1) || (mode > 4))
+        return 1;
 
     c_get_colours(vwk, colour, &foreground, &background);
 
     wk = vwk->real_address;
 
-    pos = (short)y * (long)wk->screen.wrap + x * 2;
-    addr = wk->screen.mfdb.address;
-    line_add = (wk->screen.wrap - w * 2) >> 1;
-
+    screen = (PIXEL *)wk->screen.mfdb.address;
+    wrap = wk->screen.wrap;
+    shadow = 0;
+    fill = fills[mode];
 #ifdef BOTH
-    if ((addr_fast = wk->screen.shadow.address) != 0) {
+    if ((shadow = wk->screen.shadow.address) != 0)
+        fill = s_fills[mode];
+#endif
+    if ((mode == 1) && ((rows = pattern_rows(pattern, foreground, background)) != 0)) {
+        pattern = (short *)rows;
+#ifdef BOTH
+        fill = shadow ? s_fill_replace_rows : fill_replace_rows;
+#else
+        fill = fill_replace_rows;
+#endif
+    }
 
-        addr += pos / PIXEL_SIZE;
-        addr_fast += pos / PIXEL_SIZE;
-        switch (mode) {
-        case 1:             /* Replace */
-            s_fill_replace(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
-            break;
-        case 2:             /* Transparent */
-            s_fill_transparent(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
-            break;
-        case 3:             /* XOR */
-            s_fill_xor(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
+#ifdef FAST
+    if (table)
+        mouse_keep_out(wk, vwk->clip.rectangle.x1, vwk->clip.rectangle.y1, vwk->clip.rectangle.x2, vwk->clip.rectangle.y2);
+    else
+        mouse_keep_out(wk, x, y, x + w - 1, y + h - 1);
+#endif
+    if (!table) {
+        type = -1;          /* Single block */
+        n = 1;
+    }
+    for(; n > 0; n--) {
+        switch (type) {
+        case 0:             /* Span */
+            y = *table++;
+            x = *table++;
+            w = *table++ - x + 1;
+            h = 1;
             break;
-        case 4:             /* Reverse transparent */
-            s_fill_revtransp(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
+        case 1:             /* Rectangle */
+            x = *table++;
+            y = *table++;
+            w = *table++ - x + 1;
+            h = *table++ - y + 1;
             break;
         }
+        if (w <= 0 || h <= 0)
+            continue;
+
+        pos = ((short)y * (long)wrap + x * PIXEL_SIZE) / PIXEL_SIZE;
+        fill(screen + pos, shadow ? shadow + pos : 0, (wrap - w * PIXEL_SIZE) / PIXEL_SIZE, pattern, x, y, w, h, foreground, background);
+#ifdef FAST
+        if (x < x1)
+            x1 = x;
+        if (y < y1)
+            y1 = y;
+        if (x + w - 1 > x2)
+            x2 = x + w - 1;
+        if (y + h - 1 > y2)
+            y2 = y + h - 1;
+#endif
+    }
+#ifdef FAST
+    dirty_mark(x1, y1, x2, y2);     /* Whole table at once */
+#endif
+
+    return 1;       /* Return as completed */
+}
+
+
+/*
+ * Polygon edge, as in the engine's polygon.c.
+ * The crossing is stepped one scanline at a time,
+ * with the fraction kept as a remainder of dy.
+ */
+typedef struct poly_edge_ {
+    short y_top;                /* First scanline crossed */
+    short y_bottom;             /* First scanline not crossed */
+    short x;                    /* Crossing on current scanline */
+    short x_step;               /* Whole pixels per scanline */
+    short sign;                 /* Extra pixel on remainder overflow */
+    unsigned short rem;         /* Fraction, in 1/dy units */
+    unsigned short rem_step;
+    unsigned short dy;
+} PolyEdge;
+
+
+/*
+ * Set up an edge between two polygon points.
+ * Returns zero for horizontal edges, which never cross a scanline.
+ * Until the edge is activated, x_step holds |dx|.
+ */
+static int poly_edge(PolyEdge *edge, short x1, short y1, short x2, short y2)
+{
+    short dx, tmp;
+
+    if (y1 == y2)
+        return 0;
+
+    if (y1 > y2) {
+        tmp = x1;
+        x1 = x2;
+        x2 = tmp;
+        tmp = y1;
+        y1 = y2;
+        y2 = tmp;
+    }
+
+    dx = x2 - x1;
+    edge->y_top = y1;
+    edge->y_bottom = y2;
+    edge->x = x1;
+    edge->dy = (short)(y2 - y1);
+    if (dx < 0) {
+        edge->sign = -1;
+        edge->x_step = -dx;
+    } else {
+        edge->sign = 1;
+        edge->x_step = dx;
+    }
+
+    return 1;
+}
+
+
+/*
+ * Prepare an edge for stepping from scanline y onwards.
+ */
+static void poly_activate(PolyEdge *edge, short y)
+{
+    unsigned long adx, num;
+
+    adx = (unsigned short)edge->x_step;
+    if (y > edge->y_top) {
+        num = (unsigned long)(y - edge->y_top) * adx;
+        edge->x += edge->sign * (short)(num / edge->dy);
+        edge->rem = num % edge->dy;
     } else
+        edge->rem = 0;
+    edge->x_step = edge->sign * (short)(adx / edge->dy);
+    edge->rem_step = adx % edge->dy;
+}
+
+
+/*
+ * Sort the edge table on first scanline (Shell sort).
+ */
+static void poly_sort(PolyEdge *edges, long n)
+{
+    long gap, i, j;
+    PolyEdge tmp;
+
+    for(gap = 1; gap < n / 3; gap = gap * 3 + 1)
+        ;
+    for(; gap > 0; gap /= 3) {
+        for(i = gap; i < n; i++) {
+            tmp = edges[i];
+            for(j = i; (j >= gap) && (edges[j - gap].y_top > tmp.y_top); j -= gap)
+                edges[j] = edges[j - gap];
+            edges[j] = tmp;
+        }
+    }
+}
+
+
+/*
+ * Filled polygon, scan converted straight into the screen
+ * (and shadow) rather than via a span table for c_fill_area.
+ * Edge stepping and clipping are those of the engine's
+ * filled_poly()/filled_poly_m(), so the result is the same.
+ * With moves, index[] marks where each new contour starts
+ * (as for v_bez_fill) and no closing edge is added.
+ * The pattern phase follows from the screen coordinates.
+ * Like the engine, nothing is drawn if no work memory is available.
+ */
+long CDECL c_fill_poly(Virtual *vwk, short points[], long n, short index[], long moves,
+                       short *pattern, long colour, long mode, long interior_style)
+{
+    Workstation *wk;
+    PIXEL *screen, *shadow;
+    unsigned long foreground, background;
+    int wrap;
+    long pos;
+    Fill fill;
+    PIXEL *rows;
+    char *block;
+    short (*p)[2];
+    PolyEdge *edges, *edge, *next_edge, *last_edge;
+    PolyEdge **active;
+    long i, j, n_edges, n_active;
+    short movepnt, move_n;
+    short y, maxy, x1, x2, clip_x1, clip_x2;
+#ifdef FAST
+    short dirty_x1 = 0x7fff, dirty_y1 = 0x7fff, dirty_x2 = -1, dirty_y2 = -1;
 #endif
-    {
-        addr += pos / PIXEL_SIZE;
-        switch (mode) {
-        case 1:             /* Replace */
-            fill_replace(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
-            break;
-        case 2:             /* Transparent */
-            fill_transparent(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
-            break;
-        case 3:             /* XOR */
-            fill_xor(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
-            break;
-        case 4:             /* Reverse transparent */
-            fill_revtransp(addr, addr_fast, line_add, pattern, x, y, w, h, foreground, background);
-            break;
+
+    (void) interior_style;
+    if ((n <= 0) || (mode < 1) || (mode > 4))
+        return 1;
+
+    p = (short (*)[2])points;
+    if (!moves && (p[0][0] == p[n - 1][0]) && (p[0][1] == p[n - 1][1]))
+        n--;
+    if (n < 2)
+        return 1;
+
+    if ((block = access->funcs.allocate_block(n * (long)(sizeof(PolyEdge) + sizeof(PolyEdge *)))) == 0)
+        return 1;
+
+    edges = (PolyEdge *)block;
+    if (!moves) {
+        n_edges = poly_edge(edges, p[n - 1][0], p[n - 1][1], p[0][0], p[0][1]);
+        for(i = 1; i < n; i++)
+            n_edges += poly_edge(&edges[n_edges], p[i - 1][0], p[i - 1][1], p[i][0], p[i][1]);
+    } else {
+        moves--;
+        if (index[moves] == -4)
+            moves--;
+        if (index[moves] == -2)
+            moves--;
+
+        move_n = moves;
+        movepnt = (index[move_n] + 4) / 2;
+        n_edges = 0;
+        for(i = 1; i < n; i++) {
+            if (i == movepnt) {
+                if (--move_n >= 0)
+                    movepnt = (index[move_n] + 4) / 2;
+                else
+                    movepnt = -1;       /* Never again equal to i */
+                continue;
+            }
+            n_edges += poly_edge(&edges[n_edges], p[i - 1][0], p[i - 1][1], p[i][0], p[i][1]);
         }
     }
+    if (!n_edges) {
+        access->funcs.free_block(block);
+        return 1;
+    }
+
+    c_get_colours(vwk, colour, &foreground, &background);
+
+    wk = vwk->real_address;
+
+    screen = (PIXEL *)wk->screen.mfdb.address;
+    wrap = wk->screen.wrap;
+    shadow = 0;
+    fill = fills[mode];
+#ifdef BOTH
+    if ((shadow = wk->screen.shadow.address) != 0)
+        fill = s_fills[mode];
+#endif
+    if ((mode == 1) && ((rows = pattern_rows(pattern, foreground, background)) != 0)) {
+        pattern = (short *)rows;
+#ifdef BOTH
+        fill = shadow ? s_fill_replace_rows : fill_replace_rows;
+#else
+        fill = fill_replace_rows;
+#endif
+    }
+
+    poly_sort(edges, n_edges);
+
+    maxy = edges[0].y_bottom;
+    for(i = 1; i < n_edges; i++) {
+        if (edges[i].y_bottom > maxy)
+            maxy = edges[i].y_bottom;
+    }
+    maxy--;
+    y = edges[0].y_top;
+    if (y < vwk->clip.rectangle.y1)
+        y = vwk->clip.rectangle.y1;
+    if (maxy > vwk->clip.rectangle.y2)
+        maxy = vwk->clip.rectangle.y2;
+    clip_x1 = vwk->clip.rectangle.x1;
+    clip_x2 = vwk->clip.rectangle.x2;
+#ifdef FAST
+    mouse_keep_out(wk, clip_x1, y, clip_x2, maxy);
+#endif
+
+    active = (PolyEdge **)&edges[n];
+    n_active = 0;
+    next_edge = edges;
+    last_edge = &edges[n_edges];
+
+    for(; y <= maxy; y++) {
+        /* Nothing active, so skip ahead to the next edge */
+        if (!n_active) {
+            if (next_edge == last_edge)
+                break;
+            if (next_edge->y_top > y) {
+                y = next_edge->y_top;
+                if (y > maxy)
+                    break;
+            }
+        }
+
+        /* Add edges starting at (or, when clipped, above) this scanline */
+        while ((next_edge != last_edge) && (next_edge->y_top <= y)) {
+            edge = next_edge++;
+            if (edge->y_bottom <= y)
+                continue;
+            poly_activate(edge, y);
+            active[n_active++] = edge;
+        }
+
+        /* Keep crossings in x order (almost always already sorted) */
+        for(i = 1; i < n_active; i++) {
+            edge = active[i];
+            x1 = edge->x;
+            for(j = i; (j > 0) && (active[j - 1]->x > x1); j--)
+                active[j] = active[j - 1];
+            active[j] = edge;
+        }
+
+        for(i = 0; i < n_active - 1; i += 2) {
+            x1 = active[i]->x;
+            x2 = active[i + 1]->x;
+            if (x1 < clip_x1)
+                x1 = clip_x1;
+            if (x2 > clip_x2)
+                x2 = clip_x2;
+            if (x1 > x2)
+                continue;
+            pos = (y * (long)wrap + x1 * PIXEL_SIZE) / PIXEL_SIZE;
+            fill(screen + pos, shadow ? shadow + pos : 0, 0, pattern, x1, y, x2 - x1 + 1, 1, foreground, background);
+#ifdef FAST
+            if (x1 < dirty_x1)
+                dirty_x1 = x1;
+            if (x2 > dirty_x2)
+                dirty_x2 = x2;
+            if (y < dirty_y1)
+                dirty_y1 = y;
+            dirty_y2 = y;
+#endif
+        }
+
+        /* Step to the next scanline, dropping finished edges */
+        j = 0;
+        for(i = 0; i < n_active; i++) {
+            edge = active[i];
+            if (edge->y_bottom <= y + 1)
+                continue;
+            edge->x += edge->x_step;
+            edge->rem += edge->rem_step;
+            if (edge->rem >= edge->dy) {
+                edge->rem -= edge->dy;
+                edge->x += edge->sign;
+            }
+            active[j++] = edge;
+        }
+        n_active = j;
+    }
+
+    access->funcs.free_block(block);
+#ifdef FAST
+    if (dirty_x1 <= dirty_x2)
+        dirty_mark(dirty_x1, dirty_y1, dirty_x2, dirty_y2);
+#endif
+
     return 1;       /* Return as completed */
 }
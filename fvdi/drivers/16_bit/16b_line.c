@@ -15,9 +15,7 @@
 #include "driver.h"
 #include "../bitplane/bitplane.h"
 
-#define PIXEL		short
-#define PIXEL_SIZE	sizeof(PIXEL)
-#define PIXEL_32    long
+#include "16b_pixel.h"
 
 /*
  * Make it as easy as possible for the C compiler.
@@ -29,7 +27,53 @@
  * - some compilers can't deal well with *var++ constructs
  */
 
+/*
+ * Set or invert a horizontal run of pixels,
+ * using long words once the address is aligned.
+ */
+static void span_set(PIXEL *addr, int n, unsigned PIXEL_32 solid)
+{
+    for(; (n > 0) && ((long)addr & 3); n--)
+        *addr++ = solid;
+    for(; n >= PIXEL_PER_LONG; n -= PIXEL_PER_LONG) {
+        *(PIXEL_32 *)addr = solid;
+        addr += PIXEL_PER_LONG;
+    }
+    for(; n > 0; n--)
+        *addr++ = solid;
+}
+
+static void span_invert(PIXEL *addr, int n)
+{
+    for(; (n > 0) && ((long)addr & 3); n--) {
+        *addr = ~*addr;
+        addr++;
+    }
+    for(; n >= PIXEL_PER_LONG; n -= PIXEL_PER_LONG) {
+        *(PIXEL_32 *)addr = ~*(PIXEL_32 *)addr;
+        addr += PIXEL_PER_LONG;
+    }
+    for(; n > 0; n--) {
+        *addr = ~*addr;
+        addr++;
+    }
+}
+
 #ifdef BOTH
+/* Copy a run from the shadow buffer to the screen */
+static void span_copy(PIXEL *dst, PIXEL *src, int n)
+{
+    for(; (n > 0) && ((long)dst & 3); n--)
+        *dst++ = *src++;
+    for(; n >= PIXEL_PER_LONG; n -= PIXEL_PER_LONG) {
+        *(PIXEL_32 *)dst = *(PIXEL_32 *)src;
+        dst += PIXEL_PER_LONG;
+        src += PIXEL_PER_LONG;
+    }
+    for(; n > 0; n--)
+        *dst++ = *src++;
+}
+
 static void s_line_replace(PIXEL *addr, PIXEL *addr_fast, int count,
                     int d, int incrE, int incrNE, int one_step, int both_step,
                     PIXEL foreground, PIXEL background)
@@ -191,7 +235,7 @@ static void s_line_xor(PIXEL *addr, PIXEL *addr_fast, int count,
                 int d, int incrE, int incrNE, int one_step, int both_step,
                 PIXEL foreground, PIXEL background)
 {
-    int v;
+    PIXEL v;
 
     (void) addr_fast;
     (void) foreground;
@@ -236,7 +280,7 @@ static void s_line_xor_p(PIXEL *addr, PIXEL *addr_fast, long pattern, int count,
                   int d, int incrE, int incrNE, int one_step, int both_step,
                   PIXEL foreground, PIXEL background)
 {
-    int v;
+    PIXEL v;
     unsigned short mask = 0x8000;
 
     (void) addr_fast;
@@ -361,6 +405,161 @@ static void s_line_revtransp_p(PIXEL *addr, PIXEL *addr_fast, long pattern, int
 }
 
 
+/*
+ * Solid lines that are at most a quarter as steep as a diagonal
+ * are drawn a run at a time instead. A run is the pixels that the
+ * Bresenham loops above would set along the major axis before
+ * taking a diagonal step. All runs except the first and the last
+ * are skip or skip + 1 pixels long, so the error term only needs
+ * to be checked once per run. Horizontal runs use long words.
+ * (Any line at most half as steep as a diagonal would work, but
+ * shorter runs are not worth the extra setup.)
+ */
+static void s_line_replace_r(PIXEL *addr, PIXEL *addr_fast, int count,
+                      int d, int incrE, int incrNE, int one_step, int both_step,
+                      PIXEL foreground, PIXEL background)
+{
+    int n, skip, run_incr;
+    unsigned PIXEL_32 solid;
+
+    (void) addr_fast;
+    (void) background;
+    solid = PIXEL_LONG(foreground);
+    skip = run_incr = 0;
+    n = count + 1;
+    if (incrE) {
+        skip = (incrE - incrNE) / incrE - 1;
+        run_incr = incrNE + skip * incrE;
+        n = 1;
+        if (d < 0)
+            n += (incrE - 1 - d) / incrE;
+        d += (n - 1) * incrE;
+    }
+    count++;            /* Number of pixels */
+
+    for(;;) {
+        if (n > count)
+            n = count;
+        count -= n;
+        if (one_step == 1) {
+#ifdef BOTH
+            span_set(addr_fast, n, solid);
+            addr_fast += n - 1;
+#endif
+            span_set(addr, n, solid);
+            addr += n - 1;
+        } else if (one_step == -1) {
+#ifdef BOTH
+            addr_fast -= n - 1;
+            span_set(addr_fast, n, solid);
+#endif
+            addr -= n - 1;
+            span_set(addr, n, solid);
+        } else {
+#ifdef BOTH
+            *addr_fast = foreground;
+#endif
+            *addr = foreground;
+            for(n--; n > 0; n--) {
+#ifdef BOTH
+                addr_fast += one_step;
+                *addr_fast = foreground;
+#endif
+                addr += one_step;
+                *addr = foreground;
+            }
+        }
+        if (!count)
+            break;
+#ifdef BOTH
+        addr_fast += both_step;
+#endif
+        addr += both_step;
+        d += run_incr;
+        n = skip + 1;
+        if (d < 0) {
+            d += incrE;
+            n++;
+        }
+    }
+}
+
+static void s_line_xor_r(PIXEL *addr, PIXEL *addr_fast, int count,
+                  int d, int incrE, int incrNE, int one_step, int both_step,
+                  PIXEL foreground, PIXEL background)
+{
+    int n, skip, run_incr;
+    PIXEL v;
+
+    (void) addr_fast;
+    (void) foreground;
+    (void) background;
+    skip = run_incr = 0;
+    n = count + 1;
+    if (incrE) {
+        skip = (incrE - incrNE) / incrE - 1;
+        run_incr = incrNE + skip * incrE;
+        n = 1;
+        if (d < 0)
+            n += (incrE - 1 - d) / incrE;
+        d += (n - 1) * incrE;
+    }
+    count++;            /* Number of pixels */
+
+    for(;;) {
+        if (n > count)
+            n = count;
+        count -= n;
+        if (one_step == 1) {
+#ifdef BOTH
+            span_invert(addr_fast, n);
+            span_copy(addr, addr_fast, n);
+            addr_fast += n - 1;
+#else
+            span_invert(addr, n);
+#endif
+            addr += n - 1;
+        } else if (one_step == -1) {
+            addr -= n - 1;
+#ifdef BOTH
+            addr_fast -= n - 1;
+            span_invert(addr_fast, n);
+            span_copy(addr, addr_fast, n);
+#else
+            span_invert(addr, n);
+#endif
+        } else {
+            for(;;) {
+#ifdef BOTH
+                v = ~*addr_fast;
+                *addr_fast = v;
+#else
+                v = ~*addr;
+#endif
+                *addr = v;
+                if (!--n)
+                    break;
+#ifdef BOTH
+                addr_fast += one_step;
+#endif
+                addr += one_step;
+            }
+        }
+        if (!count)
+            break;
+#ifdef BOTH
+        addr_fast += both_step;
+#endif
+        addr += both_step;
+        d += run_incr;
+        n = skip + 1;
+        if (d < 0) {
+            d += incrE;
+            n++;
+        }
+    }
+}
+
 #define BOTH_WAS_ON
 #endif
 #undef BOTH
@@ -533,7 +732,7 @@ static void line_xor(PIXEL *addr, PIXEL *addr_fast, int count,
                 int d, int incrE, int incrNE, int one_step, int both_step,
                 PIXEL foreground, PIXEL background)
 {
-    int v;
+    PIXEL v;
 
     (void) addr_fast;
     (void) foreground;
@@ -578,7 +777,7 @@ static void line_xor_p(PIXEL *addr, PIXEL *addr_fast, long pattern, int count,
                   int d, int incrE, int incrNE, int one_step, int both_step,
                   PIXEL foreground, PIXEL background)
 {
-    int v;
+    PIXEL v;
     unsigned short mask = 0x8000;
 
     (void) addr_fast;
@@ -702,16 +901,164 @@ static void line_revtransp_p(PIXEL *addr, PIXEL *addr_fast, long pattern, int co
     }
 }
 
+static void line_replace_r(PIXEL *addr, PIXEL *addr_fast, int count,
+                      int d, int incrE, int incrNE, int one_step, int both_step,
+                      PIXEL foreground, PIXEL background)
+{
+    int n, skip, run_incr;
+    unsigned PIXEL_32 solid;
+
+    (void) addr_fast;
+    (void) background;
+    solid = PIXEL_LONG(foreground);
+    skip = run_incr = 0;
+    n = count + 1;
+    if (incrE) {
+        skip = (incrE - incrNE) / incrE - 1;
+        run_incr = incrNE + skip * incrE;
+        n = 1;
+        if (d < 0)
+            n += (incrE - 1 - d) / incrE;
+        d += (n - 1) * incrE;
+    }
+    count++;            /* Number of pixels */
+
+    for(;;) {
+        if (n > count)
+            n = count;
+        count -= n;
+        if (one_step == 1) {
+#ifdef BOTH
+            span_set(addr_fast, n, solid);
+            addr_fast += n - 1;
+#endif
+            span_set(addr, n, solid);
+            addr += n - 1;
+        } else if (one_step == -1) {
+#ifdef BOTH
+            addr_fast -= n - 1;
+            span_set(addr_fast, n, solid);
+#endif
+            addr -= n - 1;
+            span_set(addr, n, solid);
+        } else {
+#ifdef BOTH
+            *addr_fast = foreground;
+#endif
+            *addr = foreground;
+            for(n--; n > 0; n--) {
+#ifdef BOTH
+                addr_fast += one_step;
+                *addr_fast = foreground;
+#endif
+                addr += one_step;
+                *addr = foreground;
+            }
+        }
+        if (!count)
+            break;
+#ifdef BOTH
+        addr_fast += both_step;
+#endif
+        addr += both_step;
+        d += run_incr;
+        n = skip + 1;
+        if (d < 0) {
+            d += incrE;
+            n++;
+        }
+    }
+}
+
+static void line_xor_r(PIXEL *addr, PIXEL *addr_fast, int count,
+                  int d, int incrE, int incrNE, int one_step, int both_step,
+                  PIXEL foreground, PIXEL background)
+{
+    int n, skip, run_incr;
+    PIXEL v;
+
+    (void) addr_fast;
+    (void) foreground;
+    (void) background;
+    skip = run_incr = 0;
+    n = count + 1;
+    if (incrE) {
+        skip = (incrE - incrNE) / incrE - 1;
+        run_incr = incrNE + skip * incrE;
+        n = 1;
+        if (d < 0)
+            n += (incrE - 1 - d) / incrE;
+        d += (n - 1) * incrE;
+    }
+    count++;            /* Number of pixels */
+
+    for(;;) {
+        if (n > count)
+            n = count;
+        count -= n;
+        if (one_step == 1) {
+#ifdef BOTH
+            span_invert(addr_fast, n);
+            span_copy(addr, addr_fast, n);
+            addr_fast += n - 1;
+#else
+            span_invert(addr, n);
+#endif
+            addr += n - 1;
+        } else if (one_step == -1) {
+            addr -= n - 1;
+#ifdef BOTH
+            addr_fast -= n - 1;
+            span_invert(addr_fast, n);
+            span_copy(addr, addr_fast, n);
+#else
+            span_invert(addr, n);
+#endif
+        } else {
+            for(;;) {
+#ifdef BOTH
+                v = ~*addr_fast;
+                *addr_fast = v;
+#else
+                v = ~*addr;
+#endif
+                *addr = v;
+                if (!--n)
+                    break;
+#ifdef BOTH
+                addr_fast += one_step;
+#endif
+                addr += one_step;
+            }
+        }
+        if (!count)
+            break;
+#ifdef BOTH
+        addr_fast += both_step;
+#endif
+        addr += both_step;
+        d += run_incr;
+        n = skip + 1;
+        if (d < 0) {
+            d += incrE;
+            n++;
+        }
+    }
+}
+
 #ifdef BOTH_WAS_ON
 #define BOTH
 #endif
 
-long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2,
-                       long pattern, long colour, long mode)
+/*
+ * Draw one clipped line. With 'last' clear, the final pixel is
+ * left out, for the next line of a polyline to draw.
+ */
+static void draw_line(Workstation *wk, long x1, long y1, long x2, long y2,
+                      long pattern, long mode, int last,
+                      unsigned long foreground, unsigned long background)
 {
-    Workstation *wk;
     PIXEL *addr, *addr_fast;
-    unsigned long foreground, background;
     int line_add;
     long pos;
     int x_step, y_step;
@@ -720,21 +1067,12 @@ long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2,
     int d, count;
     int incrE, incrNE;
 
-    if ((long)vwk & 1) {
-        return -1;          /* Don't know about anything yet */
-    }
-
-    if (!clip_line(vwk, &x1, &y1, &x2, &y2))
-        return 1;
-
-    c_get_colours(vwk, colour, &foreground, &background);
-
-    wk = vwk->real_address;
-
-    pos = (short)y1 * (long)wk->screen.wrap + x1 * 2;
-    addr = wk->screen.mfdb.address;
-    line_add = wk->screen.wrap >> 1;
-
+#ifdef FAST
+    mouse_keep_out(wk, x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, x1 < x2 ? x2 : x1, y1 < y2 ? y2 : y1);
+#endif
+    pos = (short)y1 * (long)wk->screen.wrap + x1 * PIXEL_SIZE;
+    addr = (PIXEL *)wk->screen.mfdb.address;
+    line_add = wk->screen.wrap / PIXEL_SIZE;
 
     x_step = 1;
     y_step = line_add;
@@ -764,13 +1102,29 @@ long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2,
         d = 2 * dx - dy;
     }
     both_step = x_step + y_step;
+    if (!last) {
+        if (!count)
+            return;
+        count--;
+    }
 
 #ifdef BOTH
     if ((addr_fast = wk->screen.shadow.address) != 0) {
 
-        addr += pos >> 1;
-        addr_fast += pos >> 1;
-        if ((pattern & 0xffff) == 0xffff) {
+        addr += pos / PIXEL_SIZE;
+        addr_fast += pos / PIXEL_SIZE;
+        if (((pattern & 0xffff) == 0xffff) && (2 * incrE <= count)) {
+            switch (mode) {
+            case 1:             /* Replace */
+            case 2:             /* Transparent */
+            case 4:             /* Reverse transparent */
+                s_line_replace_r(addr, addr_fast, count, d, incrE, incrNE, one_step, both_step, foreground, background);
+                break;
+            case 3:             /* XOR */
+                s_line_xor_r(addr, addr_fast, count, d, incrE, incrNE, one_step, both_step, foreground, background);
+                break;
+            }
+        } else if ((pattern & 0xffff) == 0xffff) {
             switch (mode) {
             case 1:             /* Replace */
                 s_line_replace(addr, addr_fast, count, d, incrE, incrNE, one_step, both_step, foreground, background);
@@ -804,8 +1158,19 @@ long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2,
     } else
 #endif
     {
-        addr += pos >> 1;
-        if ((pattern & 0xffff) == 0xffff) {
+        addr += pos / PIXEL_SIZE;
+        if (((pattern & 0xffff) == 0xffff) && (2 * incrE <= count)) {
+            switch (mode) {
+            case 1:             /* Replace */
+            case 2:             /* Transparent */
+            case 4:             /* Reverse transparent */
+                line_replace_r(addr, addr_fast, count, d, incrE, incrNE, one_step, both_step, foreground, background);
+                break;
+            case 3:             /* XOR */
+                line_xor_r(addr, addr_fast, count, d, incrE, incrNE, one_step, both_step, foreground, background);
+                break;
+            }
+        } else if ((pattern & 0xffff) == 0xffff) {
             switch (mode) {
             case 1:             /* Replace */
                 line_replace(addr, addr_fast, count, d, incrE, incrNE, one_step, both_step, foreground, background);
@@ -837,5 +1202,121 @@ long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2,
             }
         }
     }
+#ifdef FAST
+    dirty_mark(x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, x1 < x2 ? x2 : x1, y1 < y2 ? y2 : y1);
+#endif
+}
+
+
+/*
+ * Polyline table operation, split up as retry_line() in
+ * engine/default.c does it, but with the colours looked up once.
+ * The last pixel of each line is left for the next one to draw,
+ * so that XOR joins look right. It is only drawn at the end of
+ * a part of the polyline that does not return to its start.
+ * The line pattern carries on from one line to the next.
+ */
+static void pline(Virtual *vwk, short *table, int length, short *index, int moves,
+                  long pattern, long mode, unsigned long foreground, unsigned long background)
+{
+    Workstation *wk;
+    long x1, y1, x2, y2;
+    long cx1, cy1, cx2, cy2;
+    short init_x, init_y;
+    int n, movepnt, first;
+    int dx, dy, last, phase, shift;
+    long rotated;
+
+    wk = vwk->real_address;
+    pattern &= 0xffff;
+
+    init_x = x1 = *table++;
+    init_y = y1 = *table++;
+
+    movepnt = -1;
+    if (index && (moves > 0)) {
+        moves--;
+        if (index[moves] == -4)
+            moves--;
+        if ((moves >= 0) && (index[moves] == -2))
+            moves--;
+        if (moves >= 0)
+            movepnt = (index[moves] + 4) / 2;
+    }
+
+    first = 1;
+    phase = 0;
+    for(n = 1; n < length; n++) {
+        x2 = *table++;
+        y2 = *table++;
+        if (n == movepnt) {
+            if (--moves >= 0)
+                movepnt = (index[moves] + 4) / 2;
+            else
+                movepnt = -1;           /* Never again equal to n */
+            init_x = x1 = x2;
+            init_y = y1 = y2;
+            first = n + 1;
+            phase = 0;
+            continue;
+        }
+
+        last = ((n == length - 1) || (n == movepnt - 1)) &&
+               ((x2 != init_x) || (y2 != init_y) || (n == first));
+
+        dx = x2 - x1;
+        if (dx < 0)
+            dx = -dx;
+        dy = y2 - y1;
+        if (dy < 0)
+            dy = -dy;
+
+        cx1 = x1;
+        cy1 = y1;
+        cx2 = x2;
+        cy2 = y2;
+        if (clip_line(vwk, &cx1, &cy1, &cx2, &cy2)) {
+            if (dx > dy)            /* Pixels clipped away at the start */
+                shift = (cx1 > x1) ? cx1 - x1 : x1 - cx1;
+            else
+                shift = (cy1 > y1) ? cy1 - y1 : y1 - cy1;
+            shift = (phase + shift) & 0x0f;
+            rotated = ((pattern << shift) | (pattern >> (16 - shift))) & 0xffff;
+            if ((cx2 != x2) || (cy2 != y2))
+                last = 1;               /* End clipped away */
+            draw_line(wk, cx1, cy1, cx2, cy2, rotated, mode, last, foreground, background);
+        }
+
+        phase = (phase + (dx > dy ? dx : dy)) & 0x0f;
+        x1 = x2;
+        y1 = y2;
+    }
+}
+
+
+long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2,
+                       long pattern, long colour, long mode)
+{
+    unsigned long foreground, background;
+
+    if ((long)vwk & 1) {
+        if ((unsigned long)(y1 & 0xffff) > 1)
+            return -1;          /* Don't know about this kind of table operation */
+        vwk = (Virtual *)((long)vwk - 1);
+        c_get_colours(vwk, colour, &foreground, &background);
+        if (y1 & 0xffff)
+            pline(vwk, (short *)x1, (y1 >> 16) & 0xffff, (short *)y2, x2 & 0xffff, pattern, mode, foreground, background);
+        else
+            pline(vwk, (short *)x1, (y1 >> 16) & 0xffff, 0, 0, pattern, mode, foreground, background);
+        return 1;
+    }
+
+    if (!clip_line(vwk, &x1, &y1, &x2, &y2))
+        return 1;
+
+    c_get_colours(vwk, colour, &foreground, &background);
+
+    draw_line(vwk->real_address, x1, y1, x2, y2, pattern, mode, 1, foreground, background);
+
     return 1;       /* Return as completed */
 }
@@ -14,20 +14,74 @@
 #include "driver.h"
 #include "../bitplane/bitplane.h"
 
-#define PIXEL       short
-#define PIXEL_SIZE  sizeof(PIXEL)
+#include "16b_pixel.h"
 
+/*
+ * The saved area is described by mouse_save_state (offset, and
+ * width/height minus one in the top nibbles) and mouse_area_x/y.
+ * Two save buffers are kept, so that a move can build the new one
+ * from the old while both pointers are partly on screen.
+ * Only the pixels the pointer actually covers are ever restored,
+ * and those are what mouse_drawn[] marks (top bit first).
+ */
 static unsigned long mouse_save_state = 0;
 static long mouse_old_colours = 0;
-static PIXEL mouse_foreground = 0xffff;
+static PIXEL mouse_foreground = ~0;
 static PIXEL mouse_background = 0;
 
 static unsigned short mouse_data[16 * 2] = {
     0xffff, 0x0000, 0x7ffe, 0x3ffc, 0x3ffc, 0x1ff8, 0x1ff8, 0x0ff0,
     0x0ff0, 0x07e0, 0x07e0, 0x03c0, 0x03c0, 0x0180, 0x0180, 0x0000
 };
-static PIXEL mouse_saved[16 * 16];
+static PIXEL mouse_saved[2][16 * 16];
+static unsigned short mouse_drawn[2][16];
+static short mouse_buffer = 0;          /* Save buffer in use */
+static short mouse_area_x, mouse_area_y;
+static short mouse_at_x, mouse_at_y;    /* Position drawn for */
+static short mouse_changed = 1;         /* New shape or colours since then */
+static volatile short mouse_lazy = 0;   /* Hidden, but still on screen */
+#ifdef FAST
+static Workstation *mouse_wk;
+#endif
+
+
+/*
+ * Where the pointer goes.
+ * That is not the workstation screen when writing back from a shadow.
+ */
+static PIXEL *mouse_screen(Workstation *wk)
+{
+#ifdef FAST
+    if (dirty_video)
+        return dirty_video;
+#endif
+    return wk->screen.mfdb.address;
+}
+
+
+#ifdef FAST
+/*
+ * Screen area (if any) that is currently saved away
+ * from under the pointer, the buffer it is saved in,
+ * and which of its pixels the pointer covers.
+ */
+static PIXEL *mouse_saved_area(Workstation *wk, short *x, short *y, short *w, short *h, unsigned short **drawn)
+{
+    unsigned long state = mouse_save_state;
+
+    (void) wk;
+    if (!state || no_restore)
+        return 0;
 
+    *x = mouse_area_x;
+    *y = mouse_area_y;
+    *w = ((state >> 28) & 0x0f) + 1;
+    *h = ((state >> 24) & 0x0f) + 1;
+    *drawn = mouse_drawn[mouse_buffer];
+
+    return mouse_saved[mouse_buffer];
+}
+#endif
 
 
 static void set_mouse_shape(Mouse *mouse, unsigned short *masks)
@@ -42,29 +96,95 @@ static void set_mouse_shape(Mouse *mouse, unsigned short *masks)
 }
 
 
+/*
+ * Clip the pointer at x/y (hotspot not yet subtracted) to the screen.
+ * Gives the top left corner, size, first mask/data row
+ * and how far the masks need to be shifted left.
+ * Returns zero if nothing is visible.
+ */
+static int clip_mouse(Workstation *wk, short *x, short *y, short *w, short *h,
+                      const unsigned short **mask_start, short *shft)
+{
+    short xs, ys;
+
+    *x -= wk->mouse.hotspot.x;
+    *y -= wk->mouse.hotspot.y;
+    *w = 16;
+    *h = 16;
+
+    *mask_start = mouse_data;
+    if (*y < wk->screen.coordinates.min_y)
+    {
+        ys = wk->screen.coordinates.min_y - *y;
+        *h -= ys;
+        *y = wk->screen.coordinates.min_y;
+        *mask_start += ys << 1;
+    }
+    if (*y + *h - 1 > wk->screen.coordinates.max_y)
+    {
+        *h = wk->screen.coordinates.max_y - *y + 1;
+    }
+
+    *shft = 0;
+
+    if (*x < wk->screen.coordinates.min_x)
+    {
+        xs = wk->screen.coordinates.min_x - *x;
+        *w -= xs;
+        *x = wk->screen.coordinates.min_x;
+        *shft = xs;
+    }
+    if (*x + *w - 1 > wk->screen.coordinates.max_x)
+    {
+        *w = wk->screen.coordinates.max_x - *x + 1;
+    }
+
+    return (*w > 0) && (*h > 0);
+}
+
+
+static void set_mouse_area(Workstation *wk, short x, short y, short w, short h)
+{
+    unsigned long state;
+
+    state = 0;
+    state |= (long) ((w - 1) & 0x0f) << 28;
+    state |= (long) ((h - 1) & 0x0f) << 24;
+    state |= y * (long) wk->screen.wrap + x * PIXEL_SIZE;
+    mouse_save_state = state;
+    mouse_area_x = x;
+    mouse_area_y = y;
+}
+
+
 static void hide_mouse(Workstation *wk)
 {
     unsigned long state = mouse_save_state;
     PIXEL *dst;
     PIXEL *save_w;
+    unsigned short *drawn;
+    unsigned short mask;
     short i, w, h;
     unsigned long wrap;
 
-    dst = (PIXEL *) ((long) wk->screen.mfdb.address + (state & 0x00ffffffL));
+    dst = (PIXEL *) ((long) mouse_screen(wk) + (state & 0x00ffffffL));
 
-    w = (state >> 28) & 0x0f;
+    w = ((state >> 28) & 0x0f) + 1;
     h = (state >> 24) & 0x0f;
-    save_w = mouse_saved;
-    wrap = wk->screen.wrap - (w + 1) * PIXEL_SIZE;
-    wrap /= PIXEL_SIZE;     /* Change into pixel count */
+    save_w = mouse_saved[mouse_buffer];
+    drawn = mouse_drawn[mouse_buffer];
+    wrap = wk->screen.wrap / PIXEL_SIZE;    /* Change into pixel count */
 
     do
     {
-        i = w;
-        do
+        mask = *drawn++;
+        for (i = 0; mask; i++)
         {
-            *dst++ = *save_w++;
-        } while (--i >= 0);
+            if (mask & 0x8000)
+                dst[i] = save_w[i];
+            mask <<= 1;
+        }
+        save_w += w;
         dst += wrap;
     } while (--h >= 0);
 
@@ -74,50 +194,17 @@ static void hide_mouse(Workstation *wk)
 
 static void draw_mouse(Workstation *wk, short x, short y)
 {
-    unsigned long state;
     PIXEL *dst;
     PIXEL *save_w;
+    unsigned short *drawn;
     const unsigned short *mask_start;
     short w, h, shft;
     unsigned long wrap;
 
-    x -= wk->mouse.hotspot.x;
-    y -= wk->mouse.hotspot.y;
-    w = 16;
-    h = 16;
-
-    mask_start = mouse_data;
-    if (y < wk->screen.coordinates.min_y)
-    {
-        short ys;
-
-        ys = wk->screen.coordinates.min_y - y;
-        h -= ys;
-        y = wk->screen.coordinates.min_y;
-        mask_start += ys << 1;
-    }
-    if (y + h - 1 > wk->screen.coordinates.max_y)
-    {
-        h = wk->screen.coordinates.max_y - y + 1;
-    }
-
-    shft = 0;
-
-    if (x < wk->screen.coordinates.min_x)
-    {
-        short xs;
-
-        xs = wk->screen.coordinates.min_x - x;
-        w -= xs;
-        x = wk->screen.coordinates.min_x;
-        shft = xs;
-    }
-    if (x + w - 1 > wk->screen.coordinates.max_x)
-    {
-        w = wk->screen.coordinates.max_x - x + 1;
-    }
-
-    if (w <= 0 || h <= 0)
+    mouse_at_x = x;
+    mouse_at_y = y;
+    mouse_changed = 0;
+    if (!clip_mouse(wk, &x, &y, &w, &h, &mask_start, &shft))
     {
         mouse_save_state = 0;
         return;
@@ -125,28 +212,25 @@ static void draw_mouse(Workstation *wk, short x, short y)
 
     wrap = wk->screen.wrap - w * PIXEL_SIZE;
     wrap /= PIXEL_SIZE;     /* Change into pixel count */
-    dst = (PIXEL *) ((long) wk->screen.mfdb.address + y * (long) wk->screen.wrap + x * PIXEL_SIZE);
+    dst = (PIXEL *) ((long) mouse_screen(wk) + y * (long) wk->screen.wrap + x * PIXEL_SIZE);
 
-    w--;
-    h--;
-    state = 0;
-    state |= (long) (w & 0x0f) << 28;
-    state |= (long) (h & 0x0f) << 24;
-    state |= (long) dst - (long) wk->screen.mfdb.address;
-    mouse_save_state = state;
-
-    save_w = mouse_saved;
+    set_mouse_area(wk, x, y, w, h);
+    save_w = mouse_saved[mouse_buffer];
+    drawn = mouse_drawn[mouse_buffer];
 
     {
         unsigned short fg, bg;
         short i;
 
+        w--;
+        h--;
         do
         {
             bg = *mask_start++;
             bg <<= shft;
             fg = *mask_start++;
             fg <<= shft;
+            *drawn++ = (fg | bg) & (unsigned short)(0xffff << (15 - w));
             i = w;
             do
             {
@@ -165,6 +249,150 @@ static void draw_mouse(Workstation *wk, short x, short y)
 }
 
 
+/*
+ * Move a pointer that is on screen.
+ * Only the pixels the new pointer covers and those the old
+ * one leaves are written, each once and the new ones first,
+ * so the pointer never disappears.
+ * What is under the new pointer is taken from the old save
+ * buffer where the two overlap, and only read from the
+ * screen elsewhere.
+ */
+static void move_mouse(Workstation *wk, short x, short y)
+{
+    unsigned long state = mouse_save_state;
+    PIXEL *screen, *dst, *old_saved, *new_saved;
+    unsigned short *new_drawn;
+    unsigned short old_drawn[16];
+    const unsigned short *mask_start;
+    unsigned short fg, bg, old_mask, bit, restore;
+    short ox, oy, ow, oh, w, h, shft;
+    short i, j, oi, oj;
+    long wrap;
+    PIXEL v;
+
+    ox = mouse_area_x;
+    oy = mouse_area_y;
+    ow = ((state >> 28) & 0x0f) + 1;
+    oh = ((state >> 24) & 0x0f) + 1;
+    old_saved = mouse_saved[mouse_buffer];
+    for (j = 0; j < oh; j++)
+        old_drawn[j] = mouse_drawn[mouse_buffer][j];
+
+    mouse_at_x = x;
+    mouse_at_y = y;
+    mouse_changed = 0;
+    if (!clip_mouse(wk, &x, &y, &w, &h, &mask_start, &shft))
+    {
+        hide_mouse(wk);
+        return;
+    }
+
+    screen = mouse_screen(wk);
+    wrap = wk->screen.wrap / PIXEL_SIZE;    /* Pixel count */
+    mouse_buffer ^= 1;
+    new_saved = mouse_saved[mouse_buffer];
+    new_drawn = mouse_drawn[mouse_buffer];
+
+    for (j = 0; j < h; j++)
+    {
+        bg = *mask_start++;
+        bg <<= shft;
+        fg = *mask_start++;
+        fg <<= shft;
+        oj = y + j - oy;
+        old_mask = ((unsigned short)oj < (unsigned short)oh) ? old_drawn[oj] : 0;
+        dst = screen + (y + j) * wrap + x;
+        new_drawn[j] = 0;
+        for (i = 0, bit = 0x8000; i < w; i++, bit >>= 1)
+        {
+            oi = x + i - ox;
+            restore = 0;
+            if (((unsigned short)oj < (unsigned short)oh) && ((unsigned short)oi < (unsigned short)ow))
+            {
+                v = old_saved[oj * ow + oi];
+                restore = old_mask & (0x8000 >> oi);
+                old_mask &= ~restore;
+            } else
+                v = dst[i];
+            *new_saved++ = v;
+            if (fg & bit)
+            {
+                dst[i] = mouse_foreground;
+                new_drawn[j] |= bit;
+            } else if (bg & bit)
+            {
+                dst[i] = mouse_background;
+                new_drawn[j] |= bit;
+            } else if (restore)
+                dst[i] = v;
+        }
+        if ((unsigned short)oj < (unsigned short)oh)
+            old_drawn[oj] = old_mask;
+    }
+    set_mouse_area(wk, x, y, w, h);
+
+    /* What is left of the old pointer outside the new area */
+    for (j = 0; j < oh; j++)
+    {
+        old_mask = old_drawn[j];
+        dst = screen + (oy + j) * wrap + ox;
+        for (i = 0; old_mask; i++)
+        {
+            if (old_mask & 0x8000)
+                dst[i] = old_saved[j * ow + i];
+            old_mask <<= 1;
+        }
+    }
+}
+
+
+#ifdef FAST
+/*
+ * Called before anything is drawn to (or read from) an area of the
+ * screen. A pointer that was only hidden lazily is taken away for
+ * real if it is in the way. When writing back, the pointer is never
+ * drawn over, so nothing needs to be done then.
+ */
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2)
+{
+    unsigned long state;
+
+    if (!mouse_lazy || dirty_video)
+        return;
+
+    state = mouse_save_state;
+    if ((x2 < mouse_area_x) || (x1 > mouse_area_x + (short)((state >> 28) & 0x0f)) ||
+        (y2 < mouse_area_y) || (y1 > mouse_area_y + (short)((state >> 24) & 0x0f)))
+        return;
+
+    dirty_lock++;                       /* Keep mouse_vbl() away */
+    if (mouse_lazy)
+    {
+        hide_mouse(wk);
+        mouse_lazy = 0;
+    }
+    dirty_lock--;
+}
+
+
+#ifdef __m68k__
+/*
+ * From the VBL queue.
+ * A lazily hidden pointer goes away here at the latest.
+ */
+static void mouse_vbl(void)
+{
+    if (!mouse_lazy || dirty_lock || ((char *)mouse_wk->screen.linea)[MOUSE_FLAG])
+        return;
+
+    hide_mouse(mouse_wk);
+    mouse_lazy = 0;
+}
+#endif
+#endif
+
+
 long CDECL c_mouse_draw(Workstation *wk, long x, long y, Mouse *mouse)
 {
     unsigned long state;
@@ -196,18 +424,59 @@ long CDECL c_mouse_draw(Workstation *wk, long x, long y, Mouse *mouse)
 
         if (!fix_shape)
             set_mouse_shape(mouse, mouse_data);
+        mouse_changed = 1;
         return 0;
     }
 
-    if (state && !no_restore && (mouseparm == 0 || mouseparm == 2 || mouseparm == 3 || mouseparm == 4))
-    {                                   /* Move or Hide */
-        hide_mouse(wk);
-    }
-
-    if (mouseparm == 0 || mouseparm == 3 || mouseparm == 4)
-    {                                   /* Move or Show */
+#ifdef FAST
+    dirty_lock++;                       /* No write-back while the pointer is moved */
+#endif
+    switch (mouseparm)
+    {
+    case 0:                             /* Move shown */
+    case 4:                             /* Move shown, forced */
+        if (state && !no_restore)
+        {
+            if (mouseparm == 4)
+            {
+                hide_mouse(wk);
+                draw_mouse(wk, (short)x, (short)y);
+            } else if (mouse_changed || ((short)x != mouse_at_x) || ((short)y != mouse_at_y))
+                move_mouse(wk, (short)x, (short)y);
+        } else
+            draw_mouse(wk, (short)x, (short)y);
+        mouse_lazy = 0;
+        break;
+    case 2:                             /* Hide */
+        if (state && !no_restore)
+        {
+#ifdef FAST
+            if (lazy_hide)
+            {
+                mouse_wk = wk;
+                mouse_lazy = 1;         /* Left until in the way, or VBL */
+                break;
+            }
+#endif
+            hide_mouse(wk);
+        }
+        break;
+    case 3:                             /* Show */
+        if (mouse_lazy && state)
+        {
+            mouse_lazy = 0;
+            if (mouse_changed || ((short)x != mouse_at_x) || ((short)y != mouse_at_y))
+                move_mouse(wk, (short)x, (short)y);
+            break;
+        }
+        if (state && !no_restore)
+            hide_mouse(wk);
         draw_mouse(wk, (short)x, (short)y);
+        break;
     }
+#ifdef FAST
+    dirty_lock--;
+#endif
 
     return 0;
 }
@@ -15,21 +15,48 @@
 #include "driver.h"
 #include "../bitplane/bitplane.h"
 #include "relocate.h"
+#include "16b_pixel.h"
 
 #define NOVA 0		/* 1 - byte swap 16 bit colour value (NOVA etc) */
 
+#if DEPTH == 16
 #define red_bits   5	/* 5 for all normal 16 bit hardware */
 #define green_bits 6	/* 6 for Falcon TC and NOVA 16 bit, 5 for NOVA 15 bit */
 /* (I think 15 bit Falcon TC disregards the green LSB) */
 #define blue_bits  5	/* 5 for all normal 16 bit hardware */
+#else
+#define red_bits   8	/* xRGB for 32 bit, hardware palette for 8 bit */
+#define green_bits 8
+#define blue_bits  8
+#endif
+
+#if DEPTH == 8
+/*
+ * With 8 bit pixels, 'real' is the hardware palette index
+ * of a VDI pen. Setting the hardware palette is up to the driver.
+ */
+static int pen_index(long pen)
+{
+    static signed char tos_colours[] = { 0, -1, 1, 2, 4, 6, 3, 5, 7, 8, 9, 10, 12, 14, 11, 13 };
+
+    if (pen == 255)
+        return 15;
+    else if (pen >= 16)
+        return pen;
+    else if (tos_colours[pen] < 0)
+        return 255;
+    else
+        return tos_colours[pen];
+}
+#endif
 
 
 long CDECL c_get_colour(Virtual *vwk, long colour)
 {
     Colour *local_palette, *global_palette;
     Colour *fore_pal, *back_pal;
-    unsigned short foreground, background;
-    unsigned short *realp;
+    unsigned long foreground, background;
+    unsigned PIXEL *realp;
 
     local_palette = vwk->palette;
     if (local_palette && !((long)local_palette & 1))    /* Complete local palette? */
@@ -47,11 +74,13 @@ long CDECL c_get_colour(Virtual *vwk, long colour)
             back_pal = global_palette;
     }
 
-    realp = (unsigned short *)&fore_pal[(short)colour].real;
+    realp = (unsigned PIXEL *)&fore_pal[(short)colour].real;
     foreground = *realp;
-    realp = (unsigned short *)&back_pal[colour >> 16].real;
+    if (DEPTH > 16)
+        return foreground;      /* No room for the background */
+    realp = (unsigned PIXEL *)&back_pal[colour >> 16].real;
     background = *realp;
-    return ((unsigned long)background << 16) | (unsigned long)foreground;
+    return (background << 16) | foreground;
 }
 
 
@@ -59,7 +88,7 @@ void CDECL c_get_colours(Virtual *vwk, long colour, unsigned long *foreground, u
 {
     Colour *local_palette, *global_palette;
     Colour *fore_pal, *back_pal;
-    unsigned short *realp;
+    unsigned PIXEL *realp;
 
     local_palette = vwk->palette;
     if (local_palette && !((long)local_palette & 1))    /* Complete local palette? */
@@ -77,9 +106,9 @@ void CDECL c_get_colours(Virtual *vwk, long colour, unsigned long *foreground, u
             back_pal = global_palette;
     }
 
-    realp = (unsigned short *)&fore_pal[(short)colour].real;
+    realp = (unsigned PIXEL *)&fore_pal[(short)colour].real;
     *foreground = *realp;
-    realp = (unsigned short *)&back_pal[colour >> 16].real;
+    realp = (unsigned PIXEL *)&back_pal[colour >> 16].real;
     *background = *realp;
 }
 
@@ -90,7 +119,7 @@ void CDECL c_set_colours(Virtual *vwk, long start, long entries, unsigned short
     unsigned short component;
     unsigned long tc_word;
     int i;
-    short *realp;
+    PIXEL *realp;
 
     (void) vwk;
     if ((long)requested & 1) {          /* New entries? */
@@ -100,24 +129,27 @@ void CDECL c_set_colours(Virtual *vwk, long start, long entries, unsigned short
             component = *requested++ >> 8;
             palette[start + i].vdi.red = (component * 1000L) / 255;
             palette[start + i].hw.red = component;  /* Not at all correct */
-            colour = component >> (16 - red_bits);  /* (component + (1 << (14 - red_bits))) */
+            colour = component >> (8 - red_bits);   /* (component + (1 << (6 - red_bits))) */
             tc_word = colour << green_bits;
             component = *requested++ >> 8;
             palette[start + i].vdi.green = (component * 1000L) / 255;
             palette[start + i].hw.green = component;    /* Not at all correct */
-            colour = component >> (16 - green_bits);    /* (component + (1 << (14 - green_bits))) */
+            colour = component >> (8 - green_bits);     /* (component + (1 << (6 - green_bits))) */
             tc_word |= colour;
             tc_word <<= blue_bits;
             component = *requested++ >> 8;
             palette[start + i].vdi.blue = (component * 1000L) / 255;
             palette[start + i].hw.blue = component; /* Not at all correct */
-            colour = component >> (16 - blue_bits);     /* (component + (1 << (14 - blue_bits))) */
+            colour = component >> (8 - blue_bits);      /* (component + (1 << (6 - blue_bits))) */
             tc_word |= colour;
 #if NOVA
             tc_word = ((tc_word & 0x000000ff) << 24) | ((tc_word & 0x0000ff00) <<  8) |
                       ((tc_word & 0x00ff0000) >>  8) | ((tc_word & 0xff000000) >> 24);
 #endif
-            realp = (short *)&palette[start + i].real;
+#if DEPTH == 8
+            tc_word = pen_index(start + i);
+#endif
+            realp = (PIXEL *)&palette[start + i].real;
             *realp = tc_word;
         }
     } else {
@@ -141,7 +173,10 @@ void CDECL c_set_colours(Virtual *vwk, long start, long entries, unsigned short
 #if NOVA
             tc_word = (tc_word << 8) | (tc_word >> 8);
 #endif
-            realp = (short *)&palette[start + i].real;
+#if DEPTH == 8
+            tc_word = pen_index(start + i);
+#endif
+            realp = (PIXEL *)&palette[start + i].real;
             *realp = tc_word;
         }
     }
@@ -0,0 +1,94 @@
+#ifndef PIXEL_H
+#define PIXEL_H
+
+/*
+ * Pixel format for the 16_bit drawing routines.
+ *
+ * The routines are written for chunky pixels of any size that
+ * fits a long word a whole number of times. Defining DEPTH as
+ * 8, 16 or 32 before including them (16 if not defined) gives
+ * a version for that number of bits per pixel.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#ifndef DEPTH
+#define DEPTH       16
+#endif
+
+#ifndef PIXEL_32
+#define PIXEL_32    long        /* Long word, which is not a long on all hosts */
+#endif
+
+#if DEPTH == 8
+#define PIXEL       char
+#elif DEPTH == 16
+#define PIXEL       short
+#elif DEPTH == 32
+#define PIXEL       PIXEL_32
+#else
+#error Unsupported DEPTH, only 8, 16 and 32 bit pixels are available
+#endif
+
+#define PIXEL_SIZE  (DEPTH / 8)
+#define PIXEL_PER_LONG  (4 / PIXEL_SIZE)
+
+/* A long word with all pixels of the given colour */
+#if DEPTH == 8
+#define PIXEL_LONG(c)   ((unsigned PIXEL_32)((c) & 0xff) * 0x01010101UL)
+#elif DEPTH == 16
+#define PIXEL_LONG(c)   ((unsigned PIXEL_32)((c) & 0xffff) * 0x00010001UL)
+#else
+#define PIXEL_LONG(c)   ((unsigned PIXEL_32)(c))
+#endif
+
+/*
+ * A long word of pixels at an address that need not be long word
+ * aligned, such as a blit source. From the 68020 on that is fine, and
+ * a 68000/68010 only needs an even address, which 16 and 32 bit pixels
+ * always have. 8 bit pixels there go a byte at a time. Other hosts
+ * (see utility/bench) go through memcpy, which compilers turn into
+ * plain loads and stores where the CPU allows it.
+ */
+#if defined(__m68k__) && (defined(__mc68020__) || defined(__mc68030__) || defined(__mc68040__) || \
+                          defined(__mc68060__) || defined(__mcoldfire__) || (DEPTH != 8))
+#define GET_LONG(p)     (*(PIXEL_32 *)(p))
+#define SET_LONG(p, v)  (*(PIXEL_32 *)(p) = (v))
+#elif defined(__m68k__)
+static inline PIXEL_32 get_long(const void *p)
+{
+    const unsigned char *b = p;
+
+    return ((unsigned PIXEL_32)b[0] << 24) | ((unsigned PIXEL_32)b[1] << 16) |
+           ((unsigned PIXEL_32)b[2] << 8) | b[3];
+}
+
+static inline void set_long(void *p, unsigned PIXEL_32 v)
+{
+    unsigned char *b = p;
+
+    b[0] = v >> 24;
+    b[1] = v >> 16;
+    b[2] = v >> 8;
+    b[3] = v;
+}
+
+#define GET_LONG(p)     get_long(p)
+#define SET_LONG(p, v)  set_long((p), (v))
+#else
+#include <string.h>
+
+static inline PIXEL_32 get_long(const void *p)
+{
+    PIXEL_32 v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+#define GET_LONG(p)     get_long(p)
+#define SET_LONG(p, v)  do { PIXEL_32 v_ = (v); memcpy((p), &v_, sizeof(v_)); } while (0)
+#endif
+
+#endif
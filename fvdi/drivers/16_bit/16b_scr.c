@@ -16,8 +16,7 @@
 #include "../bitplane/bitplane.h"
 #include "relocate.h"
 
-#define PIXEL       short
-#define PIXEL_SIZE  sizeof(PIXEL)
+#include "16b_pixel.h"
 
 /* destination MFDB (odd address marks table operation)
  * x or table address
@@ -34,6 +33,9 @@ c_write_pixel(Virtual *vwk, MFDB *dst, long x, long y, long colour)
 
     wk = vwk->real_address;
     if (!dst || !dst->address || (dst->address == wk->screen.mfdb.address)) {
+#ifdef FAST
+        mouse_keep_out(wk, x, y, x, y);
+#endif
         offset = wk->screen.wrap * y + x * PIXEL_SIZE;
 #ifdef BOTH
         if (wk->screen.shadow.address) {
@@ -41,6 +43,9 @@ c_write_pixel(Virtual *vwk, MFDB *dst, long x, long y, long colour)
         }
 #endif
         *(PIXEL *)((long)wk->screen.mfdb.address + offset) = colour;
+#ifdef FAST
+        dirty_mark(x, y, x, y);
+#endif
     } else {
         offset = (dst->wdwidth * 2 * dst->bitplanes) * y + x * PIXEL_SIZE;
         *(PIXEL *)((long)dst->address + offset) = colour;
@@ -67,6 +72,9 @@ c_read_pixel(Virtual *vwk, MFDB *src, long x, long y)
         } else
 #endif
         {
+#ifdef FAST
+            mouse_keep_out(wk, x, y, x, y);
+#endif
             colour = *(unsigned PIXEL *)((long)wk->screen.mfdb.address + offset);
         }
     } else {
@@ -42,10 +42,11 @@ long CDECL (*read_pixel_r)(Virtual *vwk, MFDB *mfdb, long x, long y) = c_read_pi
 long CDECL (*line_draw_r)(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode) = c_line_draw;
 long CDECL (*expand_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation, long colour) = c_expand_area;
 long CDECL (*fill_area_r)(Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style) = c_fill_area;
-long CDECL (*fill_poly_r)(Virtual *vwk, short points[], long n, short index[], long moves, short *pattern, long colour, long mode, long interior_style) = 0;
+long CDECL (*fill_poly_r)(Virtual *vwk, short points[], long n, short index[], long moves, short *pattern, long colour, long mode, long interior_style) = c_fill_poly;
 long CDECL (*blit_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation) = c_blit_area;
 long CDECL (*text_area_r)(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets) = 0;
 long CDECL (*mouse_draw_r)(Workstation *wk, long x, long y, Mouse *mouse) = c_mouse_draw;
+long CDECL (*blend_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour) = c_blend_area;
 
 long CDECL (*get_colour_r)(Virtual *vwk, long colour) = c_get_colour;
 void CDECL (*get_colours_r)(Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background) = 0;
@@ -53,13 +54,15 @@ void CDECL (*set_colours_r)(Virtual *vwk, long start, long entries, unsigned sho
 
 long wk_extend = 0;
 short accel_s = 0;
-short accel_c = A_SET_PAL | A_GET_COL | A_SET_PIX | A_GET_PIX | A_BLIT | A_FILL | A_EXPAND | A_LINE | A_MOUSE;
+short accel_c = A_SET_PAL | A_GET_COL | A_SET_PIX | A_GET_PIX | A_BLIT | A_FILL | A_FILLPOLY | A_EXPAND | A_LINE | A_MOUSE;
 
 const Mode *graphics_mode = &mode[0];
 
 short shadow = 0;
+short writeback = 0;
 short fix_shape = 0;
 short no_restore = 0;
+short lazy_hide = 0;
 
 #if 0
 short cache_img = 0;
@@ -203,9 +206,11 @@ static Option const options[] = {
     {"screencache", { &cache_from_screen }, 1 }, /* screencache, turn on caching of images blitted from the screen */
 #endif
     {"shadow",     { &shadow }, 1 },             /* shadow, use a FastRAM buffer */
+    {"writeback",  { &writeback }, 1 },          /* writeback, draw only in the FastRAM buffer and copy to screen later */
     {"debug",      { &debug }, 2 },              /* debug, turn on debugging aids */
     {"fixshape",   { &fix_shape }, 1 },          /* fixed shape; do not allow mouse shape changes */
     {"norestore",  { &no_restore }, 1 },
+    {"lazyhide",   { &lazy_hide }, 1 },          /* lazyhide, leave a hidden pointer on screen until drawn over or the next VBL */
 };
 
 
@@ -275,6 +280,22 @@ void check_token(char *token, const char **ptr)
 #endif
 
 
+#ifdef FAST
+static void mouse_vbl(void);    /* 16b_mouse.c */
+
+/*
+ * Called (in supervisor mode) when fVDI is removed.
+ */
+static void CDECL shutdown(Virtual *vwk)
+{
+    (void) vwk;
+
+    remove_vbl(mouse_vbl);
+    dirty_shutdown();           /* Whatever was not yet written back */
+}
+#endif
+
+
 /*
  * Do whatever setup work might be necessary on boot up
  * and which couldn't be done directly while loading.
@@ -394,11 +415,35 @@ long CDECL initialize(Virtual *vwk)
             wk->screen.shadow.address = 0;
         }
 #ifndef BOTH
-        wk->screen.mfdb.address = wk->screen.shadow.address;
+        writeback = 1;
 #endif
+        if (writeback && wk->screen.shadow.address)
+        {
+            /* All drawing to the shadow, which is copied to screen on VBL */
+            access->funcs.copymem(wk->screen.mfdb.address, wk->screen.shadow.address, (long)fast_w_bytes * wk->screen.mfdb.height);
+            dirty_init(wk, wk->screen.mfdb.address);
+            if (install_vbl(dirty_vbl))
+            {
+                wk->screen.mfdb.address = wk->screen.shadow.address;
+                wk->screen.shadow.address = 0;
+            } else
+            {
+                dirty_init(wk, 0);
+#ifndef BOTH
+                wk->screen.shadow.address = 0;
+#endif
+                access->funcs.error("No free VBL slot, writeback disabled.", 0);
+            }
+        }
     }
+    if (lazy_hide && !install_vbl(mouse_vbl))
+    {
+        lazy_hide = 0;
+        access->funcs.error("No free VBL slot, lazyhide disabled.", 0);
+    }
+    me->module.shutdown = shutdown;
 #endif
-    if (!wk->screen.shadow.address)
+    if (!wk->screen.shadow.buffer)
         driver_name[20] = 0;
 
     wk->mouse.position.x = ((wk->screen.coordinates.max_x - wk->screen.coordinates.min_x + 1) >> 1) + wk->screen.coordinates.min_x;
@@ -423,6 +468,12 @@ long CDECL setup(long type, long value)
     case S_DRVOPTION:
         ret = tokenize((char *) value);
         break;
+#ifdef FAST
+    case S_UPDATE:
+        dirty_update();
+        ret = 1;
+        break;
+#endif
     }
 
     return ret;
@@ -133,6 +133,18 @@ long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
 }
 
 
+/*
+ * The host already knows how to alpha expand an 8 bit chunky
+ * MFDB, so the whole coverage buffer goes over in one call.
+ */
+long CDECL c_blend_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
+    long dst_x, long dst_y, long w, long h,
+    long mode, long colour)
+{
+    return c_expand_area(vwk, src, src_x, src_y, 0, dst_x, dst_y, w, h, mode, colour);
+}
+
+
 long CDECL c_fill_area(Virtual *vwk, long x, long y, long w, long h, short *pattern,
     long colour, long mode, long interior_style)
 {
@@ -109,6 +109,7 @@ long CDECL (*fill_poly_r)(Virtual *vwk, short points[], long n, short index[], l
 long CDECL (*blit_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation) = c_blit_area;
 long CDECL (*text_area_r)(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets) = c_text_area;
 long CDECL (*mouse_draw_r)(Workstation *wk, long x, long y, Mouse *mouse) = c_mouse_draw;
+long CDECL (*blend_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour) = c_blend_area;
 
 long CDECL (*get_colour_r)(Virtual *vwk, long colour) = c_get_colour_16;
 void CDECL (*get_colours_r)(Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background) = c_get_colours_16;
@@ -1,5 +1,12 @@
 extern short fix_shape;
 extern short no_restore;
+extern short lazy_hide;
+extern short hardware_blit;
+extern short chunky_shadow;
+
+#ifndef LONG_32
+#define LONG_32     long        /* Long word, which is not a long on all hosts */
+#endif
 
 long CDECL x_get_colour(Workstation *wk, long colour);
 void CDECL x_get_colours(Workstation *wk, long colour, short *foreground, short *background);
@@ -13,5 +20,15 @@ long CDECL c_read_pixel(Virtual *vwk, MFDB *mfdb, long x, long y);
 long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
 long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation, long colour);
 long CDECL c_fill_area(Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style);
+long CDECL c_fill_poly(Virtual *vwk, short points[], long n, short index[], long moves, short *pattern, long colour, long mode, long interior_style);
 long CDECL c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+long CDECL c_text_area(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets);
 long CDECL c_mouse_draw(Workstation *wk, long x, long y, Mouse *mouse);
+long CDECL c_blend_area(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour);
+
+long blitter_fill(Virtual *vwk, long x1, long y1, long w, long h, short *pattern, int patadd, unsigned short colour, long mode);
+long mouse_shown(short *x, short *y);
+
+long chunky_init(Workstation *wk);
+void chunky_screen(short *video);
+void chunky_update(void);
@@ -89,9 +89,100 @@ struct blit
 };
 
 
+/*
+ * The real BLiTTER (Mega ST, STE, Mega STE, Falcon).
+ * From $ffff8a20 on, its registers have the layout of struct blit,
+ * so the values set up for do_blit() are used as they are, apart from
+ * FXSR/NFSR that the chip wants in the skew register rather than in
+ * 'hop'. In front of the registers are the 16 halftone (pattern) words.
+ * The chip can only reach ST RAM.
+ */
+#if defined(__m68k__) && !defined(__mcoldfire__)
+#define HW_BLITTER
+#endif
+
+#ifdef BLITTER_MODEL
+/* A software model of the chip instead (see utility/bench/check_blitter.c) */
+#define HW_BLITTER
+extern unsigned short blitter_halftone[16];
+extern struct blit blitter_registers;
+void blitter_run(void);
+#endif
+
+#ifdef HW_BLITTER
+#ifdef BLITTER_MODEL
+#define BLITTER_HALFTONE (blitter_halftone)
+#define BLITTER          (&blitter_registers)
+#else
+#define BLITTER_HALFTONE ((volatile unsigned short *)0xffff8a00L)
+#define BLITTER          ((volatile struct blit *)0xffff8a20L)
+#endif
+
+#define HOP_HALFTONE    1
+#define HOP_SOURCE      2
+
+#define BUSY            0x80
+#define HOG             0x40
+
+#ifdef BLITTER_MODEL
+#define ST_RAM_END      (~0UL)          /* Reaches everything */
+#else
+#define ST_RAM_END      0x00e00000L
+#endif
+
+#define HW_MIN_WORDS    8               /* Smaller blits are done by the CPU */
+#define HW_MAX_HOG      512             /* Larger blits share the bus */
+
+/*
+ * Run a single plane on the chip.
+ * Small jobs are done in hog mode, where the CPU is stopped until
+ * the chip is finished. For larger ones the bus is shared, so that
+ * interrupts are not held off for too long, and the chip is
+ * restarted until it is done (as recommended by Atari).
+ */
+static void hw_blit(struct blit *blt, short hop, short line)
+{
+    volatile struct blit *hw = BLITTER;
+
+    hw->src_x_inc = blt->src_x_inc;
+    hw->src_y_inc = blt->src_y_inc;
+    hw->src_addr = blt->src_addr;
+    hw->end_1 = blt->end_1;
+    hw->end_2 = blt->end_2;
+    hw->end_3 = blt->end_3;
+    hw->dst_x_inc = blt->dst_x_inc;
+    hw->dst_y_inc = blt->dst_y_inc;
+    hw->dst_addr = blt->dst_addr;
+    hw->x_cnt = blt->x_cnt;
+    hw->y_cnt = blt->y_cnt;
+    hw->hop = hop;
+    hw->op = blt->op;
+    hw->skew = (blt->hop & (FXSR | NFSR)) | (blt->skew & SKEW);
+
+    if ((long)blt->x_cnt * blt->y_cnt <= HW_MAX_HOG)
+        hw->status = BUSY | HOG | line;
+    else
+        hw->status = BUSY | line;
+
+#ifdef BLITTER_MODEL
+    blitter_run();
+#else
+    __asm__ __volatile__(
+        "1:\n"
+        " bset.b #7,(%0)\n"
+        " nop\n"
+        " jbne 1b\n"
+        :
+        : "a"(&hw->status)
+        : "cc", "memory");
+#endif
+}
+#endif
+
+
 static void do_blit_short_32(struct blit *blt)
 {
-    unsigned long blt_src_in;
+    unsigned LONG_32 blt_src_in;
     unsigned short blt_src_out, blt_dst_in;
     int yc;
     char skew;
@@ -213,7 +304,7 @@ static void do_blit_short_32(struct blit *blt)
 
 static void do_blit_short(struct blit *blt)
 {
-    unsigned long blt_src_in;
+    unsigned LONG_32 blt_src_in;
     unsigned short blt_src_out, blt_dst_in;
     int yc;
     char skew;
@@ -326,14 +417,14 @@ static void do_blit_short(struct blit *blt)
 
 static void do_blit(struct blit *blt)
 {
-    unsigned long blt_src_in;
+    unsigned LONG_32 blt_src_in;
     unsigned short blt_src_out, blt_dst_in, blt_dst_out;
     int xc, yc;
     char skew;
     unsigned short *dst_addr;
     unsigned short *src_addr;
     long src_x_inc, dst_x_inc, src_y_inc, dst_y_inc;
-    unsigned long end_1;
+    unsigned LONG_32 end_1;
 
 #if DBG_BLIT
     kprintf("bitblt: Start\n");
@@ -364,7 +455,7 @@ static void do_blit(struct blit *blt)
     dst_y_inc = blt->dst_y_inc;
     src_x_inc = blt->src_x_inc;
     dst_x_inc = blt->dst_x_inc;
-    end_1 = ((unsigned long) blt->end_3 << 16) | (unsigned short) blt->end_1;
+    end_1 = ((unsigned LONG_32) (unsigned short) blt->end_3 << 16) | (unsigned short) blt->end_1;
 
     if (blt->op < 2)
         end_1 = ~end_1;
@@ -480,7 +571,7 @@ static void do_blit(struct blit *blt)
             } else
             {
                 blt_src_in >>= 16;
-                blt_src_in |= (unsigned long)(*src_addr) << 16;
+                blt_src_in |= (unsigned LONG_32)(*src_addr) << 16;
             }
             src_addr += src_x_inc >> 1;
 
@@ -571,7 +662,7 @@ static void do_blit(struct blit *blt)
                 src_addr -= src_x_inc >> 1;
             } else
             {
-                blt_src_in |= (unsigned long)(*src_addr) << 16;
+                blt_src_in |= (unsigned LONG_32)(*src_addr) << 16;
             }
         }
 
@@ -678,6 +769,9 @@ static void bit_blt(struct blit_frame *info)
     unsigned long s_addr, d_addr;
     struct blit blitter;
     struct blit *blt = &blitter;
+#ifdef HW_BLITTER
+    short hw;
+#endif
 
     /* Setting of skew flags */
 
@@ -767,9 +861,7 @@ static void bit_blt(struct blit_frame *info)
     {
         /* Merge both end masks into Endmask1. */
         lendmask &= rendmask;           /* Single word end mask */
-#if 0
-        rendmask = lendmask;
-#endif
+        rendmask = lendmask;            /* Either may end up in Endmask1 */
         skew_idx |= 0x0004;             /* Single word dst */
         /* The other end masks will be ignored by the BLiTTER */
     }
@@ -858,7 +950,27 @@ static void bit_blt(struct blit_frame *info)
     blt->skew = skew & 0x0f;
     blt->hop = skew_flags[skew_idx];
 
-    for (plane = info->plane_ct - 1; plane >= 0; plane--)
+#ifdef HW_BLITTER
+    hw = hardware_blit &&
+         (long)blt->x_cnt * info->b_ht >= HW_MIN_WORDS &&
+         (unsigned long)info->s_form < ST_RAM_END &&
+         (unsigned long)info->d_form < ST_RAM_END;
+
+    /*
+     * do_blit() uses the single source word twice when it needs to be
+     * shifted left into a single destination word, but the chip would
+     * take the missing bits from whatever it read last. Have it read
+     * the same word twice instead, so that nothing outside the source
+     * (possibly outside memory) is touched.
+     */
+    if (hw && skew_idx == 7)
+    {
+        blt->hop |= FXSR;
+        blt->src_x_inc = 0;
+    }
+#endif
+
+    for (plane = 0; plane < info->plane_ct; plane++)
     {
         int op_tabidx;
 
@@ -866,16 +978,120 @@ static void bit_blt(struct blit_frame *info)
         blt->dst_addr = (unsigned short *)d_addr;         /* Load Dest ptr to this plane */
         blt->y_cnt = info->b_ht;        /* Load the line count */
 
-        /* Calculate operation for actual plane */
+        /* Calculate operation for actual plane, colour bit n is plane n */
         op_tabidx = ((info->fg_col >> plane) & 0x0001) << 1;
         op_tabidx |= (info->bg_col >> plane) & 0x0001;
         blt->op = info->op_tab[op_tabidx] & 0x000f;
 
-        do_blit(blt);
+#ifdef HW_BLITTER
+        if (hw)
+            hw_blit(blt, HOP_SOURCE, 0);
+        else
+#endif
+            do_blit(blt);
 
         s_addr += info->s_nxpl;         /* a0-> start of next src plane */
         d_addr += info->d_nxpl;         /* a1-> start of next dst plane */
     }
+
+#ifdef HW_BLITTER
+    if (hw && hardware_blit > 1)
+        access->funcs.cache_flush();    /* The chip went past the data cache */
+#endif
+}
+
+
+/*
+ * Fill a rectangle on the screen using the BLiTTER, with the pattern in
+ * the halftone registers. The operation for each plane depends on the
+ * writing mode and that plane's bit of the colour, just as in draw_rect().
+ * With patadd 16, each plane has its own pattern (multifill).
+ * Returns 0 when the CPU should do the fill instead.
+ */
+long blitter_fill(Virtual *vwk, long x1, long y1, long w, long h, short *pattern, int patadd, unsigned short colour, long mode)
+{
+#ifdef HW_BLITTER
+    static const unsigned char ops[4][2] = {
+        { 0, 3 },                       /* Replace: D' <- 0      D' <- S */
+        { 4, 7 },                       /* Transparent: [not S] and D, S or D */
+        { 6, 6 },                       /* XOR: S xor D */
+        { 1, 13 }                       /* Reverse transparent: S and D, [not S] or D */
+    };
+    Workstation *wk = vwk->real_address;
+    struct blit blitter;
+    struct blit *blt = &blitter;
+    unsigned long d_addr;
+    long x2;
+    short span, plane, planes, i;
+
+    if (!hardware_blit || (unsigned long)wk->screen.mfdb.address >= ST_RAM_END)
+        return 0;
+
+    x2 = x1 + w - 1;
+    span = (x2 >> 4) - (x1 >> 4);
+    if ((long)(span + 1) * h < HW_MIN_WORDS)
+        return 0;
+
+    planes = wk->screen.mfdb.bitplanes;
+    mode = (mode - 1) & 3;
+
+    for (i = 0; i < 16; i++)
+        BLITTER_HALFTONE[i] = pattern[i];
+
+    blt->end_1 = 0xffff >> (x1 & 0x0f);
+    blt->end_2 = 0xffff;
+    blt->end_3 = ~(0x7fff >> (x2 & 0x0f));
+    if (!span)
+        blt->end_1 &= blt->end_3;
+
+    /* No source is read with only the halftone selected */
+    blt->src_x_inc = 0;
+    blt->src_y_inc = 0;
+    blt->dst_x_inc = planes * 2;
+    blt->dst_y_inc = wk->screen.wrap - planes * 2 * span;
+    blt->x_cnt = span + 1;
+    blt->hop = 0;
+    blt->skew = 0;
+
+    d_addr = (unsigned long)wk->screen.mfdb.address +
+             y1 * (long)wk->screen.wrap + (x1 >> 4) * planes * 2;
+
+    for (plane = 0; plane < planes; plane++)
+    {
+        if (patadd && plane)
+        {
+            pattern += patadd;
+            for (i = 0; i < 16; i++)
+                BLITTER_HALFTONE[i] = pattern[i];
+        }
+        blt->src_addr = (unsigned short *)d_addr;
+        blt->dst_addr = (unsigned short *)d_addr;
+        blt->y_cnt = h;
+        blt->op = ops[mode][colour & 1];
+
+        hw_blit(blt, HOP_HALFTONE, y1 & 0x0f);  /* Pattern row follows y */
+
+        d_addr += 2;
+        colour >>= 1;
+    }
+
+    if (hardware_blit > 1)
+        access->funcs.cache_flush();
+
+    return 1;
+#else
+    (void) vwk;
+    (void) x1;
+    (void) y1;
+    (void) w;
+    (void) h;
+    (void) pattern;
+    (void) patadd;
+    (void) colour;
+    (void) mode;
+
+    return 0;
+#endif
 }
 
 
@@ -1047,7 +1263,7 @@ long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
         info.op_tab[0] = 01;            /* fg:0 bg:0  D' <- S and D */
         info.op_tab[1] = 13;            /* fg:0 bg:1  D' <- [not S] or D */
         info.fg_col = 0;                /* We're only interested in one color */
-        info.bg_col = background;       /* Save the color of interest */
+        info.bg_col = foreground;       /* Zeros drawn in the foreground, as in the other drivers */
         break;
 
     default:
@@ -1077,11 +1293,11 @@ long CDECL c_read_pixel(Virtual *vwk, MFDB *mfdb, long x, long y)
     c_blit_area(vwk, mfdb, x, y, &dst, 15, 0, 1, 1, 3);
 
     colour = 0;
-    ptr = pixel;
+    ptr = pixel + mfdb->bitplanes;      /* Plane n is bit n */
     for (i = mfdb->bitplanes - 1; i >= 0; --i)
     {
         colour *= 2;
-        colour += *ptr++ & 1;
+        colour += *--ptr & 1;
     }
 
     return colour;
@@ -1112,6 +1328,23 @@ long CDECL c_write_pixel(Virtual *vwk, MFDB *mfdb, long x, long y, long colour)
 }
 
 
+static volatile long save_state = 0;   /* Pointer background saved, see mouse.c */
+static short mouse_x, mouse_y;          /* Position the pointer was last drawn for */
+
+
+/*
+ * Tell if the mouse pointer is on screen,
+ * and what position it was drawn for.
+ */
+long mouse_shown(short *x, short *y)
+{
+    *x = mouse_x;
+    *y = mouse_y;
+
+    return save_state != 0;
+}
+
+
 static short set_mouse_colours(Workstation *wk)
 {
     int foreground, background;
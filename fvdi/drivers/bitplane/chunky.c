@@ -0,0 +1,473 @@
+/*
+ * Bitplane chunky shadow
+ *
+ * With the 'chunky' option, all drawing to the screen is done in
+ * an eight bit per pixel buffer in (Fast)RAM, using the 16_bit
+ * driver routines built for 8 bit pixels. What has been changed is
+ * remembered as a bitmap of screen tiles (see ../common/dirty.c),
+ * and only those tiles are converted to the interleaved bitplanes
+ * of the real screen, from the VBL queue (or on v_updwk).
+ *
+ * Blits between the screen and memory go through a small buffer of
+ * bitplanes, so that the ordinary bitplane code can deal with the
+ * memory side of them.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+#include "driver.h"
+#include "relocate.h"
+#include "bitplane.h"
+#include "c2p8.h"
+
+#define FAST            /* The drawing routines tell what they changed */
+#define DEPTH       8   /* Odd pixel addresses, 16b_pixel.h GET_LONG copes on a 68000 */
+
+static void dirty_mark(long x1, long y1, long x2, long y2);
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2);
+
+/* The 8 bit versions of the drawing routines */
+#define c_write_pixel   c8_write_pixel
+#define c_read_pixel    c8_read_pixel
+#define c_line_draw     c8_line_draw
+#define c_expand_area   c8_expand_area
+#define c_fill_area     c8_fill_area
+#define c_fill_poly     c8_fill_poly
+#define c_blit_area     c8_blit_area
+
+#include "../16_bit/16b_scr.c"
+#include "../16_bit/16b_exp.c"
+#include "../16_bit/16b_blit.c"
+#include "../16_bit/16b_line.c"
+#include "../16_bit/16b_fill.c"
+
+#undef c_write_pixel
+#undef c_read_pixel
+#undef c_line_draw
+#undef c_expand_area
+#undef c_fill_area
+#undef c_fill_poly
+#undef c_blit_area
+
+#define DIRTY_PIXEL unsigned short   /* The real screen is interleaved bitplanes */
+
+#include "../common/dirty.c"
+
+short chunky_shadow = 0;
+
+static short dirty_wrap;        /* Of the real screen */
+
+static unsigned short strip_buffer[4096];   /* Bitplanes for screen <-> memory blits */
+
+
+/*
+ * Convert an area of whole 16 pixel groups from chunky to bitplanes.
+ * The wraps are in bytes.
+ */
+static void area_to_planes(unsigned char *src, int src_wrap, unsigned short *dst, int dst_wrap,
+                           int groups, int h, int planes)
+{
+    unsigned char *s;
+    unsigned short *d;
+    int i;
+
+    for (; h > 0; h--)
+    {
+        s = src;
+        d = dst;
+        for (i = groups; i > 0; i--)
+        {
+            chunky8_to_planes(s, d, planes);
+            s += 16;
+            d += planes;
+        }
+        src += src_wrap;
+        dst = (unsigned short *)((long)dst + dst_wrap);
+    }
+}
+
+
+/*
+ * Convert an area of whole 16 pixel groups from bitplanes to chunky.
+ */
+static void area_to_chunky(unsigned short *src, int src_wrap, unsigned char *dst, int dst_wrap,
+                           int groups, int h, int planes)
+{
+    unsigned short *s;
+    unsigned char *d;
+    int i;
+
+    for (; h > 0; h--)
+    {
+        s = src;
+        d = dst;
+        for (i = groups; i > 0; i--)
+        {
+            planes_to_chunky8(s, d, planes);
+            s += planes;
+            d += 16;
+        }
+        src = (unsigned short *)((long)src + src_wrap);
+        dst += dst_wrap;
+    }
+}
+
+
+/*
+ * The mouse pointer lives on the real screen, so there is
+ * nothing to keep it away from in the shadow.
+ */
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2)
+{
+    (void) wk;
+    (void) x1;
+    (void) y1;
+    (void) x2;
+    (void) y2;
+}
+
+
+/*
+ * The ordinary bitplane mouse routines, on the real screen.
+ */
+static long CDECL chunky_mouse_draw(Workstation *wk, long x, long y, Mouse *mouse)
+{
+    short *shadow;
+    short wrap;
+    long ret;
+
+    shadow = wk->screen.mfdb.address;
+    wrap = wk->screen.wrap;
+    wk->screen.mfdb.address = (short *)dirty_video;
+    wk->screen.wrap = dirty_wrap;
+    ret = c_mouse_draw(wk, x, y, mouse);
+    wk->screen.mfdb.address = shadow;
+    wk->screen.wrap = wrap;
+
+    return ret;
+}
+
+
+/*
+ * Check if any dirty tile is below the mouse pointer
+ * (drawn for the given position).
+ */
+static int mouse_dirty(Workstation *wk, short x, short y)
+{
+    unsigned long bits;
+    int col1, col2, row, row2;
+
+    x -= wk->mouse.hotspot.x;
+    y -= wk->mouse.hotspot.y;
+    col1 = x < 0 ? 0 : (x & ~15) >> dirty_x_shift;
+    col2 = ((x | 15) + 16) >> dirty_x_shift;
+    row = y < 0 ? 0 : y >> dirty_y_shift;
+    row2 = (y + 15) >> dirty_y_shift;
+    if (col2 > 31)
+        col2 = 31;
+    if (row2 > ((dirty_height - 1) >> dirty_y_shift))
+        row2 = (dirty_height - 1) >> dirty_y_shift;
+    if (col1 > col2)
+        return 0;
+
+    bits = (0xffffffffUL >> (31 - (col2 - col1))) << col1;
+    for (; row <= row2; row++)
+    {
+        if (dirty_rows[row] & bits)
+            return 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Convert a run of dirty tiles to the real screen.
+ */
+static void dirty_copy(short x1, short y1, short x2, short y2)
+{
+    int planes, wrap;
+
+    planes = dirty_wk->screen.mfdb.bitplanes;
+    wrap = dirty_wk->screen.wrap;
+    area_to_planes((unsigned char *)dirty_wk->screen.mfdb.address + (long)y1 * wrap + x1, wrap,
+                   dirty_video + ((long)y1 * dirty_wrap + (x1 >> 4) * planes * 2) / 2, dirty_wrap,
+                   (x2 - x1) >> 4, y2 - y1, planes);
+}
+
+
+/*
+ * Convert all dirty tiles to the real screen.
+ * The mouse pointer is taken away while that happens
+ * below it, and then drawn on the new background.
+ */
+static void dirty_flush(void)
+{
+    short mx, my, lifted;
+
+    lifted = 0;
+    if (mouse_shown(&mx, &my) && mouse_dirty(dirty_wk, mx, my))
+    {
+        chunky_mouse_draw(dirty_wk, 0, 0, (Mouse *)2);
+        lifted = 1;
+    }
+
+    dirty_tiles();
+
+    if (lifted)
+        chunky_mouse_draw(dirty_wk, mx, my, (Mouse *)3);
+}
+
+
+/*
+ * Flush from normal code (v_updwk).
+ */
+void chunky_update(void)
+{
+    dirty_update();
+}
+
+
+/*
+ * Called (in supervisor mode) when fVDI is removed.
+ */
+static void CDECL chunky_shutdown(Virtual *vwk)
+{
+    (void) vwk;
+
+#ifdef __m68k__
+    dirty_shutdown();
+#endif
+}
+
+
+static int is_screen(Workstation *wk, MFDB *mfdb)
+{
+    return !mfdb || !mfdb->address || (mfdb->address == wk->screen.mfdb.address);
+}
+
+
+static long CDECL chunky_write_pixel(Virtual *vwk, MFDB *mfdb, long x, long y, long colour)
+{
+    if (((long)vwk & 1) || is_screen(vwk->real_address, mfdb))
+        return c8_write_pixel(vwk, mfdb, x, y, colour);
+
+    return c_write_pixel(vwk, mfdb, x, y, colour);
+}
+
+
+static long CDECL chunky_read_pixel(Virtual *vwk, MFDB *mfdb, long x, long y)
+{
+    Workstation *wk;
+
+    wk = vwk->real_address;
+    if (is_screen(wk, mfdb))
+        return c8_read_pixel(vwk, mfdb, x, y) & ((1 << wk->screen.mfdb.bitplanes) - 1);
+
+    return c_read_pixel(vwk, mfdb, x, y);
+}
+
+
+static long CDECL chunky_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst,
+                                     long dst_x, long dst_y, long w, long h, long operation, long colour)
+{
+    if (is_screen(((Virtual *)((long)vwk & ~1))->real_address, dst))
+        return c8_expand_area(vwk, src, src_x, src_y, dst, dst_x, dst_y, w, h, operation, colour);
+
+    return c_expand_area(vwk, src, src_x, src_y, dst, dst_x, dst_y, w, h, operation, colour);
+}
+
+
+/*
+ * Blits between the screen and memory are done in strips,
+ * via bitplanes converted from/to the screen area.
+ */
+static long CDECL chunky_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst,
+                                   long dst_x, long dst_y, long w, long h, long operation)
+{
+    Workstation *wk;
+    MFDB strip;
+    unsigned char *shadow;
+    int from_screen, to_screen, planes, groups, rows, n;
+    short x, y;
+
+    wk = vwk->real_address;
+    from_screen = is_screen(wk, src);
+    to_screen = is_screen(wk, dst);
+    if (from_screen && to_screen)
+        return c8_blit_area(vwk, src, src_x, src_y, dst, dst_x, dst_y, w, h, operation);
+    if (!from_screen && !to_screen)
+        return c_blit_area(vwk, src, src_x, src_y, dst, dst_x, dst_y, w, h, operation);
+
+    if ((w <= 0) || (h <= 0))
+        return 1;
+
+    x = to_screen ? dst_x : src_x;
+    y = to_screen ? dst_y : src_y;
+    planes = wk->screen.mfdb.bitplanes;
+    groups = ((x + w - 1) >> 4) - (x >> 4) + 1;
+    rows = sizeof(strip_buffer) / (groups * planes * 2);
+
+    strip.address = (short *)strip_buffer;
+    strip.width = groups * 16;
+    strip.wdwidth = groups;
+    strip.standard = 0;
+    strip.bitplanes = planes;
+
+    shadow = (unsigned char *)wk->screen.mfdb.address + (x & ~15);
+    for (; h > 0; h -= n)
+    {
+        n = h < rows ? h : rows;
+        strip.height = n;
+        area_to_planes(shadow + (long)y * wk->screen.wrap, wk->screen.wrap,
+                       strip_buffer, groups * planes * 2, groups, n, planes);
+        if (to_screen)
+        {
+            c_blit_area(vwk, src, src_x, src_y, &strip, x & 15, 0, w, n, operation);
+            area_to_chunky(strip_buffer, groups * planes * 2,
+                           shadow + (long)y * wk->screen.wrap, wk->screen.wrap, groups, n, planes);
+            dirty_mark(x, y, x + w - 1, y + n - 1);
+        } else
+            c_blit_area(vwk, &strip, x & 15, 0, dst, dst_x, dst_y, w, n, operation);
+        src_y += n;
+        dst_y += n;
+        y += n;
+    }
+
+    return 1;
+}
+
+
+/*
+ * Multi plane user patterns have the colours in them, which the
+ * 8 bit fill knows nothing about. Those are drawn from pixels
+ * converted from the pattern, with the modes working on each
+ * plane as in the bitplane draw_rect(). Tables are not handled
+ * for them, like in the bitplane c_fill_area().
+ */
+static long CDECL chunky_fill_area(Virtual *vwk, long x, long y, long w, long h, short *pattern,
+                                   long colour, long mode, long interior_style)
+{
+    Virtual *real_vwk;
+    Workstation *wk;
+    unsigned short pixels[16][8], planes_buf[8];     /* Pixels as words, for the long accesses */
+    unsigned char *addr, *line, mask;
+    int planes, wrap, row, p, i;
+
+    real_vwk = (Virtual *)((long)vwk & ~1);
+    wk = real_vwk->real_address;
+    planes = wk->screen.mfdb.bitplanes;
+    if (((interior_style >> 16) != 4) || (real_vwk->fill.user.multiplane < planes))
+        return c8_fill_area(vwk, x, y, w, h, pattern, colour, mode, interior_style);
+
+    if ((long)vwk & 1)
+        return -1;
+    if ((w <= 0) || (h <= 0) || (mode < 1) || (mode > 4))
+        return 1;
+
+    for (row = 0; row < 16; row++)
+    {
+        for (p = 0; p < planes; p++)
+            planes_buf[p] = pattern[p * 16 + row];
+        planes_to_chunky8(planes_buf, (unsigned char *)pixels[row], planes);
+    }
+
+    mask = (1 << planes) - 1;
+    wrap = wk->screen.wrap;
+    addr = (unsigned char *)wk->screen.mfdb.address + (long)y * wrap + x;
+    for (row = y; row < y + h; row++)
+    {
+        line = (unsigned char *)pixels[row & 15];
+        switch (mode)
+        {
+        case 1:
+            for (i = 0; i < w; i++)
+                addr[i] = line[(x + i) & 15];
+            break;
+        case 2:
+            for (i = 0; i < w; i++)
+                addr[i] |= line[(x + i) & 15];
+            break;
+        case 3:
+            for (i = 0; i < w; i++)
+                addr[i] ^= line[(x + i) & 15];
+            break;
+        default:
+            for (i = 0; i < w; i++)
+                addr[i] |= ~line[(x + i) & 15] & mask;
+            break;
+        }
+        addr += wrap;
+    }
+    dirty_mark(x, y, x + w - 1, y + h - 1);
+
+    return 1;
+}
+
+
+/*
+ * Start drawing in a chunky shadow of the screen.
+ * The BLiTTER can't reach FastRAM, so it is not used after this.
+ */
+long chunky_init(Workstation *wk)
+{
+    char *buf;
+    unsigned char *shadow;
+    short width, height;
+
+    width = wk->screen.mfdb.width;
+    height = wk->screen.mfdb.height;
+    buf = (char *)access->funcs.malloc((long)width * height + 255, 1);
+    if (!buf)
+    {
+        access->funcs.error("Can't allocate FastRAM!", 0);
+        return 0;
+    }
+    shadow = (unsigned char *)(((long)buf + 255) & ~255L);
+    area_to_chunky((unsigned short *)wk->screen.mfdb.address, wk->screen.wrap, shadow, width,
+                   width >> 4, height, wk->screen.mfdb.bitplanes);
+
+    dirty_init(wk, (unsigned short *)wk->screen.mfdb.address);
+    dirty_wrap = wk->screen.wrap;
+#ifdef __m68k__
+    if (!install_vbl(dirty_vbl))
+    {
+        dirty_init(wk, 0);
+        access->funcs.free(buf);
+        access->funcs.error("No free VBL slot, chunky disabled.", 0);
+        return 0;
+    }
+#endif
+
+    wk->screen.shadow.buffer = buf;
+    wk->screen.mfdb.address = (short *)shadow;
+    wk->screen.wrap = width;
+
+    write_pixel_r = chunky_write_pixel;
+    read_pixel_r = chunky_read_pixel;
+    line_draw_r = c8_line_draw;
+    expand_area_r = chunky_expand_area;
+    fill_area_r = chunky_fill_area;
+    blit_area_r = chunky_blit_area;
+    mouse_draw_r = chunky_mouse_draw;
+    hardware_blit = 0;
+
+    me->module.shutdown = chunky_shutdown;
+
+    return 1;
+}
+
+
+/*
+ * The real screen has (possibly) moved.
+ */
+void chunky_screen(short *video)
+{
+    if ((unsigned short *)video == dirty_video)
+        return;
+
+    dirty_video = (unsigned short *)video;
+    dirty_mark(0, 0, dirty_width - 1, dirty_height - 1);
+}
@@ -18,453 +18,218 @@
 #define FALSE 0
 
 
-#define GetMemW(addr) ((unsigned long)*(unsigned short *)(addr))
+#define GetMemW(addr) ((unsigned LONG_32)*(unsigned short *)(addr))
 #define SetMemW(addr, val) *(unsigned short *)(addr) = val
 
 
 /*
- * draw_rect - draw one or more horizontal lines
- *
- * Rewritten in C instead of assembler this routine is now looking
- * very complicated. Since in assembler you can pass parameters in
- * registers, you have an easy game to be both, fast and flexible.
- *
- * In C we need to double the code a bit, like loops and such things.
- * So, the following code works as follows:
- *
- * 1.  Fill variables with all values for masks, fringes etc.
- * 2.  Decide, if we have the situation of writing just one word
- * 3.  In any case we choose the writing mode now
- * 4.  Then loop through the y axis (just one pass for horzline)
- * 5.  Inner loop through the planes
- * 6a. If just one word, mask out the bits and process the action
- * 6b. else mask out left fringe, write words, process the right fringe
+ * One 16 pixel group of interleaved planes, as fill words or on screen.
+ * Every plane is filled as (screen & keep) ^ flip, so the mode and
+ * colour only need to be looked at when the fill words are set up.
  */
+typedef union {
+    unsigned LONG_32 l[4];
+    unsigned short w[8];
+} Group;
 
-static void draw_rect(Virtual *vwk, long x1, long y1, long w, long h, short *patternptr, unsigned short fillcolor, long mode)
+static Group keep_words[16];
+static Group flip_words[16];
+
+
+/*
+ * Set up the fill words for (up to) the 16 pattern rows used,
+ * starting with the one for the first line.
+ */
+static void fill_words(short *pattern, int patadd, unsigned short colour, int mode, int planes, long y1, int rows)
 {
-    unsigned short leftmask, rightmask, patmsk;
-    unsigned short *addr;
-    int x2 = x1 + w - 1;
-    int y2 = y1 + h - 1;
-    int dx, y, yinc;
-    int patadd;               /* advance for multiplane patterns */
-    int leftpart;
-    int rightpart;
-    int planes;
-    unsigned short pattern, bits, help;
-
-    mode -= 1;
-
-    /* Get the pattern with which the line is to be drawn. */
-    planes = vwk->real_address->screen.mfdb.bitplanes;
-    dx = x2 - x1 - 16;      /* Width of line - one word */
-    addr = (unsigned short *) vwk->real_address->screen.mfdb.address;
-    addr += (x1 / 16) * vwk->real_address->screen.mfdb.bitplanes;
-    addr += (long)y1 * vwk->real_address->screen.wrap / 2;
-#if 0
-    patmsk = vwk->patmsk;                   /* Which pattern to start with */
-    patadd = vwk->multifill ? 16 : 0;       /* Multi plane pattern offset */
-#else
-    patmsk = 0x0f;
-    patadd = 0;
-#endif
-    leftpart  = x1 & 0xf;               /* Left fringe */
-    rightpart = x2 & 0xf;               /* Right fringe */
-    leftmask  = ~(0xffff >> leftpart);  /* Origin for not left fringe lookup */
-    rightmask =  0x7fff >> rightpart;   /* Origin for right fringe lookup */
-    yinc = vwk->real_address->screen.wrap / 2 - planes;
-
-    /* Check if we have to process just one single word on screen */
-    if (dx + leftpart < 0) {
-        switch (mode) {
-        case 3:  /* nor */
-            for(y = y1; y <= y2; y++ ) {
-                int plane;
-                int patind = patmsk & y;        /* Pattern to start with */
-                unsigned short color = fillcolor;
-
-                /* Init adress counter */
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    pattern = patternptr[patind];
-                        /* Isolate the necessary pixels */
-                        bits = *addr;
-                        help = bits;
-
-                    if (color & 0x0001) {
-                        bits |= ~pattern;       /* Complement of mask with source */
-                    } else {
-                        bits &= pattern;        /* Complement of mask with source */
-                    }
-                        help ^= bits;           /* Isolate changed bits */
-                        help &= leftmask | rightmask;   /* Isolate changed bits outside of fringe */
-                        bits ^= help;           /* Restore them to original states */
-                        *addr = bits;
-                    addr++;                     /* Next plane */
-                    patind += patadd;
-                    color >>= 1;
-                }
-                addr += yinc;                   /* Next scanline */
+    int row, plane;
+    unsigned short pat, keep, flip;
+
+    for(row = 0; row < rows; row++) {
+        unsigned short *patternptr = (unsigned short *)&pattern[(y1 + row) & 0x0f];
+        unsigned short color = colour;
+
+        for(plane = 0; plane < planes; plane++) {
+            pat = *patternptr;
+            switch (mode) {
+            case 3:  /* nor */
+                keep = pat;
+                flip = (color & 0x0001) ? ~pat : 0;
+                break;
+            case 2:  /* xor */
+                keep = 0xffff;
+                flip = pat;
+                break;
+            case 1:  /* or */
+                keep = ~pat;
+                flip = (color & 0x0001) ? pat : 0;
+                break;
+            default: /* Replace */
+                keep = 0;
+                flip = (color & 0x0001) ? pat : 0;
+                break;
             }
-            break;
+            keep_words[row].w[plane] = keep;
+            flip_words[row].w[plane] = flip;
+            patternptr += patadd;
+            color >>= 1;
+        }
+    }
+}
 
-        case 2:  /* xor */
-            for(y = y1; y <= y2; y++) {
-                int plane;
-                int patind = patmsk & y;        /* Pattern to start with */
-
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    pattern = patternptr[patind];
-
-                    /* Isolate the necessary pixels */
-                    bits = *addr;
-                    help = bits;
-                    bits ^= pattern;
-                    help ^= bits;        /* xor result with source - now have pattern */
-                    help &= leftmask | rightmask;       /* Isolate bits */
-                    bits ^= help;       /* Restore states of bits outside of fringe */
-                    *addr = bits;
-                    addr++;            /* Next plane */
-                    patind += patadd;
-                }
-                addr += yinc;           /* Next scanline */
-            }
-            break;
 
-        case 1:  /* or */
-            for(y = y1; y <= y2; y++) {
-                int plane;
-                int patind = patmsk & y;        /* Pattern to start with */
-                unsigned short color = fillcolor;
-
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    pattern = patternptr[patind];
-                        /* Isolate the necessary pixels */
-                        bits = *addr;
-                        help = bits;
-
-                    if (color & 0x0001) {
-			pattern &= ~(leftmask | rightmask);
-			bits |= pattern;
-                    } else {
-                        bits &= ~pattern;        /* Complement of mask with source */
-                        help ^= bits;           /* Isolate changed bits */
-                        help &= leftmask | rightmask;   /* Isolate bits */
-                        bits ^= help;           /* Restore them to original states */
-                    }
-                    *addr = bits;
-                    addr++;               /* Next plane */
-                    patind += patadd;
-                    color >>= 1;
-                }
-                addr += yinc;           /* Next scanline */
-            }
-            break;
+/*
+ * Partial group, only the bits in mask are changed.
+ */
+static void fill_fringe(unsigned short *addr, Group *keep, Group *flip, unsigned short mask, int planes)
+{
+    int plane;
 
-        default: /* Replace */
-            for(y = y1; y <= y2; y++) {
-                int patind = patmsk & y;        /* Pattern to start with */
-                int plane;
-                unsigned short color = fillcolor;
-
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    pattern = 0;
-
-                    /* Isolate the necessary pixels */
-                    bits = *addr;
-                    if (color & 0x0001) {
-                        pattern = patternptr[patind];
-#if 1
-		    }
-#endif
-                    bits ^= pattern;
-                    bits &= leftmask | rightmask; /* Isolate the bits outside the fringe */
-                    bits ^= pattern;    /* Restore the bits outside the fringe */
-#if 0
-		    } else {
-                    bits &= leftmask | rightmask; /* Isolate the bits outside the fringe */
-		    }
-#endif
-                    *addr = bits;
-                    addr++;             /* Next plane */
-                    patind += patadd;
-                    color >>= 1;
-                }
-                addr += yinc;           /* Next scanline */
-            }
-        }
+    for(plane = 0; plane < planes; plane++)
+        addr[plane] = (addr[plane] & (keep->w[plane] | ~mask)) ^ (flip->w[plane] & mask);
+}
 
-    }
-    /* Write the left fringe, then some whole words, then the right fringe */
-    else {
-        leftpart = 16 - leftpart;       /* Precalculate delta for the left */
-
-        switch (mode) {
-        case 3:  /* nor */
-            for(y = y1; y <= y2; y++) {
-                int plane;
-                int patind = patmsk & y;        /* Pattern to start with */
-                unsigned short color = fillcolor;
-
-                /* Init adress counter */
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    unsigned short *adr = addr;
-                    int pixels = dx;
-                    pattern = patternptr[patind];
-
-                    if (color & 0x0001) {
-                        int bw;
-                        pattern = ~pattern;
-                        /* Check if the line is completely contained within one word */
-
-                        /* Draw the left fringe */
-                        if (leftmask) {
-                            bits = *adr;
-                            help = bits;
-                            bits |= pattern;    /* Complement of mask with source */
-                            help ^= bits;       /* Isolate changed bits */
-                            help &= leftmask;   /* Isolate changed bits outside of fringe */
-                            bits ^= help;       /* Restore them to original states */
-                            *adr = bits;
-
-                            adr += planes;
-                            pixels -= leftpart;
-                        }
-                        /* Full bytes */
-                        for(bw = pixels >> 4; bw >= 0; bw--) {
-                            *adr |= pattern;
-                            adr += planes;
-                        }
-                        /* Draw the right fringe */
-                        if (~rightmask) {
-                            bits = *adr;
-                            help = bits;
-                            bits |= pattern;    /* Complement of mask with source */
-                            help ^= bits;       /* Isolate changed bits */
-                            help &= rightmask;  /* Isolate changed bits outside of fringe */
-                            bits ^= help;       /* Restore them to original states */
-                            *adr = bits;
-                        }
-                        pattern = ~pattern;
-                    } else {
-                        int bw;
-
-                        /* Draw the left fringe */
-                        if (leftmask) {
-                            bits = *adr;
-                            help = bits;
-                            bits &= pattern;    /* Complement of mask with source */
-                            help ^= bits;       /* Isolate changed bits */
-                            help &= leftmask;   /* Isolate changed bits outside of fringe */
-                            bits ^= help;       /* Restore them to original states */
-                            *adr = bits;
-
-                            adr += planes;
-                            pixels -= leftpart;
-                        }
-                        /* Full bytes */
-                        for(bw = pixels >> 4; bw >= 0; bw--) {
-                            *adr &= pattern;
-                            adr += planes;
-                        }
-                        /* Draw the right fringe */
-                        if (~rightmask) {
-                            bits = *adr;
-                            help = bits;
-                            bits &= pattern;    /* Complement of mask with source */
-                            help ^= bits;       /* Isolate changed bits */
-                            help &= rightmask;  /* Isolate changed bits outside of fringe */
-                            bits ^= help;       /* Restore them to original states */
-                            *adr = bits;
-                        }
-                    }
-                    addr++;                     /* Next plane */
-                    patind += patadd;
-                    color >>= 1;
-                }
-                addr += yinc;           /* Next scanline */
-            }
-            break;
 
-        case 2:  /* xor */
-            for(y = y1; y <= y2; y++ ) {
-                int plane;
-                int patind = patmsk & y;        /* Pattern to start with */
-
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    unsigned short *adr = addr;
-                    int pixels = dx;
-                    int bw;
-                    pattern = patternptr[patind];
-
-                    /* Draw the left fringe */
-                    if (leftmask) {
-                        bits = *adr;
-                        help = bits;
-                        bits ^= pattern;        /* xor the pattern with the source */
-                        help ^= bits;           /* xor result with source - now have pattern */
-                        help &= leftmask;       /* Isolate changed bits outside of fringe */
-                        bits ^= help;           /* Restore states of bits outside of fringe */
-                        *adr = bits;
-
-                        adr += planes;
-                        pixels -= leftpart;
-                    }
-                    /* Full bytes */
-                    for(bw = pixels >> 4; bw >= 0; bw--) {
-                        *adr ^= pattern;
-                        adr += planes;
-                    }
-                    /* Draw the right fringe */
-                    if (~rightmask) {
-                        bits = *adr;
-                        help = bits;
-                        bits ^= pattern;    /* xor the pattern with the source */
-                        help ^= bits;               /* xor result with source - now have pattern */
-                        help &= rightmask;    /* Isolate changed bits outside of fringe */
-                        bits ^= help;               /* Restore states of bits outside of fringe */
-                        *adr = bits;
-                    }
-                    addr++;                  /* Next plane */
-                    patind += patadd;
-                }
-                addr += yinc;           /* Next scanline */
+/*
+ * Whole groups, all planes at a time.
+ */
+static void fill_groups(unsigned short *addr, Group *keep, Group *flip, int groups, int planes, int replace)
+{
+    unsigned LONG_32 *dst = (unsigned LONG_32 *)addr;
+    unsigned LONG_32 f0, f1, f2, f3, k0, k1, k2, k3;
+
+    f0 = flip->l[0];
+    f1 = flip->l[1];
+    f2 = flip->l[2];
+    f3 = flip->l[3];
+    if (replace) {
+        switch (planes) {
+        case 8:
+            for(; groups > 0; groups--) {
+                dst[0] = f0;
+                dst[1] = f1;
+                dst[2] = f2;
+                dst[3] = f3;
+                dst += 4;
             }
             break;
-
-        case 1:  /* or */
-            for(y = y1; y <= y2; y++) {
-                int plane;
-                int patind = patmsk & y;        /* Pattern to start with */
-                unsigned short color = fillcolor;
-
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    unsigned short *adr = addr;
-                    int pixels = dx;
-                    pattern = patternptr[patind];
-
-                    if (color & 0x0001) {
-                        int bw;
-
-                        /* Draw the left fringe */
-                        if (leftmask) {
-                            bits = *adr;
-			    help = pattern & ~leftmask;
-                            bits |= help;
-                            *adr = bits;
-
-                            adr += planes;
-                            pixels -= leftpart;
-                        }
-                        /* Full bytes */
-                        for(bw = pixels >> 4; bw >= 0; bw--) {
-                            *adr |= pattern;
-                            adr += planes;
-                        }
-                        /* Draw the right fringe */
-                        if (~rightmask) {
-                            bits = *adr;
-			    help = pattern & ~rightmask;
-                            bits |= help;
-                            *adr = bits;
-                        }
-                    } else {
-                        int bw;
-
-                        pattern = ~pattern;
-
-                        /* Draw the left fringe */
-                        if (leftmask) {
-                            bits = *adr;
-                            help = bits;
-                            bits &= pattern;    /* Complement of mask with source */
-                            help ^= bits;       /* Isolate changed bits */
-                            help &= leftmask;   /* Isolate changed bits outside of fringe */
-                            bits ^= help;       /* Restore them to original states */
-                            *adr = bits;
-
-                            adr += planes;
-                            pixels -= leftpart;
-                        }
-                        /* Full bytes */
-                        for(bw = pixels >> 4; bw >= 0; bw--) {
-                            *adr &= pattern;
-                            adr += planes;
-                        }
-                        /* Draw the right fringe */
-                        if (~rightmask) {
-                            bits = *adr;
-                            help = bits;
-                            bits &= pattern;    /* Complement of mask with source */
-                            help ^= bits;       /* Isolate changed bits */
-                            help &= rightmask;  /* Isolate changed bits outside of fringe */
-                            bits ^= help;       /* Restore them to original states */
-                            *adr = bits;
-                        }
-                        pattern = ~pattern;
-                    }
-                    addr++;                     /* Next plane */
-                    patind += patadd;
-                    color >>= 1;
-                }
-                addr += yinc;           /* Next scanline */
+        case 4:
+            for(; groups > 0; groups--) {
+                dst[0] = f0;
+                dst[1] = f1;
+                dst += 2;
             }
             break;
+        case 2:
+            for(; groups > 0; groups--)
+                *dst++ = f0;
+            break;
+        default:
+            for(; groups > 0; groups--)
+                *addr++ = flip->w[0];
+            break;
+        }
+        return;
+    }
 
-        default: /* Replace */
-            for(y = y1; y <= y2; y++ ) {
-                int patind = patmsk & y;        /* Ppattern to start with */
-                int plane;
-                unsigned short color = fillcolor;
-
-                for(plane = planes - 1; plane >= 0; plane--) {
-                    /* Load values fresh for this bitplane */
-                    int bw;
-                    unsigned short *adr = addr;
-                    int pixels = dx;
-                    pattern = 0;
-
-                    if (color & 0x0001)
-                        pattern = patternptr[patind];
-
-                    /* Draw the left fringe */
-                    if (leftmask) {
-                        bits = *adr;
-                        bits ^= pattern;        /* xor the pattern with the source */
-                        bits &= leftmask;       /* Isolate the bits outside the fringe */
-                        bits ^= pattern;        /* Restore the bits outside the fringe */
-                        *adr = bits;
-
-                        adr += planes;
-                        pixels -= leftpart;
-                    }
-                    /* Full words */
-                    for(bw = pixels >> 4; bw >= 0; bw--) {
-                        *adr = pattern;
-                        adr += planes;
-                    }
-                    /* Draw the right fringe */
-                    if (~rightmask) {
-                        bits = *adr;
-                        bits ^= pattern;        /* xor the pattern with the source */
-                        bits &= rightmask;      /* isolate the bits outside the fringe */
-                        bits ^= pattern;        /* Restore the bits outside the fringe */
-                        *adr = bits;
-                    }
-                    addr++;                     /* Next plane */
-                    patind += patadd;
-                    color >>= 1;
-                }
-                addr += yinc;           /* Next scanline */
-            }
+    k0 = keep->l[0];
+    k1 = keep->l[1];
+    k2 = keep->l[2];
+    k3 = keep->l[3];
+    switch (planes) {
+    case 8:
+        for(; groups > 0; groups--) {
+            dst[0] = (dst[0] & k0) ^ f0;
+            dst[1] = (dst[1] & k1) ^ f1;
+            dst[2] = (dst[2] & k2) ^ f2;
+            dst[3] = (dst[3] & k3) ^ f3;
+            dst += 4;
+        }
+        break;
+    case 4:
+        for(; groups > 0; groups--) {
+            dst[0] = (dst[0] & k0) ^ f0;
+            dst[1] = (dst[1] & k1) ^ f1;
+            dst += 2;
+        }
+        break;
+    case 2:
+        for(; groups > 0; groups--) {
+            *dst = (*dst & k0) ^ f0;
+            dst++;
+        }
+        break;
+    default:
+        for(; groups > 0; groups--) {
+            *addr = (*addr & keep->w[0]) ^ flip->w[0];
+            addr++;
+        }
+        break;
+    }
+}
+
+
+/*
+ * draw_rect - draw one or more horizontal lines
+ *
+ * The fill words for each pattern row and plane are set up first.
+ * Each line is then a left fringe, a number of whole groups of
+ * interleaved planes (just stores in replace mode) and a right fringe.
+ * With patadd 16, each plane has its own pattern (multifill).
+ */
+static void draw_rect(Virtual *vwk, long x1, long y1, long w, long h, short *patternptr, int patadd, unsigned short fillcolor, long mode)
+{
+    Workstation *wk = vwk->real_address;
+    unsigned short leftmask, rightmask;
+    unsigned short *addr;
+    long x2 = x1 + w - 1;
+    int planes, wrap, groups, row, rows;
+
+    mode = (mode - 1) & 3;
+    planes = wk->screen.mfdb.bitplanes;
+    wrap = wk->screen.wrap / 2;
+    addr = (unsigned short *)wk->screen.mfdb.address;
+    addr += (x1 >> 4) * planes;
+    addr += (long)y1 * wrap;
+
+    rows = (h < 16) ? h : 16;
+    fill_words(patternptr, patadd, fillcolor, mode, planes, y1, rows);
+
+    leftmask  = 0xffff >> (x1 & 0x0f);          /* Bits to change */
+    rightmask = ~(0x7fff >> (x2 & 0x0f));
+    groups = (x2 >> 4) - (x1 >> 4) - 1;         /* Between the fringes */
+
+    /* Line within a single word */
+    if (groups < 0) {
+        leftmask &= rightmask;
+        for(row = 0; h > 0; h--) {
+            fill_fringe(addr, &keep_words[row], &flip_words[row], leftmask, planes);
+            addr += wrap;
+            row = (row + 1) & 0x0f;
         }
+        return;
+    }
+
+    /* Whole words at the ends are done together with the rest */
+    if (leftmask == 0xffff) {
+        groups++;
+        addr -= planes;
+    }
+    if (rightmask == 0xffff)
+        groups++;
+
+    for(row = 0; h > 0; h--) {
+        unsigned short *adr = addr;
+
+        if (leftmask != 0xffff)
+            fill_fringe(adr, &keep_words[row], &flip_words[row], leftmask, planes);
+        adr += planes;
+        fill_groups(adr, &keep_words[row], &flip_words[row], groups, planes, !mode);
+        adr += groups * planes;
+        if (rightmask != 0xffff)
+            fill_fringe(adr, &keep_words[row], &flip_words[row], rightmask, planes);
+        addr += wrap;
+        row = (row + 1) & 0x0f;
     }
 }
 
@@ -474,6 +239,7 @@ long CDECL c_fill_area(Virtual *vwk, long x, long y, long w, long h, short *patt
 {
   unsigned long foreground;
   unsigned long background;
+  int patadd;
 
   /* Don't understand any table operations yet */
   if ((long)vwk & 1)
@@ -481,8 +247,16 @@ long CDECL c_fill_area(Virtual *vwk, long x, long y, long w, long h, short *patt
 
   c_get_colours((Virtual *)((long)vwk & ~1), colour, &foreground, &background);
 
-  (void) interior_style;
-  draw_rect(vwk, x, y, w, h, pattern, foreground, mode);
+  /* Multi plane user pattern, the colour comes from the pattern */
+  patadd = 0;
+  if (((interior_style >> 16) == 4) &&
+      (vwk->fill.user.multiplane >= vwk->real_address->screen.mfdb.bitplanes)) {
+    patadd = 16;
+    foreground = 0xffff;
+  }
+
+  if (!blitter_fill(vwk, x, y, w, h, pattern, patadd, foreground, mode))
+    draw_rect(vwk, x, y, w, h, pattern, patadd, foreground, mode);
 
   return 1;
 }
@@ -30,8 +30,6 @@ static long CDECL c_mouse_draw_8(Workstation *wk, long x, long y, Mouse *mouse)
     static long old_colours = 0;
     static short colours = 0xaaaa;
     long *color_p;
-    
-    static volatile long save_state = 0;
 
     static unsigned short mouse_data[16 * 2] = {
         0xffff, 0x0000, 0x7ffe, 0x3ffc, 0x3ffc, 0x1ff8, 0x1ff8, 0x0ff0,
@@ -146,6 +144,8 @@ static long CDECL c_mouse_draw_8(Workstation *wk, long x, long y, Mouse *mouse)
         int w, xs, ys;
 #endif
 
+        mouse_x = x;
+        mouse_y = y;
         x -= wk->mouse.hotspot.x;
         y -= wk->mouse.hotspot.y;
 #if !NO_W
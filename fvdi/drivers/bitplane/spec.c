@@ -44,8 +44,9 @@ long CDECL(*expand_area_r) (Virtual *vwk, MFDB * src, long src_x, long src_y, MF
 long CDECL(*fill_area_r) (Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style) = c_fill_area;
 long CDECL(*fill_poly_r) (Virtual *vwk, short points[], long n, short index[], long moves, short *pattern, long colour, long mode, long interior_style) = 0;
 long CDECL(*blit_area_r) (Virtual *vwk, MFDB * src, long src_x, long src_y, MFDB * dst, long dst_x, long dst_y, long w, long h, long operation) = c_blit_area;
-long CDECL(*text_area_r) (Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets) = 0;
+long CDECL(*text_area_r) (Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets) = c_text_area;
 long CDECL(*mouse_draw_r) (Workstation *wk, long x, long y, Mouse * mouse) = c_mouse_draw;
+long CDECL(*blend_area_r) (Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour) = 0;
 
 long CDECL(*get_colour_r) (Virtual *vwk, long colour) = c_get_colour;
 void CDECL(*get_colours_r) (Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background) = 0;
@@ -53,7 +54,7 @@ void CDECL(*set_colours_r) (Virtual *vwk, long start, long entries, unsigned sho
 
 long wk_extend = 0;
 short accel_s = 0;
-short accel_c = A_SET_PAL | A_GET_COL | A_SET_PIX | A_GET_PIX | A_BLIT | A_FILL | A_EXPAND | A_LINE | A_MOUSE;
+short accel_c = A_SET_PAL | A_GET_COL | A_SET_PIX | A_GET_PIX | A_BLIT | A_FILL | A_EXPAND | A_LINE | A_TEXT | A_MOUSE;
 
 const Mode *graphics_mode = &mode[0];
 
@@ -61,6 +62,8 @@ short shadow = 0;
 short fix_shape = 0;
 short no_restore = 0;
 short depth = 0;
+short hardware_blit = 0;               /* 1 - BLiTTER in use, 2 - and data cache to flush */
+static short no_blitter = 0;
 
 
 static Option const options[] = {
@@ -68,6 +71,8 @@ static Option const options[] = {
     { "shadow",     { &shadow },            0 },  /* Use a separate buffer of the screen in RAM */
     { "fixshape",   { &fix_shape },         0 },  /* fixed shape; do not allow mouse shape changes */
     { "norestore",  { &no_restore },        0 },
+    { "noblitter",  { &no_blitter },        1 },  /* noblitter, do not use the BLiTTER chip even if there is one */
+    { "chunky",     { &chunky_shadow },     1 },  /* chunky, draw in an 8 bit per pixel buffer that is converted to the screen later */
 };
 
 /*
@@ -202,6 +207,32 @@ long initialize(Virtual *vwk)
 
     device.address = wk->screen.mfdb.address;
 
+#ifndef __mcoldfire__
+    /*
+     * The Mega ST, STE, Mega STE and Falcon can have a BLiTTER.
+     * Blitmode() tells whether it is there (bit 1) and has not been
+     * switched off by the user (bit 0).
+     * It works behind the back of the data cache of a 68030.
+     */
+    if (!no_blitter)
+    {
+        long mch, cpu;
+
+        mch = access->funcs.get_cookie("_MCH", 0);
+        if (mch == -1)
+            mch = 0;                    /* No cookie jar, so a plain ST */
+        mch >>= 16;
+        if ((mch == 0 || mch == 1 || mch == 3) && (Blitmode(-1) & 3) == 3)
+        {
+            hardware_blit = 1;
+            cpu = access->funcs.get_cookie("_CPU", 0);
+            if (cpu >= 30)
+                hardware_blit = 2;
+            PRINTF(("Using the BLiTTER\n"));
+        }
+    }
+#endif
+
     switch (wk->screen.mfdb.bitplanes)
     {
     case 1:
@@ -222,6 +253,9 @@ long initialize(Virtual *vwk)
     }
     setup_scrninfo(me->device, graphics_mode);
 
+    if (chunky_shadow && !chunky_init(wk))
+        chunky_shadow = 0;
+
     PRINTF(("%dx%dx%d screen at %08lx\n", wk->screen.mfdb.width, wk->screen.mfdb.height, wk->screen.mfdb.bitplanes,
             (long) wk->screen.mfdb.address));
 
@@ -264,6 +298,13 @@ long setup(long type, long value)
     case Q_NAME:
         ret = (long) driver_name;
         break;
+    case S_UPDATE:
+        if (chunky_shadow)
+        {
+            chunky_update();
+            ret = 1;
+        }
+        break;
     }
 
     return ret;
@@ -281,7 +322,10 @@ Virtual *CDECL opnwk(Virtual *vwk)
 
     (void) vwk;
     wk = me->default_vwk->real_address;
-    wk->screen.mfdb.address = (short *) Logbase();
+    if (chunky_shadow)
+        chunky_screen((short *) Logbase());
+    else
+        wk->screen.mfdb.address = (short *) Logbase();
 
     linea = wk->screen.linea;
     wk->mouse.position.x = linea[-0x25a / 2]; /* GCURX */
@@ -0,0 +1,180 @@
+/*
+ * Bitplane text
+ *
+ * Strings in 6 or 8 pixel wide mono-spaced fonts are drawn directly
+ * from the unpacked font data (16 bytes per character, see unpack_font
+ * in engine/fonts.c), one screen word at a time in all planes.
+ * What each plane should do with the character bits is worked out
+ * once per string from the colours and the drawing mode.
+ * Anything else is left to the generic code (via expand_area).
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+#include "driver.h"
+#include "bitplane.h"
+
+
+/*
+ * Draw some text
+ * Returns 0 when the generic code should deal with it.
+ */
+long CDECL c_text_area(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets)
+{
+    static unsigned char blank[16];     /* For characters not in the font */
+    Workstation *wk;
+    Fontheader *font;
+    unsigned char *glyph[4];
+    unsigned short *dst, *dst_line;
+    unsigned short fg_mask[8], bg_mask[8];
+    unsigned short cell_mask, clear_cell, clear_source, invert, first_mask, last_mask;
+    unsigned short bits, mask, source, rest, clear;
+    unsigned long foreground, background;
+    long *fgbg;
+    short shift[4];
+    long x1, x2, group_x, cx;
+    int width, height, first_line, planes, wrap, group, last_group;
+    int chars, first, last, code_high, i, n, line, plane;
+
+    if (vwk->text.effects)
+        return 0;
+
+    if (offsets)
+        return 0;
+
+    if (chunky_shadow)                  /* Nothing to gain */
+        return 0;
+
+    /*
+     * Must have 6 or 8 pixel wide characters unpacked to 16 bytes
+     * each. External (FT2) fonts keep other things in 'unpacked'.
+     */
+    font = vwk->text.current_font;
+    if ((font->flags & FONTF_EXTERNAL) || !font->extra.unpacked.format || !font->extra.unpacked.data)
+        return 0;
+
+    width = font->widest.cell;
+    if (((width != 6) && (width != 8)) || (font->height > 16))
+        return 0;
+    cell_mask = (width == 8) ? 0xff : 0xfc;
+
+    wk = vwk->real_address;
+    planes = wk->screen.mfdb.bitplanes;
+    wrap = wk->screen.wrap;
+
+    /* Clip */
+    dst_y += (&font->extra.distance.base)[vwk->text.alignment.vertical];
+    height = font->height;
+    first_line = 0;
+    if (dst_y < vwk->clip.rectangle.y1)
+    {
+        first_line = vwk->clip.rectangle.y1 - dst_y;
+        height -= first_line;
+        dst_y = vwk->clip.rectangle.y1;
+    }
+    if (dst_y + height - 1 > vwk->clip.rectangle.y2)
+        height = vwk->clip.rectangle.y2 - dst_y + 1;
+
+    x1 = dst_x;
+    x2 = dst_x + length * width - 1;
+    if (x1 < vwk->clip.rectangle.x1)
+        x1 = vwk->clip.rectangle.x1;
+    if (x2 > vwk->clip.rectangle.x2)
+        x2 = vwk->clip.rectangle.x2;
+
+    if (height <= 0 || x1 > x2)
+        return 1;
+
+    /* What to do with the character bits in each plane */
+    fgbg = (long *) &vwk->text.colour;
+    c_get_colours(vwk, *fgbg, &foreground, &background);
+    clear_cell = 0;
+    clear_source = 0xffff;
+    invert = 0;
+    switch (((vwk->mode - 1) & 0x03) + 1)
+    {
+    case 1:                     /* Replace, zeros in the background colour */
+        clear_cell = 0xffff;
+        clear_source = 0;
+        break;
+    case 2:                     /* Transparent */
+        background = 0;
+        break;
+    case 3:                     /* XOR, whatever the colour */
+        clear_source = 0;
+        foreground = 0xff;
+        background = 0;
+        break;
+    case 4:                     /* Reverse transparent, zeros in the foreground colour */
+        invert = 0xffff;
+        background = 0;
+        break;
+    }
+    for (plane = 0; plane < planes; plane++)
+    {
+        fg_mask[plane] = (foreground >> plane) & 1 ? 0xffff : 0;
+        bg_mask[plane] = (background >> plane) & 1 ? 0xffff : 0;
+    }
+
+    dst_line = (unsigned short *) ((long) wk->screen.mfdb.address + (long) dst_y * wrap);
+    code_high = font->code.high - font->code.low;
+    first_mask = 0xffff >> (x1 & 0x0f);
+    last_mask = 0xffff << (15 - (x2 & 0x0f));
+    last_group = x2 >> 4;
+
+    /*
+     * One column of screen words at a time,
+     * from the (up to four) characters that cover it.
+     */
+    for (group = x1 >> 4; group <= last_group; group++)
+    {
+        group_x = (long) group << 4;
+
+        first = (group_x - dst_x) / width;
+        if (group_x < dst_x)
+            first = 0;
+        last = (group_x + 15 - dst_x) / width;
+        if (last > length - 1)
+            last = length - 1;
+
+        chars = 0;
+        mask = 0;
+        for (i = first; i <= last; i++)
+        {
+            n = text[i] - font->code.low;
+            if ((unsigned int) n > (unsigned int) code_high)
+                glyph[chars] = blank + first_line;
+            else
+                glyph[chars] = (unsigned char *) font->extra.unpacked.data + n * 16 + first_line;
+            cx = dst_x + (long) i * width - group_x;   /* -7 to 15 */
+            shift[chars] = cx + 8;
+            mask |= (unsigned short) (((unsigned long) cell_mask << 16) >> shift[chars]);
+            chars++;
+        }
+        if (group == x1 >> 4)
+            mask &= first_mask;
+        if (group == last_group)
+            mask &= last_mask;
+
+        dst = dst_line + group * planes;
+        for (line = 0; line < height; line++)
+        {
+            bits = 0;
+            for (i = 0; i < chars; i++)
+                bits |= (unsigned short) (((unsigned long) *glyph[i]++ << 16) >> shift[i]);
+
+            source = (bits ^ invert) & mask;
+            rest = source ^ mask;       /* Zeros within the characters */
+            clear = ~((mask & clear_cell) | (source & clear_source));
+
+            for (plane = 0; plane < planes; plane++)
+                dst[plane] = (dst[plane] & clear) ^ (source & fg_mask[plane]) ^ (rest & bg_mask[plane]);
+
+            dst = (unsigned short *) ((long) dst + wrap);
+        }
+    }
+
+    return 1;
+}
@@ -331,7 +331,7 @@ _c_expand:
 * In:	a0	VDI struct (odd address marks table operation)
 *	d0	colours
 *	d1	x1 destination or table address
-*	d2	y1    - " -    or table length (high) and type (0 - y/x1/x2 spans)
+*	d2	y1    - " -    or table length (high) and type (0 - y/x1/x2 spans, 1 - x1/y1/x2/y2 rectangles)
 *	d3-d4	x2,y2 destination
 *	d5	pattern address
 *	d6	mode
@@ -382,12 +382,14 @@ _c_fill:
 	rts
 
  label .l2,2					; Transform table fill into ordinary one
-	move.w		36+8+2(a7),d0
-	tst.w		d0
-	bne		.fill_done		; Only y/x1/x2 spans available so far
 	move.l		36+3*4(a7),d3		; Fetch a0
 	bclr		#0,d3
 	move.l		d3,0(a7)
+	move.w		36+8+2(a7),d0
+	cmp.w		#1,d0
+	beq		.rect_loop
+	tst.w		d0
+	bne		.fill_done		; Only y/x1/x2 spans and rectangles available so far
 	move.l		#1,16(a7)		; Always 1 high
 .fill_loop:
 	move.l		36+4(a7),a2
@@ -404,6 +406,30 @@ _c_fill:
 	ijsr		_fill_area_r
 	subq.w		#1,36+8(a7)
 	bne		.fill_loop
+	bra		.fill_done
+
+.rect_loop:
+	move.l		36+4(a7),a2
+	move.w		(a2)+,d0
+	ext.l		d0
+	move.l		d0,4(a7)
+	move.w		(a2)+,d0
+	ext.l		d0
+	move.l		d0,8(a7)
+	move.w		(a2)+,d0
+	sub.w		4+2(a7),d0
+	addq.w		#1,d0
+	ext.l		d0
+	move.l		d0,12(a7)
+	move.w		(a2)+,d0
+	sub.w		8+2(a7),d0
+	addq.w		#1,d0
+	ext.l		d0
+	move.l		d0,16(a7)
+	move.l		a2,36+4(a7)
+	ijsr		_fill_area_r
+	subq.w		#1,36+8(a7)
+	bne		.rect_loop
 .fill_done:
 	add.w		#36,a7
 	movem.l		(a7)+,d0-d2/a0-a2
@@ -0,0 +1,226 @@
+/*
+ * fVDI driver shadow screen, dirty tile tracking
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ *
+ * Used by drivers that draw in a FastRAM shadow of the screen and
+ * bring the real screen up to date later, from the VBL queue (or on
+ * v_updwk). What has been changed is remembered as a bitmap of
+ * screen tiles.
+ *
+ * The including driver defines DIRTY_PIXEL (what the real screen
+ * address points to) and supplies dirty_flush(), which is to call
+ * dirty_tiles(), and dirty_copy(), which is called for each run of
+ * dirty tiles.
+ */
+
+#define DIRTY_ROWS  128         /* Tile rows, each a bitmap of at most 32 tiles */
+#define MOUSE_FLAG  -0x153      /* LineA, VBL mouse drawing not allowed when set */
+
+static void dirty_flush(void);
+static void dirty_copy(short x1, short y1, short x2, short y2);
+
+static DIRTY_PIXEL *dirty_video = 0;    /* Real screen, when drawing in the shadow */
+static Workstation *dirty_wk;
+static unsigned long dirty_rows[DIRTY_ROWS];
+static short dirty_x_shift;     /* Tile size, as powers of two */
+static short dirty_y_shift;
+static short dirty_width;
+static short dirty_height;
+static volatile short dirty_lock = 0;   /* Screen busy, no flushing from VBL */
+
+
+#ifdef __m68k__
+/*
+ * Put a routine in a free slot of the VBL queue.
+ * Returns zero if there was none.
+ */
+static int install_vbl(void (*routine)(void))
+{
+    void (**vbl_list)(void);
+    int i;
+
+    vbl_list = *(void (***)(void))0x456;     /* _vblqueue */
+    for (i = 1; i < *(short *)0x454; i++)   /* nvbls, first slot is the mouse */
+    {
+        if (!vbl_list[i])
+        {
+            vbl_list[i] = routine;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Take a routine out of the VBL queue again.
+ * The queue is searched, since it may have been moved.
+ */
+static void remove_vbl(void (*routine)(void))
+{
+    void (**vbl_list)(void);
+    int i;
+
+    vbl_list = *(void (***)(void))0x456;
+    for (i = 1; i < *(short *)0x454; i++)
+    {
+        if (vbl_list[i] == routine)
+            vbl_list[i] = 0;
+    }
+}
+#endif
+
+
+/*
+ * Remember that an area (inclusive coordinates) has been drawn to.
+ * Does nothing unless drawing goes to the shadow.
+ */
+static void dirty_mark(long x1, long y1, long x2, long y2)
+{
+    unsigned long bits;
+    int col1, col2, row;
+
+    if (!dirty_video)
+        return;
+
+    if (x1 < 0)
+        x1 = 0;
+    if (y1 < 0)
+        y1 = 0;
+    if (x2 >= dirty_width)
+        x2 = dirty_width - 1;
+    if (y2 >= dirty_height)
+        y2 = dirty_height - 1;
+    if ((x1 > x2) || (y1 > y2))
+        return;
+
+    col1 = (short)x1 >> dirty_x_shift;
+    col2 = (short)x2 >> dirty_x_shift;
+    bits = (0xffffffffUL >> (31 - (col2 - col1))) << col1;
+
+    /*
+     * Marking may be interrupted by a flush. At worst that makes
+     * a tile be written out again, since drawing is already done.
+     */
+    for (row = (short)y1 >> dirty_y_shift; row <= ((short)y2 >> dirty_y_shift); row++)
+        dirty_rows[row] |= bits;
+}
+
+
+/*
+ * Hand each run of dirty tiles in a tile row to dirty_copy()
+ * (exclusive end coordinates, within the screen), and
+ * forget about them.
+ */
+static void dirty_tiles(void)
+{
+    unsigned long bits;
+    int row, col, first;
+    short x1, x2, y1, y2;
+
+    for (row = 0; row <= ((dirty_height - 1) >> dirty_y_shift); row++)
+    {
+        if (!(bits = dirty_rows[row]))
+            continue;
+        dirty_rows[row] = 0;
+
+        y1 = row << dirty_y_shift;
+        y2 = (row + 1) << dirty_y_shift;
+        if (y2 > dirty_height)
+            y2 = dirty_height;
+        col = 0;
+        while (bits)
+        {
+            while (!(bits & 1))
+            {
+                bits >>= 1;
+                col++;
+            }
+            first = col;
+            while (bits & 1)
+            {
+                bits >>= 1;
+                col++;
+            }
+            x1 = first << dirty_x_shift;
+            x2 = col << dirty_x_shift;
+            if (x2 > dirty_width)
+                x2 = dirty_width;
+
+            dirty_copy(x1, y1, x2, y2);
+        }
+    }
+}
+
+
+#ifdef __m68k__
+/*
+ * From the VBL queue.
+ * Waits for another time if anyone else is busy with the screen.
+ */
+static void dirty_vbl(void)
+{
+    if (dirty_lock || ((char *)dirty_wk->screen.linea)[MOUSE_FLAG])
+        return;
+
+    dirty_flush();
+}
+#endif
+
+
+/*
+ * Flush from normal code (v_updwk).
+ * The VBL mouse routine is kept away while this is going on.
+ */
+static void dirty_update(void)
+{
+    char *linea;
+
+    if (!dirty_video)
+        return;
+
+    linea = dirty_wk->screen.linea;
+    dirty_lock++;
+    linea[MOUSE_FLAG]++;
+    dirty_flush();
+    linea[MOUSE_FLAG]--;
+    dirty_lock--;
+}
+
+
+/*
+ * Start keeping track of what is drawn in the shadow, which is
+ * to go to the real screen at video (or stop, with zero).
+ * The tiles are at least 32 pixels wide and 16 lines high.
+ */
+static void dirty_init(Workstation *wk, DIRTY_PIXEL *video)
+{
+    dirty_wk = wk;
+    dirty_width = wk->screen.mfdb.width;
+    dirty_height = wk->screen.mfdb.height;
+
+    dirty_x_shift = 5;
+    while ((dirty_width - 1) >> dirty_x_shift >= 32)
+        dirty_x_shift++;
+    dirty_y_shift = 4;
+    while ((dirty_height - 1) >> dirty_y_shift >= DIRTY_ROWS)
+        dirty_y_shift++;
+
+    dirty_video = video;
+}
+
+
+#ifdef __m68k__
+/*
+ * When the driver is removed (in supervisor mode).
+ * Whatever was not yet written out goes to the screen.
+ */
+static void dirty_shutdown(void)
+{
+    remove_vbl(dirty_vbl);
+    dirty_update();
+}
+#endif
@@ -428,6 +428,8 @@ long CDECL init(Access *_access, Driver *driver, Virtual *vwk, char *opts)
         else if (accel_c & A_TEXT)
             wk->r.text = &c_text;
     }
+    if ((accelerate & A_EXPAND) && blend_area_r)
+        wk->blend = blend_area_r;     /* Called directly from C, no wrapper */
     if (!mouse_draw_r || !((accel_s | accel_c) & A_MOUSE))
     {
         PUTS("driver without mouse drawing no longer supported\n");
@@ -59,6 +59,8 @@ long c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
                  MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
 long c_text_area(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets);
 long c_mouse_draw(Workstation *wk, long x, long y, Mouse *mouse);
+long c_blend_area(Virtual *vwk, MFDB *src, long src_x, long src_y,
+                  long dst_x, long dst_y, long w, long h, long mode, long colour);
 
 long c_get_colour(Virtual *vwk, long colour);
 void c_set_colours(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[]);
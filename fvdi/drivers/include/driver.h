@@ -116,6 +116,7 @@ extern long CDECL (*fill_poly_r)(Virtual *vwk, short points[], long n, short ind
 extern long CDECL (*blit_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
 extern long CDECL (*text_area_r)(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets);
 extern long CDECL (*mouse_draw_r)(Workstation *wk, long x, long y, Mouse *mouse);
+extern long CDECL (*blend_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour);
 
 long CDECL initialize(Virtual *vwk);
 long check_token(char *, const char **);
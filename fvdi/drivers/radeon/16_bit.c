@@ -7,6 +7,7 @@
 #endif
 
 #include "../16_bit/16b_exp.c"
+#include "../16_bit/16b_blend.c"
 #include "../16_bit/16b_blit.c"
 #include "../16_bit/16b_line.c"
 #include "../16_bit/16b_fill.c"
@@ -163,6 +163,7 @@ long CDECL c_fill_polygon(Virtual *vwk, short points[], long n, short index[], l
 long CDECL c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
 long CDECL c_text_area(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets);
 long CDECL c_mouse_draw(Workstation *wk, long x, long y, Mouse *mouse);
+long CDECL c_blend_area(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour);
 
 long CDECL c_get_colour(Virtual *vwk, long colour);
 void CDECL c_set_colours(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[]);
@@ -36,8 +36,8 @@ static Mouse *pmouse;
 static MFDB mouse_mfdb = {NULL, 16, 16, 1, 1, 1, { 0, 0, 0 }};
 
 /* We must save the mouse background */
-static short backup_data[16*16];
-static MFDB mouse_backup_mfdb = {backup_data, 16, 16, 1, 0, 16, { 0, 0, 0 }};
+static long backup_data[16*16 * DEPTH / 32];
+static MFDB mouse_backup_mfdb = {(short *)backup_data, 16, 16, 1, 0, DEPTH, { 0, 0, 0 }};
 static short backup_x, backup_y, backup_w, backup_h;
 
 static void clip_mouse(Virtual *vwk, short x, short y, short *pw, short *ph)
@@ -29,14 +29,40 @@
 #include <os.h>
 #include "string/memset.h"
 
+static char const none[] = { 0 };
+
+/*
+ * The drawing routines are built for a single depth,
+ * see DEPTH in the Makefile.
+ */
+#if DEPTH == 8
+static char const r_8[] = { 8 };
+static char const g_8[] = { 8 };
+static char const b_8[] = { 8 };
+
+static Mode const mode[1] = {
+	{  8, CHUNKY | CHECK_PREVIOUS, { r_8, g_8, b_8, none, none, none }, 0,  2, 1, 1 }
+};
+#define SAGA_FORMAT	SAGA_VIDEO_FORMAT_CLUT8
+#elif DEPTH == 16
 static char const r_16[] = { 5, 11, 12, 13, 14, 15 };
 static char const g_16[] = { 6,  5,  6,  7,  8,  9, 10 };
 static char const b_16[] = { 5,  0,  1,  2,  3,  4 };
-static char const none[] = { 0 };
 
 static Mode const mode[1] = {
 	{ 16, CHUNKY | CHECK_PREVIOUS | TRUE_COLOUR, { r_16, g_16, b_16, none, none, none }, 0,  2, 2, 1 }
 };
+#define SAGA_FORMAT	SAGA_VIDEO_FORMAT_RGB16
+#else
+static char const r_32[] = { 8, 16, 17, 18, 19, 20, 21, 22, 23 };
+static char const g_32[] = { 8,  8,  9, 10, 11, 12, 13, 14, 15 };
+static char const b_32[] = { 8,  0,  1,  2,  3,  4,  5,  6,  7 };
+
+static Mode const mode[1] = {
+	{ 32, CHUNKY | CHECK_PREVIOUS | TRUE_COLOUR, { r_32, g_32, b_32, none, none, none }, 0,  2, 2, 1 }
+};
+#define SAGA_FORMAT	SAGA_VIDEO_FORMAT_RGB32
+#endif
 
 char driver_name[] = "SAGA";
 
@@ -46,7 +72,7 @@ static struct {
 	short height;
 	short bpp;
 	short freq;
-} resolution = {0, 640, 480, 16, 60};
+} resolution = {0, 640, 480, DEPTH, 60};
 
 struct {
 	short width;
@@ -58,14 +84,20 @@ long CDECL (*read_pixel_r)(Virtual *vwk, MFDB *mfdb, long x, long y) = c_read_pi
 long CDECL (*line_draw_r)(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode) = c_line_draw;
 long CDECL (*expand_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation, long colour) = c_expand_area;
 long CDECL (*fill_area_r)(Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style) = c_fill_area;
-long CDECL (*fill_poly_r)(Virtual *vwk, short points[], long n, short index[], long moves, short *pattern, long colour, long mode, long interior_style) = 0;
+long CDECL (*fill_poly_r)(Virtual *vwk, short points[], long n, short index[], long moves, short *pattern, long colour, long mode, long interior_style) = c_fill_poly;
 long CDECL (*blit_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation) = c_blit_area;
 long CDECL (*text_area_r)(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets) = 0;
 long CDECL (*mouse_draw_r)(Workstation *wk, long x, long y, Mouse *mouse) = c_mouse_draw;
+long CDECL (*blend_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour) = c_blend_area;
 
 long CDECL (*get_colour_r)(Virtual *vwk, long colour) = c_get_colour;
 void CDECL (*get_colours_r)(Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background) = 0;
+#if DEPTH == 8
+static void CDECL saga_set_colours(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[]);
+void CDECL (*set_colours_r)(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[]) = saga_set_colours;
+#else
 void CDECL (*set_colours_r)(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[]) = c_set_colours;
+#endif
 
 
 short hwmouse = -1;
@@ -89,7 +121,7 @@ static void panic(const char* message)
 long wk_extend = 0;
 
 short accel_s = 0;
-short accel_c = A_SET_PAL | A_GET_COL | A_SET_PIX | A_GET_PIX | A_BLIT | A_FILL | A_EXPAND | A_LINE | A_MOUSE;
+short accel_c = A_SET_PAL | A_GET_COL | A_SET_PIX | A_GET_PIX | A_BLIT | A_FILL | A_FILLPOLY | A_EXPAND | A_LINE | A_MOUSE;
 
 const Mode *graphics_mode = &mode[0];
 
@@ -119,7 +151,7 @@ static int set_bpp(int bpp)
 {
 	switch (bpp) {
 	case -1:
-	case 16:
+	case DEPTH:
 		graphics_mode = &mode[0];
 		break;
 	default:
@@ -244,7 +276,7 @@ static struct ModeInfo *find_mode_info(void)
 static UBYTE *saga_alloc_vram(UWORD width, UWORD height)
 {
 	ULONG buffer;
-	ULONG vram_size = (ULONG)width * height * sizeof(short);
+	ULONG vram_size = (ULONG)width * height * PIXEL_SIZE;
 	const int alignment = 32; /* Size of SAGA burst reads */
 
 	/* SAGA screen buffers reside in Alt-RAM */
@@ -257,6 +289,18 @@ static UBYTE *saga_alloc_vram(UWORD width, UWORD height)
 	return (UBYTE *)buffer;
 }
 
+#if DEPTH == 8
+/*
+ * The palette entries are set up as usual,
+ * and then copied to the hardware palette.
+ */
+static void CDECL saga_set_colours(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[])
+{
+	c_set_colours(vwk, start, entries, requested, palette);
+	saga_set_clut(start, entries, palette);
+}
+#endif
+
 /*
  * Do whatever setup work might be necessary on boot up
  * and which couldn't be done directly while loading.
@@ -377,7 +421,7 @@ Virtual* CDECL opnwk(Virtual *vwk)
 
 	/* Switch to SAGA screen */
 	saga_set_clock(mi);
-	saga_set_modeline(mi, SAGA_VIDEO_FORMAT_RGB16);
+	saga_set_modeline(mi, SAGA_FORMAT);
 	saga_set_panning(screen_address);
 
 	/* update the settings */
@@ -184,15 +184,35 @@ void saga_set_mouse_position(short x, short y)
 }
 
 
-static unsigned short rgb16to4(unsigned short color)
+/*
+ * Copy palette entries to the hardware palette (8 bit modes),
+ * at the pixel values they were given.
+ */
+void saga_set_clut(long start, long entries, Colour palette[])
+{
+	Colour *colour;
+	long i;
+
+	for (i = start; i < start + entries; i++)
+	{
+		colour = &palette[i];
+		Write32(SAGA_VIDEO_CLUT(*(UBYTE *)&colour->real),
+		        ((ULONG)((colour->vdi.red * 255L + 500) / 1000) << 16) |
+		        ((ULONG)((colour->vdi.green * 255L + 500) / 1000) << 8) |
+		         (ULONG)((colour->vdi.blue * 255L + 500) / 1000));
+	}
+}
+
+
+static unsigned short rgb_to_4(const Colour *colour)
 {
 	/*
-	 * Input : 0xRRRRRGGGGGGBBBBB
+	 * Input : VDI components, 0 - 1000
 	 * Output: 0x0000RRRRGGGGBBBB
 	 */
-	return ((color >> 4) & 0xf00) |
-	       ((color >> 3) & 0x0f0) |
-	       ((color >> 1) & 0x00f);
+	return (((colour->vdi.red * 15L + 500) / 1000) << 8) |
+	       (((colour->vdi.green * 15L + 500) / 1000) << 4) |
+	        ((colour->vdi.blue * 15L + 500) / 1000);
 }
 
 
@@ -228,20 +248,14 @@ void saga_set_mouse_sprite(Workstation *wk, Mouse *mouse)
 {
 	unsigned short fg, bg;
 	Colour *global_palette;
-	unsigned short *realp;
 	unsigned short mousedata[2 * 16];
 	unsigned long *lp;
 	int i;
 	
 	/* c_get_colour(wk, *pp, &foreground, &background); */
 	global_palette = wk->screen.palette.colours;
-	realp = (unsigned short *)&global_palette[wk->mouse.colour.foreground].real;
-	fg = *realp;
-	realp = (unsigned short *)&global_palette[wk->mouse.colour.background].real;
-	bg = *realp;
-
-	fg = rgb16to4(fg);
-	bg = rgb16to4(bg);
+	fg = rgb_to_4(&global_palette[wk->mouse.colour.foreground]);
+	bg = rgb_to_4(&global_palette[wk->mouse.colour.background]);
 
 	/* SAGA HW MOUSE => COLORS */
 	Write16(SAGA_VIDEO_SPRITECLUT + 0, bg);  /* COLOR1 */
@@ -34,6 +34,8 @@
 #ifndef SAGA_H
 #define SAGA_H
 
+#include "../16_bit/16b_pixel.h"     /* DEPTH the driver is built for */
+
 typedef unsigned char UBYTE;
 typedef unsigned short UWORD;
 typedef unsigned long ULONG;
@@ -140,8 +142,10 @@ long CDECL c_fill_polygon(Virtual *vwk, short points[], long n, short index[], l
 long CDECL c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
 long CDECL c_text_area(Virtual *vwk, short *text, long length, long dst_x, long dst_y, short *offsets);
 long CDECL c_mouse_draw(Workstation *wk, long x, long y, Mouse *mouse);
+long CDECL c_blend_area(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour);
 
 long CDECL c_get_colour(Virtual *vwk, long colour);
 void CDECL c_set_colours(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[]);
+void saga_set_clut(long start, long entries, Colour palette[]);
 
 #endif /* SAGA_H */
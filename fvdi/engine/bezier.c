@@ -440,7 +440,7 @@ short CDECL calc_bez(char *marks, short *points, long flags, long maxpnt, long m
     short maxchk, movptr, i;
     short *pts_ptr, *last_pnt, *pts_out;
     char *chk_ptr;
-    unsigned short memneeded;
+    long memneeded;
     short *XMOV, *XPTS;
 
     *pnt_mv_cnt = 0;
@@ -485,9 +485,8 @@ short CDECL calc_bez(char *marks, short *points, long flags, long maxpnt, long m
     }
 
     memneeded = _max(maxpnt, MINVERTSIN) * 2 * sizeof(short) + _max(*pnt_mv_cnt, MININTIN) * sizeof(short);
-    memneeded = (memneeded + 15) >> 4;
 
-    if ((XPTS = (short *) allocate_block(0)) == NULL || (*(long *) XPTS < memneeded))
+    if ((XPTS = (short *) allocate_block(memneeded)) == NULL || (*(long *) XPTS < memneeded))
     {
         if (XPTS)
             free_block(XPTS);
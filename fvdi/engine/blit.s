@@ -17,6 +17,7 @@ transparent	equ	1		; Fall through?
 	xref	_pattern_ptrs
 	xref	_default_line
 	xref	_vr_transfer_bits,_colour_entry
+	xref	_c2p_trnfm
 	xref	_set_colour_table,_colour_table,_inverse_table
 
 	xdef	v_bar,vr_recfl,vrt_cpyfm,vro_cpyfm
@@ -985,598 +986,19 @@ vr_trnfm:
 	done_return
 
 * lib_vr_trnfm - Standard Library function
-* Todo: Should use C2P from MGIF instead of the current crap!
+* Todo: ?
 * In:   a1      Parameters   lib_vr_trnfm(source, dest)
 *       a0      VDI struct
 _lib_vr_trnfm:
 	uses_d1
-	movem.l	d2-d7/a3-a6,-(a7)
-	move.l	(a1)+,a2
-	move.l	(a1),a1
-	exg	a1,a2		; a1 - source, a2 - dest
-
-	move.l	mfdb_address(a1),a3
-	move.l	mfdb_address(a2),a4
-	move.w	mfdb_height(a1),d0
-	move.w	mfdb_wdwidth(a1),d1
-	move.w	mfdb_bitplanes(a1),d2
-
-	cmp.l	a3,a4
-	beq	in_place
-
-;	cmp.w	#1,d2			; Single plane is the same
-;	beq	end_vr_trnfm		;  but needs to copy
-
-	tst.w	mfdb_standard(a1)
-	beq	to_standard
-
-* Reorganize standard bitplanes into device specific ones.
-* Does not work in place.
-* In:	d0.w	mfdb_height
-*	d1.w	mfdb_wdwidth (pixels / 16)
-*	d2.w	bitplanes
-*	a3	mfdb_address source
-*	a4	mfdb_address destination
-	move.w	d0,d3
-	mulu	d1,d3
-	add.l	d3,d3			; d3 = pix/16 * height * 2 = words/plane
-
-	move.l	a3,a5
-
-	move.w	d0,d7
-	subq.w	#1,d7
-
- label .loop1,1
-	move.w	d1,d6
-	subq.w	#1,d6
-
- label .loop2,2
-	move.w	d2,d5
-	subq.w	#1,d5
-
- label .loop3,3
-	move.w	(a3),(a4)+
-	add.l	d3,a3
-	ldbra	d5,.loop3,3
-	addq.w	#2,a5
-	move.l	a5,a3
-	ldbra	d6,.loop2,2
-	ldbra	d7,.loop1,1
-	bra	finish_up
-
-
-to_standard:
-	move.l	vwk_real_address(a0),a5
-	move.l	wk_driver(a5),a5
-	move.l	driver_device(a5),a5
-	move.w	dev_format(a5),d6
-	and.w	#2,d6
-	beq	not_chunky_ts
-
-	move.w	d0,d7
-	mulu	d1,d7
-	add.l	d7,d7			; d7 = pix/16 * height * 2 = words/plane
-	moveq	#2,d6
-
-	cmp.w	#16,d2
-	bne	.not_16bit_ts
-	bsr	to_standard_16
-	bra	end_vr_trnfm
-
-.not_16bit_ts:
-	cmp.w	#8,d2
-	bne	.not_8bit_ts
-	bsr	to_standard_8
-	bra	end_vr_trnfm
-
-.not_8bit_ts:
-;	move.w	d1,d6			; Copy source to destination since the
-;	mulu	d2,d6			;  current dechunk routine is in-place
-;	mulu	d0,d6			; d6 = pix/16 * planes * height * 2 = total words
-;
-;	subq.l	#1,d6
-;	move.l	a3,a5
-;	move.l	a4,a6
-;5$:
-;	move.w	(a5)+,(a6)+
-;	dbra	d6,5$
-
-	cmp.w	#32,d2
-	bne	not_32bit_ts
-	bsr	to_standard_32
-	bra	end_vr_trnfm
-
-
-* Transform device specific to standard format.
-* Works in place due to source copying.
-* In:	d0.w	mfdb_height
-*	d1.w	mfdb_wdwidth (pixels / 16)
-*	d6.w	group result step (2 or 16/32/64)
-*	d7.l	single result step (bytes per plane or 2)
-*	a3	mfdb_address source
-*	a4	mfdb_address destination
-to_standard_8:
-	sub.w	#16,a7			; This is specialized for 8 bit!
-	move.l	a7,a6			; Doesn't seem to work correctly (Jinnee)
-	move.l	a4,a5
-
-	move.w	d6,d1
-
-	subq.w	#1,d0
-
- label .loop0b,0
-	swap	d0
-	move.w	mfdb_wdwidth(a1),d0
-	subq.w	#1,d0
-
- label .loop1b,1
-	movem.l	(a3)+,d2-d5
-	movem.l	d2-d5,(a6)
-	moveq	#7,d3		; Was 15
-
- label .loop2b,2
-	moveq	#15,d4		; Was 14
-
- label .loop3b,3
-	move.b	0(a6,d4),d5	; Was .w
-	add.b	d5,d5		; Was .w
-	addx.w	d6,d6		; Was .b
-;	roxr.b	#1,d6		; This _is_ the right one!???
-	move.b	d5,0(a6,d4)	; Was .w
-	subq.l	#1,d4		; Was 2
-	lbpl	.loop3b,3
-	move.w	d6,(a4)		; Was .b
-	add.l	d7,a4
-
-	ldbra	d3,.loop2b,2
-	add.w	d1,a5
-	move.l	a5,a4
-	ldbra	d0,.loop1b,1
-	swap	d0
-	ldbra	d0,.loop0b,0
-
-	add.w	#16,a7
-	rts
-
-
-to_standard_16:
-	sub.w	#32,a7			; This is specialized for 16 bit!
-	move.l	a7,a6
-	move.l	a4,a5
-
-	move.w	d6,d1
-
-	subq.w	#1,d0			; d0 = height - 1
-
- label .loop0,0
-	swap	d0
-	move.w	mfdb_wdwidth(a1),d0
-	subq.w	#1,d0			; d1 = width - 1
-
- label .loop1,1
-	movem.l	(a3)+,d2-d5		; Copy 16 words due to bad dechunky routine
-	movem.l	d2-d5,(a6)
-	movem.l	(a3)+,d2-d5
-	movem.l	d2-d5,16(a6)
-	moveq	#15,d3			; d3 = bitplanes - 1 
-
- label .loop2,2
-	moveq	#30,d4			; d4 = last word index
-
- label .loop3,3
-	move.w	0(a6,d4),d5
-	add.w	d5,d5
-;	addx.w	d6,d6
-	roxr.w	#1,d6		; This _is_ the right one!
-	move.w	d5,0(a6,d4)
-	subq.w	#2,d4
-	lbpl	.loop3,3
-	move.w	d6,(a4)
-	add.l	d7,a4
-
-	ldbra	d3,.loop2,2
-	add.w	d1,a5
-	move.l	a5,a4
-	ldbra	d0,.loop1,1
-	swap	d0
-	ldbra	d0,.loop0,0
-
-	add.w	#32,a7
-	rts
-
-
-to_standard_32:
-	sub.w	#64,a7			; This is specialized for 32 bit!
-	move.l	a7,a6			; Doesn't seem to work correctly (Jinnee)
-	move.l	a4,a5
-
-	move.w	d6,d1
-
-	subq.w	#1,d0
-
- label .loop0c,0
-	swap	d0
-	move.w	mfdb_wdwidth(a1),d0
-	subq.w	#1,d0
-
- label .loop1c,1
-	movem.l	(a3)+,d2-d5
-	movem.l	d2-d5,(a6)
-	movem.l	(a3)+,d2-d5
-	movem.l	d2-d5,16(a6)
-	movem.l	(a3)+,d2-d5
-	movem.l	d2-d5,32(a6)
-	movem.l	(a3)+,d2-d5
-	movem.l	d2-d5,48(a6)
-	moveq	#31,d3		; Was 15
-
- label .loop2c,2
-	moveq	#60,d4		; Was 62
-
- label .loop3c,3
-	move.l	0(a6,d4),d5	; Was .w
-	add.l	d5,d5		; Was .w
-;;	addx.w	d6,d6		; Was .l
-;	roxr.l	#1,d6		; This _is_ the right one!
-	roxr.w	#1,d6		; This _is_ the right one!
-	move.l	d5,0(a6,d4)	; Was .w
-	subq.l	#4,d4		; Was 2
-	lbpl	.loop3c,3
-	move.w	d6,(a4)		; Was .l
-	add.l	d7,a4
-
-	ldbra	d3,.loop2c,2
-	add.w	d1,a5
-	move.l	a5,a4
-	ldbra	d0,.loop1c,1
-	swap	d0
-	ldbra	d0,.loop0c,0
-
-	add.w	#64,a7
-	rts
-
-
-not_32bit_ts:
-not_chunky_ts:
-	move.w	d2,d3			; Reorganize device specific
-	add.w	d3,d3			;  bitplanes into standard ones
-
-	move.l	a3,a5
-
-	move.w	d2,d7
-	subq.w	#1,d7
-
- label .loop1d,1
-	move.w	d0,d6
-	subq.w	#1,d6
-
- label .loop2d,2
-	move.w	d1,d5
-	subq.w	#1,d5
-
- label .loop3d,3
-	move.w	(a3),(a4)+
-	add.w	d3,a3
-	ldbra	d5,.loop3d,3
-	ldbra	d6,.loop2d,2
-	addq.w	#2,a5
-	move.l	a5,a3
-	ldbra	d7,.loop1d,1
-	bra	end_vr_trnfm
-
-
-in_place:
-	cmp.w	#1,d2			; Single plane is the same
-	beq	end_vr_trnfm
-	tst.w	mfdb_standard(a1)
-	beq	to_standard_ip
-
-* Reorganize standard bitplanes into device specific ones.
-* In:	d0.w	mfdb_height
-*	d1.w	mfdb_wdwidth (pixels / 16)
-*	d2.w	bitplanes
-*	a3	mfdb_address source
-*	a4	mfdb_address destination
-	move.w	d0,d7			; Reorganize standard bitplanes
-	move.w	d1,d6			;  into device specific ones
-
-	move.w	d1,d3
-	mulu	d2,d3
-	mulu	d0,d3
-	add.l	d3,d3			; d0 = pix/16 * planes * height * 2 = total bytes
-
-	mulu	d0,d1
-	add.w	d1,d1			; d1 = bytes per standard line * height
-
-	move.l	d3,d0
-	subq.l	#2,d0
-	subq.l	#2,d1
-	addq.l	#2,a4
-
-	move.l	a0,-(a7)
-
-	subq.w	#1,d7
-
- label .loop1,1
-	move.w	d6,d5
-	subq.w	#1,d5
-
- label .loop2,2
-	move.w	d2,d4
-	subq.w	#1,d4
-
- label .loop3,3
-	move.l	a4,a0
-	bsr	rotate_mem
-	addq.l	#2,a4
-	subq.l	#2,d0
-	ldbra	d4,.loop3,3
-	subq.w	#2,d1
-	ldbra	d5,.loop2,2
-	ldbra	d7,.loop1,1
-
-	move.l	(a7)+,a0
-	bra	finish_up
-
-
-to_standard_ip:			; Should have code for chunky modes (working on it)
-	move.l	vwk_real_address(a0),a5
-	move.l	wk_driver(a5),a5
-	move.l	driver_device(a5),a5
-	move.w	dev_format(a5),d6
-	and.w	#2,d6
-	beq	.not_chunky_ts_ip
-
-	move.w	d0,d7
-	mulu	d1,d7
-	add.l	d7,d7			; d7 = pix/16 * height * 2 = words/plane
-	moveq	#2,d6
-
-	cmp.w	#16,d2
-	bne	.not_16bit_ts_ip
-	bsr	to_standard_16
-	bra	end_vr_trnfm
-
-.not_16bit_ts_ip:
-	cmp.w	#8,d2
-	bne	.not_8bit_ts_ip
-	bsr	to_standard_8
-	bra	end_vr_trnfm
-
-.not_8bit_ts_ip:
-
-	cmp.w	#32,d2
-	bne	.not_32bit_ts_ip
-	bsr	to_standard_32
-	bra	end_vr_trnfm
-
-
-.not_32bit_ts_ip:
-.not_chunky_ts_ip:
-	exg	d1,d2
-
-	move.w	d0,d7
-	move.w	d1,d6
-
-	move.w	d1,d3
-	mulu	d2,d3
-	mulu	d0,d3
-	add.l	d3,d3			; d3 = pix/16 * planes * height * 2 = total bytes
-
-	add.w	d1,d1			; d1 = bytes per 16 pixel block
-
-	move.l	d3,d0
-	subq.l	#2,d0
-	subq.w	#2,d1
-	ext.l	d1
-	addq.l	#2,a4
+	move.l	d2,-(a7)
 
+	move.l	4(a1),-(a7)
+	move.l	(a1),-(a7)
 	move.l	a0,-(a7)
+	jsr	_c2p_trnfm
+	add.w	#12,a7
 
-	subq.w	#1,d6
-
- label .loop1,1
-	move.w	d7,d5
-	subq.w	#1,d5
-
- label .loop2,2
-	move.w	d2,d4
-	subq.w	#1,d4
-
- label .loop3,3
-	move.l	a4,a0
-	bsr	rotate_mem
-	addq.l	#2,a4
-	subq.l	#2,d0
-	ldbra	d4,.loop3,3
-	ldbra	d5,.loop2,2
-	subq.w	#2,d1
-	ldbra	d6,.loop1,1
-
-	move.l	(a7)+,a0
-	bra	end_vr_trnfm
-
-
-finish_up:
-	move.l	vwk_real_address(a0),a4	; Should this really check driver?
-	move.l	wk_driver(a4),a4
-	move.l	driver_device(a4),a4
-	move.w	dev_format(a4),d0
-	and.w	#2,d0
-	beq	.not_chunky
-
-	move.w	mfdb_bitplanes(a1),d0
-	cmp.w	#16,d0
-	bne	.not_16bit
-	move.l	mfdb_address(a2),a4
-	move.l	a4,a3
-	move.w	mfdb_height(a1),d0
-	moveq	#32,d6
-	moveq	#2,d7
-	bsr	to_standard_16		; Is its own inverse!
-	bra	end_vr_trnfm
-
-
-.not_16bit:
-	cmp.w	#8,d0
-	bne	.not_8bit
-
-	sub.w	#16,a7			; This is specialized for 8 bit!
-	move.l	a7,a3
-	move.l	mfdb_address(a2),a4
-	move.w	mfdb_height(a1),d0
-
-	subq.w	#1,d0
-
- label .loop0,0
-	move.w	mfdb_wdwidth(a1),d1
-	subq.w	#1,d1
-
- label .loop1,1
-	movem.l	(a4),d2-d5
-	movem.l	d2-d5,(a3)
-	moveq	#15,d3
-
- label .loop2,2
-	moveq	#14,d4
-
- label .loop3,3
-	move.w	0(a3,d4),d5
-	add.w	d5,d5
-	addx.b	d6,d6
-;	roxr.b	#1,d6		; This _is_ the right one!???
-	move.w	d5,0(a3,d4)
-	subq.w	#2,d4
-	lbpl	.loop3,3
-	move.b	d6,(a4)+
-
-	ldbra	d3,.loop2,2
-	ldbra	d1,.loop1,1
-	ldbra	d0,.loop0,0
-
-	add.w	#16,a7
-	bra	end_vr_trnfm
-
-
-.not_8bit:
-	cmp.w	#32,d0
-	bne	.not_32bit
-
-	move.l	vwk_real_address(a0),a5
-;	move.l	wk_driver(a5),a6
-;	move.l	driver_device(a6),a6
-;	lea	dev_vdi2pix(a6),a6
-	lea	vdi_colours,a6
-
-	move.l	vwk_palette(a0),d0
-	bne	.local_palette
-	move.l	wk_screen_palette_colours(a5),d0
-.local_palette:
-	move.l	d0,a5
-
-	sub.w	#64,a7			; This is specialized for 32 bit!
-	move.l	a7,a3
-	move.l	mfdb_address(a2),a4
-	move.w	mfdb_height(a1),d0
-
-	subq.w	#1,d0
-
- label .loop0b,0
-	move.w	mfdb_wdwidth(a1),d1
-	subq.w	#1,d1
-
- label .loop1b,1
-	movem.l	(a4),d2-d5
-	movem.l	d2-d5,(a3)
-	movem.l	16(a4),d2-d5
-	movem.l	d2-d5,16(a3)
-	movem.l	32(a4),d2-d5
-	movem.l	d2-d5,32(a3)
-	movem.l	48(a4),d2-d5
-	movem.l	d2-d5,48(a3)
-	moveq	#15,d3
-
- label .loop2b,2
-	moveq	#62,d4
-
- label .loop3b,3
-	move.w	0(a3,d4),d5
-	add.w	d5,d5
-
-	roxr.l	#1,d6		; This _is_ the right one!
-	move.w	d5,0(a3,d4)
-	subq.w	#2,d4
-	lbpl	.loop3b,3
-
-	move.l	d6,(a4)+
-
- label .skipb,4
-	ldbra	d3,.loop2b,2
-	ldbra	d1,.loop1b,1
-	ldbra	d0,.loop0b,0
-
-	add.w	#64,a7
-	bra	end_vr_trnfm
-
-.not_32bit:
-.not_chunky:		
-
-end_vr_trnfm:
-	moveq	#1,d0
-	tst.w	mfdb_standard(a1)
-	beq	.was_not_standard
-	moveq	#0,d0
-.was_not_standard:
-	move.w	d0,mfdb_standard(a2)
-	movem.l	(a7)+,d2-d7/a3-a6
+	move.l	(a7)+,d2
 	used_d1
 	rts
-
-
-* rotate_mem - Support function
-*              Rotates a memory area in a reasonably smart way
-* Todo: Use stack buffer for small amounts
-* In:   a0      Pointer to data
-*       d0	Size
-*       d1      Shift
-rotate_mem:
-	movem.l	d0-d3/a2-a3,-(a7)
-	move.l	a0,a2
-	cmp.l	d0,d1
-	bge	.end_rotate
-	tst.l	d1
-	beq	.end_rotate
-.rotate:
-	move.l	a2,a3
-	add.l	d1,a3
-	move.l	d0,d2
-	sub.l	d1,d2
-	subq.l	#1,d2
-
- label .loop,1
-	move.b	(a2),d3
-	move.b	(a3),(a2)+
-	move.b	d3,(a3)+
-	ldbra	d2,.loop,1
-	sub.l	#$10000,d2
-	lbpl	.loop,1
-	move.l	d0,d2
-	move.l	d1,d0
-	divu	d1,d2
-	swap	d2
-	ext.l	d2
-	sub.l	d2,d1
-;	bpl	.positive
-;	neg.l	d1
-;.positive:
-	cmp.l	d0,d1
-	blt	.rotate
-.end_rotate:
-	movem.l	(a7)+,d0-d3/a2-a3
-	rts
-
-
-	data
-
-vdi_colours:
-	dc.b	0,2,3,6,4,7,5,8,9,10,11,14,12,15,13,255
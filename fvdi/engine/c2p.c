@@ -0,0 +1,579 @@
+/*
+ * fVDI chunky <-> planar conversion
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ *
+ * All conversions work on groups of 16 pixels. A group of device
+ * specific bitplanes (one word per plane) and the same group as
+ * chunky pixels take the same amount of space, so the group kernels
+ * below work in place as well. Between standard and device specific
+ * format the groups are just shuffled around as whole words.
+ *
+ * Chunky pixels are turned into planes using the usual bit matrix
+ * transposes (8x8 for bytes in c2p8.h, 16x16 for words). 8 bit pixels
+ * keep bit n in plane n (like the Atari interleaved modes), while 16
+ * and 32 bit pixels have their most significant bit in plane 0.
+ */
+
+#include "fvdi.h"
+#include "function.h"
+#include "relocate.h"
+#include "utility.h"
+#include "c2p8.h"
+
+#define PIXELS   256    /* Per call of the transfer row functions */
+
+void CDECL c2p_trnfm(Virtual *vwk, MFDB *src, MFDB *dst);
+
+
+/*
+ * Transpose the 16x16 bit matrix with two rows per long,
+ * the first row of each pair in the high word.
+ */
+static void transpose16(unsigned long *m)
+{
+    unsigned long t;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        t = (m[i] ^ (m[i + 4] >> 8)) & 0x00ff00ffUL;
+        m[i] ^= t;
+        m[i + 4] ^= t << 8;
+    }
+    for (i = 0; i < 8; i++)
+    {
+        if (i & 2)
+            continue;
+        t = (m[i] ^ (m[i + 2] >> 4)) & 0x0f0f0f0fUL;
+        m[i] ^= t;
+        m[i + 2] ^= t << 4;
+    }
+    for (i = 0; i < 8; i += 2)
+    {
+        t = (m[i] ^ (m[i + 1] >> 2)) & 0x33333333UL;
+        m[i] ^= t;
+        m[i + 1] ^= t << 2;
+    }
+    for (i = 0; i < 8; i++)
+    {
+        t = (m[i] ^ (m[i] >> 15)) & 0x0000aaaaUL;
+        m[i] ^= t ^ (t << 15);
+    }
+}
+
+
+/*
+ * 16 chunky 16 bit pixels to 16 planes, or back again.
+ */
+static void flip16(const unsigned short *src, unsigned short *dst)
+{
+    unsigned long m[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        m[i] = ((unsigned long)src[i * 2] << 16) | src[i * 2 + 1];
+    transpose16(m);
+    for (i = 0; i < 8; i++)
+    {
+        dst[i * 2] = m[i] >> 16;
+        dst[i * 2 + 1] = m[i];
+    }
+}
+
+
+/*
+ * 16 chunky 32 bit pixels (as word pairs) to 32 planes.
+ */
+static void chunky32_to_planes(const unsigned short *src, unsigned short *dst)
+{
+    unsigned long hi[8], lo[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        hi[i] = ((unsigned long)src[i * 4] << 16) | src[i * 4 + 2];
+        lo[i] = ((unsigned long)src[i * 4 + 1] << 16) | src[i * 4 + 3];
+    }
+    transpose16(hi);
+    transpose16(lo);
+    for (i = 0; i < 8; i++)
+    {
+        dst[i * 2] = hi[i] >> 16;
+        dst[i * 2 + 1] = hi[i];
+        dst[i * 2 + 16] = lo[i] >> 16;
+        dst[i * 2 + 17] = lo[i];
+    }
+}
+
+
+static void planes_to_chunky32(const unsigned short *src, unsigned short *dst)
+{
+    unsigned long hi[8], lo[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        hi[i] = ((unsigned long)src[i * 2] << 16) | src[i * 2 + 1];
+        lo[i] = ((unsigned long)src[i * 2 + 16] << 16) | src[i * 2 + 17];
+    }
+    transpose16(hi);
+    transpose16(lo);
+    for (i = 0; i < 8; i++)
+    {
+        dst[i * 4] = hi[i] >> 16;
+        dst[i * 4 + 1] = lo[i] >> 16;
+        dst[i * 4 + 2] = hi[i];
+        dst[i * 4 + 3] = lo[i];
+    }
+}
+
+
+static void chunky_to_planes(const unsigned short *src, unsigned short *dst, int planes)
+{
+    switch (planes)
+    {
+    case 8:
+        chunky8_to_planes((const unsigned char *)src, dst, 8);
+        break;
+    case 16:
+        flip16(src, dst);
+        break;
+    default:
+        chunky32_to_planes(src, dst);
+        break;
+    }
+}
+
+
+static void planes_to_chunky(const unsigned short *src, unsigned short *dst, int planes)
+{
+    switch (planes)
+    {
+    case 8:
+        planes_to_chunky8(src, (unsigned char *)dst, 8);
+        break;
+    case 16:
+        flip16(src, dst);
+        break;
+    default:
+        planes_to_chunky32(src, dst);
+        break;
+    }
+}
+
+
+/*
+ * Standard format (all of plane 0, then plane 1 ...) to
+ * interleaved planes (all planes of group 0, then group 1 ...)
+ */
+static void weave(const unsigned short *src, unsigned short *dst, long groups, int planes)
+{
+    const unsigned short *plane;
+    long g;
+    int p;
+
+    for (g = 0; g < groups; g++)
+    {
+        plane = src++;
+        for (p = planes - 1; p >= 0; p--)
+        {
+            *dst++ = *plane;
+            plane += groups;
+        }
+    }
+}
+
+
+static void unweave(const unsigned short *src, unsigned short *dst, long groups, int planes)
+{
+    unsigned short *plane;
+    long g;
+    int p;
+
+    for (g = 0; g < groups; g++)
+    {
+        plane = dst++;
+        for (p = planes - 1; p >= 0; p--)
+        {
+            *plane = *src++;
+            plane += groups;
+        }
+    }
+}
+
+
+static void reverse(unsigned short *first, long n)
+{
+    unsigned short *last, tmp;
+
+    last = first + n - 1;
+    while (first < last)
+    {
+        tmp = *first;
+        *first++ = *last;
+        *last-- = tmp;
+    }
+}
+
+
+/*
+ * Move the last n words of an area of size words to its start.
+ */
+static void rotate(unsigned short *area, long size, long n)
+{
+    reverse(area, size - n);
+    reverse(area + size - n, n);
+    reverse(area, size);
+}
+
+
+/*
+ * In place (un)weaving without any extra memory.
+ * The groups are split in two halves, a and b. In standard
+ * format each plane is a(n) b(n), which needs to be turned
+ * into a(0..planes-1) b(0..planes-1) for recursion, or back.
+ * Slow, but only used when no memory block can be had.
+ */
+static void weave_rotate(unsigned short *area, long groups, int planes)
+{
+    long a, b;
+    int p;
+
+    if (groups < 2)
+        return;
+
+    a = groups / 2;
+    b = groups - a;
+    for (p = planes - 2; p >= 0; p--)
+        rotate(area + p * groups + a, (planes - 1 - p) * a + b, (planes - 1 - p) * a);
+    weave_rotate(area, a, planes);
+    weave_rotate(area + a * planes, b, planes);
+}
+
+
+static void unweave_rotate(unsigned short *area, long groups, int planes)
+{
+    long a, b;
+    int p;
+
+    if (groups < 2)
+        return;
+
+    a = groups / 2;
+    b = groups - a;
+    unweave_rotate(area, a, planes);
+    unweave_rotate(area + a * planes, b, planes);
+    for (p = 0; p < planes - 1; p++)
+        rotate(area + p * groups + a, (planes - 1 - p) * a + b, b);
+}
+
+
+/*
+ * In place conversion between standard and interleaved planes,
+ * via a temporary copy if there is memory available for one.
+ */
+static void shuffle_in_place(unsigned short *area, long groups, int planes, int to_standard)
+{
+    unsigned short *copy, *from, *to;
+    long n;
+
+    if (planes < 2)
+        return;
+
+    n = groups * planes;
+    if ((copy = (unsigned short *)allocate_block(n * 2)) == 0)
+    {
+        if (to_standard)
+            unweave_rotate(area, groups, planes);
+        else
+            weave_rotate(area, groups, planes);
+        return;
+    }
+
+    from = area;
+    to = copy;
+    while (--n >= 0)
+        *to++ = *from++;
+
+    if (to_standard)
+        unweave(copy, area, groups, planes);
+    else
+        weave(copy, area, groups, planes);
+
+    free_block(copy);
+}
+
+
+/*
+ * vr_trnfm
+ * Converts between standard format and the device specific one,
+ * interleaved planes or (in 8/16/32 bit modes on chunky devices)
+ * packed pixels. Works in place as well.
+ */
+void CDECL c2p_trnfm(Virtual *vwk, MFDB *src, MFDB *dst)
+{
+    unsigned short *from, *to, *group;
+    unsigned short planes_buf[32];
+    long groups, g;
+    int planes, p, chunky;
+
+    from = (unsigned short *)src->address;
+    to = (unsigned short *)dst->address;
+    planes = src->bitplanes;
+    groups = (long)src->wdwidth * src->height;
+
+    chunky = 0;
+    if (vwk->real_address->driver->device->format & 2)
+        chunky = (planes == 8) || (planes == 16) || (planes == 32);
+
+    if (src->standard)
+    {
+        if (from == to)
+        {
+            shuffle_in_place(to, groups, planes, 0);
+            if (chunky)
+            {
+                for (g = 0; g < groups; g++)
+                {
+                    planes_to_chunky(to, to, planes);
+                    to += planes;
+                }
+            }
+        } else if (chunky)
+        {
+            for (g = 0; g < groups; g++)
+            {
+                group = from++;
+                for (p = 0; p < planes; p++)
+                {
+                    planes_buf[p] = *group;
+                    group += groups;
+                }
+                planes_to_chunky(planes_buf, to, planes);
+                to += planes;
+            }
+        } else
+            weave(from, to, groups, planes);
+    } else
+    {
+        if (from == to)
+        {
+            if (chunky)
+            {
+                group = to;
+                for (g = 0; g < groups; g++)
+                {
+                    chunky_to_planes(group, group, planes);
+                    group += planes;
+                }
+            }
+            shuffle_in_place(to, groups, planes, 1);
+        } else if (chunky)
+        {
+            for (g = 0; g < groups; g++)
+            {
+                chunky_to_planes(from, planes_buf, planes);
+                from += planes;
+                group = to++;
+                for (p = 0; p < planes; p++)
+                {
+                    *group = planes_buf[p];
+                    group += groups;
+                }
+            }
+        } else
+            unweave(from, to, groups, planes);
+    }
+
+    dst->standard = !src->standard;
+}
+
+
+/*
+ * Index pixel formats for vr_transfer_bits:
+ * packed 1, 2, 4 and 8 bit, and interleaved 2, 4 and 8 planes.
+ * Returns the number of bits, or zero if not supported.
+ */
+static int index_format(unsigned long px_format, int *planar)
+{
+    int bits;
+
+    bits = px_format & 0xff;
+    if ((px_format & 0xff000000UL) != 0x01000000UL ||     /* PX_1COMP */
+        (int)((px_format >> 8) & 0xff) != bits)           /* All bits used */
+        return 0;
+    if ((bits != 1) && (bits != 2) && (bits != 4) && (bits != 8))
+        return 0;
+
+    switch (px_format & 0x00ff0000UL)
+    {
+    case 0x00020000UL:      /* PX_PACKED */
+        *planar = 0;
+        break;
+    case 0x00000000UL:      /* PX_IPLANES */
+        *planar = bits > 1;
+        break;
+    default:
+        return 0;
+    }
+
+    return bits;
+}
+
+
+/*
+ * Read n pixels of a row as 8 bit indices.
+ */
+static void get_pixels(GCBITMAP *bm, int bits, int planar, long x, long y, int n, unsigned char *pixels)
+{
+    unsigned char *row, group_pixels[16];
+    unsigned short *group;
+    int first, count, i, shift, mask;
+
+    row = bm->addr + bm->width * y;
+    if (planar)
+    {
+        group = (unsigned short *)row + (x >> 4) * bits;
+        first = x & 15;
+        while (n > 0)
+        {
+            count = 16 - first;
+            if (count > n)
+                count = n;
+            if ((count == 16) && !((long)pixels & 1))      /* No odd long access */
+                planes_to_chunky8(group, pixels, bits);
+            else
+            {
+                planes_to_chunky8(group, group_pixels, bits);
+                for (i = 0; i < count; i++)
+                    pixels[i] = group_pixels[first + i];
+            }
+            pixels += count;
+            n -= count;
+            first = 0;
+            group += bits;
+        }
+    } else if (bits == 8)
+    {
+        row += x;
+        for (i = 0; i < n; i++)
+            *pixels++ = *row++;
+    } else
+    {
+        mask = (1 << bits) - 1;
+        x *= bits;
+        for (i = 0; i < n; i++)
+        {
+            shift = 8 - bits - (x & 7);
+            *pixels++ = (row[x >> 3] >> shift) & mask;
+            x += bits;
+        }
+    }
+}
+
+
+/*
+ * Write n 8 bit indices to a row.
+ */
+static void put_pixels(GCBITMAP *bm, int bits, int planar, long x, long y, int n, const unsigned char *pixels)
+{
+    unsigned char *row, group_pixels[16];
+    unsigned short *group;
+    int first, count, i, shift, mask;
+
+    row = bm->addr + bm->width * y;
+    if (planar)
+    {
+        group = (unsigned short *)row + (x >> 4) * bits;
+        first = x & 15;
+        while (n > 0)
+        {
+            count = 16 - first;
+            if (count > n)
+                count = n;
+            if ((count == 16) && !((long)pixels & 1))
+                chunky8_to_planes(pixels, group, bits);
+            else
+            {
+                planes_to_chunky8(group, group_pixels, bits);
+                for (i = 0; i < count; i++)
+                    group_pixels[first + i] = pixels[i];
+                chunky8_to_planes(group_pixels, group, bits);
+            }
+            pixels += count;
+            n -= count;
+            first = 0;
+            group += bits;
+        }
+    } else if (bits == 8)
+    {
+        row += x;
+        for (i = 0; i < n; i++)
+            *row++ = *pixels++;
+    } else
+    {
+        mask = (1 << bits) - 1;
+        x *= bits;
+        for (i = 0; i < n; i++)
+        {
+            shift = 8 - bits - (x & 7);
+            row[x >> 3] = (row[x >> 3] & ~(mask << shift)) | ((*pixels++ & mask) << shift);
+            x += bits;
+        }
+    }
+}
+
+
+/*
+ * vr_transfer_bits between index formats (replace mode).
+ * The source can not have more bits than the destination.
+ * Monochrome set pixels become all ones, other indices are kept.
+ * Returns zero for formats that are not handled.
+ */
+long c2p_transfer(GCBITMAP *src_bm, GCBITMAP *dst_bm, RECT16 *src_rect, RECT16 *dst_rect)
+{
+    unsigned char pixels[PIXELS];
+    int src_bits, dst_bits, src_planar, dst_planar;
+    long y, x, dy, dx, w, h, step;
+    int n, i, k;
+
+    src_bits = index_format(src_bm->px_format, &src_planar);
+    dst_bits = index_format(dst_bm->px_format, &dst_planar);
+    if (!src_bits || !dst_bits || (src_bits > dst_bits))
+        return 0;
+
+    w = src_rect->x2 - src_rect->x1 + 1;
+    h = src_rect->y2 - src_rect->y1 + 1;
+    dx = dst_rect->x1 - src_rect->x1;
+    dy = dst_rect->y1 - src_rect->y1;
+
+    /* Overlapping areas within the same bitmap go backwards if needed */
+    y = src_rect->y1;
+    step = 1;
+    if (dy > 0)
+    {
+        y = src_rect->y2;
+        step = -1;
+    }
+    for (; h > 0; h--, y += step)
+    {
+        for (i = 0; i < w; i += PIXELS)
+        {
+            n = (w - i > PIXELS) ? PIXELS : w - i;
+            x = src_rect->x1 + i;
+            if (!dy && (dx > 0))
+                x = src_rect->x2 + 1 - i - n;
+            get_pixels(src_bm, src_bits, src_planar, x, y, n, pixels);
+            if ((src_bits == 1) && (dst_bits > 1))
+            {
+                for (k = 0; k < n; k++)
+                    pixels[k] = -pixels[k];
+            }
+            put_pixels(dst_bm, dst_bits, dst_planar, x + dx, y + dy, n, pixels);
+        }
+    }
+
+    return 1;
+}
@@ -207,7 +207,7 @@ void CDECL vr_transfer_bits(Virtual *vwk, GCBITMAP *src_bm, GCBITMAP *dst_bm, RE
                         }
                     }
                     mode = 0;  /* Just to skip error printout at the end */
-                } else
+                } else if (!c2p_transfer(src_bm, dst_bm, src_rect, dst_rect))
                 {
                     PUTS("No support yet for memory->memory between these different pixmap formats\n");
                     error = 1;
@@ -215,13 +215,7 @@ void CDECL vr_transfer_bits(Virtual *vwk, GCBITMAP *src_bm, GCBITMAP *dst_bm, RE
                 }
             } else
             {
-                if (src_bm->px_format == 0x01020101L)
-                {
-                    /* PX_PREF1 */
-                    PUTS("No support yet for 1 bit memory->memory\n");
-                    error = 1;
-                    break;
-                } else if (src_bm->px_format == 0x01020808L)
+                if (src_bm->px_format == 0x01020808L)
                 {
                     /* PX_PREF8 */
                     int x, y;
@@ -249,7 +243,7 @@ void CDECL vr_transfer_bits(Virtual *vwk, GCBITMAP *src_bm, GCBITMAP *dst_bm, RE
                         for (x = src_rect->x2 - src_rect->x1; x >= 0; x--)
                             *dst++ = *src++;
                     }
-                } else
+                } else if (!c2p_transfer(src_bm, dst_bm, src_rect, dst_rect))
                 {
                     PRINTF(("Unsupported pixel format ($%lx) for memory->memory\n", src_bm->px_format));
                     error = 1;
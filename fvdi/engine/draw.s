@@ -34,7 +34,7 @@ transparent	equ	1		; Fall through?
 	xdef	v_rbox,v_rfbox
 
 	xdef	_default_line
-	xdef	_fill_poly,_hline,_fill_spans
+	xdef	_fill_poly,_hline,_fill_rect,_fill_spans
 	xdef	_c_pline
 	xdef	_v_bez_accel
 
@@ -260,7 +260,7 @@ c_v_pline:
 	beq		.no_arrow
 
 	move.l	d0,d1
-	clr.l	-(a7)
+	move.l	#1024,-(a7)	; Only a few points, so a small block will do
 	bsr	asm_allocate_block
 	addq.l	#4,a7
 	tst.l	d0
@@ -1308,6 +1308,36 @@ _hline:
 	rts
 
 
+* fill_rect(Virtual *vwk, long x1, long y1, long x2, long y2, long colour, short *pattern, long mode, long interior_style)
+*
+_fill_rect:
+	movem.l	d2-d7/a2-a6,-(a7)
+
+	move.l	11*4+4+0(a7),a0
+	move.l	11*4+4+20(a7),d0
+	move.l	11*4+4+4(a7),d1
+	move.l	11*4+4+8(a7),d2
+	move.l	11*4+4+12(a7),d3
+	move.l	11*4+4+16(a7),d4
+
+	bsr	clip_rect
+	blt	.end_fill_rect		; Empty rectangle?
+
+	move.l	vwk_real_address(a0),a2
+	move.l	wk_r_fill(a2),a1
+
+	move.l	11*4+4+24(a7),d5
+
+	move.l	11*4+4+28(a7),d6
+	move.l	11*4+4+32(a7),d7
+
+	jsr	(a1)
+
+.end_fill_rect:
+	movem.l	(a7)+,d2-d7/a2-a6
+	rts
+
+
 * fill_spans(Virtual *vwk, short *spans, long n, long colour, short *pattern, long mode, long interior_style)
 *
 _fill_spans:
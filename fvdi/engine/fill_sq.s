@@ -121,27 +121,31 @@ lib_vsf_udpat:
 	add.l	#vwk_struct_size,a1
 	cmp.w	#16,d1
 	ble	.single_plane		; Actually only n*16 allowed
+	cmp.w	#16*32,d1		; No more than 32 planes
+	ble	.size_ok
+	move.w	#16*32,d1
+.size_ok:
 	move.l	vwk_fill_user_pattern_extra(a0),d0
 	bne	.allocated
 
 	movem.l	d1-d2/a0/a2,-(a7)
-	ext.l	d1
-	add.w	d1,d1
 ;	move.l	d1,-(a7)
 ;	move.w	#$48,-(a7)		; Malloc
 ;	trap	#1
 ;	addq.l	#6,a7
 	move.l	#3,-(a7)
-	move.l	d1,-(a7)
+	move.l	#16*32*2,-(a7)		; Room for any later pattern too
 	bsr	_malloc
 	addq.l	#8,a7
 	movem.l	(a7)+,d1-d2/a0/a2
 	tst.l	d0
 	beq	.error_vsf_updat	; .error
+	move.l	d0,vwk_fill_user_pattern_extra(a0)
 
 .allocated:
 	move.l	d0,a1
-	moveq	#1,d0
+	move.w	d1,d0
+	lsr.w	#4,d0			; Number of planes
 .single_plane:
 	move.w	d0,vwk_fill_user_multiplane(a0)
 	move.l	a1,vwk_fill_user_pattern_in_use(a0)
@@ -16,6 +16,12 @@
 
 #define BLOCKS           2              /* Default number of memory blocks to allocate for internal use */
 #define BLOCK_SIZE      10              /* Default size of those blocks, in kbyte */
+#define SMALL_BLOCKS     4              /* Default number of small blocks (point arrays and such) */
+#define SMALL_BLOCK_SIZE 2              /* Default size of those blocks, in kbyte */
+#define LARGE_BLOCKS     1              /* Default number of large blocks (text and glyph buffers) */
+#define LARGE_BLOCK_SIZE 32             /* Default size of those blocks, in kbyte */
+#define GLYPH_CACHE_SIZE 256            /* Default memory for cached FreeType2 glyphs, in kbyte */
+#define FONT_CACHE_SIZE  512            /* Default memory for FreeType2 font size instances, in kbyte */
 
 #define MAGIC     "InitMagic"
 
@@ -45,6 +51,10 @@ void *(*external_char_advance)(Virtual *vwk, Fontheader *font, long ch, short *a
 void (*external_xfntinfo)(Virtual *vwk, Fontheader *font, long flags, XFNT_INFO *info) = ft2_xfntinfo;
 void (*external_fontheader)(Virtual *vwk, Fontheader *font, VQT_FHDR *fhdr) = ft2_fontheader;
 unsigned short (*external_char_index)(Virtual *vwk, Fontheader *font, short *intin) = ft2_char_index;
+long (*external_savecache)(Virtual *vwk, const char *filename) = ft2_savecache;
+long (*external_loadcache)(Virtual *vwk, const char *filename, long mode) = ft2_loadcache;
+long (*external_flushcache)(Virtual *vwk) = ft2_flushcache;
+long (*external_cachesize)(Virtual *vwk, long which) = ft2_cachesize;
 
 #else
 
@@ -61,6 +71,10 @@ void *(*external_char_advance)(Virtual *vwk, Fontheader *font, long ch, short *a
 void (*external_xfntinfo)(Virtual *vwk, Fontheader *font, long flags, XFNT_INFO *info) = 0;
 void (*external_fontheader)(Virtual *vwk, Fontheader *font, VQT_FHDR *fhdr) = 0;
 unsigned short (*external_char_index)(Virtual *vwk, Fontheader *font, short *intin) = 0;
+long (*external_savecache)(Virtual *vwk, const char *filename) = 0;
+long (*external_loadcache)(Virtual *vwk, const char *filename, long mode) = 0;
+long (*external_flushcache)(Virtual *vwk) = 0;
+long (*external_cachesize)(Virtual *vwk, long which) = 0;
 
 #endif
 
@@ -79,6 +93,10 @@ short singlebend = 0;
 short memlink = 1;
 short blocks = BLOCKS;
 long block_size = BLOCK_SIZE * 1024L;
+short small_blocks = SMALL_BLOCKS;
+long small_block_size = SMALL_BLOCK_SIZE * 1024L;
+short large_blocks = LARGE_BLOCKS;
+long large_block_size = LARGE_BLOCK_SIZE * 1024L;
 long log_size = 1000;
 short arc_split = 16384;  /* 1/4 as many lines as largest ellipse axel radius in pixels */
 short arc_min = 16;       /* Minimum number of lines in an ellipse */
@@ -115,6 +133,8 @@ short check_mem = 0;
 short bconout = 0;
 short file_cache_size = 0;
 short antialiasing = 0;
+long glyph_cache_size = GLYPH_CACHE_SIZE * 1024L;
+long font_cache_size = FONT_CACHE_SIZE * 1024L;
 char *debug_file = 0;
 static short dummy_v;
 
@@ -133,6 +153,10 @@ static long set_width(Virtual *vwk, const char **ptr);
 static long set_height(Virtual *vwk, const char **ptr);
 static long set_blocks(Virtual *vwk, const char **ptr);
 static long set_block_size(Virtual *vwk, const char **ptr);
+static long set_small_blocks(Virtual *vwk, const char **ptr);
+static long set_small_block_size(Virtual *vwk, const char **ptr);
+static long set_large_blocks(Virtual *vwk, const char **ptr);
+static long set_large_block_size(Virtual *vwk, const char **ptr);
 static long set_log_size(Virtual *vwk, const char **ptr);
 static long set_arc_split(Virtual *vwk, const char **ptr);
 static long set_arc_min(Virtual *vwk, const char **ptr);
@@ -145,6 +169,8 @@ static long set_silent(Virtual *vwk, const char **ptr);
 static long set_size(Virtual *vwk, const char **ptr);
 static long pre_allocate(Virtual *vwk, const char **ptr);
 static long file_cache(Virtual *vwk, const char **ptr);
+static long glyph_cache(Virtual *vwk, const char **ptr);
+static long font_cache(Virtual *vwk, const char **ptr);
 static long set_debug_file(Virtual *vwk, const char **ptr);
 
 static Option const options[] = {
@@ -177,6 +203,10 @@ static Option const options[] = {
     {"height", { set_height }, -1 },        /* height, set screen height in mm */
     {"blocks", { set_blocks }, -1 },        /* blocks n, number of memory blocks to allocate */
     {"blocksize", { set_block_size }, -1 }, /* blocksize n, size of memory blocks in kbyte */
+    {"smallblocks", { set_small_blocks }, -1 },        /* smallblocks n, number of small memory blocks */
+    {"smallblocksize", { set_small_block_size }, -1 }, /* smallblocksize n, size of small memory blocks in kbyte */
+    {"largeblocks", { set_large_blocks }, -1 },        /* largeblocks n, number of large memory blocks */
+    {"largeblocksize", { set_large_block_size }, -1 }, /* largeblocksize n, size of large memory blocks in kbyte */
     {"logsize", { set_log_size }, -1 },     /* logsize n, size of log in kbyte */
     {"arcsplit", { set_arc_split }, -1 },   /* arcsplit n, % of largest ellipse radius to give # of lines to use */
     {"arcmin", { set_arc_min }, -1 },       /* arcmin n, minimum number of line to use in an ellipse */
@@ -200,6 +230,8 @@ static Option const options[] = {
     {"preallocate", { pre_allocate }, -1 }, /* preallocate n, allocate n kbyte at startup */
     {"filecache", { file_cache }, -1 },     /* filecache n, allocate n kbyte for FreeType2 font files */
     {"antialias", { &antialiasing }, 1 },   /* use FT2 antialiasing */
+    {"glyphcache", { glyph_cache }, -1 },   /* glyphcache n, keep at most n kbyte of FreeType2 glyphs cached */
+    {"fontcache", { font_cache }, -1 },     /* fontcache n, keep at most n kbyte of FreeType2 font sizes cached */
     {"debugfile", { set_debug_file }, -1 }, /* debugfile str, file to use for debug output */
     {"bconout", { &bconout }, 1 },          /* bconout, enables handling of BConout the the screen in fVDI */
 };
@@ -362,6 +394,8 @@ static Driver *init_module(Virtual *vwk, const char **ptr, List **list)
     driver->module.id = -1;
     driver->module.flags = MOD_RESIDENT;           /* Resident */
     driver->module.file_name = tmp + sizeof(List) + sizeof(Driver);
+    driver->module.shutdown = 0;
+    driver->default_vwk = 0;
     copy(name, driver->module.file_name);
 
     if (!load_driver(name, driver, vwk, token))
@@ -762,6 +796,78 @@ static long set_block_size(Virtual *vwk, const char **ptr)
 }
 
 
+static long set_small_blocks(Virtual *vwk, const char **ptr)
+{
+    char token[TOKEN_SIZE];
+
+    (void) vwk;
+    if ((*ptr = skip_space(*ptr)) == NULL)
+    {
+        /* *********** Error, somehow */
+    }
+    *ptr = get_token(*ptr, token, TOKEN_SIZE);
+    small_blocks = atol(token);
+    if (small_blocks < 0)
+        small_blocks = 0;
+
+    return 1;
+}
+
+
+static long set_small_block_size(Virtual *vwk, const char **ptr)
+{
+    char token[TOKEN_SIZE];
+
+    (void) vwk;
+    if ((*ptr = skip_space(*ptr)) == NULL)
+    {
+        /* *********** Error, somehow */
+    }
+    *ptr = get_token(*ptr, token, TOKEN_SIZE);
+    small_block_size = atol(token) * 1024;
+    if (small_block_size < 1024)
+        small_block_size = 1024;
+
+    return 1;
+}
+
+
+static long set_large_blocks(Virtual *vwk, const char **ptr)
+{
+    char token[TOKEN_SIZE];
+
+    (void) vwk;
+    if ((*ptr = skip_space(*ptr)) == NULL)
+    {
+        /* *********** Error, somehow */
+    }
+    *ptr = get_token(*ptr, token, TOKEN_SIZE);
+    large_blocks = atol(token);
+    if (large_blocks < 0)
+        large_blocks = 0;
+
+    return 1;
+}
+
+
+static long set_large_block_size(Virtual *vwk, const char **ptr)
+{
+    char token[TOKEN_SIZE];
+
+    (void) vwk;
+    if ((*ptr = skip_space(*ptr)) == NULL)
+    {
+        /* *********** Error, somehow */
+    }
+    *ptr = get_token(*ptr, token, TOKEN_SIZE);
+    large_block_size = atol(token) * 1024;
+    if (large_block_size < 10 * 1024)
+        large_block_size = 10 * 1024;
+
+    return 1;
+}
+
+
 static long set_log_size(Virtual *vwk, const char **ptr)
 {
     char token[TOKEN_SIZE];
@@ -875,6 +981,44 @@ static long file_cache(Virtual *vwk, const char **ptr)
 }
 
 
+static long glyph_cache(Virtual *vwk, const char **ptr)
+{
+    char token[TOKEN_SIZE];
+    long amount;
+
+    (void) vwk;
+    if ((*ptr = skip_space(*ptr)) == NULL)
+    {
+        /* *********** Error, somehow */
+    }
+    *ptr = get_token(*ptr, token, TOKEN_SIZE);
+    amount = atol(token);
+    if (amount > 0)
+        glyph_cache_size = amount * 1024;
+
+    return 1;
+}
+
+
+static long font_cache(Virtual *vwk, const char **ptr)
+{
+    char token[TOKEN_SIZE];
+    long amount;
+
+    (void) vwk;
+    if ((*ptr = skip_space(*ptr)) == NULL)
+    {
+        /* *********** Error, somehow */
+    }
+    *ptr = get_token(*ptr, token, TOKEN_SIZE);
+    amount = atol(token);
+    if (amount > 0)
+        font_cache_size = amount * 1024;
+
+    return 1;
+}
+
+
 static long load_palette(Virtual *vwk, const char **ptr)
 {
     char token[TOKEN_SIZE], name[NAME_SIZE];
@@ -0,0 +1,479 @@
+/*
+ * fVDI internal memory pool
+ *
+ * Small allocations are carved out of 16 kbyte arenas fetched
+ * from the OS. Free blocks are kept on segregated lists (eight
+ * sub-classes per power of two), with bitmaps to find a large
+ * enough list in constant time. Blocks are split on allocation
+ * and merged with free neighbours when released, so the arenas
+ * do not fragment over time.
+ *
+ * Every block has a three long header, laid out so that free()
+ * can tell it from an OS block: the first long is the (even)
+ * address of the previous block in the arena, while OS blocks
+ * have an odd Circle.prev.
+ *
+ * Copyright 1997-2003, Johan Klockars
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+#include "relocate.h"
+#include "stdlib.h"
+#include "utility.h"
+#include "globals.h"
+
+
+typedef struct Block_ {
+    struct Block_ *prev_phys;       /* Previous block in arena, or 0 */
+    long requested;                 /* Size asked for, when in use */
+    unsigned long size;             /* Including header, BLOCK_FREE flag */
+    struct Block_ *next_free;       /* Only in free blocks */
+    struct Block_ *prev_free;
+} Block;
+
+typedef struct Arena_ {
+    struct Arena_ *next;
+    long size;
+} Arena;
+
+#define OS_MARGIN    64
+#define ARENA_SIZE   (16 * 1024L - OS_MARGIN)
+#define HEADER_SIZE  (3 * (long)sizeof(long))
+#define MIN_BLOCK    ((long)sizeof(Block))
+#define BLOCK_FREE   1L
+#define BLOCK_ALIGN  ((long)sizeof(long) - 1)
+#define BLOCK_SIZE(b)    ((long)((b)->size & ~3L))
+#define NEXT_PHYS(b)     ((Block *)((char *)(b) + BLOCK_SIZE(b)))
+#define LARGEST_BLOCK    (15 * 1024L)     /* Always found in a fresh arena */
+
+#define SL_BITS      3
+#define SL_COUNT     (1 << SL_BITS)
+#define SMALL_LIMIT  128             /* Below this, classes are 16 bytes apart */
+#define SMALL_SHIFT  4
+#define FL_OFFSET    6               /* log2(SMALL_LIMIT) - 1 */
+#define FL_COUNT     8               /* Enough for ARENA_SIZE */
+
+#ifndef ADDR_NOT_OK
+#define ADDR_NOT_OK 0xfc000003
+#endif
+
+static Arena *arenas = 0;
+static unsigned char fl_bitmap = 0;
+static unsigned char sl_bitmap[FL_COUNT];
+static Block *free_list[FL_COUNT][SL_COUNT];
+
+static short allocated = 0;         /* Arenas */
+static long used_blocks = 0;
+static long used_bytes = 0;         /* Including headers */
+static long requested_bytes = 0;
+static long free_bytes = 0;
+static long high_water = 0;         /* Maximum of used_bytes */
+
+
+static int highest_bit(unsigned long x)
+{
+    int n = 0;
+
+    if (x & 0xffff0000L)
+    {
+        x >>= 16;
+        n += 16;
+    }
+    if (x & 0xff00)
+    {
+        x >>= 8;
+        n += 8;
+    }
+    if (x & 0xf0)
+    {
+        x >>= 4;
+        n += 4;
+    }
+    if (x & 0x0c)
+    {
+        x >>= 2;
+        n += 2;
+    }
+    if (x & 0x02)
+        n++;
+
+    return n;
+}
+
+
+static int lowest_bit(unsigned int x)
+{
+    return highest_bit(x & -x);
+}
+
+
+/*
+ * Find the list a block of the given size belongs on.
+ */
+static void size_class(long size, int *fl, int *sl)
+{
+    int bit;
+
+    if (size < SMALL_LIMIT)
+    {
+        *fl = 0;
+        *sl = (int)(size >> SMALL_SHIFT);
+    } else
+    {
+        bit = highest_bit(size);
+        *fl = bit - FL_OFFSET;
+        *sl = (int)(size >> (bit - SL_BITS)) & (SL_COUNT - 1);
+    }
+}
+
+
+/*
+ * Find a non-empty list where every block is at least 'size' bytes.
+ */
+static Block *find_free(long size)
+{
+    int fl, sl;
+    unsigned int map;
+
+    if (size < SMALL_LIMIT)
+        size += (1 << SMALL_SHIFT) - 1;
+    else
+        size += (1L << (highest_bit(size) - SL_BITS)) - 1;
+    size_class(size, &fl, &sl);
+    if (fl >= FL_COUNT)
+        return 0;
+
+    map = sl_bitmap[fl] & (~0U << sl);
+    if (!map)
+    {
+        map = fl_bitmap & (~0U << (fl + 1));
+        if (!map)
+            return 0;
+        fl = lowest_bit(map);
+        map = sl_bitmap[fl];
+    }
+    sl = lowest_bit(map);
+
+    return free_list[fl][sl];
+}
+
+
+static void insert_free(Block *block)
+{
+    int fl, sl;
+    Block *first;
+
+    size_class(BLOCK_SIZE(block), &fl, &sl);
+    first = free_list[fl][sl];
+    block->next_free = first;
+    block->prev_free = 0;
+    if (first)
+        first->prev_free = block;
+    free_list[fl][sl] = block;
+    fl_bitmap |= 1 << fl;
+    sl_bitmap[fl] |= 1 << sl;
+    block->size |= BLOCK_FREE;
+    free_bytes += BLOCK_SIZE(block);
+}
+
+
+static void remove_free(Block *block)
+{
+    int fl, sl;
+
+    size_class(BLOCK_SIZE(block), &fl, &sl);
+    if (block->next_free)
+        block->next_free->prev_free = block->prev_free;
+    if (block->prev_free)
+        block->prev_free->next_free = block->next_free;
+    else
+    {
+        free_list[fl][sl] = block->next_free;
+        if (!block->next_free)
+        {
+            sl_bitmap[fl] &= ~(1 << sl);
+            if (!sl_bitmap[fl])
+                fl_bitmap &= ~(1 << fl);
+        }
+    }
+    block->size &= ~BLOCK_FREE;
+    free_bytes -= BLOCK_SIZE(block);
+}
+
+
+/*
+ * Turn a piece of OS memory into an arena with a single free block,
+ * terminated by a zero sized block that is never free.
+ */
+static void add_arena(char *buf, long size)
+{
+    Arena *arena;
+    Block *block, *end;
+
+    size &= ~BLOCK_ALIGN;
+    arena = (Arena *)buf;
+    arena->next = arenas;
+    arena->size = size;
+    arenas = arena;
+
+    block = (Block *)&arena[1];
+    block->prev_phys = 0;
+    block->size = size - sizeof(Arena) - HEADER_SIZE;
+    end = NEXT_PHYS(block);
+    end->prev_phys = block;
+    end->requested = 0;
+    end->size = 0;
+    insert_free(block);
+
+    allocated++;
+}
+
+
+void allocate(long amount)
+{
+    char *buf;
+    long i;
+
+    amount &= ~0x0fL;
+    if (!amount)
+        return;
+
+    buf = fmalloc(amount * 1024, 3);
+    if (!buf)
+        return;
+
+    if ((debug > 2) && !(silentx[0] & 0x02))
+    {
+        PRINTF(("       Malloc at $%08lx\n", (long) buf));
+    }
+
+    for (i = 0; i < amount; i += 16)
+        add_arena(&buf[i * 1024L], 16 * 1024L);
+}
+
+
+/*
+ * Allocate from the pool.
+ * Returns 0 if the block is too large for an arena,
+ * or if no new arena could be had.
+ */
+void *arena_malloc(long size)
+{
+    long need, rest;
+    Block *block, *split;
+
+    need = (size + HEADER_SIZE + BLOCK_ALIGN) & ~BLOCK_ALIGN;
+    if (need < MIN_BLOCK)
+        need = MIN_BLOCK;
+
+    if (need > LARGEST_BLOCK)
+        return 0;
+
+    if ((debug > 2) && !(silentx[0] & 0x02))
+    {
+        PRINTF(("Alloc: Need block of size %ld/%ld\n", need, size));
+    }
+
+    if (!(block = find_free(need)))
+    {
+        char *buf;
+
+        if (!(buf = fmalloc(ARENA_SIZE, 3)))
+            return 0;
+        if ((debug > 2) && !(silentx[0] & 0x02))
+        {
+            PRINTF(("       Malloc at $%08lx\n", (long) buf));
+        }
+        add_arena(buf, ARENA_SIZE);
+        if (!(block = find_free(need)))
+            return 0;
+    }
+    remove_free(block);
+
+    rest = BLOCK_SIZE(block) - need;
+    if (rest >= MIN_BLOCK)
+    {
+        if ((debug > 2) && !(silentx[0] & 0x02))
+        {
+            PUTS("       Splitting\n");
+        }
+        block->size = need;
+        split = NEXT_PHYS(block);
+        split->prev_phys = block;
+        split->size = rest;
+        NEXT_PHYS(split)->prev_phys = split;
+        insert_free(split);
+    }
+
+    if ((debug > 2) && !(silentx[0] & 0x02))
+    {
+        PRINTF(("       Allocating at $%08lx\n", (long) block));
+    }
+
+    block->requested = size;
+    used_blocks++;
+    used_bytes += BLOCK_SIZE(block);
+    requested_bytes += size;
+    if (used_bytes > high_water)
+        high_water = used_bytes;
+
+    *(long *)((char *)block + HEADER_SIZE) = BLOCK_SIZE(block) - HEADER_SIZE;
+    return (char *)block + HEADER_SIZE;
+}
+
+
+/*
+ * Return a block to the pool, merging it with free neighbours.
+ */
+void arena_free(void *addr)
+{
+    Block *block, *next, *prev;
+
+    block = (Block *)((char *)addr - HEADER_SIZE);
+
+    used_blocks--;
+    used_bytes -= BLOCK_SIZE(block);
+    requested_bytes -= block->requested;
+
+    next = NEXT_PHYS(block);
+    if (next->size & BLOCK_FREE)
+    {
+        remove_free(next);
+        block->size += BLOCK_SIZE(next);
+        NEXT_PHYS(block)->prev_phys = block;
+    }
+
+    prev = block->prev_phys;
+    if (prev && (prev->size & BLOCK_FREE))
+    {
+        remove_free(prev);
+        prev->size += BLOCK_SIZE(block);
+        NEXT_PHYS(prev)->prev_phys = prev;
+        block = prev;
+    }
+
+    insert_free(block);
+}
+
+
+long arena_requested(void *addr)
+{
+    return ((Block *)((char *)addr - HEADER_SIZE))->requested;
+}
+
+
+#ifdef FVDI_DEBUG
+void arena_usage(Arena_usage *usage)
+{
+    int fl, sl;
+    long largest;
+    Block *block;
+
+    largest = 0;
+    for (fl = FL_COUNT - 1; !largest && (fl >= 0); fl--)
+    {
+        for (sl = SL_COUNT - 1; sl >= 0; sl--)
+        {
+            for (block = free_list[fl][sl]; block; block = block->next_free)
+            {
+                if (BLOCK_SIZE(block) > largest)
+                    largest = BLOCK_SIZE(block);
+            }
+            if (largest)
+                break;
+        }
+    }
+
+    usage->arenas = allocated;
+    usage->blocks = used_blocks;
+    usage->used = used_bytes;
+    usage->requested = requested_bytes;
+    usage->free = free_bytes;
+    usage->largest = largest;
+    usage->high_water = high_water;
+}
+
+
+/*
+ * Walk all arenas and free lists.
+ * Returns non-zero if anything is inconsistent.
+ */
+long arena_check(void)
+{
+    int fl, sl, error;
+    long used, free_size, free_count, list_count;
+    Arena *arena;
+    Block *block, *prev;
+
+    error = 0;
+    used = free_size = free_count = 0;
+    for (arena = arenas; arena && !error; arena = arena->next)
+    {
+        if ((long)arena & ADDR_NOT_OK)
+        {
+            PRINTF(("Bad arena linkage at $%08lx\n", (long) arena));
+            error = 1;
+            break;
+        }
+        prev = 0;
+        for (block = (Block *)&arena[1]; BLOCK_SIZE(block); block = NEXT_PHYS(block))
+        {
+            if (((long)block & ADDR_NOT_OK) || (block->prev_phys != prev) ||
+                (BLOCK_SIZE(block) < MIN_BLOCK) ||
+                ((char *)NEXT_PHYS(block) > (char *)arena + arena->size))
+            {
+                PRINTF(("Bad block $%08lx (prev $%08lx/$%08lx) in arena $%08lx\n",
+                        (long) block, (long) block->prev_phys, (long) prev, (long) arena));
+                error = 1;
+                break;
+            }
+            if (block->size & BLOCK_FREE)
+            {
+                if (prev && (prev->size & BLOCK_FREE))
+                {
+                    PRINTF(("Uncoalesced free blocks at $%08lx\n", (long) block));
+                    error = 1;
+                }
+                free_size += BLOCK_SIZE(block);
+                free_count++;
+            } else
+                used += BLOCK_SIZE(block);
+            prev = block;
+        }
+    }
+
+    list_count = 0;
+    for (fl = 0; fl < FL_COUNT; fl++)
+    {
+        for (sl = 0; sl < SL_COUNT; sl++)
+        {
+            for (block = free_list[fl][sl]; block; block = block->next_free)
+            {
+                if (((long)block & ADDR_NOT_OK) || !(block->size & BLOCK_FREE))
+                {
+                    PRINTF(("Bad free list entry $%08lx (%d,%d)\n", (long) block, fl, sl));
+                    error = 1;
+                    break;
+                }
+                list_count++;
+            }
+            if (!free_list[fl][sl] != !(sl_bitmap[fl] & (1 << sl)))
+            {
+                PRINTF(("Free list bitmap mismatch (%d,%d)\n", fl, sl));
+                error = 1;
+            }
+        }
+    }
+
+    if (!error && ((used != used_bytes) || (free_size != free_bytes) || (list_count != free_count)))
+    {
+        PRINTF(("Wrong block accounting (%ld/%ld used, %ld/%ld free, %ld/%ld free blocks)\n",
+                used, used_bytes, free_size, free_bytes, list_count, free_count));
+        error = 1;
+    }
+
+    return error;
+}
+#endif /* FVDI_DEBUG */
@@ -10,6 +10,8 @@
  */
 
 #include "fvdi.h"
+#include "relocate.h"
+#include "utility.h"
 #include "function.h"
 
 #ifdef __GNUC__
@@ -23,8 +25,441 @@ int SMUL_DIV(int, int, int);            /*   d0d1d0d2 */
 #endif
 #endif
 
+#define MAX_SPANS     32767         /* Table length is passed as a word */
+#define MIN_SPANS     64            /* Smallest useful span table */
+#define MIN_RECT      4             /* Shorter runs go in the span table */
+#define DEFAULT_ROOM  (1000 * 3 * sizeof(short))   /* For buffers not from the pool */
 
-void filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
+
+/*
+ * Span accumulator.
+ * Spans go into a y/x1/x2 table for fill_spans, sized after the
+ * memory block it is written into. Spans that repeat unchanged on
+ * consecutive scanlines are kept as open runs instead, and handed
+ * to the driver as a single rectangle each.
+ */
+typedef struct Spans_ {
+    Virtual *vwk;
+    Fgbg colour;
+    short *pattern;
+    long mode;
+    long interior_style;
+    short *table;                   /* y/x1/x2 table for fill_spans */
+    short *next;
+    long count;
+    long max_count;
+    short *runs;                    /* x1/x2/y_top of runs ending at y - 1 */
+    short *new_runs;                /* x1/x2/y_top of runs ending at y */
+    long n_runs;
+    long n_new_runs;
+    long run;                       /* First run not yet matched on y */
+    long max_runs;
+    short y;
+} Spans;
+
+
+/*
+ * Set up a span accumulator in 'room' bytes of memory.
+ * At most max_runs spans per scanline will be added.
+ */
+static void spans_init(Spans *s, Virtual *vwk, short *buffer, long room, long max_runs,
+    Fgbg colour, short *pattern, long mode, long interior_style)
+{
+    long run_room;
+
+    s->vwk = vwk;
+    s->colour = colour;
+    s->pattern = pattern;
+    s->mode = mode;
+    s->interior_style = interior_style;
+
+    if (!room)
+    {
+        room = DEFAULT_ROOM;
+        max_runs = 0;
+    }
+    run_room = max_runs * 2 * 3 * (long)sizeof(short);
+    if (room - run_room < MIN_SPANS * 3 * (long)sizeof(short))
+    {
+        run_room = 0;
+        max_runs = 0;                   /* No coalescing, all room for the table */
+    }
+
+    s->runs = buffer;
+    s->new_runs = &buffer[max_runs * 3];
+    s->n_runs = 0;
+    s->n_new_runs = 0;
+    s->run = 0;
+    s->max_runs = max_runs;
+    s->y = -32768;
+
+    s->table = s->next = &buffer[max_runs * 2 * 3];
+    s->count = 0;
+    s->max_count = (room - run_room) / (3 * (long)sizeof(short));
+    if (s->max_count > MAX_SPANS)
+        s->max_count = MAX_SPANS;
+}
+
+
+static void spans_flush_table(Spans *s)
+{
+    if (s->count)
+        fill_spans(s->vwk, s->table, s->count, s->colour, s->pattern, s->mode, s->interior_style);
+    s->count = 0;
+    s->next = s->table;
+}
+
+
+static void spans_table_add(Spans *s, short y, short x1, short x2)
+{
+    if (s->count >= s->max_count)
+        spans_flush_table(s);
+
+    *s->next++ = y;
+    *s->next++ = x1;
+    *s->next++ = x2;
+    s->count++;
+}
+
+
+/*
+ * Output a run that ends at scanline y.
+ */
+static void spans_close(Spans *s, short *run, short y)
+{
+    short line;
+
+    if (y - run[2] + 1 >= MIN_RECT)
+        fill_rect(s->vwk, run[0], run[2], run[1], y, s->colour, s->pattern, s->mode, s->interior_style);
+    else
+    {
+        for (line = run[2]; line <= y; line++)
+            spans_table_add(s, line, run[0], run[1]);
+    }
+}
+
+
+/*
+ * Close the runs that were not continued on the current scanline
+ * and make the ones that reach it the candidates for the next.
+ */
+static void spans_next_line(Spans *s)
+{
+    short *tmp;
+
+    for (; s->run < s->n_runs; s->run++)
+        spans_close(s, &s->runs[s->run * 3], s->y - 1);
+
+    tmp = s->runs;
+    s->runs = s->new_runs;
+    s->new_runs = tmp;
+    s->n_runs = s->n_new_runs;
+    s->n_new_runs = 0;
+    s->run = 0;
+}
+
+
+/*
+ * Add a span. Scanlines must come in increasing order,
+ * and the spans on each scanline in increasing x order.
+ */
+static void spans_add(Spans *s, short y, short x1, short x2)
+{
+    short *run, *new_run;
+
+    if (y != s->y)
+    {
+        spans_next_line(s);
+        if (y != s->y + 1)
+        {
+            for (; s->run < s->n_runs; s->run++)
+                spans_close(s, &s->runs[s->run * 3], s->y);
+            s->n_runs = 0;
+            s->run = 0;
+        }
+        s->y = y;
+    }
+
+    /* Runs to the left can not continue any more */
+    for (; s->run < s->n_runs; s->run++)
+    {
+        run = &s->runs[s->run * 3];
+        if (run[0] > x1)
+            break;
+        if ((run[0] == x1) && (run[1] == x2))
+        {
+            s->run++;
+            new_run = &s->new_runs[s->n_new_runs++ * 3];
+            new_run[0] = x1;
+            new_run[1] = x2;
+            new_run[2] = run[2];
+            return;
+        }
+        spans_close(s, run, y - 1);
+    }
+
+    if (s->n_new_runs < s->max_runs)
+    {
+        new_run = &s->new_runs[s->n_new_runs++ * 3];
+        new_run[0] = x1;
+        new_run[1] = x2;
+        new_run[2] = y;
+    } else
+        spans_table_add(s, y, x1, x2);
+}
+
+
+/*
+ * Output everything still held by the accumulator.
+ */
+static void spans_flush(Spans *s)
+{
+    spans_next_line(s);
+    for (; s->run < s->n_runs; s->run++)
+        spans_close(s, &s->runs[s->run * 3], s->y);
+    s->n_runs = 0;
+    s->run = 0;
+    spans_flush_table(s);
+}
+
+
+/*
+ * Polygon edge, as used by the active edge table scan.
+ * The x coordinate is stepped exactly like the
+ * SMUL_DIV intersection in the old per-scanline code,
+ * with the fraction kept as a remainder of dy.
+ */
+typedef struct Edge_ {
+    short y_top;                    /* First scanline crossed */
+    short y_bottom;                 /* First scanline not crossed */
+    short x;                        /* Crossing on current scanline */
+    short x_step;                   /* Whole pixels per scanline */
+    short sign;                     /* Extra pixel on remainder overflow */
+    unsigned short rem;             /* Fraction, in 1/dy units */
+    unsigned short rem_step;
+    unsigned short dy;
+} Edge;
+
+
+/*
+ * Set up an edge between two polygon points.
+ * Returns zero for horizontal edges, which never cross a scanline.
+ * Until the edge is activated, x_step holds |dx|.
+ */
+static int make_edge(Edge *edge, short x1, short y1, short x2, short y2)
+{
+    short dx;
+
+    if (y1 == y2)
+        return 0;
+
+    if (y1 > y2)
+    {
+        short tmp;
+
+        tmp = x1;
+        x1 = x2;
+        x2 = tmp;
+        tmp = y1;
+        y1 = y2;
+        y2 = tmp;
+    }
+
+    dx = x2 - x1;
+    edge->y_top = y1;
+    edge->y_bottom = y2;
+    edge->x = x1;
+    edge->dy = (short)(y2 - y1);
+    if (dx < 0)
+    {
+        edge->sign = -1;
+        edge->x_step = -dx;
+    } else
+    {
+        edge->sign = 1;
+        edge->x_step = dx;
+    }
+
+    return 1;
+}
+
+
+/*
+ * Prepare an edge for stepping from scanline y onwards.
+ * This is the only place where a division is needed.
+ */
+static void activate_edge(Edge *edge, short y)
+{
+    unsigned long adx, num;
+
+    adx = (unsigned short)edge->x_step;
+    if (y > edge->y_top)
+    {
+        num = (unsigned long)(y - edge->y_top) * adx;
+        edge->x += edge->sign * (short)(num / edge->dy);
+        edge->rem = num % edge->dy;
+    } else
+        edge->rem = 0;
+    edge->x_step = edge->sign * (short)(adx / edge->dy);
+    edge->rem_step = adx % edge->dy;
+}
+
+
+/*
+ * Sort the edge table on first scanline.
+ * Shell sort, since the table can be large and there is
+ * no extra memory available for anything fancier.
+ */
+static void sort_edges(Edge *edges, long n)
+{
+    long gap, i, j;
+    Edge tmp;
+
+    for (gap = 1; gap < n / 3; gap = gap * 3 + 1)
+        ;
+    for (; gap > 0; gap /= 3)
+    {
+        for (i = gap; i < n; i++)
+        {
+            tmp = edges[i];
+            for (j = i; (j >= gap) && (edges[j - gap].y_top > tmp.y_top); j -= gap)
+                edges[j] = edges[j - gap];
+            edges[j] = tmp;
+        }
+    }
+}
+
+
+/*
+ * Scan convert a set of edges using an active edge table.
+ * 'active' needs room for n_edges pointers.
+ */
+static void scan_edges(Virtual *vwk, Edge *edges, long n_edges, Edge **active, Spans *spans)
+{
+    int i, j;
+    int n_active;
+    short y, maxy;
+    short x1, x2;
+    short clip_x1, clip_x2;
+    Edge *edge, *next_edge, *last_edge;
+
+    sort_edges(edges, n_edges);
+
+    maxy = edges[0].y_bottom;
+    for (i = 1; i < n_edges; i++)
+    {
+        if (edges[i].y_bottom > maxy)
+            maxy = edges[i].y_bottom;
+    }
+    maxy--;
+    y = edges[0].y_top;
+
+    /* if (vwk->clip.on) */
+    {
+        if (y < vwk->clip.rectangle.y1)
+            y = vwk->clip.rectangle.y1;
+        if (maxy > vwk->clip.rectangle.y2)
+            maxy = vwk->clip.rectangle.y2;
+    }
+    clip_x1 = vwk->clip.rectangle.x1;
+    clip_x2 = vwk->clip.rectangle.x2;
+
+    n_active = 0;
+    next_edge = edges;
+    last_edge = &edges[n_edges];
+
+    for (; y <= maxy; y++)
+    {
+        /* Nothing active, so skip ahead to the next edge */
+        if (!n_active)
+        {
+            if (next_edge == last_edge)
+                break;
+            if (next_edge->y_top > y)
+            {
+                y = next_edge->y_top;
+                if (y > maxy)
+                    break;
+            }
+        }
+
+        /* Add edges starting at (or, when clipped, above) this scanline */
+        while ((next_edge != last_edge) && (next_edge->y_top <= y))
+        {
+            edge = next_edge++;
+            if (edge->y_bottom <= y)
+                continue;
+            activate_edge(edge, y);
+            active[n_active++] = edge;
+        }
+
+        /* Keep crossings in x order (almost always already sorted) */
+        for (i = 1; i < n_active; i++)
+        {
+            edge = active[i];
+            x1 = edge->x;
+            for (j = i; (j > 0) && (active[j - 1]->x > x1); j--)
+                active[j] = active[j - 1];
+            active[j] = edge;
+        }
+
+        for (i = 0; i < n_active - 1; i += 2)
+        {
+            x1 = active[i]->x;
+            x2 = active[i + 1]->x;
+            if (x1 < clip_x1)
+                x1 = clip_x1;
+            if (x2 > clip_x2)
+                x2 = clip_x2;
+            if (x1 <= x2)
+                spans_add(spans, y, x1, x2);
+        }
+
+        /* Step to the next scanline, dropping finished edges */
+        j = 0;
+        for (i = 0; i < n_active; i++)
+        {
+            edge = active[i];
+            if (edge->y_bottom <= y + 1)
+                continue;
+            edge->x += edge->x_step;
+            edge->rem += edge->rem_step;
+            if (edge->rem >= edge->dy)
+            {
+                edge->rem -= edge->dy;
+                edge->x += edge->sign;
+            }
+            active[j++] = edge;
+        }
+        n_active = j;
+    }
+
+    spans_flush(spans);
+}
+
+
+/*
+ * Number of bytes left in the work area after
+ * the edge table for n edges, or zero if there is
+ * not enough room for the edge table approach.
+ */
+static long edge_room(short *points, long n)
+{
+    long room;
+
+    room = block_room(points) - n * (long)(sizeof(Edge) + sizeof(Edge *));
+    if (room < MIN_SPANS * 3 * (long)sizeof(short))
+        return 0;
+
+    return room;
+}
+
+
+/*
+ * Scan convert a polygon by intersecting every edge with every scanline.
+ * Only used when the work area is too small for the edge table.
+ */
+static void slow_filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
     short *pattern, short *points, long mode, long interior_style)
 {
     int i, j;
@@ -33,8 +468,8 @@ void filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
     short x1, y1;
     short x2, y2;
     int ints;
-    int spans;
     short *coords;
+    Spans spans;
 
     if (!n)
         return;
@@ -66,8 +501,8 @@ void filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
             maxy = vwk->clip.rectangle.y2;
     }
 
-    spans = 0;
-    coords = &points[n];
+    spans_init(&spans, vwk, &points[n], block_room(&points[n]), n / 2 + 1,
+               colour, pattern, mode, interior_style);
 
     for (y = miny; y <= maxy; y++)
     {
@@ -108,14 +543,6 @@ void filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
             }
         }
 
-        if (spans > 1000)
-        {
-            /* Should really check against size of points array! */
-            fill_spans(vwk, &points[n], spans, colour, pattern, mode, interior_style);
-            spans = 0;
-            coords = &points[n];
-        }
-
         x1 = vwk->clip.rectangle.x1;
         x2 = vwk->clip.rectangle.x2;
         for (i = 0; i < ints - 1; i += 2)
@@ -127,20 +554,17 @@ void filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
             if (y2 > x2)
                 y2 = x2;
             if (y1 <= y2)
-            {
-                *coords++ = y;
-                *coords++ = y1;
-                *coords++ = y2;
-                spans++;
-            }
+                spans_add(&spans, y, y1, y2);
         }
     }
-    if (spans)
-        fill_spans(vwk, &points[n], spans, colour, pattern, mode, interior_style);
+    spans_flush(&spans);
 }
 
 
-void filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
+/*
+ * Multi-contour version of the above.
+ */
+static void slow_filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
     short *pattern, short *points, short index[], long moves, long mode, long interior_style)
 {
     int i, j;
@@ -149,8 +573,8 @@ void filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
     short x1, y1;
     short x2, y2;
     int ints;
-    int spans;
     short *coords;
+    Spans spans;
     short movepnt, move_n;
 
     if (!n)
@@ -185,8 +609,8 @@ void filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
             maxy = vwk->clip.rectangle.y2;
     }
 
-    spans = 0;
-    coords = &points[n];
+    spans_init(&spans, vwk, &points[n], block_room(&points[n]), n / 2 + 1,
+               colour, pattern, mode, interior_style);
 
     for (y = miny; y <= maxy; y++)
     {
@@ -238,14 +662,6 @@ void filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
             }
         }
 
-        if (spans > 1000)
-        {
-            /* Should really check against size of points array! */
-            fill_spans(vwk, &points[n], spans, colour, pattern, mode, interior_style);
-            spans = 0;
-            coords = &points[n];
-        }
-
         x1 = vwk->clip.rectangle.x1;
         x2 = vwk->clip.rectangle.x2;
         for (i = 0; i < ints - 1; i += 2)
@@ -257,14 +673,94 @@ void filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
             if (y2 > x2)
                 y2 = x2;
             if (y1 <= y2)
-            {
-                *coords++ = y;
-                *coords++ = y1;
-                *coords++ = y2;
-                spans++;
-            }
+                spans_add(&spans, y, y1, y2);
+        }
+    }
+    spans_flush(&spans);
+}
+
+void filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
+    short *pattern, short *points, long mode, long interior_style)
+{
+    long i, n_edges, room;
+    Edge *edges;
+    Edge **active;
+    Spans spans;
+
+    if (!n)
+        return;
+
+    if (!(room = edge_room(points, n)))
+    {
+        slow_filled_poly(vwk, p, n, colour, pattern, points, mode, interior_style);
+        return;
+    }
+
+    if ((p[0][0] == p[n - 1][0]) && (p[0][1] == p[n - 1][1]))
+        n--;
+    if (n < 2)
+        return;
+
+    edges = (Edge *)points;
+    n_edges = make_edge(edges, p[n - 1][0], p[n - 1][1], p[0][0], p[0][1]);
+    for (i = 1; i < n; i++)
+        n_edges += make_edge(&edges[n_edges], p[i - 1][0], p[i - 1][1], p[i][0], p[i][1]);
+    if (!n_edges)
+        return;
+
+    active = (Edge **)&edges[n];
+    spans_init(&spans, vwk, (short *)&active[n], room, n_edges / 2 + 1,
+               colour, pattern, mode, interior_style);
+    scan_edges(vwk, edges, n_edges, active, &spans);
+}
+
+
+void filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
+    short *pattern, short *points, short index[], long moves, long mode, long interior_style)
+{
+    long i, n_edges, room;
+    short movepnt, move_n;
+    Edge *edges;
+    Edge **active;
+    Spans spans;
+
+    if (!n)
+        return;
+
+    if (!(room = edge_room(points, n)))
+    {
+        slow_filled_poly_m(vwk, p, n, colour, pattern, points, index, moves, mode, interior_style);
+        return;
+    }
+
+    moves--;
+    if (index[moves] == -4)
+        moves--;
+    if (index[moves] == -2)
+        moves--;
+
+    move_n = moves;
+    movepnt = (index[move_n] + 4) / 2;
+
+    edges = (Edge *)points;
+    n_edges = 0;
+    for (i = 1; i < n; i++)
+    {
+        if (i == movepnt)
+        {
+            if (--move_n >= 0)
+                movepnt = (index[move_n] + 4) / 2;
+            else
+                movepnt = -1;           /* Never again equal to n */
+            continue;
         }
+        n_edges += make_edge(&edges[n_edges], p[i - 1][0], p[i - 1][1], p[i][0], p[i][1]);
     }
-    if (spans)
-        fill_spans(vwk, &points[n], spans, colour, pattern, mode, interior_style);
+    if (!n_edges)
+        return;
+
+    active = (Edge **)&edges[n];
+    spans_init(&spans, vwk, (short *)&active[n], room, n_edges / 2 + 1,
+               colour, pattern, mode, interior_style);
+    scan_edges(vwk, edges, n_edges, active, &spans);
 }
@@ -236,6 +236,7 @@ Virtual *initialize_vdi(void)
     wk->r.blit = default_blit;
     wk->r.text = default_text;
     wk->r.mouse = (void CDECL (*)(struct wk_ *wk, long x, long y, Mouse *mouse))do_nothing; /* must be set by driver */
+    wk->blend = 0;
 
     copymem(default_functions - 1, (char *)((long)wk->function - sizeof(Function)), 257 * sizeof(Function));
     wk->opcode5_count = *(short *) ((long) default_opcode5 - 2);
@@ -524,7 +525,18 @@ void copy_workstations(Virtual *def, long really_copy)
 
 /*
  * Really supposed to handle most shut-down operations.
+ * For now, lets the drivers and modules unhook themselves.
+ * Called in supervisor mode.
  */
 void shut_down(void)
 {
+    List *list;
+    Driver *driver;
+
+    for (list = driver_list; list; list = list->next)
+    {
+        driver = (Driver *) list->value;
+        if (driver->module.shutdown)
+            driver->module.shutdown(driver->default_vwk);
+    }
 }
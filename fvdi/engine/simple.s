@@ -11,7 +11,7 @@ transparent	equ	1		; Fall through?
 	.include	"vdi.inc"
 	.include	"macros.inc"
 
-	xref	_v_opnwk,_v_opnvwk,_v_clsvwk,_v_clswk
+	xref	_v_opnwk,_v_opnvwk,_v_clsvwk,_v_clswk,_v_updwk
 	xref	_vq_devinfo
 	xref	_event
 
@@ -21,7 +21,7 @@ transparent	equ	1		; Fall through?
 
 	xref	_lib_vq_extnd
 
-	xdef	v_opnwk,v_opnvwk,v_clsvwk,v_clswk
+	xdef	v_opnwk,v_opnvwk,v_clsvwk,v_clswk,v_updwk
 	xdef	vq_devinfo
 	xdef	vs_clip,vswr_mode,vq_extnd
 
@@ -107,6 +107,24 @@ v_clswk:
 	done_return
 
 
+* v_updwk - Standard Trap function
+* Todo: ?
+* In:   a1      Parameter block
+*       a0      VDI struct
+v_updwk:
+	uses_d1
+	move.l	d2,-(a7)
+	
+	move.l	a0,-(a7)
+	jsr	_v_updwk
+	addq.l	#4,a7
+	
+	move.l	(a7)+,d2
+	used_d1
+	
+	done_return
+
+
 * vq_devinfo - Standard Trap function
 * Todo: ?
 * In:   a1      Parameter block
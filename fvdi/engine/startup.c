@@ -207,6 +207,12 @@ long startup(void)
         return 0;
     }
 
+    /* The small and large pools are optional */
+    if (small_blocks && (small_block_size < block_size) && !initialize_pool(small_block_size, small_blocks))
+        error("Error while initializing small memory pool.", 0);
+    if (large_blocks && (large_block_size > block_size) && !initialize_pool(large_block_size, large_blocks))
+        error("Error while initializing large memory pool.", 0);
+
     if (remove_xbra(34 * 4, "fVDI") && debug)		/* fVDI might already be installed */
     {
         PUTS("Removing previous XBRA.\n");
@@ -416,6 +422,14 @@ long startup(void)
 }
 
 
+static long shut_down_super(void)
+{
+    shut_down();
+
+    return 0;
+}
+
+
 /*
  * Shutdown support
  * Unlinks fVDI and releases all allocated memory.
@@ -440,8 +454,8 @@ static long CDECL remove_fvdi(void)
         {
             Supexec(bconout_unhook);
         }
+        Supexec(shut_down_super);          /* Before the driver code goes away */
         ret = free_all();
-        shut_down();
         readable->cookie.flags = 0;
     }
 
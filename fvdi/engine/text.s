@@ -412,7 +412,17 @@ _default_text:
 .no_offsets:
 
 	move.l	d0,a3
-	move.l	#0,-(a7)			; Get a memory block of any size (hopefully large)
+	move.l	vwk_text_current_font(a0),a5	; Ask for a block that can hold
+	move.w	font_widest_cell(a5),d3		;  the widest possible string,
+	mulu	d0,d3				;  twice for outlines, so that
+	add.l	d4,d3				;  long strings and large fonts
+	lsr.l	#3,d3				;  are given a large block
+	addq.l	#6,d3
+	move.w	font_height(a5),d5
+	addq.w	#2,d5
+	mulu	d5,d3
+	add.l	d3,d3
+	move.l	d3,-(a7)
 	bsr	asm_allocate_block
 	addq.l	#4,a7
 	tst.l	d0
@@ -40,6 +40,9 @@ SUB1		equ	0		; Subtract 1 from text width? (NVDI apparently doesn't)
 	xref	_lib_vqt_char_index
 	xref	_lib_vst_charmap
 
+	xdef	v_savecache,v_loadcache,v_flushcache,vqt_cachesize
+	xref	_lib_v_savecache,_lib_v_loadcache,_lib_v_flushcache,_lib_vqt_cachesize
+
 	text
 
 * vqt_pair/trackkern - Standard Trap function
@@ -1166,4 +1169,82 @@ vst_load_fonts:
 vst_unload_fonts:
 	done_return
 
+* v_savecache - Standard Trap function
+* Todo: ?
+* In:   a1      Parameter block
+*       a0      VDI struct
+v_savecache:
+	uses_d1
+	movem.l	d2/a1,-(a7)
+	move.l	control(a1),a2
+	move.w	L_intin(a2),d0
+	ext.l	d0
+	move.l	d0,-(a7)		; Name length
+	move.l	intin(a1),-(a7)		; Name
+	move.l	a0,-(a7)
+	jsr	_lib_v_savecache
+	add.w	#12,a7
+	movem.l	(a7)+,d2/a1
+	move.l	intout(a1),a2
+	move.w	d0,(a2)
+	used_d1
+	done_return
+
+* v_loadcache - Standard Trap function
+* Todo: ?
+* In:   a1      Parameter block
+*       a0      VDI struct
+v_loadcache:
+	uses_d1
+	movem.l	d2/a1,-(a7)
+	move.l	control(a1),a2
+	move.w	L_intin(a2),d0
+	ext.l	d0
+	move.l	d0,-(a7)		; Mode and name length
+	move.l	intin(a1),-(a7)		; Mode and name
+	move.l	a0,-(a7)
+	jsr	_lib_v_loadcache
+	add.w	#12,a7
+	movem.l	(a7)+,d2/a1
+	move.l	intout(a1),a2
+	move.w	d0,(a2)
+	used_d1
+	done_return
+
+* v_flushcache - Standard Trap function
+* Todo: ?
+* In:   a1      Parameter block
+*       a0      VDI struct
+v_flushcache:
+	uses_d1
+	movem.l	d2/a1,-(a7)
+	move.l	a0,-(a7)
+	jsr	_lib_v_flushcache
+	addq.l	#4,a7
+	movem.l	(a7)+,d2/a1
+	move.l	intout(a1),a2
+	move.w	d0,(a2)
+	used_d1
+	done_return
+
+* vqt_cachesize - Standard Trap function
+* Todo: ?
+* In:   a1      Parameter block
+*       a0      VDI struct
+vqt_cachesize:
+	uses_d1
+	movem.l	d2/a1,-(a7)
+	move.l	intin(a1),a2
+	move.w	(a2),d0
+	ext.l	d0
+	move.l	d0,-(a7)		; Which cache
+	move.l	a0,-(a7)
+	jsr	_lib_vqt_cachesize
+	addq.l	#8,a7
+	movem.l	(a7)+,d2/a1
+	move.l	intout(a1),a2
+	move.l	d0,(a2)			; Size as a long in intout[0-1]
+	used_d1
+	done_return
+
 	end
@@ -676,3 +676,65 @@ void lib_vst_unload_fonts(Virtual *vwk, long select)
     (void) vwk;
     (void) select;
 }
+
+
+#define CACHE_NAME_SIZE 128
+
+static void cache_filename(char *name, const short *intin, long length)
+{
+    int i;
+
+    if (length > CACHE_NAME_SIZE - 1)
+        length = CACHE_NAME_SIZE - 1;
+    for (i = 0; (i < length) && intin[i]; i++)
+        name[i] = intin[i];
+    name[i] = 0;
+}
+
+
+/* status = lib_v_savecache(filename) */
+long CDECL lib_v_savecache(Virtual *vwk, short *intin, long length)
+{
+    char name[CACHE_NAME_SIZE];
+
+    if (!external_savecache)
+        return -1;
+
+    cache_filename(name, intin, length);
+
+    return set_stack_call_lvplp(vdi_stack_top, vdi_stack_size, external_savecache, vwk, name, 0, 0);
+}
+
+
+/* status = lib_v_loadcache(mode, filename) */
+long CDECL lib_v_loadcache(Virtual *vwk, short *intin, long length)
+{
+    char name[CACHE_NAME_SIZE];
+
+    if (!external_loadcache || (length < 2))
+        return -1;
+
+    cache_filename(name, &intin[1], length - 1);
+
+    return set_stack_call_lvplp(vdi_stack_top, vdi_stack_size, external_loadcache, vwk, name, intin[0], 0);
+}
+
+
+/* status = lib_v_flushcache() */
+long CDECL lib_v_flushcache(Virtual *vwk)
+{
+    if (!external_flushcache)
+        return 0;
+
+    return set_stack_call_lplll(vdi_stack_top, vdi_stack_size, external_flushcache, vwk, 0, 0, 0);
+}
+
+
+/* size = lib_vqt_cachesize(which) */
+long CDECL lib_vqt_cachesize(Virtual *vwk, long which)
+{
+    if (!external_cachesize)
+        return 0;
+
+    return set_stack_call_lplll(vdi_stack_top, vdi_stack_size, external_cachesize, vwk, which, 0, 0);
+}
@@ -413,11 +413,11 @@ default_functions:
 	dc.l	vqt_advance
 	dc.w	0,2
 	dc.l	vq_devinfo		; also vq_ext_devinfo (sub 4242)
-	dc.w	0,0
+	dc.w	0,1
 	dc.l	v_savecache
-	dc.w	0,0
+	dc.w	0,1
 	dc.l	v_loadcache
-	dc.w	0,0
+	dc.w	0,1
 	dc.l	v_flushcache
 	dc.w	0,0
 	dc.l	vst_setsize
@@ -425,7 +425,7 @@ default_functions:
 	dc.l	vst_skew
 	dc.w	0,0
 	dc.l	vqt_get_table
-	dc.w	0,0
+	dc.w	0,2
 	dc.l	vqt_cachesize	; this is number 255
 
 	dc.w	23
@@ -23,15 +23,15 @@ transparent	equ	1		; Fall through?
 	xref	_no_vex
 
 	xdef	nothing
-	xdef	v_clrwk,v_updwk
+	xdef	v_clrwk
 	xdef	vrq_locator,vrq_valuator,vrq_choice,vsin_mode
 	xdef	v_contourfill
 	xdef	vqin_mode
 	xdef	v_cellarray,vq_cellarray
 	xdef	vst_name,vst_width
 	xdef	v_getoutline,vst_scratch
-	xdef	vst_error,v_savecache
-	xdef	v_loadcache,v_flushcache,vst_setsize,vqt_cachesize
+	xdef	vst_error
+	xdef	vst_setsize
 	xdef	vqt_get_table
 	xdef	v_set_app_buff
 	xdef	vq_tabstatus,v_hardcopy,v_rmcur,v_form_adv
@@ -57,7 +57,6 @@ special_11:
 
 * Physical workstation manipulation
 v_clrwk:
-v_updwk:
 	done_return
 
 * Strange mouse/keyboard functions
@@ -102,11 +101,7 @@ v_getoutline:
 vst_scratch:
 vst_error:
 ;vq_devinfo:
-v_savecache:
-v_loadcache:
-v_flushcache:
 vst_setsize:
-vqt_cachesize:
 vqt_get_table:
 v_set_app_buff:
 	done_return
@@ -86,7 +86,38 @@ long pid_addr = 0;        /* Copied into 'pid' when fVDI is installed */
 long *pid = 0;
 short mxalloc = 0;
 
-char *block_chain = 0;
+/*
+ * Internal scratch block pools, kept sorted on block size.
+ * A request is counted against the smallest pool with large enough
+ * blocks: as a hit if that pool could serve it, as a miss if a larger
+ * pool had to, and as exhausted if it ended up on the heap instead.
+ */
+#define MAX_POOLS 3
+
+typedef struct Pool_ {
+    char *start;
+    char *end;
+    long size;
+    long count;
+    char *chain;
+    long hits;
+    long misses;
+    long exhausted;
+} Pool;
+
+static Pool pools[MAX_POOLS];
+static short pool_count = 0;
+
+/*
+ * Blocks handed out from the heap when no pool could serve a request
+ */
+typedef struct Extra_block_ {
+    struct Extra_block_ *next;
+    long size;
+} Extra_block;
+
+static Extra_block *extra_blocks = 0;
+static long extra_count = 0;
 
 static struct nf_ops _nf_ops = { _nf_get_id, _nf_call, { 0, 0, 0 } };
 static struct nf_ops *nf_ops;
@@ -285,18 +316,27 @@ long DRIVER_EXPORT set_cookie(const char *name, long value)
 long initialize_pool(long size, long n)
 {
     char *addr, *ptr;
+    Pool *pool;
 
-    if ((size <= 0) || (n <= 0))
+    if ((size < (long)sizeof(char *)) || (n <= 0) || (pool_count >= MAX_POOLS))
         return 0;
 
     if ((addr = malloc(size * n)) == NULL)
         return 0;
 
-    block_size = size;
+    for (pool = &pools[pool_count]; (pool > pools) && (pool[-1].size > size); pool--)
+        pool[0] = pool[-1];
+    pool_count++;
+
+    pool->start = addr;
+    pool->end = addr + size * n;
+    pool->size = size;
+    pool->count = n;
+    pool->hits = pool->misses = pool->exhausted = 0;
     ptr = 0;
     for (n = n - 1; n >= 0; n--)
     {
-        block_chain = addr;
+        pool->chain = addr;
         *(char **) addr = ptr;
         ptr = addr;
         addr += size;
@@ -307,30 +347,122 @@ long initialize_pool(long size, long n)
 
 
 /*
- * Allocate a block from the internal memory pool.
+ * Find the pool that a block belongs to, if any.
+ */
+static Pool *find_pool(const void *addr)
+{
+    Pool *pool;
+
+    for (pool = pools; pool < &pools[pool_count]; pool++)
+    {
+        if (((const char *)addr >= pool->start) && ((const char *)addr < pool->end))
+            return pool;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Allocate a block from the internal memory pools.
+ * A size of zero asks for a normal sized block.
+ * Falls back to the heap rather than fail when the pools are empty.
  */
 char *DRIVER_EXPORT allocate_block(long size)
 {
+    Pool *pool, *wanted;
+    Extra_block *extra;
     char *addr;
 
-    if ((size > block_size) || !block_chain)
+    if (!size)
+        size = block_size;
+
+    wanted = 0;
+    for (pool = pools; pool < &pools[pool_count]; pool++)
+    {
+        if (pool->size < size)
+            continue;
+        if (!wanted)
+            wanted = pool;
+        if (!pool->chain)
+            continue;
+
+        if (pool == wanted)
+            wanted->hits++;
+        else
+            wanted->misses++;
+        addr = pool->chain;
+        pool->chain = *(char **) addr;
+        *(long *) addr = pool->size;    /* Make size info available */
+        return addr;
+    }
+
+    if (wanted)
+        wanted->exhausted++;
+    if ((extra = malloc(sizeof(Extra_block) + size)) == NULL)
         return 0;
+    extra->next = extra_blocks;
+    extra->size = size;
+    extra_blocks = extra;
+    extra_count++;
 
-    addr = block_chain;
-    block_chain = *(char **) addr;
-    *(long *) addr = block_size;    /* Make size info available */
+    addr = (char *)&extra[1];
+    *(long *) addr = size;
 
     return addr;
 }
 
 
 /*
- * Free a block and return it to the internal memory pool.
+ * Return the number of bytes from addr to the end of the
+ * internal memory pool block it points into.
+ * Zero if the address is not inside such a block.
+ */
+long block_room(const void *addr)
+{
+    Pool *pool;
+    Extra_block *extra;
+    const char *start;
+
+    if ((pool = find_pool(addr)) != NULL)
+        return pool->size - ((const char *)addr - pool->start) % pool->size;
+
+    for (extra = extra_blocks; extra; extra = extra->next)
+    {
+        start = (const char *)&extra[1];
+        if (((const char *)addr >= start) && ((const char *)addr < start + extra->size))
+            return extra->size - ((const char *)addr - start);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Free a block and return it to the internal memory pool it came from.
  */
 void DRIVER_EXPORT free_block(void *addr)
 {
-    *(char **) addr = block_chain;
-    block_chain = addr;
+    Pool *pool;
+    Extra_block **link, *extra;
+
+    if ((pool = find_pool(addr)) != NULL)
+    {
+        *(char **) addr = pool->chain;
+        pool->chain = addr;
+        return;
+    }
+
+    extra = (Extra_block *)addr - 1;
+    for (link = &extra_blocks; *link; link = &(*link)->next)
+    {
+        if (*link == extra)
+        {
+            *link = extra->next;
+            free(extra);
+            return;
+        }
+    }
 }
 
 
@@ -787,7 +919,8 @@ void *fmalloc(long size, long type)
                 new->prev = (Circle *)((long)new | 1);
                 new->next = new;
             }
-        }
+        } else
+            new->prev = (Circle *)1;    /* Odd, so free() knows it is an OS block */
         new->size = size + sizeof(Circle);
         *(long *) &new[1] = size;
         return (void *) &new[1];
@@ -799,272 +932,49 @@ void *fmalloc(long size, long type)
 }
 
 
-static short block_space[] = { 16, 48, 112, 240, 496, 1008, 2028, 4068, 8148, 16308 };
-static char *block_free[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-static Circle *block_used[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-static short free_blocks[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-static short used_blocks[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-
-static short allocated = 0;
-
-#define ADDR_NOT_OK 0xfc000003
-
-
-void allocate(long amount)
-{
-    const int sizes = (int)(sizeof(block_space) / sizeof(block_space[0]));
-    char *buf;
-    Circle *link, *last;
-    int i;
-
-    amount &= ~0x0fL;
-    if (!amount)
-        return;
-
-    buf = fmalloc(amount * 1024, 3);
-    if (!buf)
-        return;
-
-    if ((debug > 2) && !(silentx[0] & 0x02))
-    {
-        PRINTF(("       Malloc at $%08lx\n", (long) buf));
-    }
-
-    last = (Circle *)block_free[sizes - 1];
-    for (i = 0; i < amount; i += 16)
-    {
-        link = (Circle *)&buf[i * 1024L];
-        link->next = last;
-        link->prev = 0;
-        link->size = sizes - 1;
-        last = link;
-    }
-
-    block_free[sizes - 1] = (char *)last;
-    free_blocks[sizes - 1] += amount >> 4;
-    allocated += amount >> 4;
-}
-
-
 #ifdef FVDI_DEBUG
+/*
+ * Fragmentation is reported as the part (in 1/1000) of the free
+ * memory that is not in the largest free block.
+ */
 static void memory_statistics(void)
 {
-    const int sizes = sizeof(block_space) / sizeof(block_space[0]);
-    int n;
-
-    PRINTF(("       %d: ", allocated));
-    for (n = 0; n < sizes; n++)
-    {
-        PRINTF(("%d/%d ", used_blocks[n], free_blocks[n]));
-    }
-    PUTS("\n");
-}
-
-
-static void search_links(Circle *srch)
-{
-    int n;
-    const int sizes = sizeof(block_space) / sizeof(block_space[0]);
-    Circle *link, *next, *first, *found = 0;
-    long dist, dist_min;
-    int dist_n = 0;
-
-    dist_min = 999999999;
-    for (n = 0; n < sizes; n++)
-    {
-        link = (Circle *)block_free[n];
-        while (link)
-        {
-            if (((long)link & ADDR_NOT_OK) ||
-                ((unsigned int)(link->size & 0xffff) >=
-                 sizeof(block_space) / sizeof(block_space[0])) ||
-                 !(link->size >> 16))
-                break;
-
-            dist = (long)srch - (long)link;
-            if ((dist > 0) && (dist < dist_min))
-            {
-                dist_min = dist;
-                dist_n = n | 0x8000;
-                found = link;
-            }
-
-            link = link->next;
-        }
-
-        link = first = block_used[n];
-        while (link)
-        {
-            if (((long)link & ADDR_NOT_OK) ||
-                ((unsigned int)(link->size & 0xffff) >=
-                 sizeof(block_space) / sizeof(block_space[0])) ||
-                 !(link->size >> 16))
-                break;
-
-            dist = (long)srch - (long)link;
-            if ((dist > 0) && (dist < dist_min))
-            {
-                dist_min = dist;
-                dist_n = n;
-                found = link;
-            }
-
-            next = link->next;
-            if ((next == first) || (next->prev != link))
-                break;
-            link = next;
-        }
-    }
-
-    PRINTF(("At distance %ld: $%08lx(%d %s)\n", dist_min, (long) found, dist_n & 0x7fff, dist_n & 0x8000 ? "free" : "used"));
-}
+    Arena_usage usage;
+    long fragmentation, free_count;
+    Pool *pool;
+    char *ptr;
 
+    arena_usage(&usage);
+    fragmentation = usage.free ? 1000 - (usage.largest * 1000) / usage.free : 0;
 
-static void display_links(Circle *first)
-{
-    Circle *link, *last;
-    int m = 0;
-
-    PRINTF(("Links: $%08lx", (long) first));
+    PRINTF(("       %ld arenas, %ld blocks, %ld/%ld bytes used (%ld asked for), high water %ld\n",
+            usage.arenas, usage.blocks, usage.used, usage.used + usage.free, usage.requested, usage.high_water));
+    PRINTF(("       %ld free, largest %ld, fragmentation %ld.%ld%%\n",
+            usage.free, usage.largest, fragmentation / 10, fragmentation % 10));
 
-    last = first;
-    if (first)
+    for (pool = pools; pool < &pools[pool_count]; pool++)
     {
-        link = first->next;
-        while (link != first)
-        {
-            if (m++ > 1000)
-                break;
-            PRINTF(("->$%08lx", (long) link));
-            if (link->prev != last)
-            {
-                PRINTF(("($%08lx)", (long) link->prev));
-                break;
-            }
-            last = link;
-            link = link->next;
-            if ((long)link & ADDR_NOT_OK)
-                break;
-        }
+        for (free_count = 0, ptr = pool->chain; ptr; ptr = *(char **) ptr)
+            free_count++;
+        PRINTF(("       Pool %ld x %ld bytes, %ld free, %ld hits, %ld misses, %ld exhausted\n",
+                pool->count, pool->size, free_count, pool->hits, pool->misses, pool->exhausted));
     }
-    PUTS("\n");
+    if (extra_count)
+        PRINTF(("       %ld pool blocks taken from the heap\n", extra_count));
 }
 
 
 void check_memory(void)
 {
-    int m, n;
-    const int sizes = sizeof(block_space) / sizeof(block_space[0]);
-    Circle *link, *next, *first;
-    int error, statistics;
-
-    statistics = 0;
-    for (n = 0; n < sizes; n++)
-    {
-        link = (Circle *)block_free[n];
-        m = 0;
-        error = 0;
-        while (link)
-        {
-            m++;
-            if ((long)link & ADDR_NOT_OK)
-            {
-                PUTS("Bad free list linkage at ");
-                error = 1;
-            }
-            if (error)
-            {
-                PRINTF(("$%08lx(%d,%d)\n", (long) link, m, n));
-                break;
-            }
-
-            link = link->next;
-        }
-
-        if (!error && (m != free_blocks[n]))
-        {
-            PRINTF(("Wrong number of free blocks (%d/%d)\n", m, free_blocks[n]));
-            error = 1;
-        }
-
-        if (error && !statistics)
-        {
-            statistics = 1;
-            memory_statistics();
-        }
-
-        link = first = block_used[n];
-        m = 0;
-        error = 0;
-        while (link)
-        {
-            m++;
-            if ((long)link & ADDR_NOT_OK)
-            {
-                PUTS("Bad used list link at ");
-                error = 1;
-            } else if ((unsigned int)(link->size & 0xffff) >=
-                       sizeof(block_space) / sizeof(block_space[0]) ||
-                       !(link->size >> 16))
-            {
-                PUTS("\n");
-                search_links(link);
-                PUTS("Bad used list size at ");
-                error = 1;
-            } else if ((long)link->next & ADDR_NOT_OK)
-            {
-                PUTS("\n");
-                search_links(link);
-                PUTS("Bad used list linkage at ");
-                error = 1;
-            }
-            next = link->next;
-            if (next->prev != link)
-            {
-                PUTS("\n");
-                search_links(next);
-                PRINTF(("Bad used list prev linkage $%08lx $%08lx ", (long) next, (long) next->prev));
-                error = 1;
-            }
-
-            if (error)
-            {
-                PRINTF(("$%08lx (%d,%d)\n", (long) link, m, n));
-                display_links(block_used[n]);
-                break;
-            }
-            if (next == first)
-                break;
-            link = next;
-        }
-
-        if (!error && (m != used_blocks[n]))
-        {
-            PRINTF(("Wrong number of used blocks (%d:%d/%d)\n", n, m, used_blocks[n]));
-            display_links(block_used[n]);
-            error = 1;
-        }
-
-        if (error && !statistics)
-        {
-            statistics = 1;
-            memory_statistics();
-        }
-    }
+    if (arena_check())
+        memory_statistics();
 }
 #endif /* FVDI_DEBUG */
 
 
-#define OS_MARGIN 64
-#define MIN_BLOCK 32
-#define LINK_SIZE (sizeof(Circle))
-#define MIN_KB_BLOCK
 void *DRIVER_EXPORT malloc(size_t size)
 {
-    int m, n;
-    const int sizes = (int)(sizeof(block_space) / sizeof(block_space[0]));
-    char *block;
-    Circle *link, *next;
+    void *addr;
 
     size += ext_malloc;
 
@@ -1073,105 +983,9 @@ void *DRIVER_EXPORT malloc(size_t size)
         check_memory();
 #endif
 
-    if (old_malloc || (size > 16 * 1024 - OS_MARGIN - (long)LINK_SIZE))
+    if (old_malloc || !(addr = arena_malloc(size)))
         return fmalloc(size, 3);
 
-    /* This will always break eventually thanks to the if-statement above */
-    for (n = 0; n < sizes; n++)
-    {
-        if ((long)size <= block_space[n])
-            break;
-    }
-
-    if ((debug > 2) && !(silentx[0] & 0x02))
-    {
-        PRINTF(("Alloc: Need block of size %d/%ld\n", n, size));
-    }
-
-    if (!block_free[n])
-    {
-        for (m = n + 1; m < sizes; m++)
-        {
-            if (block_free[m])
-                break;
-        }
-        if (m >= sizes)
-        {
-            m = sizes - 1;
-            block_free[m] = fmalloc(16 * 1024 - OS_MARGIN, 3);
-            if (!block_free[m])
-                return 0;
-            if ((debug > 2) && !(silentx[0] & 0x02))
-            {
-                PRINTF(("       Malloc at $%08lx\n", (long) block_free[m]));
-            }
-            link = (Circle *)block_free[m];
-            link->next = 0;
-            link->prev = 0;
-            link->size = m;
-            free_blocks[m]++;
-            allocated++;
-        }
-        for (; m > n; m--)
-        {
-            if ((debug > 2) && !(silentx[0] & 0x02))
-            {
-                PUTS("       Splitting\n");
-            }
-            block_free[m - 1] = block_free[m];
-            link = (Circle *)block_free[m];
-            block_free[m] = (char *)link->next;
-            free_blocks[m]--;
-            next = (Circle *)(block_free[m - 1] + block_space[m - 1] + LINK_SIZE);
-            link->next = next;
-            link->prev = 0;
-            link->size = m - 1;
-            free_blocks[m - 1]++;
-            link = next;
-            link->next = 0;
-            link->prev = 0;
-            link->size = m - 1;
-            free_blocks[m - 1]++;
-        }
-    } else
-    {
-        if ((debug > 2) && !(silentx[0] & 0x02))
-        {
-            PUTS("       Available\n");
-        }
-    }
-
-    block = block_free[n];
-    block_free[n] = (char *)((Circle *)block)->next;
-
-    if ((debug > 2) && !(silentx[0] & 0x02))
-    {
-        PRINTF(("       Allocating at $%08lx (next at $%08lx)\n", (long) block, (long) block_free[n]));
-    }
-
-    ((Circle *)block)->size = (((Circle *)block)->size & 0xffff) + (size << 16);
-
-    if (1 || memlink)
-    {
-        Circle *new = (Circle *)block;
-
-        if (block_used[n])
-        {
-            new->prev = block_used[n]->prev;
-            new->next = block_used[n];
-            block_used[n]->prev->next = new;
-            block_used[n]->prev = new;
-        } else
-        {
-            block_used[n] = new;
-            new->prev = new;
-            new->next = new;
-        }
-    }
-
-    free_blocks[n]--;
-    used_blocks[n]++;
-
 #ifdef FVDI_DEBUG
     if ((debug > 2) && !(silentx[0] & 0x02))
     {
@@ -1179,8 +993,7 @@ void *DRIVER_EXPORT malloc(size_t size)
     }
 #endif
 
-    *(long *)(block + sizeof(Circle)) = block_space[n];
-    return block + sizeof(Circle);
+    return addr;
 }
 
 
@@ -1205,7 +1018,7 @@ void *realloc(void *addr, size_t new_size)
     if ((long)current->prev & 1)
         old_size = current->size - sizeof(Circle);
     else
-        old_size = current->size >> 16;
+        old_size = arena_requested(addr);
 
     copymem_aligned(addr, new, old_size < new_size ? old_size : new_size);
     free(addr);
@@ -1231,38 +1044,7 @@ long free_size(void *addr)
 
     if (!((long) current->prev & 1))
     {
-        size = current->size & 0xffff;
-#if 1
-        /*
-         * FIXME:
-         * memlink is forced here in free(). It is also forced in malloc().
-         * But it is not forced in fmalloc(), so current->prev may be 0.
-         * This can happen because real_access.funcs.malloc == fmalloc,
-         * so drivers indirectly call fmalloc(), hence current->prev is set to 0
-         * if nomemlink is used.
-         */
-        if (1 || memlink)
-        {
-            if (block_used[size] == current)
-            {
-                block_used[size] = current->next;
-                if (current->next == current)
-                    block_used[size] = NULL;
-            }
-            if (current->prev == 0)
-            {
-                access->funcs.puts("BUG!! current->prev == 0");
-                access->funcs.puts("Please comment out nomemlink in fvdi.sys");
-                for (;;) ;
-            }
-            current->prev->next = current->next;
-            current->next->prev = current->prev;
-        }
-#endif
-        current->next = (Circle *) block_free[size];
-        block_free[size] = (char *) current;
-        free_blocks[size]++;
-        used_blocks[size]--;
+        arena_free(addr);
         return 0;
     }
 
@@ -1298,7 +1080,6 @@ long free_size(void *addr)
 void DRIVER_EXPORT free(void *addr)
 {
     Circle *current;
-    long size;
 
     if (!addr)
         return;
@@ -1307,36 +1088,7 @@ void DRIVER_EXPORT free(void *addr)
 
     if (!((long)current->prev & 1))
     {
-        size = current->size & 0xffff;
-        /*
-         * FIXME:
-         * memlink is forced here in free(). It is also forced in malloc().
-         * But it is not forced in fmalloc(), so current->prev may be 0.
-         * This can happen because real_access.funcs.malloc == fmalloc,
-         * so drivers indirectly call fmalloc(), hence current->prev is set to 0
-         * if nomemlink is used.
-         */
-        if (1 || memlink)
-        {
-            if (block_used[size] == current)
-            {
-                block_used[size] = current->next;
-                if (current->next == current)
-                    block_used[size] = NULL;
-            }
-            if (current->prev == 0)
-            {
-                access->funcs.puts("BUG!! current->prev == 0\n");
-                access->funcs.puts("Please comment out nomemlink in fvdi.sys\n");
-                for (;;) ;
-            }
-            current->prev->next = current->next;
-            current->next->prev = current->prev;
-        }
-        current->next = (Circle *)block_free[size];
-        block_free[size] = (char *)current;
-        free_blocks[size]++;
-        used_blocks[size]--;
+        arena_free(addr);
         return;
     }
 
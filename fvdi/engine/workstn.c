@@ -521,6 +521,21 @@ void CDECL v_clswk(Virtual *vwk, VDIpars *pars)
 }
 
 
+/*
+ * Drivers that do not draw directly on screen
+ * get a chance to bring it up to date.
+ */
+void CDECL v_updwk(Virtual *vwk)
+{
+    Driver *driver;
+    Workstation *wk;
+
+    wk = vwk->real_address;
+    if (wk != non_fvdi_wk && (driver = wk->driver) != NULL && driver->module.setup)
+        driver->module.setup(S_UPDATE, (long) vwk);
+}
+
+
 void CDECL vq_devinfo(VDIpars *pars)
 {
     /* For now, just assume that any
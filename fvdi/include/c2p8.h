@@ -0,0 +1,146 @@
+#ifndef C2P8_H
+#define C2P8_H
+/*
+ * fVDI 8 bit chunky <-> planar group kernels
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ *
+ * Sixteen 8 bit pixels to and from one word for each of up to eight
+ * interleaved bitplanes, bit n of a pixel in plane n. Used both by
+ * the engine (vr_trnfm and vr_transfer_bits) and by the bitplane
+ * driver chunky shadow, which is why the functions are in here.
+ */
+
+
+/*
+ * Chunky 8 bit pixels are in big endian byte order also when
+ * the conversion code is compiled natively (for the benchmark).
+ */
+#ifdef __m68k__
+ #define GET_BYTES(p)      (*(const unsigned long *)(p))
+ #define SET_BYTES(p, v)   (*(unsigned long *)(p) = (v))
+#else
+ #define GET_BYTES(p)      (((unsigned long)(p)[0] << 24) | ((unsigned long)(p)[1] << 16) | \
+                            ((unsigned long)(p)[2] << 8) | (unsigned long)(p)[3])
+ #define SET_BYTES(p, v)   ((p)[0] = (v) >> 24, (p)[1] = (v) >> 16, (p)[2] = (v) >> 8, (p)[3] = (v))
+#endif
+
+
+/*
+ * Transpose the 8x8 bit matrix with rows 0-3 in x and 4-7 in y,
+ * the first row in the most significant byte.
+ */
+#define TRANSPOSE8(x, y) \
+    do { \
+        unsigned long t; \
+        t = (x ^ (x >> 7)) & 0x00aa00aaUL; x ^= t ^ (t << 7); \
+        t = (y ^ (y >> 7)) & 0x00aa00aaUL; y ^= t ^ (t << 7); \
+        t = (x ^ (x >> 14)) & 0x0000ccccUL; x ^= t ^ (t << 14); \
+        t = (y ^ (y >> 14)) & 0x0000ccccUL; y ^= t ^ (t << 14); \
+        t = (x & 0xf0f0f0f0UL) | ((y >> 4) & 0x0f0f0f0fUL); \
+        y = ((x << 4) & 0xf0f0f0f0UL) | (y & 0x0f0f0f0fUL); \
+        x = t; \
+    } while (0)
+
+
+/*
+ * 16 chunky 8 bit pixels to 1-8 planes.
+ * Any bits above the number of planes are ignored.
+ */
+static void chunky8_to_planes(const unsigned char *src, unsigned short *dst, int planes)
+{
+    unsigned long a0, a1, b0, b1, p75, p64, p31, p20;
+
+    a0 = GET_BYTES(src);
+    a1 = GET_BYTES(src + 4);
+    b0 = GET_BYTES(src + 8);
+    b1 = GET_BYTES(src + 12);
+    TRANSPOSE8(a0, a1);
+    TRANSPOSE8(b0, b1);
+
+    /* Plane pairs, high bytes from the first eight pixels */
+    p75 = (a0 & 0xff00ff00UL) | ((b0 >> 8) & 0x00ff00ffUL);
+    p64 = ((a0 << 8) & 0xff00ff00UL) | (b0 & 0x00ff00ffUL);
+    p31 = (a1 & 0xff00ff00UL) | ((b1 >> 8) & 0x00ff00ffUL);
+    p20 = ((a1 << 8) & 0xff00ff00UL) | (b1 & 0x00ff00ffUL);
+
+    switch (planes)
+    {
+    case 8:
+        dst[7] = p75 >> 16;
+        /* fall through */
+    case 7:
+        dst[6] = p64 >> 16;
+        /* fall through */
+    case 6:
+        dst[5] = p75;
+        /* fall through */
+    case 5:
+        dst[4] = p64;
+        /* fall through */
+    case 4:
+        dst[3] = p31 >> 16;
+        /* fall through */
+    case 3:
+        dst[2] = p20 >> 16;
+        /* fall through */
+    case 2:
+        dst[1] = p31;
+        /* fall through */
+    default:
+        dst[0] = p20;
+    }
+}
+
+
+/*
+ * 1-8 planes to 16 chunky 8 bit pixels.
+ * Missing planes give zero bits.
+ */
+static void planes_to_chunky8(const unsigned short *src, unsigned char *dst, int planes)
+{
+    unsigned long a0, a1, b0, b1, p75, p64, p31, p20;
+
+    p75 = p64 = p31 = p20 = 0;
+    switch (planes)
+    {
+    case 8:
+        p75 = (unsigned long)src[7] << 16;
+        /* fall through */
+    case 7:
+        p64 = (unsigned long)src[6] << 16;
+        /* fall through */
+    case 6:
+        p75 |= src[5];
+        /* fall through */
+    case 5:
+        p64 |= src[4];
+        /* fall through */
+    case 4:
+        p31 = (unsigned long)src[3] << 16;
+        /* fall through */
+    case 3:
+        p20 = (unsigned long)src[2] << 16;
+        /* fall through */
+    case 2:
+        p31 |= src[1];
+        /* fall through */
+    default:
+        p20 |= src[0];
+    }
+
+    a0 = (p75 & 0xff00ff00UL) | ((p64 >> 8) & 0x00ff00ffUL);
+    b0 = ((p75 << 8) & 0xff00ff00UL) | (p64 & 0x00ff00ffUL);
+    a1 = (p31 & 0xff00ff00UL) | ((p20 >> 8) & 0x00ff00ffUL);
+    b1 = ((p31 << 8) & 0xff00ff00UL) | (p20 & 0x00ff00ffUL);
+    TRANSPOSE8(a0, a1);
+    TRANSPOSE8(b0, b1);
+
+    SET_BYTES(dst, a0);
+    SET_BYTES(dst + 4, a1);
+    SET_BYTES(dst + 8, b0);
+    SET_BYTES(dst + 12, b1);
+}
+
+#endif
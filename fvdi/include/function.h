@@ -37,6 +37,7 @@ void fill_area(Virtual *vwk, long x1, long y1, long x2, long y2, Fgbg colour);
 void get_extent(Virtual *vwk, long length, short *text, short points[]);
 void draw_text(Virtual *vwk, long x, long y, short *text, long length, Fgbg colour);
 void hline(Virtual *vwk, long x1, long y1, long x2, Fgbg colour, short *pattern, long mode, long interior_style);
+void fill_rect(Virtual *vwk, long x1, long y1, long x2, long y2, Fgbg colour, short *pattern, long mode, long interior_style);
 void fill_spans(void *, short *, long n, Fgbg colour, short *pattern, long mode, long interior_style);
 
 
@@ -80,6 +81,7 @@ void lib_vrt_cpyfm_nocheck(Virtual *vwk, short mode, short *pxy, MFDB *src, MFDB
 void lib_vro_cpyfm(Virtual *vwk, short mode, short *pxy, MFDB *src, MFDB *dst);
 void lib_vs_clip(Virtual *, short, short *);
 void lib_vr_trnfm(Virtual *, MFDB *, MFDB *);
+long c2p_transfer(GCBITMAP *src_bm, GCBITMAP *dst_bm, RECT16 *src_rect, RECT16 *dst_rect);
 void opnvwk_values(Virtual *, VDIpars *);
 void CDECL lib_v_bez(Virtual *vwk, struct v_bez_pars *par);
 long lib_vst_load_fonts(Virtual *vwk, long select);
@@ -94,6 +96,10 @@ void CDECL lib_vqt_fontheader(Virtual *vwk, VQT_FHDR *fhdr);
 int CDECL lib_vst_arbpt(Virtual *vwk, long height, short *charw, short *charh, short *cellw, short *cellh);
 void CDECL lib_vqt_attributes(Virtual * vwk, short *settings);
 unsigned short CDECL lib_vqt_char_index(Virtual *vwk, short *intin);
+long CDECL lib_v_savecache(Virtual *vwk, short *intin, long length);
+long CDECL lib_v_loadcache(Virtual *vwk, short *intin, long length);
+long CDECL lib_v_flushcache(Virtual *vwk);
+long CDECL lib_vqt_cachesize(Virtual *vwk, long which);
 short CDECL lib_vst_charmap(Virtual *vwk, long mode);
 
 void CDECL lib_vs_color(Virtual *vwk, long pen, RGB *values);
@@ -122,6 +128,10 @@ extern void*       (*external_char_advance)(Virtual *vwk, Fontheader *font, long
 extern void        (*external_xfntinfo)(Virtual *vwk, Fontheader *font, long flags, XFNT_INFO *info);
 extern void        (*external_fontheader)(Virtual *vwk, Fontheader *font, VQT_FHDR *fhdr);
 extern unsigned short (*external_char_index) (Virtual *vwk, Fontheader *font, short *intin);
+extern long        (*external_savecache)(Virtual *vwk, const char *filename);
+extern long        (*external_loadcache)(Virtual *vwk, const char *filename, long mode);
+extern long        (*external_flushcache)(Virtual *vwk);
+extern long        (*external_cachesize)(Virtual *vwk, long which);
 
 #ifdef FVDI_DEBUG
 void display_output(VDIpars *pars);
@@ -134,6 +144,7 @@ void CDECL v_opnvwk(Virtual *vwk, VDIpars * pars);
 void CDECL v_opnwk(VDIpars *pars);
 void CDECL v_clsvwk(Virtual *vwk, VDIpars *pars);
 void CDECL v_clswk(Virtual *vwk, VDIpars *pars);
+void CDECL v_updwk(Virtual *vwk);
 void CDECL vq_devinfo(VDIpars *pars);
 
 void CDECL scall_v_clswk(long handle);
@@ -35,6 +35,7 @@
 #define S_AESBUF	102
 #define S_CACHEIMG	103
 #define S_DOBLIT	104
+#define S_UPDATE	105
 
 #define MODULE_IF_VER   0x0020
 
@@ -234,7 +235,7 @@ typedef struct Fontextra_ {
     short index;			/* FreeType2 font index */
     void *current;		/* Font current glyph */
     void *cache;			/* Glyph cache */
-    void *scratch;		/* Glyph scratch .. */
+    void *scratch;		/* Unused */
     short effects;		/* Effect combination the font was rendered to */
     short underline_offset;	/* Offset or the underline stroke */
 } Fontextra;
@@ -669,6 +670,13 @@ typedef struct wk_ {
     void *opcode5[24];
     short opcode11_count;
     void *opcode11[14];
+    /*
+     * Coverage blend (anti-aliased text), 0 if none. Unlike the r
+     * routines, this is called directly from C (CDECL arguments on
+     * the stack) and has no register convention wrapper, so it is
+     * only for drivers written in C. Last, to keep the offsets above.
+     */
+    long CDECL (*blend)(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour);
 } Workstation;
 
 
@@ -85,6 +85,10 @@ extern short singlebend;
 extern short memlink;
 extern short blocks;
 extern long block_size;
+extern short small_blocks;
+extern long small_block_size;
+extern short large_blocks;
+extern long large_block_size;
 extern long log_size;
 extern short arc_split;
 extern short arc_min;
@@ -107,6 +111,8 @@ extern short check_mem;
 #endif
 extern short file_cache_size;
 extern short antialiasing;
+extern long glyph_cache_size;
+extern long font_cache_size;
 extern char *debug_file;
 
 extern long pid_addr;
@@ -19,3 +19,7 @@ void *ft2_char_advance(Virtual *vwk, Fontheader *font, long ch, short *advance_i
 void ft2_xfntinfo(Virtual *vwk, Fontheader *font, long flags, XFNT_INFO *info);
 void ft2_fontheader(Virtual *vwk, Fontheader *font, VQT_FHDR *fhdr);
 unsigned short ft2_char_index(Virtual *vwk, Fontheader *font, short *intin);
+long ft2_savecache(Virtual *vwk, const char *filename);
+long ft2_loadcache(Virtual *vwk, const char *filename, long mode);
+long ft2_flushcache(Virtual *vwk);
+long ft2_cachesize(Virtual *vwk, long which);
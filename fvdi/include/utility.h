@@ -32,6 +32,7 @@ long remove_xbra(long vector, const char *name);
 long initialize_pool(long size, long n);
 char *DRIVER_EXPORT allocate_block(long size);
 void DRIVER_EXPORT free_block(void *addr);
+long block_room(const void *addr);
 
 
 /*
@@ -69,6 +70,27 @@ void allocate(long amount);
 void check_memory(void);
 #endif
 
+/*
+ * Internal memory pool (memory.c)
+ */
+typedef struct Arena_usage_ {
+    long arenas;
+    long blocks;
+    long used;              /* Including headers */
+    long requested;
+    long free;
+    long largest;           /* Free block */
+    long high_water;
+} Arena_usage;
+
+void *arena_malloc(long size);
+void arena_free(void *addr);
+long arena_requested(void *addr);
+#ifdef FVDI_DEBUG
+void arena_usage(Arena_usage *usage);
+long arena_check(void);
+#endif
+
 /*
  * Text output
  */
@@ -38,6 +38,7 @@
 #endif
 
 #include <mint/osbind.h>
+#include "os.h"
 
 #include "globals.h"
 #include "utility.h"
@@ -59,6 +60,11 @@ char const ft2_version[] = __STRINGIFY(FREETYPE_MAJOR) "." __STRINGIFY(FREETYPE_
 /* Cached glyph information */
 typedef struct cached_glyph
 {
+    struct Linkable *next;	/* Glyph LRU list, most recently used first */
+    struct Linkable *prev;
+    Fontheader *font;		/* Face whose glyph cache this is in */
+    long code;			/* Character code and mapping, see GLYPH_CODE */
+    long bytes;			/* Memory held by the glyph */
     int stored;
     FT_UInt index;
     FT_Bitmap bitmap;
@@ -71,9 +77,43 @@ typedef struct cached_glyph
 #endif
     int yoffset;
     int advance;
-    short cached;
 } c_glyph;
 
+/* Per face glyph cache, open addressed with linear probing */
+typedef struct glyph_cache
+{
+    c_glyph **table;
+    int size;			/* Always a power of two */
+    int count;
+    long bytes;			/* Memory held by the glyphs */
+} glyph_cache;
+
+#define GLYPH_CACHE_START	64
+
+/* One glyph of a laid out string */
+typedef struct
+{
+    c_glyph *glyph;
+    int x;			/* Left edge, relative to the string start */
+} placed_glyph;
+
+/* A string laid out for measuring or drawing, see ft2_layout_text */
+typedef struct
+{
+    placed_glyph *glyphs;
+    int count;
+    int size;			/* Allocated entries, kept between strings */
+    int minx;			/* Horizontal extent, relative to the string start */
+    int maxx;
+    int advance;		/* Pen position after the last glyph */
+} text_layout;
+
+#define LAYOUT_GRANULE	32
+
+/* The character to glyph index mapping depends on the mapping mode */
+#define GLYPH_CODE(vwk, ch)	(((long) (vwk)->text.charmap << 16) | (unsigned short) (ch))
+#define GLYPH_HASH(code, size)	((((unsigned long) (code) * 0x9e3779b1UL) >> 12) & ((size) - 1))
+
 
 /* Handy routines for converting from fixed point */
 #define FT_FLOOR(X)	((X & -64) / 64)
@@ -98,12 +138,31 @@ static short spdchar_map_len = 0;
 static FT_Library library;
 static LIST fonts;
 
-typedef struct {
+/* All cached glyphs, for eviction under the glyph_cache_size budget */
+static LIST glyphs;
+static long glyph_bytes = 0;
+static long glyph_hits = 0;
+static long glyph_misses = 0;
+static short glyph_pinned = 0;	/* No eviction while a layout is in use */
+static text_layout layout;
+
+typedef struct font_item {
     struct Linkable *next;
     struct Linkable *prev;
     Fontheader *font;
+    struct font_item *hash_next;
+    short id;			/* Key: face id, point size and effects */
+    short size;
+    short effects;
+    long face_bytes;		/* Memory FreeType allocated for the face */
 } FontheaderListItem;
 
+/* Hash index into the size/effects instance list */
+#define FONT_HASH_SIZE	64
+#define FONT_HASH(id, size, effects)	((((unsigned short) (id) * 31U + (unsigned short) (size)) * 8U + (effects)) & (FONT_HASH_SIZE - 1))
+
+static FontheaderListItem *font_hash[FONT_HASH_SIZE];
+
 
 static FT_Error ft2_find_glyph(Virtual *vwk, Fontheader *font, short ch, int want);
 static Fontheader *ft2_dup_font(Virtual *vwk, Fontheader *src, short ptsize);
@@ -173,6 +232,14 @@ void ft2_term(void)
         ft2_dispose_font(x->font);      /* Remove the whole font */
         x = tmp;
     }
+    free(layout.glyphs);
+    layout.glyphs = NULL;
+    layout.size = 0;
+
+    if (debug > 0)
+    {
+        PRINTF(("FT2 glyph cache: %ld hits, %ld misses, %ld bytes\n", glyph_hits, glyph_misses, glyph_bytes));
+    }
 
     /* Terminate the FT2 library */
     FT_Done_FreeType(library);
@@ -190,6 +257,9 @@ int ft2_init(void)
     /* Initialize Fontheader LRU cache */
     listInit(&fonts);
 
+    /* Initialize glyph LRU list */
+    listInit(&glyphs);
+
     return 0;
 }
 
@@ -709,7 +779,6 @@ Fontheader *ft2_load_font(Virtual *vwk, const char *filename)
         /* By default faces should not be kept in memory... (void *)face */
         font->extra.unpacked.data = NULL;
         font->extra.cache = NULL;
-        font->extra.scratch = NULL;
 
 #if 0
         if (face->num_fixed_sizes > 1)
@@ -791,10 +860,30 @@ static Fontheader *ft2_open_face(Virtual *vwk, Fontheader *font, short ptsize)
 
     if (!font->extra.cache)
     {
-        font->extra.cache = malloc(sizeof(c_glyph) * 256);	/* Cache */
-        memset(font->extra.cache, 0, sizeof(c_glyph) * 256);	/* Cache */
-        font->extra.scratch = malloc(sizeof(c_glyph));		/* Scratch */
-        memset(font->extra.scratch, 0, sizeof(c_glyph));
+        glyph_cache *cache = malloc(sizeof(glyph_cache));
+
+        if (cache)
+        {
+            cache->size = GLYPH_CACHE_START;
+            cache->count = 0;
+            cache->bytes = 0;
+            cache->table = malloc(sizeof(c_glyph *) * GLYPH_CACHE_START);
+            if (cache->table)
+            {
+                memset(cache->table, 0, sizeof(c_glyph *) * GLYPH_CACHE_START);
+            } else
+            {
+                free(cache);
+                cache = NULL;
+            }
+        }
+        if (!cache)
+        {
+            access->funcs.puts("FT2  Not enough memory for glyph cache\n");
+            FT_Done_Face(face);
+            return NULL;
+        }
+        font->extra.cache = cache;
     }
 
     font = ft2_load_metrics(vwk, font, face, ptsize);
@@ -842,7 +931,6 @@ static Fontheader *ft2_dup_font(Virtual *vwk, Fontheader *src, short ptsize)
         /* Clean the FT2 data and cache -> initialized below here */
         font->extra.unpacked.data = NULL;
         font->extra.cache = NULL;
-        font->extra.scratch = NULL;
 
         /* underline == 0 -> metrics were not read yet */
         font->underline = 0;
@@ -1499,53 +1587,48 @@ static FT_Error ft2_load_glyph(Virtual *vwk, Fontheader *font, short ch, c_glyph
 
     FT_Done_Glyph(g);
 
-    /* We're done, mark this glyph cached */
-    cached->cached = ch;
-
     return 0;
 }
 
 
-static void ft2_flush_glyph(c_glyph *glyph)
+static void ft2_free_glyph(c_glyph *glyph)
 {
-    glyph->stored = 0;
-    glyph->index = 0;
+    listRemove((LINKABLE *) glyph);
+    glyph_bytes -= glyph->bytes;
+    ((glyph_cache *) glyph->font->extra.cache)->bytes -= glyph->bytes;
+
     if (glyph->bitmap.buffer)
-    {
         free(glyph->bitmap.buffer);
-        glyph->bitmap.buffer = 0;
-    }
     if (glyph->pixmap.buffer)
-    {
         free(glyph->pixmap.buffer);
-        glyph->pixmap.buffer = 0;
-    }
-    glyph->cached = 0;
+    free(glyph);
 }
 
 
 static void ft2_flush_cache(Fontheader *font)
 {
+    glyph_cache *cache = font->extra.cache;
     int i;
-    int size = 256;
 
-    for (i = 0; i < size; ++i)
+    if (!cache)
+        return;
+
+    for (i = 0; i < cache->size; ++i)
     {
-        if (((c_glyph *) font->extra.cache)[i].cached)
+        if (cache->table[i])
         {
-            ft2_flush_glyph(&((c_glyph *) font->extra.cache)[i]);
+            ft2_free_glyph(cache->table[i]);
+            cache->table[i] = NULL;
         }
-
-    }
-    if (((c_glyph *) font->extra.scratch)->cached)
-    {
-        ft2_flush_glyph(font->extra.scratch);
     }
+    cache->count = 0;
 }
 
 
 static void ft2_dispose_font(Fontheader *font)
 {
+    glyph_cache *cache = font->extra.cache;
+
     /* Close the FreeType2 face */
     ft2_close_face(font);
 
@@ -1554,33 +1637,213 @@ static void ft2_dispose_font(Fontheader *font)
 
     /* Dispose of the data */
     free(font->extra.filename);
-    free(font->extra.cache);
-    free(font->extra.scratch);
+    if (cache)
+    {
+        free(cache->table);
+        free(cache);
+    }
     free(font);
 }
 
 
-static FT_Error ft2_find_glyph(Virtual *vwk, Fontheader *font, short ch, int want)
+/*
+ * Return the slot where a glyph is, or should go, in a glyph cache.
+ */
+static c_glyph **ft2_glyph_slot(glyph_cache *cache, long code)
+{
+    c_glyph **slot;
+    int i;
+
+    i = GLYPH_HASH(code, cache->size);
+    while (*(slot = &cache->table[i]) && (*slot)->code != code)
+        i = (i + 1) & (cache->size - 1);
+
+    return slot;
+}
+
+
+/*
+ * Double the size of a glyph cache.
+ * Returns zero on failure, leaving the cache unchanged.
+ */
+static int ft2_grow_cache(glyph_cache *cache)
 {
-    int retval = 0;
+    c_glyph **old_table = cache->table;
+    int old_size = cache->size;
+    int i;
 
-    if (ch < 256)
+    cache->table = malloc(sizeof(c_glyph *) * old_size * 2);
+    if (!cache->table)
     {
-        font->extra.current = &((c_glyph *) font->extra.cache)[ch];
-    } else
+        cache->table = old_table;
+        return 0;
+    }
+    memset(cache->table, 0, sizeof(c_glyph *) * old_size * 2);
+    cache->size = old_size * 2;
+
+    for (i = 0; i < old_size; i++)
+    {
+        if (old_table[i])
+            *ft2_glyph_slot(cache, old_table[i]->code) = old_table[i];
+    }
+    free(old_table);
+
+    return 1;
+}
+
+
+/*
+ * Remove a glyph from the cache of its face and free it.
+ * Following entries are moved back to close the gap,
+ * so that no deleted markers are needed for the probing.
+ */
+static void ft2_evict_glyph(c_glyph *glyph)
+{
+    glyph_cache *cache = glyph->font->extra.cache;
+    int mask = cache->size - 1;
+    int i, j, home;
+
+    for (i = GLYPH_HASH(glyph->code, cache->size); cache->table[i] != glyph; i = (i + 1) & mask)
+        ;
+    cache->table[i] = NULL;
+    cache->count--;
+
+    for (j = (i + 1) & mask; cache->table[j]; j = (j + 1) & mask)
     {
-        if (((c_glyph *) font->extra.scratch)->cached != ch)
+        home = GLYPH_HASH(cache->table[j]->code, cache->size);
+        /* Move back unless its home slot lies cyclically in (i, j] */
+        if (((j - home) & mask) >= ((j - i) & mask))
         {
-            ft2_flush_glyph(font->extra.scratch);
+            cache->table[i] = cache->table[j];
+            cache->table[j] = NULL;
+            i = j;
         }
-        font->extra.current = font->extra.scratch;
     }
-    if ((((c_glyph *) font->extra.current)->stored & want) != want)
+
+    ft2_free_glyph(glyph);
+}
+
+
+static long ft2_glyph_bytes(c_glyph *glyph)
+{
+    long bytes = sizeof(c_glyph);
+
+    if (glyph->bitmap.buffer)
+        bytes += (long) glyph->bitmap.pitch * glyph->bitmap.rows;
+    if (glyph->pixmap.buffer)
+        bytes += (long) glyph->pixmap.pitch * glyph->pixmap.rows;
+
+    return bytes;
+}
+
+
+/*
+ * Find a glyph in the cache of a face and make it the most recently used.
+ * An empty glyph is added if it was not there.
+ */
+static c_glyph *ft2_cache_glyph(Fontheader *font, long code)
+{
+    glyph_cache *cache = font->extra.cache;
+    c_glyph **slot, *glyph;
+
+    slot = ft2_glyph_slot(cache, code);
+    glyph = *slot;
+    if (glyph)
+    {
+        listRemove((LINKABLE *) glyph);
+        listInsert(glyphs.head.next, (LINKABLE *) glyph);
+        return glyph;
+    }
+
+    /* Keep the load below 3/4 */
+    if (cache->count * 4 >= cache->size * 3)
+    {
+        if (ft2_grow_cache(cache))
+            slot = ft2_glyph_slot(cache, code);
+        else if (cache->count >= cache->size - 1)
+            return NULL;
+    }
+
+    glyph = malloc(sizeof(c_glyph));
+    if (!glyph)
+        return NULL;
+    memset(glyph, 0, sizeof(c_glyph));
+    glyph->font = font;
+    glyph->code = code;
+    glyph->bytes = sizeof(c_glyph);
+    glyph_bytes += glyph->bytes;
+    cache->bytes += glyph->bytes;
+    *slot = glyph;
+    cache->count++;
+    listInsert(glyphs.head.next, (LINKABLE *) glyph);
+
+    return glyph;
+}
+
+
+/*
+ * Evict the least recently used glyphs of any face until
+ * within budget again, unless glyphs are pinned by a layout.
+ */
+static void ft2_trim_glyphs(c_glyph *keep)
+{
+    LINKABLE *last;
+
+    if (glyph_pinned)
+        return;
+
+    while (glyph_bytes > glyph_cache_size &&
+           (last = listLast(&glyphs)) != NULL && last != (LINKABLE *) keep)
+    {
+        ft2_evict_glyph((c_glyph *) last);
+    }
+}
+
+
+/*
+ * Account for a change in the bitmaps held by a glyph.
+ */
+static void ft2_update_glyph(c_glyph *glyph)
+{
+    glyph_cache *cache = glyph->font->extra.cache;
+
+    glyph_bytes -= glyph->bytes;
+    cache->bytes -= glyph->bytes;
+    glyph->bytes = ft2_glyph_bytes(glyph);
+    glyph_bytes += glyph->bytes;
+    cache->bytes += glyph->bytes;
+
+    ft2_trim_glyphs(glyph);
+}
+
+
+static FT_Error ft2_find_glyph(Virtual *vwk, Fontheader *font, short ch, int want)
+{
+    c_glyph *glyph;
+    FT_Error error;
+
+    if (!font->extra.cache)
+    {
+        if (!ft2_get_face(vwk, font) || !font->extra.cache)
+            return 1;
+    }
+
+    glyph = ft2_cache_glyph(font, GLYPH_CODE(vwk, ch));
+    if (!glyph)
+        return 1;
+    font->extra.current = glyph;
+
+    if ((glyph->stored & want) == want)
     {
-        retval = ft2_load_glyph(vwk, font, ch, font->extra.current, want);
+        glyph_hits++;
+        return 0;
     }
+    glyph_misses++;
+
+    error = ft2_load_glyph(vwk, font, ch, glyph, want);
+    ft2_update_glyph(glyph);
 
-    return retval;
+    return error;
 }
 
 
@@ -1652,315 +1915,353 @@ void *ft2_char_bitmap(Virtual *vwk, Fontheader *font, long ch, short *bitmap_inf
 }
 
 
-static int ft2_text_size(Virtual *vwk, Fontheader *font, const short *text, int *w, int *h)
+/*
+ * Top row of the underline in a string of the font's height.
+ */
+static int ft2_underline_row(Fontheader *font)
+{
+    int row = font->distance.ascent - font->extra.underline_offset - 1;
+
+    if (row + font->underline > font->height)
+    {
+        row = (font->height - 1) - font->underline;
+    }
+
+    return row < 0 ? 0 : row;
+}
+
+
+/*
+ * Lay out a string in a single walk over it, looking up each glyph
+ * once with (at least) the wanted data loaded.
+ * The glyphs are pinned in the cache until ft2_layout_done().
+ */
+static text_layout *ft2_layout_text(Virtual *vwk, Fontheader *font, const short *text, int want)
 {
     const short *ch;
-    int x, z;
-    int minx = 0, maxx = 0;
-#ifdef CACHE_YSIZE
-    int miny = 0, maxy = 0;
-#endif
     c_glyph *glyph;
-    FT_Error error;
+    placed_glyph *placed;
+    FT_Long use_kerning;
+    FT_UInt prev_index = 0;
+    int xstart, z, length;
+
+    for (length = 0; text[length]; length++)
+        ;
+    if (length > layout.size)
+    {
+        placed = malloc(sizeof(placed_glyph) * (length + LAYOUT_GRANULE));
+        if (!placed)
+            return NULL;
+        free(layout.glyphs);
+        layout.glyphs = placed;
+        layout.size = length + LAYOUT_GRANULE;
+    }
+    layout.count = 0;
+    layout.minx = layout.maxx = 0;
+    glyph_pinned++;
+
+    /* Check kerning */
+    use_kerning = 0; /* FIXME: FT_HAS_KERNING(face); */
 
-    /* Load each character and sum it's bounding box */
-    x = 0;
+    xstart = 0;
+    placed = layout.glyphs;
     for (ch = text; *ch; ++ch)
     {
-        error = ft2_find_glyph(vwk, font, *ch, CACHED_METRICS);
-        if (error)
+        if (ft2_find_glyph(vwk, font, *ch, CACHED_METRICS | want))
         {
             continue;
         }
         glyph = font->extra.current;
 
-        z = x + glyph->minx;
-        if (minx > z)
+        /* Do kerning, if possible AC-Patch */
+        if (use_kerning && prev_index && glyph->index)
         {
-            minx = z;
+            FT_Vector delta;
+
+            FT_Get_Kerning((FT_Face)font->extra.unpacked.data, prev_index, glyph->index, ft_kerning_default, &delta);
+            xstart += delta.x >> 6;
         }
-        if (glyph->advance > glyph->maxx)
-        {
-            z = x + glyph->advance;
-        } else
+        /* Compensate for wrap around bug with negative minx's */
+        if ((ch == text) && (glyph->minx < 0))
         {
-            z = x + glyph->maxx;
+            xstart -= glyph->minx;
         }
-        if (maxx < z)
+
+        z = xstart + glyph->minx;
+        placed->glyph = glyph;
+        placed->x = z;
+        placed++;
+        if (layout.minx > z)
         {
-            maxx = z;
+            layout.minx = z;
         }
-        x += glyph->advance;
-
-#ifdef CACHE_YSIZE
-        if (glyph->miny < miny)
+        if (glyph->advance > glyph->maxx)
+        {
+            z = xstart + glyph->advance;
+        } else
         {
-            miny = glyph->miny;
+            z = xstart + glyph->maxx;
         }
-        if (glyph->maxy > maxy)
+        if (layout.maxx < z)
         {
-            maxy = glyph->maxy;
+            layout.maxx = z;
         }
-#endif
-    }
 
-    /* Fill the bounds rectangle */
-    if (w)
-    {
-        *w = (maxx - minx);
-    }
-    if (h)
-    {
-#ifdef CACHE_YSIZE
-#if 0 /* This is correct, but breaks many applications */
-        *h = (maxy - miny);
-#else
-        *h = font->height;
-#endif
-#else
-        *h = font->height;
-#endif
+        xstart += glyph->advance;
+        prev_index = glyph->index;
     }
+    layout.count = placed - layout.glyphs;
+    layout.advance = xstart;
 
 #ifdef FVDI_DEBUG
     if (debug > 2)
     {
         char buf[255];
 
-        for (ch = text; *ch; ++ch)
+        for (ch = text; *ch && ch - text < 254; ++ch)
         {
             buf[ch - text] = *ch;
         }
         buf[ch - text] = '\0';
 
-        PRINTF(("txt width: \"%s\" -> %d\n", buf, *w));
+        PRINTF(("txt width: \"%s\" -> %d\n", buf, layout.maxx - layout.minx));
     }
 #endif
 
-    return 0;
+    return &layout;
+}
+
+
+/*
+ * Release the glyphs of the last layout to the cache again.
+ */
+static void ft2_layout_done(void)
+{
+    if (--glyph_pinned == 0)
+        ft2_trim_glyphs(NULL);
+}
+
+
+/*
+ * Draw a coverage map through a monochrome version of it,
+ * for drivers that can not blend.
+ */
+static void ft2_threshold_coverage(Virtual *vwk, MFDB *coverage, short x, short y, short *colors)
+{
+    MFDB mono;
+    unsigned char *src;
+    unsigned short *dst;
+    unsigned short bit;
+    int row, col;
+    short pxy[8];
+
+    mono.width = coverage->width;
+    mono.height = coverage->height;
+    mono.standard = 1;
+    mono.bitplanes = 1;
+    mono.wdwidth = (mono.width + 15) >> 4;
+    mono.address = malloc(mono.wdwidth * 2 * mono.height);
+    if (!mono.address)
+        return;
+    memset(mono.address, 0, mono.wdwidth * 2 * mono.height);
+
+    for (row = 0; row < coverage->height; row++)
+    {
+        src = (unsigned char *)coverage->address + row * coverage->wdwidth * 2;
+        dst = (unsigned short *)mono.address + row * mono.wdwidth;
+        bit = 0x8000;
+        for (col = 0; col < coverage->width; col++)
+        {
+            if (*src++ & 0x80)
+                *dst |= bit;
+            if (!(bit >>= 1))
+            {
+                bit = 0x8000;
+                dst++;
+            }
+        }
+    }
+
+    pxy[0] = 0;
+    pxy[1] = 0;
+    pxy[2] = mono.width - 1;
+    pxy[3] = mono.height - 1;
+    pxy[4] = x;
+    pxy[5] = y;
+    pxy[6] = x + mono.width - 1;
+    pxy[7] = y + mono.height - 1;
+    lib_vdi_spppp(&lib_vrt_cpyfm_nocheck, vwk, vwk->mode, pxy, &mono, NULL, colors);
+
+    free(mono.address);
 }
 
 
+/*
+ * The whole string, underline included, is composed into a single
+ * 8 bit coverage map which the driver then blends onto the screen
+ * in one call.
+ */
 static MFDB *ft2_text_render_antialias(Virtual *vwk, Fontheader *font, short x, short y, const short *text, MFDB *textbuf)
 {
-    int xstart = 0;
-    int width;
-    const short *ch;
+    Workstation *wk = vwk->real_address;
+    text_layout *lay;
+    placed_glyph *placed;
+    int width, height, pitch;
+    int i, row, col, z;
     c_glyph *glyph;
+    unsigned char *src, *dst;
 
     FT_Bitmap *current;
-    FT_Face face;
-    FT_Error error;
-    FT_Long use_kerning;
-    FT_UInt prev_index = 0;
 
     MFDB tb;
     short colors[2];
-    short pxy[8];
+    long src_x, src_y, dst_x, dst_y, w, h;
 
     (void) textbuf;
-    tb.standard = 0x0100;		/* Chunky! */
-    tb.bitplanes = 8;
-
     colors[1] = vwk->text.colour.background;
     colors[0] = vwk->text.colour.foreground;
 
-    pxy[0] = 0;
-    pxy[1] = 0;
-
-    face = (FT_Face)font->extra.unpacked.data;
-
-    /* Check kerning */
-    use_kerning = 0; /* FIXME: FT_HAS_KERNING(face); */
-
     y += ((short *)&font->extra.distance)[vwk->text.alignment.vertical];
 
-    for (ch = text; *ch; ++ch)
+    lay = ft2_layout_text(vwk, font, text, CACHED_PIXMAP);
+    if (!lay)
+        return NULL;
+
+    width = lay->maxx - lay->minx;
+    height = font->height;
+    if (width <= 0 || height <= 0)
     {
-        short c = *ch;
+        ft2_layout_done();
+        return NULL;
+    }
 
-        error = ft2_find_glyph(vwk, font, c, CACHED_METRICS | CACHED_PIXMAP);
-        if (error)
-        {
-            continue;
-        }
-        glyph = font->extra.current;
+    /* Fill in the coverage surface */
+    pitch = (width + 1) & ~1;
+    tb.width = width;
+    tb.height = height;
+    tb.wdwidth = pitch >> 1;    /* Words per line */
+    tb.standard = 0x0100;       /* Chunky! */
+    tb.bitplanes = 8;
+    tb.address = malloc(pitch * height);
+    if (!tb.address)
+    {
+        ft2_layout_done();
+        return NULL;
+    }
+    memset(tb.address, 0, pitch * height);
 
+    /* Compose the glyphs, keeping the largest coverage where they overlap */
+    for (i = 0, placed = lay->glyphs; i < lay->count; i++, placed++)
+    {
+        glyph = placed->glyph;
         current = &glyph->pixmap;
 
         /* Ensure the width of the pixmap is correct. In some cases,
          * FreeType may report a larger pixmap than possible.
          */
-        width = current->width;
-        if (width > glyph->maxx - glyph->minx)
+        w = current->width;
+        if (w > glyph->maxx - glyph->minx)
+            w = glyph->maxx - glyph->minx;
+
+        for (row = 0; row < (int)current->rows; row++)
         {
-            width = glyph->maxx - glyph->minx;
+            z = row + glyph->yoffset;
+            if (z < 0 || z >= height)
+                continue;
+
+            src = current->buffer + row * current->pitch;
+            dst = (unsigned char *)tb.address + z * pitch + placed->x - lay->minx;
+            for (col = 0; col < w; col++)
+            {
+                if (dst[col] < src[col])
+                    dst[col] = src[col];
+            }
         }
-        /* Do kerning, if possible AC-Patch */
-        if (use_kerning && prev_index && glyph->index)
-        {
-            FT_Vector delta;
-
-            FT_Get_Kerning(face, prev_index, glyph->index, ft_kerning_default, &delta);
-            xstart += delta.x >> 6;
-        }
-        /* Compensate for wrap around bug with negative minx's */
-        if ((ch == text) && (glyph->minx < 0))
-        {
-            xstart -= glyph->minx;
-        }
-
-        /* FIXME? For now this is char by char */
-        {
-            /* NOTE:
-             * This MFDB is only supported by the aranym driver so far
-             *
-             * standard = 0x0100  ~  chunky data
-             * bitplane = 8       ~  will alpha expand the data
-             **/
-
-            /* Fill in the target surface */
-            tb.width = width;
-            tb.height = current->rows;
-            tb.wdwidth = current->pitch >> 1; /* Words per line */
-            tb.address = (void *)current->buffer;
-
-            pxy[2] = tb.width - 1;
-            pxy[3] = tb.height - 1;
-            pxy[4] = x + xstart + glyph->minx;
-            pxy[5] = y + glyph->yoffset;
-            pxy[6] = pxy[4] + tb.width - 1;
-            pxy[7] = pxy[5] + tb.height - 1;
-            lib_vdi_spppp(&lib_vrt_cpyfm_nocheck, vwk, vwk->mode, pxy, &tb, NULL, colors);
-        }
-
-        xstart += glyph->advance;
-        prev_index = glyph->index;
     }
 
     /* Handle the underline style */
     if (vwk->text.effects & 0x8)
     {
-        short row = font->distance.ascent - font->extra.underline_offset - 1;
+        unsigned char level = (font->extra.effects & 0x2) ? 0xff / 3 : 0xff;
 
-        if (row + font->underline > font->height)
+        row = ft2_underline_row(font);
+        for (z = row; z < row + font->underline && z < height; z++)
         {
-            row = (font->height - 1) - font->underline;
+            dst = (unsigned char *)tb.address + z * pitch - lay->minx;
+            for (col = 0; col < lay->advance; col++)
+            {
+                if (dst[col] < level)
+                    dst[col] = level;
+            }
         }
-        y += row;
+    }
 
-        /* Fill in the target surface */
-        tb.width = xstart;
-        tb.height = font->underline;
-        tb.wdwidth = (tb.width + 1) >> 1; /* Words per line */
-        tb.address = malloc(tb.wdwidth * 2 * tb.height);
-        memset(tb.address, (font->extra.effects & 0x2) ? 0xff / 3 : 0xff, tb.wdwidth * 2 * tb.height);
+    x += lay->minx;
+    ft2_layout_done();
 
-        pxy[2] = tb.width - 1;
-        pxy[3] = tb.height - 1;
-        pxy[4] = x;
-        pxy[5] = y;
-        pxy[6] = pxy[4] + tb.width - 1;
-        pxy[7] = pxy[5] + tb.height - 1;
-        lib_vdi_spppp(&lib_vrt_cpyfm_nocheck, vwk, vwk->mode, pxy, &tb, NULL, colors);
+    /* Clip */
+    dst_x = x;
+    dst_y = y;
+    src_x = src_y = 0;
+    w = width;
+    h = height;
+    if (dst_x < vwk->clip.rectangle.x1)
+    {
+        src_x = vwk->clip.rectangle.x1 - dst_x;
+        dst_x = vwk->clip.rectangle.x1;
+    }
+    if (dst_y < vwk->clip.rectangle.y1)
+    {
+        src_y = vwk->clip.rectangle.y1 - dst_y;
+        dst_y = vwk->clip.rectangle.y1;
+    }
+    w -= src_x;
+    h -= src_y;
+    if (dst_x + w - 1 > vwk->clip.rectangle.x2)
+        w = vwk->clip.rectangle.x2 - dst_x + 1;
+    if (dst_y + h - 1 > vwk->clip.rectangle.y2)
+        h = vwk->clip.rectangle.y2 - dst_y + 1;
 
-        free(tb.address);
+    if (w > 0 && h > 0)
+    {
+        if (!wk->blend ||
+            wk->blend(vwk, &tb, src_x, src_y, dst_x, dst_y, w, h, vwk->mode,
+                        ((long)colors[1] << 16) | (unsigned short)colors[0]) <= 0)
+        {
+            ft2_threshold_coverage(vwk, &tb, x, y, colors);
+        }
     }
 
+    free(tb.address);
+
     return NULL;
 }
 
 
 static MFDB *ft2_text_render(Virtual *vwk, Fontheader *font, const short *text, MFDB *textbuf)
 {
-    int xstart;
+    text_layout *lay;
+    placed_glyph *placed;
     int width;
     int height;
-    const short *ch;
+    int i;
     unsigned char *src;
     unsigned char *dst;
-    unsigned char *dst_check;
     c_glyph *glyph;
 
     FT_Bitmap *current;
-#if 0
-    FT_Error error;
-#endif
-    FT_Long use_kerning;
-    FT_UInt prev_index = 0;
-    FT_Face face;
+
+    lay = ft2_layout_text(vwk, font, text, CACHED_BITMAP);
+    if (!lay)
+        return NULL;
 
     /* Get the dimensions of the text surface */
-#if 0
-    if ((ft2_text_size(vwk, font, text, &width, NULL) < 0) || !width)
+    width = lay->maxx - lay->minx;
+    if (!width)
     {
-        /* TTF_SetError("Text has zero width"); */
+        ft2_layout_done();
         return NULL;
     }
-#else
-    {
-        int x, z;
-        int minx, maxx;
-
-        minx = maxx = 0;
-
-        /* Load each character and sum its bounding box */
-        x = 0;
-        for (ch = text; *ch; ++ch)
-        {
-#if 0
-            if (ft2_find_glyph(vwk, font, *ch, CACHED_METRICS))
-                continue;
-        }
-        glyph = font->extra.current;
-#else
-            short c = *ch;
-
-            /* This should be done via a macro! */
-            if (c < 256)
-            {
-                glyph = &((c_glyph *)font->extra.cache)[c];
-            } else
-            {
-                if (((c_glyph *)font->extra.scratch)->cached != c)
-                {
-                    ft2_flush_glyph(font->extra.scratch);
-                }
-                glyph = font->extra.scratch;
-            }
-            if (!(glyph->stored & CACHED_METRICS))
-            {
-                if (ft2_load_glyph(vwk, font, c, glyph, CACHED_METRICS))
-                {
-                    continue;
-                }
-            }
-#endif
-
-            z = x + glyph->minx;
-            if (minx > z)
-            {
-                minx = z;
-            }
-            if (glyph->advance > glyph->maxx)
-            {
-                z = x + glyph->advance;
-            } else
-            {
-                z = x + glyph->maxx;
-            }
-            if (maxx < z)
-            {
-                maxx = z;
-            }
-            x += glyph->advance;
-        }
-
-        width = maxx - minx;
-        if (!width)
-            return NULL;
-    }
-#endif
     height = font->height;
 
     /* Fill in the target surface */
@@ -1973,269 +2274,168 @@ static MFDB *ft2_text_render(Virtual *vwk, Fontheader *font, const short *text,
     textbuf->address = malloc(textbuf->wdwidth * 2 * textbuf->height);
     if (textbuf->address == NULL)
     {
+        ft2_layout_done();
         return NULL;
     }
     memset(textbuf->address, 0, textbuf->wdwidth * 2 * textbuf->height);
 
-    /* Adding bounds checking to avoid all kinds of memory
-     * corruption errors that may occur.
-     */
-    dst_check = (unsigned char *) textbuf->address + textbuf->wdwidth * 2 * textbuf->height;
-
-    face = (FT_Face)font->extra.unpacked.data;
-
-    /* Check kerning */
-    use_kerning = 0; /* FIXME: FT_HAS_KERNING(face); */
-
-    if (debug > 2)
-    {
-        PUTS("\n");
-        PUTS("Text: ");
-    }
-
-    /* Load and render each character */
-    xstart = 0;
-    for (ch = text; *ch; ++ch)
+    /* Render each character */
+    for (i = 0, placed = lay->glyphs; i < lay->count; i++, placed++)
     {
-        short c = *ch;
+        int offset = placed->x - lay->minx;
+        short shift = offset % 8;
+        int last_row;
+        unsigned long byte;
+        short row, col;
+        short dst_inc, src_inc;
 
-#ifdef FVDI_DEBUG
-        if (debug > 2)
-        {
-            char buf[2];
-            buf[0] = c;
-            buf[1] = '\0';
-            PUTS(buf);
-        }
-#endif
-#if 0
-        int swapped;
+        glyph = placed->glyph;
+        current = &glyph->bitmap;
 
-        swapped = TTF_byteswapped;
-        if (c == UNICODE_BOM_NATIVE)
+        row = 0;
+        src = current->buffer;
+        dst = (unsigned char *)textbuf->address + (offset >> 3);
+        if (glyph->yoffset < 0)   /* Under limit? */
         {
-            swapped = 0;
-            if (text == ch)
-            {
-                ++text;
-            }
-            continue;
-        }
-        if (c == UNICODE_BOM_SWAPPED)
+            row -= glyph->yoffset;
+            src += row * current->pitch;
+        } else if (glyph->yoffset)
         {
-            swapped = 1;
-            if (text == ch)
-            {
-                ++text;
-            }
-            continue;
-        }
-        if (swapped)
-        {
-            c = SDL_Swap16(c);
+            dst += glyph->yoffset * textbuf->wdwidth * 2;
         }
-#endif
 
-#if 0
-        error = ft2_find_glyph(vwk, font, c, CACHED_METRICS | CACHED_BITMAP);
-        if (error)
-        {
-            continue;
-        }
-        glyph = font->extra.current;
-#else
-        /* This should be done via a macro! */
-        if (c < 256)
-        {
-            glyph = &((c_glyph *)font->extra.cache)[c];
-        } else
-        {
-            if (((c_glyph *)font->extra.scratch)->cached != c)
-            {
-                ft2_flush_glyph(font->extra.scratch);
-            }
-            glyph = font->extra.scratch;
-        }
-        if ((glyph->stored & (CACHED_METRICS | CACHED_BITMAP)) != (CACHED_METRICS | CACHED_BITMAP))
+        /* Over limit? */
+        last_row = current->rows - 1;
+        if (last_row + glyph->yoffset >= textbuf->height)
+            last_row = textbuf->height - glyph->yoffset - 1;
+
+        /* Ensure the width of the bitmap is correct. In some cases,
+         * FreeType may report a larger bitmap than possible.
+         */
+        width = current->width;
+        if (width > glyph->maxx - glyph->minx)
         {
-            if (ft2_load_glyph(vwk, font, c, glyph, (CACHED_METRICS | CACHED_BITMAP)))
-            {
-                continue;
-            }
+            width = glyph->maxx - glyph->minx;
         }
-#endif
-        current = &glyph->bitmap;
 
-        /* Do kerning, if possible AC-Patch */
-        if (use_kerning && prev_index && glyph->index)
-        {
-            FT_Vector delta;
+        width = ((width + 7) >> 3) - 1;
+        dst_inc = textbuf->wdwidth * 2 - (width + 1);
+        src_inc = current->pitch - (width + 1);
 
-            FT_Get_Kerning(face, prev_index, glyph->index, ft_kerning_default, &delta);
-            xstart += delta.x >> 6;
-        }
-        /* Compensate for wrap around bug with negative minx's */
-        if ((ch == text) && (glyph->minx < 0))
+        /* We need to OR with memory in case previous
+         * character "encroached" far into "our" space.
+         * Could be special case.
+         */
+        for (row = last_row - row; row >= 0; --row)
         {
-            xstart -= glyph->minx;
-        }
+            byte = *dst;
+            col = width;
+            do
+            {
+                unsigned long x = *src++;
 
-        {
-#if 0
-            int offset = xstart + glyph->minx;
-            short shift = offset % 8;
-            unsigned char rmask = (1 << shift) - 1;
-            unsigned char lmask = ~rmask;
-            int row, col;
+                *dst++ |= byte | (x >> shift);
+                byte = x << (8 - shift);
+            } while (--col >= 0);
 
-            /* Ensure the width of the bitmap is correct. In some cases,
-             * FreeType may report a larger bitmap than possible.
-             */
-            width = current->width;
-            if (width > glyph->maxx - glyph->minx)
-            {
-                width = glyph->maxx - glyph->minx;
-            }
+            *dst |= byte;
+            dst += dst_inc;
+            src += src_inc;
+        }
+    }
 
-            for (row = 0; row < current->rows; ++row)
-            {
-                /* Make sure we don't go either over, or under the
-                 * limit */
-                if (row + glyph->yoffset < 0)
-                {
-                    continue;
-                }
-                if (row + glyph->yoffset >= textbuf->height)
-                {
-                    continue;
-                }
+    /* Handle the underline style */
+    if (vwk->text.effects & 0x8)
+    {
+        unsigned char color = 0xff;
+        short row = ft2_underline_row(font);
 
-                dst = (unsigned char *)textbuf->address +
-                      (row + glyph->yoffset) * textbuf->wdwidth * 2 +
-                      (offset >> 3);
-                src = current->buffer + row * current->pitch;
+        dst = (unsigned char *)textbuf->address + row * textbuf->wdwidth * 2;
+        for (row = font->underline; row > 0; --row)
+        {
+            /* 1 because 0 is the bg color */
+            if (font->extra.effects & 0x2)
+                color = row & 1 ? (font->lightening & 0xff) : ~(font->lightening & 0xff);
+            memset(dst, color, textbuf->wdwidth * 2);
+            dst += textbuf->wdwidth * 2;
+        }
+    }
 
-                for (col = (width + 7) >> 3; col > 0; --col)
-                {
-                    unsigned char x = *src++;
+    ft2_layout_done();
 
-                    *dst++ |= (x & lmask) >> shift;
+    return textbuf;
+}
 
-                    /* Sanity end of buffer check */
-                    if (dst >= dst_check)
-                    {
-                        break;
-                    }
 
-                    *dst |= (x & rmask) << (8 - shift);
-                }
-            }
-#else
-            int offset = xstart + glyph->minx;
-            short shift = offset % 8;
-            int last_row;
-            unsigned long byte;
-            short row, col, width;
-            short dst_inc, src_inc;
-#if 0
-            unsigned char *src_base, *dst_base;
-#else
-#define src_base src
-#define dst_base dst
-#endif
+static long ft2_font_bytes(FontheaderListItem *item)
+{
+    glyph_cache *cache = item->font->extra.cache;
+    long bytes = sizeof(Fontheader) + sizeof(FontheaderListItem) + item->face_bytes;
 
-            row = 0;
-            src_base = current->buffer;
-            dst_base = (unsigned char *)textbuf->address + (offset >> 3);
-            if (glyph->yoffset < 0)   /* Under limit? */
-            {
-                row -= glyph->yoffset;
-                src_base += row * current->pitch;
-            } else if (glyph->yoffset)
-            {
-                dst_base += glyph->yoffset * textbuf->wdwidth * 2;
-            }
-#if 0
-            src = src_base;
-            dst = dst_base;
-#else
-#undef src_base
-#undef dst_base
-#endif
+    if (cache)
+        bytes += sizeof(glyph_cache) + cache->size * sizeof(c_glyph *) + cache->bytes;
 
-            /* Over limit? */
-            last_row = current->rows - 1;
-            if (last_row + glyph->yoffset >= textbuf->height)
-                last_row = textbuf->height - glyph->yoffset - 1;
+    return bytes;
+}
 
-            /* Ensure the width of the bitmap is correct. In some cases,
-             * FreeType may report a larger bitmap than possible.
-             */
-            width = current->width;
-            if (width > glyph->maxx - glyph->minx)
-            {
-                width = glyph->maxx - glyph->minx;
-            }
 
-            width = ((width + 7) >> 3) - 1;
-            dst_inc = textbuf->wdwidth * 2 - (width + 1);
-            src_inc = current->pitch - (width + 1);
+static void ft2_remove_fontsize(FontheaderListItem *item)
+{
+    FontheaderListItem **link;
 
-            /* We need to OR with memory in case previous
-             * character "encroached" far into "our" space.
-             * Could be special case.
-             */
-            for (row = last_row - row; row >= 0; --row)
-            {
-                byte = *dst;
-                col = width;
-                do
-                {
-                    unsigned long x = *src++;
+    link = &font_hash[FONT_HASH(item->id, item->size, item->effects)];
+    while (*link != item)
+        link = &(*link)->hash_next;
+    *link = item->hash_next;
 
-                    *dst++ |= byte | (x >> shift);
-                    byte = x << (8 - shift);
-                } while (--col >= 0);
+    listRemove((LINKABLE *) item);
+    ft2_dispose_font(item->font);
+    free(item);
+}
 
-                *dst |= byte;
-                dst += dst_inc;
-                src += src_inc;
-            }
-#endif
-        }
 
-        xstart += glyph->advance;
+/*
+ * Bring the font instances within the font_cache_size budget.
+ * The glyphs of the least recently used instances are thrown out
+ * first, and only then whole instances that no vwk refers to.
+ */
+static void ft2_trim_fontsizes(FontheaderListItem *keep)
+{
+    FontheaderListItem *x, *prev;
+    LIST *l = &fonts;
+    long total;
 
-        prev_index = glyph->index;
+    total = 0;
+    listForEach(FontheaderListItem *, x, l)
+    {
+        total += ft2_font_bytes(x);
     }
-    if (debug > 2)
+
+    for (x = (FontheaderListItem *) listLast(&fonts); x && total > font_cache_size; x = prev)
     {
-        PUTS("\n\n");
+        prev = (FontheaderListItem *) listPrev(x);
+        if (x == keep)
+            continue;
+        total -= ft2_font_bytes(x);
+        ft2_flush_cache(x->font);
+        total += ft2_font_bytes(x);
     }
-    (void) dst_check;
 
-    /* Handle the underline style */
-    if (vwk->text.effects & 0x8)
+    for (x = (FontheaderListItem *) listLast(&fonts); x && total > font_cache_size; x = prev)
     {
-        unsigned char color = 0xff;
-        short row = font->distance.ascent - font->extra.underline_offset - 1;
+        prev = (FontheaderListItem *) listPrev(x);
+        if (x == keep || x->font->extra.ref_count)
+            continue;
 
-        if (row + font->underline > textbuf->height)
-        {
-            row = (textbuf->height - 1) - font->underline;
-        }
-        dst = (unsigned char *)textbuf->address + row * textbuf->wdwidth * 2;
-        for (row = font->underline; row > 0; --row)
+        if (debug > 0)
         {
-            /* 1 because 0 is the bg color */
-            if (font->extra.effects & 0x2)
-                color = row & 1 ? (font->lightening & 0xff) : ~(font->lightening & 0xff);
-            memset(dst, color, textbuf->wdwidth * 2);
-            dst += textbuf->wdwidth * 2;
+            PRINTF(("FT2 find_font: dispose: %s size=%ld eff=%ld\n",
+                x->font->extra.filename, (long) x->size, (long) x->effects));
         }
-    }
 
-    return textbuf;
+        total -= ft2_font_bytes(x);
+        ft2_remove_fontsize(x);
+    }
 }
 
 
@@ -2243,12 +2443,14 @@ static MFDB *ft2_text_render(Virtual *vwk, Fontheader *font, const short *text,
  * Maintains LRU cache of Fontheader instances coresponding to
  * different sizes of FreeType2 fonts loaded in the beginning
  * (which are maintained in the global font list normally).
+ * Instances are found through a hash on (id, size, effects).
  **/
 static Fontheader *ft2_find_fontsize(Virtual *vwk, Fontheader *font, short ptsize)
 {
-    static short font_count = 0;
     Fontheader *f;
-    FontheaderListItem *i;
+    FontheaderListItem *i, **bucket;
+    short effects = vwk->text.effects & FT2_EFFECTS_MASK;
+    long before;
 
     if (!(font->flags & FONTF_SCALABLE))
     {
@@ -2268,25 +2470,15 @@ static Fontheader *ft2_find_fontsize(Virtual *vwk, Fontheader *font, short ptsiz
         PRINTF(("FT2 looking for cached_font: id=%ld size=%d eff=%d\n", (long) font->id, ptsize, vwk->text.effects));
     }
 
-    /* LRU: put the selected font to the front of the list */
+    bucket = &font_hash[FONT_HASH(font->id, ptsize, effects)];
+    for (i = *bucket; i; i = i->hash_next)
     {
-        LIST *l = &fonts;
-
-        listForEach(FontheaderListItem *, i, l)
+        if (i->id == font->id && i->size == ptsize && i->effects == effects)
         {
-            if (debug > 2)
-            {
-                PRINTF(("FT2 cached_font: id==%ld size=%ld eff=%d\n", (long) i->font->id, (long) i->font->size, i->font->extra.effects));
-            }
-
-            if (i->font->id == font->id &&
-                i->font->size == ptsize &&
-                i->font->extra.effects == (vwk->text.effects & FT2_EFFECTS_MASK))
-            {
-                listRemove((LINKABLE *) i);
-                listInsert(fonts.head.next, (LINKABLE *) i);
-                return i->font;
-            }
+            /* LRU: put the selected font to the front of the list */
+            listRemove((LINKABLE *) i);
+            listInsert(fonts.head.next, (LINKABLE *) i);
+            return i->font;
         }
     }
 
@@ -2295,59 +2487,454 @@ static Fontheader *ft2_find_fontsize(Virtual *vwk, Fontheader *font, short ptsiz
         PRINTF(("FT2 find_font: fetch size=%d\n", ptsize));
     }
 
-    /* FIXME: handle maximum number of fonts in the cache here (configurable) */
+    i = malloc(sizeof(FontheaderListItem));
+    if (!i)
+        return NULL;
 
-    /* BUG! Cannot dispose any Fontheader structure when held by a vwk.
-     *      Either all functions would update the current_font pointer when
-     *      called or all currently used by vwks need to stay in mem.
-     */
-    if (font_count > 10)
+    /* Create additional size/effects face */
+    before = ft_memory_used;
+    f = ft2_dup_font(vwk, font, ptsize);
+    if (!f)
     {
-        FontheaderListItem *x = (FontheaderListItem *)listLast(&fonts);
+        free(i);
+        return NULL;
+    }
 
-        /* Flush the cache anyway */
-        if (x)
-            ft2_flush_cache(x->font);
+    i->font = f;
+    i->id = font->id;
+    i->size = ptsize;
+    i->effects = effects;
+    i->face_bytes = ft_memory_used - before;
+    i->hash_next = *bucket;
+    *bucket = i;
+    listInsert(fonts.head.next, (LINKABLE *) i);
 
-        if (debug > 0)
+    ft2_trim_fontsizes(i);
+
+    return f;
+}
+
+
+/*
+ * Glyph cache files, for v_savecache/v_loadcache.
+ * All face records are tied to the identity (size and time stamp)
+ * of the font file, and the whole file to the screen pixel size.
+ * A face record with an empty filename ends the file.
+ */
+#define CACHE_FILE_MAGIC	0x66564743L	/* 'fVGC' */
+#define CACHE_FILE_VERSION	1
+#define CACHE_NAME_SIZE		256
+
+typedef struct
+{
+    long magic;
+    short version;
+    short pixel_width;
+    short pixel_height;
+    short reserved;
+} cache_file_header;
+
+typedef struct
+{
+    long file_size;
+    unsigned short file_time;
+    unsigned short file_date;
+    long glyphs;		/* Number of glyph records that follow */
+    short index;		/* Face index within the font file */
+    short size;
+    short effects;
+    short name_length;	/* Filename (padded to even length) follows */
+} cache_file_face;
+
+typedef struct
+{
+    long code;
+    unsigned long index;
+    short stored;
+    short minx;
+    short maxx;
+    short yoffset;
+    short advance;
+    short reserved;
+} cache_file_glyph;
+
+/* Follows a glyph record for each of CACHED_BITMAP and CACHED_PIXMAP stored */
+typedef struct
+{
+    short width;
+    short rows;		/* pitch * rows bytes of data follow */
+    short pitch;
+    short reserved;
+} cache_file_bitmap;
+
+
+static int ft2_file_identity(const char *filename, cache_file_face *face)
+{
+    unsigned short datime[2];
+    long handle;
+
+    if ((handle = Fopen(filename, O_RDONLY)) < 0)
+        return 0;
+    face->file_size = Fseek(0, handle, SEEK_END);
+    Fdatime(datime, handle, 0);
+    Fclose(handle);
+    face->file_time = datime[0];
+    face->file_date = datime[1];
+
+    return 1;
+}
+
+
+static int ft2_write_bitmap(long handle, FT_Bitmap *bitmap)
+{
+    cache_file_bitmap rec;
+    long length;
+
+    rec.width = bitmap->width;
+    rec.rows = bitmap->buffer ? bitmap->rows : 0;
+    rec.pitch = bitmap->pitch;
+    rec.reserved = 0;
+    length = (long) rec.pitch * rec.rows;
+
+    if (Fwrite(handle, sizeof(rec), &rec) != sizeof(rec))
+        return 0;
+    if (length && Fwrite(handle, length, bitmap->buffer) != length)
+        return 0;
+
+    return 1;
+}
+
+
+static int ft2_write_face(long handle, FontheaderListItem *item)
+{
+    Fontheader *font = item->font;
+    glyph_cache *cache = font->extra.cache;
+    cache_file_face face;
+    cache_file_glyph rec;
+    c_glyph *glyph;
+    long length;
+    int i;
+
+    if (!cache || !ft2_file_identity(font->extra.filename, &face))
+        return 1;
+
+    face.glyphs = 0;
+    for (i = 0; i < cache->size; i++)
+    {
+        if (cache->table[i] && cache->table[i]->stored)
+            face.glyphs++;
+    }
+    if (!face.glyphs)
+        return 1;
+
+    face.index = font->extra.index;
+    face.size = item->size;
+    face.effects = item->effects;
+    face.name_length = strlen(font->extra.filename);
+    length = (face.name_length + 1) & ~1;
+    if (Fwrite(handle, sizeof(face), &face) != sizeof(face) ||
+        Fwrite(handle, length, font->extra.filename) != length)
+        return 0;
+
+    for (i = 0; i < cache->size; i++)
+    {
+        glyph = cache->table[i];
+        if (!glyph || !glyph->stored)
+            continue;
+
+        rec.code = glyph->code;
+        rec.index = glyph->index;
+        rec.stored = glyph->stored;
+        rec.minx = glyph->minx;
+        rec.maxx = glyph->maxx;
+        rec.yoffset = glyph->yoffset;
+        rec.advance = glyph->advance;
+        rec.reserved = 0;
+        if (Fwrite(handle, sizeof(rec), &rec) != sizeof(rec))
+            return 0;
+        if ((glyph->stored & CACHED_BITMAP) && !ft2_write_bitmap(handle, &glyph->bitmap))
+            return 0;
+        if ((glyph->stored & CACHED_PIXMAP) && !ft2_write_bitmap(handle, &glyph->pixmap))
+            return 0;
+    }
+
+    return 1;
+}
+
+
+long ft2_savecache(Virtual *vwk, const char *filename)
+{
+    cache_file_header header;
+    cache_file_face end;
+    FontheaderListItem *i;
+    LIST *l = &fonts;
+    long handle;
+    int ok;
+
+    if ((handle = Fcreate(filename, 0)) < 0)
+        return -1;
+
+    header.magic = CACHE_FILE_MAGIC;
+    header.version = CACHE_FILE_VERSION;
+    header.pixel_width = vwk->real_address->screen.pixel.width;
+    header.pixel_height = vwk->real_address->screen.pixel.height;
+    header.reserved = 0;
+    ok = Fwrite(handle, sizeof(header), &header) == sizeof(header);
+
+    listForEach(FontheaderListItem *, i, l)
+    {
+        if (ok)
+            ok = ft2_write_face(handle, i);
+    }
+
+    memset(&end, 0, sizeof(end));
+    if (ok)
+        ok = Fwrite(handle, sizeof(end), &end) == sizeof(end);
+    Fclose(handle);
+
+    if (!ok)
+    {
+        Fdelete(filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Read a bitmap record, into the glyph if it is given.
+ * Mono bitmaps have eight pixels per byte, pixmaps one.
+ */
+static int ft2_read_bitmap(long handle, FT_Bitmap *bitmap, int mono)
+{
+    cache_file_bitmap rec;
+    unsigned char *buffer;
+    long length;
+
+    if (Fread(handle, sizeof(rec), &rec) != sizeof(rec))
+        return 0;
+    if (rec.pitch < 0 || rec.rows < 0 || rec.width < 0)
+        return 0;
+    if (rec.width > (mono ? rec.pitch * 8L : (long) rec.pitch))
+        return 0;               /* Rows too short for the width */
+    length = (long) rec.pitch * rec.rows;
+
+    if (!bitmap)
+    {
+        if (length)
+            Fseek(length, handle, SEEK_CUR);
+        return 1;
+    }
+
+    buffer = NULL;
+    if (length)
+    {
+        if ((buffer = malloc(length)) == NULL)
+            return 0;
+        if (Fread(handle, length, buffer) != length)
         {
-            PRINTF(("FT2 find_font: flush cache: %s ID=%ld refs=%ld\n",
-                x ? x->font->extra.filename : "[null]",
-                (long) (x ? x->font->id : -1),
-                (long) (x ? x->font->extra.ref_count : -1)));
+            free(buffer);
+            return 0;
         }
+    }
+    bitmap->width = rec.width;
+    bitmap->rows = rec.rows;
+    bitmap->pitch = rec.pitch;
+    bitmap->buffer = buffer;
+
+    return 1;
+}
 
-        /* Find the first one that we can dispose */
-        while (x && x->font->extra.ref_count)
-            x = (FontheaderListItem *)listPrev(x);
 
-        if (x)
+static Fontheader *ft2_find_file_font(Virtual *vwk, const char *filename, short index)
+{
+    Fontheader *font, *size;
+
+    for (font = vwk->real_address->writing.first_font; font; font = font->next)
+    {
+        for (size = font; size; size = size->extra.next_size)
         {
-            if (debug > 0)
+            if ((size->flags & FONTF_EXTERNAL) && size->extra.filename &&
+                size->extra.index == index && !strcmp(size->extra.filename, filename))
             {
-                PRINTF(("FT2 find_font: found disposable victim: %s refs=%ld\n",
-                    x->font->extra.filename,
-                    (long) x->font->extra.ref_count));
+                return size;
             }
+        }
+    }
+
+    return NULL;
+}
+
+
+static int ft2_read_face(Virtual *vwk, long handle, cache_file_face *face, const char *filename)
+{
+    cache_file_face identity;
+    cache_file_glyph rec;
+    Fontheader *font;
+    c_glyph *glyph;
+    short effects;
+    long n;
+
+    /* Only use the glyphs if the font file is still the same */
+    font = ft2_find_file_font(vwk, filename, face->index);
+    if (font && (!ft2_file_identity(filename, &identity) ||
+                 identity.file_size != face->file_size ||
+                 identity.file_time != face->file_time ||
+                 identity.file_date != face->file_date))
+    {
+        font = NULL;
+    }
+
+    if (font)
+    {
+        effects = vwk->text.effects;
+        vwk->text.effects = face->effects;
+        font = ft2_find_fontsize(vwk, font, face->size);
+        vwk->text.effects = effects;
+    }
+    if (font && !font->extra.cache)
+        font = NULL;
+
+    for (n = face->glyphs; n > 0; n--)
+    {
+        if (Fread(handle, sizeof(rec), &rec) != sizeof(rec))
+            return 0;
+
+        glyph = font ? ft2_cache_glyph(font, rec.code) : NULL;
+        if (glyph && glyph->stored)
+            glyph = NULL;		/* Already there */
+        if (glyph)
+        {
+            glyph->index = rec.index;
+            glyph->minx = rec.minx;
+            glyph->maxx = rec.maxx;
+            glyph->yoffset = rec.yoffset;
+            glyph->advance = rec.advance;
+        }
 
-            listRemove((LINKABLE *) x);
-            ft2_dispose_font(x->font); /* Remove the whole font */
-            free(x);
+        if (((rec.stored & CACHED_BITMAP) && !ft2_read_bitmap(handle, glyph ? &glyph->bitmap : NULL, 1)) ||
+            ((rec.stored & CACHED_PIXMAP) && !ft2_read_bitmap(handle, glyph ? &glyph->pixmap : NULL, 0)))
+        {
+            if (glyph)
+                ft2_evict_glyph(glyph);     /* With any bitmap already read */
+            return 0;
+        }
+
+        if (glyph)
+        {
+            glyph->stored = rec.stored & (CACHED_METRICS | CACHED_BITMAP | CACHED_PIXMAP);
+            ft2_update_glyph(glyph);
         }
-        font_count--;
     }
 
-    /* Create additional size/effects face */
-    f = ft2_dup_font(vwk, font, ptsize);
-    if (f)
+    return 1;
+}
+
+
+/*
+ * Mode 0 flushes the cache before loading, otherwise the
+ * file contents are added to what is already cached.
+ */
+long ft2_loadcache(Virtual *vwk, const char *filename, long mode)
+{
+    cache_file_header header;
+    cache_file_face face;
+    char name[CACHE_NAME_SIZE];
+    long handle, length;
+    int ok;
+
+    if ((handle = Fopen(filename, O_RDONLY)) < 0)
+        return -1;
+
+    if (Fread(handle, sizeof(header), &header) != sizeof(header) ||
+        header.magic != CACHE_FILE_MAGIC ||
+        header.version != CACHE_FILE_VERSION)
     {
-        i = malloc(sizeof(FontheaderListItem));
-        i->font = f;
-        listInsert(fonts.head.next, (LINKABLE *) i);
-        font_count++;
+        Fclose(handle);
+        return -1;
     }
 
-    return f;
+    if (!mode)
+        ft2_flushcache(vwk);
+
+    /* Glyphs rendered for another pixel size are of no use */
+    if (header.pixel_width != vwk->real_address->screen.pixel.width ||
+        header.pixel_height != vwk->real_address->screen.pixel.height)
+    {
+        Fclose(handle);
+        return 0;
+    }
+
+    ok = 1;
+    while (ok)
+    {
+        if (Fread(handle, sizeof(face), &face) != sizeof(face))
+        {
+            ok = 0;
+            break;
+        }
+        if (!face.name_length)
+            break;
+
+        length = (face.name_length + 1) & ~1;
+        if (face.name_length < 0 || length >= CACHE_NAME_SIZE || Fread(handle, length, name) != length)
+        {
+            ok = 0;
+            break;
+        }
+        name[face.name_length] = 0;
+
+        ok = ft2_read_face(vwk, handle, &face, name);
+    }
+    Fclose(handle);
+
+    return ok ? 0 : -1;
+}
+
+
+long ft2_flushcache(Virtual *vwk)
+{
+    FontheaderListItem *i;
+    LIST *l = &fonts;
+
+    (void) vwk;
+    listForEach(FontheaderListItem *, i, l)
+    {
+        ft2_flush_cache(i->font);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Which 0 is the glyph (character bitmap) cache,
+ * anything else the font size (data) cache.
+ * Returns the number of bytes left within the budget.
+ */
+long ft2_cachesize(Virtual *vwk, long which)
+{
+    FontheaderListItem *i;
+    LIST *l = &fonts;
+    long used, budget;
+
+    (void) vwk;
+    if (which == 0)
+    {
+        used = glyph_bytes;
+        budget = glyph_cache_size;
+    } else
+    {
+        used = 0;
+        listForEach(FontheaderListItem *, i, l)
+        {
+            used += ft2_font_bytes(i);
+        }
+        budget = font_cache_size;
+    }
+
+    return used < budget ? budget - used : 0;
 }
 
 
@@ -2424,29 +3011,26 @@ long ft2_text_render_default(Virtual *vwk, unsigned long coords, short *s, long
 long ft2_char_width(Virtual *vwk, Fontheader *font, long ch)
 {
     short s[] = { ch, 0 };
-    int width;
 
-    /* Get the dimensions of the text surface */
-    if (ft2_text_size(vwk, font, s, &width, NULL) < 0)
-    {
-        return 0;
-    }
-
-    return width;
+    return ft2_text_width(vwk, font, s, 1);
 }
 
 
 long ft2_text_width(Virtual *vwk, Fontheader *font, short *s, long slen)
 {
-    int width;
+    text_layout *lay;
+    long width;
 
     /* Terminate text */
     s[slen] = 0;
     /* Get the dimensions of the text surface */
-    if (ft2_text_size(vwk, font, s, &width, NULL) < 0)
+    lay = ft2_layout_text(vwk, font, s, 0);
+    if (!lay)
     {
         return 0;
     }
+    width = lay->maxx - lay->minx;
+    ft2_layout_done();
 
     return width;
 }
@@ -4,6 +4,8 @@ void ft_keep_open(void);
 
 void ft_keep_closed(void);
 
+extern long ft_memory_used;
+
 /* from engine/text.s */
 void CDECL bitmap_outline(void *src, void *dst, long pitch, long wdwidth, long lines);
 
@@ -116,6 +116,9 @@ long get_at_end(struct file_cache_entry *entry)
 }
 #endif
 
+/* Memory currently held by FreeType, used for the font cache budget */
+long ft_memory_used = 0;
+
 static char *file_cache_area = 0;
 static long file_cache_free = 0;
 static struct file_cache_entry file_cache[FC_ENTRIES];
@@ -173,10 +176,15 @@ void ft_keep_closed(void)
 /*                                                                       */
 FT_CALLBACK_DEF(void *) ft_alloc(FT_Memory memory, long size)
 {
-    void *addr = (void *) malloc(size);
+    long *addr = (long *) malloc(size + sizeof(long));
 
     FT_UNUSED(memory);
-    return addr;
+    if (!addr)
+        return NULL;
+    *addr++ = size;
+    ft_memory_used += size;
+
+    return (void *) addr;
 }
 
 
@@ -202,10 +210,18 @@ FT_CALLBACK_DEF(void *) ft_alloc(FT_Memory memory, long size)
 /*                                                                       */
 FT_CALLBACK_DEF(void *) ft_realloc(FT_Memory memory, long cur_size, long new_size, void *block)
 {
+    long *addr = &((long *) block)[-1];
+
     FT_UNUSED(memory);
     FT_UNUSED(cur_size);
 
-    return (void *) realloc(block, new_size);
+    addr = (long *) realloc(addr, new_size + sizeof(long));
+    if (!addr)
+        return NULL;
+    ft_memory_used += new_size - *addr;
+    *addr++ = new_size;
+
+    return (void *) addr;
 }
 
 
@@ -224,9 +240,12 @@ FT_CALLBACK_DEF(void *) ft_realloc(FT_Memory memory, long cur_size, long new_siz
 /*                                                                       */
 FT_CALLBACK_DEF(void) ft_free(FT_Memory memory, void *block)
 {
+    long *addr = &((long *) block)[-1];
+
     FT_UNUSED(memory);
 
-    free(block);
+    ft_memory_used -= *addr;
+    free(addr);
 }
 
 
@@ -691,5 +710,5 @@ FT_EXPORT_DEF(void) FT_Done_Memory(FT_Memory memory)
 #ifdef FT_DEBUG_MEMORY
     ft_mem_debug_done(memory);
 #endif
-    memory->free(memory, memory);
+    free(memory);       /* Not from ft_alloc */
 }
@@ -0,0 +1,647 @@
+/*
+ * fVDI host primitive benchmark
+ *
+ * Runs the engine drawing code (polygon, conic, line, bezier and
+ * default.c) together with the 16 bit driver kernels against a
+ * framebuffer in ordinary memory, and times each primitive over a
+ * set of sizes, modes and clip settings. The vr_trnfm conversions
+ * (c2p.c) are timed as well.
+ *
+ * Usage: bench [-t ms] [-W width] [-H height] [-s | -w] [primitive...]
+ *   -t  minimum time per case, in milliseconds (default 100)
+ *   -W  screen width (default 1024)
+ *   -H  screen height (default 768)
+ *   -s  also write to a shadow buffer, like FAST/BOTH on the Atari
+ *   -w  write-back, draw in the shadow only (shadow column 2);
+ *       the dirty areas are flushed once per timed round
+ * Any further arguments select which primitives to run.
+ *
+ * The output is CSV, one line per case, with a header line:
+ *   primitive,variant,size,mode,clip,shadow,iterations,ns_per_op,mpixels_per_s
+ * Pixel rates are approximate (nominal pixels per call) and
+ * zero where they would not mean much.
+ *
+ * Note that the m68k inline assembly in the kernels is replaced by
+ * plain C on the host, so the numbers are only useful for comparing
+ * algorithmic changes, not as absolute Atari figures.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fvdi.h"
+#include "function.h"
+#include "globals.h"
+#include "utility.h"
+#include "bench.h"
+
+#define MARGIN 16
+
+typedef struct Case_ {
+    const char *variant;
+    int size;
+    int mode;
+    int clip;
+} Case;
+
+typedef long (*Runner)(const Case *c, long n);
+
+static Workstation wk;
+static Virtual vwk;
+static Colour palette[256];
+static int screen_w = 1024;
+static int screen_h = 768;
+static int shadow;             /* 1 - both, 2 - write-back */
+static char linea[0x200];       /* For the mouse flag */
+static long min_ns = 100000000L;
+static char **wanted;
+static int wanted_count;
+
+static MFDB mono;               /* 1 bit source for expand */
+static MFDB coverage;           /* 8 bit source for blend */
+static short *work;             /* Point/edge work block */
+static short *trnfm_buffer[2];  /* 256x256 at up to 32 bit */
+static Driver driver;
+static Device device;           /* For the chunky/planar check */
+
+static Fgbg colour = { 0, 1 };  /* Background, foreground */
+
+
+static long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+
+static int selected(const char *name)
+{
+    int i;
+
+    if (!wanted_count)
+        return 1;
+    for(i = 0; i < wanted_count; i++) {
+        if (!strcmp(wanted[i], name))
+            return 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Clip on means a clip rectangle covering the middle of the screen,
+ * with the primitives placed so that they straddle its edges.
+ * Clip off means no clipping, with everything kept on screen.
+ */
+static void set_clip(int on)
+{
+    vwk.clip.on = on;
+    if (on) {
+        vwk.clip.rectangle.x1 = screen_w / 4;
+        vwk.clip.rectangle.y1 = screen_h / 4;
+        vwk.clip.rectangle.x2 = screen_w * 3 / 4 - 1;
+        vwk.clip.rectangle.y2 = screen_h * 3 / 4 - 1;
+    } else {
+        vwk.clip.rectangle.x1 = 0;
+        vwk.clip.rectangle.y1 = 0;
+        vwk.clip.rectangle.x2 = screen_w - 1;
+        vwk.clip.rectangle.y2 = screen_h - 1;
+    }
+}
+
+
+/*
+ * Top left corner for the i:th repetition of something of the given size.
+ * Without clipping, nothing may go outside the screen, and wide lines
+ * reach a bit beyond their coordinates.
+ */
+static void place(const Case *c, long i, int w, int h, int *x, int *y)
+{
+    if (c->clip) {
+        *x = vwk.clip.rectangle.x1 - w / 2 + (int)(i * 7 % (screen_w / 2));
+        *y = vwk.clip.rectangle.y1 - h / 2 + (int)(i * 5 % (screen_h / 2));
+    } else {
+        *x = MARGIN + (int)(i * 7 % (screen_w - 2 * MARGIN - w + 1));
+        *y = MARGIN + (int)(i * 5 % (screen_h - 2 * MARGIN - h + 1));
+    }
+}
+
+
+static short *fill_pattern(const Case *c)
+{
+    if (!strcmp(c->variant, "solid"))
+        return solid;
+
+    return pattern_ptrs[2] + 3 * 16;        /* Pattern style 4 */
+}
+
+
+static long run_fill(const Case *c, long n)
+{
+    short *pattern = fill_pattern(c);
+    int x, y;
+    long i;
+
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        fill_rect(&vwk, x, y, x + c->size - 1, y + c->size - 1, colour, pattern, c->mode, 0x20004L);
+    }
+
+    return (long)c->size * c->size;
+}
+
+
+static long run_expand(const Case *c, long n)
+{
+    int x, y;
+    long i;
+
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        c_expand_area(&vwk, &mono, i & 15, 0, 0, x, y, c->size, c->size, c->mode, fgbg_colour(colour));
+    }
+
+    return (long)c->size * c->size;
+}
+
+
+static long run_blend(const Case *c, long n)
+{
+    int x, y;
+    long i;
+
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        c_blend_area(&vwk, &coverage, i & 15, 0, x, y, c->size, c->size, c->mode, fgbg_colour(colour));
+    }
+
+    return (long)c->size * c->size;
+}
+
+
+/*
+ * "down" copies to a lower position, "up" to a higher one and
+ * "pan" sideways to the right (the backwards case).
+ */
+static long run_blit(const Case *c, long n)
+{
+    int x, y, dx, dy;
+    long i;
+
+    dx = dy = 0;
+    if (!strcmp(c->variant, "down"))
+        dy = 3;
+    else if (!strcmp(c->variant, "up"))
+        dy = -3;
+    else
+        dx = 3;
+
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size + 3, c->size + 3, &x, &y);
+        c_blit_area(&vwk, 0, x + (dx < 0 ? 3 : 0), y + (dy < 0 ? 3 : 0),
+                    0, x + (dx > 0 ? dx : 0), y + (dy > 0 ? dy : 0), c->size, c->size, c->mode);
+    }
+
+    return (long)c->size * c->size;
+}
+
+
+static long run_line(const Case *c, long n)
+{
+    long dx, dy;
+    int x, y;
+    long i;
+
+    dx = dy = c->size - 1;
+    if (!strcmp(c->variant, "horizontal"))
+        dy = 0;
+    else if (!strcmp(c->variant, "vertical"))
+        dx = 0;
+    else if (!strcmp(c->variant, "shallow"))
+        dy /= 3;
+
+    for(i = 0; i < n; i++) {
+        place(c, i, (int)dx + 1, (int)dy + 1, &x, &y);
+        c_line_draw(&vwk, x, y, x + dx, y + dy, 0xffff, fgbg_colour(colour), c->mode);
+    }
+
+    return c->size;
+}
+
+
+/*
+ * Zig-zag through a square of the given size.
+ */
+static void make_zigzag(short *pts, int count, int size, int x, int y)
+{
+    int i;
+
+    for(i = 0; i < count; i++) {
+        pts[i * 2] = x + (int)((long)i * (size - 1) / (count - 1));
+        pts[i * 2 + 1] = y + ((i & 1) ? size - 1 : 0);
+    }
+}
+
+
+static long run_pline(const Case *c, long n)
+{
+    short pts[2 * 64];
+    int count = 64;
+    int x, y;
+    long i;
+
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        make_zigzag(pts, count, c->size, x, y);
+        c_pline(&vwk, count, colour, pts);
+    }
+
+    return 0;
+}
+
+
+static long run_wide(const Case *c, long n)
+{
+    short pts[2 * 8];
+    int x, y;
+    long i;
+
+    vwk.line.width = c->mode;
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        make_zigzag(pts, 8, c->size, x, y);
+        c_pline(&vwk, 8, colour, pts);
+    }
+    vwk.line.width = 1;
+
+    return 0;
+}
+
+
+/*
+ * Star polygon with mode points, on a circle of the given size.
+ * The "spans" variant goes through the engine span table
+ * instead of the driver polygon routine.
+ */
+static long run_poly(const Case *c, long n)
+{
+    short pts[2 * 256];
+    int count = c->mode * 2;
+    int spans = !strcmp(c->variant, "star-spans");
+    int r, x, y, j;
+    long i;
+
+    r = c->size / 2;
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        for(j = 0; j < count; j++) {
+            int a = (int)(3600L * j / count);
+            int rad = (j & 1) ? r / 3 : r;
+            pts[j * 2] = x + r + (short)((long)Icos(a) * rad / 32767);
+            pts[j * 2 + 1] = y + r - (short)((long)Isin(a) * rad / 32767);
+        }
+        if (spans)
+            filled_poly(&vwk, (short (*)[2])pts, count, colour, solid, work, 1, 0x10001L);
+        else
+            fill_poly(&vwk, pts, count, colour, solid, work, 1, 0x10001L);
+    }
+
+    return 0;
+}
+
+
+static long run_ellipse(const Case *c, long n)
+{
+    int r, x, y;
+    long i;
+
+    r = c->size / 2;
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        ellipsearc(&vwk, c->mode, x + r, y + r, r, r * 3 / 4, 0, 3600);
+    }
+
+    return 0;
+}
+
+
+static long run_bezier(const Case *c, long n)
+{
+    short pts[2 * 7];
+    char marks[8];
+    short extent[4], totpoints, totmoves;
+    struct v_bez_pars par;
+    int x, y, s;
+    long i;
+
+    memset(marks, 0, sizeof(marks));
+    marks[0 ^ 1] = 1;           /* Byte swapped, like the VDI array */
+    marks[3 ^ 1] = 1;
+    s = c->size - 1;
+    par.num_pts = 7;
+    par.points = pts;
+    par.bezarr = marks;
+    par.extent = extent;
+    par.totpoints = &totpoints;
+    par.totmoves = &totmoves;
+
+    for(i = 0; i < n; i++) {
+        place(c, i, c->size, c->size, &x, &y);
+        pts[0] = x;          pts[1] = y + s;
+        pts[2] = x;          pts[3] = y;
+        pts[4] = x + s / 2;  pts[5] = y;
+        pts[6] = x + s / 2;  pts[7] = y + s / 2;
+        pts[8] = x + s / 2;  pts[9] = y + s;
+        pts[10] = x + s;     pts[11] = y + s;
+        pts[12] = x + s;     pts[13] = y;
+        totmoves = 0;
+        lib_v_bez(&vwk, &par);
+    }
+
+    return 0;
+}
+
+
+/*
+ * vr_trnfm of a size x size image with mode bitplanes, alternately
+ * to and from standard format. The in-place variants convert back
+ * and forth within the same buffer.
+ */
+static long run_trnfm(const Case *c, long n)
+{
+    MFDB src, dst, tmp;
+    long i;
+
+    device.format = strncmp(c->variant, "chunky", 6) ? 0 : 2;
+    src.address = trnfm_buffer[0];
+    src.width = c->size;
+    src.height = c->size;
+    src.wdwidth = c->size / 16;
+    src.standard = 1;
+    src.bitplanes = c->mode;
+    dst = src;
+    if (!strstr(c->variant, "in-place"))
+        dst.address = trnfm_buffer[1];
+
+    for(i = 0; i < n; i++) {
+        c2p_trnfm(&vwk, &src, &dst);
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    return (long)c->size * c->size;
+}
+
+
+/*
+ * Double the iteration count until the minimum time is reached,
+ * then report the last round.
+ */
+static void measure(const char *name, Runner run, const Case *c)
+{
+    long n, start, elapsed, pixels;
+
+    if (!selected(name))
+        return;
+
+    set_clip(c->clip);
+    for(n = 1; ; n *= 2) {
+        start = now_ns();
+        pixels = run(c, n);
+        if (shadow == 2)
+            bench_flush();
+        elapsed = now_ns() - start;
+        if (elapsed >= min_ns)
+            break;
+    }
+
+    printf("%s,%s,%d,%d,%d,%d,%ld,%.1f,%.2f\n", name, c->variant, c->size, c->mode, c->clip, shadow,
+           n, (double)elapsed / n, (double)pixels * n * 1000.0 / elapsed);
+    fflush(stdout);
+}
+
+
+static void setup(void)
+{
+    unsigned short requested[256 * 3];
+    unsigned char *cov;
+    short *bits;
+    int i;
+
+    wk.screen.mfdb.address = calloc((long)screen_w * screen_h, 2);
+    wk.screen.mfdb.width = screen_w;
+    wk.screen.mfdb.height = screen_h;
+    wk.screen.mfdb.wdwidth = (screen_w + 15) / 16;
+    wk.screen.mfdb.standard = 0;
+    wk.screen.mfdb.bitplanes = 16;
+    wk.screen.wrap = screen_w * 2;
+    wk.screen.palette.size = 256;
+    wk.screen.palette.colours = palette;
+    wk.screen.pixel.width = 278;
+    wk.screen.pixel.height = 278;
+    wk.drawing.bezier.depth_scale.min = 9;
+    if (shadow) {
+        wk.screen.shadow.buffer = calloc((long)screen_w * screen_h, 2);
+        wk.screen.shadow.address = wk.screen.shadow.buffer;
+        wk.screen.shadow.wrap = wk.screen.wrap;
+    }
+    if (shadow == 2) {
+        wk.screen.linea = linea + sizeof(linea);
+        bench_writeback(&wk, wk.screen.mfdb.address);
+        wk.screen.mfdb.address = wk.screen.shadow.address;
+        wk.screen.shadow.address = 0;
+    }
+
+    vwk.real_address = &wk;
+    vwk.mode = 1;
+    vwk.line.width = 1;
+    vwk.line.type = 1;
+    vwk.line.colour = colour;
+    vwk.fill.interior = 1;
+    vwk.fill.style = 1;
+    vwk.fill.colour = colour;
+    vwk.fill.perimeter = 1;
+    vwk.bezier.depth_scale = 0;
+
+    for(i = 0; i < 256; i++) {
+        requested[i * 3 + 0] = (i * 37) % 1001;
+        requested[i * 3 + 1] = (i * 91) % 1001;
+        requested[i * 3 + 2] = (i * 13) % 1001;
+    }
+    requested[0] = requested[1] = requested[2] = 1000;     /* White and black */
+    requested[3] = requested[4] = requested[5] = 0;
+    c_set_colours(&vwk, 0, 256, requested, palette);
+
+    bits = malloc(64 * 2 * 512);
+    for(i = 0; i < 64 * 512; i++)
+        bits[i] = (short)((unsigned int)i * 0x9e37u + 0x55aau);
+    mono.address = bits;
+    mono.width = 64 * 16;
+    mono.height = 512;
+    mono.wdwidth = 64;
+    mono.bitplanes = 1;
+
+    cov = malloc(1024 * 512);
+    for(i = 0; i < 1024 * 512; i++)
+        cov[i] = (unsigned char)((i % 3) ? i * 7 : 0);
+    coverage.address = (short *)cov;
+    coverage.width = 1024;
+    coverage.height = 512;
+    coverage.wdwidth = 1024 / 2;
+    coverage.bitplanes = 8;
+
+    work = (short *)allocate_block(0);
+
+    wk.driver = &driver;
+    driver.device = &device;
+    for(i = 0; i < 2; i++)
+        trnfm_buffer[i] = malloc(256 * 256 * 4);
+    for(i = 0; i < 256 * 256 * 2; i++)
+        trnfm_buffer[0][i] = (short)((unsigned int)i * 0x9e37u + 0x55aau);
+}
+
+
+int main(int argc, char **argv)
+{
+    static const char *fills[] = { "solid", "pattern" };
+    static const char *blits[] = { "down", "up", "pan" };
+    static const char *lines[] = { "horizontal", "vertical", "diagonal", "shallow" };
+    static const int sizes[] = { 8, 64, 256 };
+    static const int blit_ops[] = { 3, 7, 6, 12 };
+    static const char *trnfms[] = { "planar", "planar-in-place", "chunky", "chunky-in-place" };
+    static const int trnfm_planes[] = { 4, 8, 16, 32 };
+    Case c;
+    int i, j, k, clip;
+
+    for(i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "-s"))
+            shadow = 1;
+        else if (!strcmp(argv[i], "-w"))
+            shadow = 2;
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            min_ns = atol(argv[++i]) * 1000000L;
+        else if (!strcmp(argv[i], "-W") && i + 1 < argc)
+            screen_w = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-H") && i + 1 < argc)
+            screen_h = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-t ms] [-W width] [-H height] [-s | -w] [primitive...]\n", argv[0]);
+            return 1;
+        }
+    }
+    wanted = &argv[i];
+    wanted_count = argc - i;
+    if (screen_w < 512 || screen_h < 384 || screen_w > 8192) {
+        fprintf(stderr, "Screen must be between 512x384 and 8192 wide\n");
+        return 1;
+    }
+
+    setup();
+
+    printf("primitive,variant,size,mode,clip,shadow,iterations,ns_per_op,mpixels_per_s\n");
+
+    for(clip = 0; clip < 2; clip++) {
+        for(i = 0; i < 2; i++) {
+            for(j = 0; j < 3; j++) {
+                for(k = 1; k <= 4; k++) {
+                    c.variant = fills[i];
+                    c.size = sizes[j];
+                    c.mode = k;
+                    c.clip = clip;
+                    measure("fill", run_fill, &c);
+                }
+            }
+        }
+    }
+
+    for(j = 0; j < 3; j++) {
+        for(k = 1; k <= 4; k++) {
+            c.variant = "mono";
+            c.size = sizes[j];
+            c.mode = k;
+            c.clip = 0;
+            measure("expand", run_expand, &c);
+            c.variant = "coverage";
+            if (k != 4)
+                measure("blend", run_blend, &c);
+        }
+    }
+
+    for(i = 0; i < 3; i++) {
+        for(j = 0; j < 3; j++) {
+            for(k = 0; k < 4; k++) {
+                c.variant = blits[i];
+                c.size = sizes[j];
+                c.mode = blit_ops[k];
+                c.clip = 0;
+                measure("blit", run_blit, &c);
+            }
+        }
+    }
+
+    for(clip = 0; clip < 2; clip++) {
+        for(i = 0; i < 4; i++) {
+            for(j = 1; j < 3; j++) {
+                for(k = 1; k <= 3; k += 2) {
+                    c.variant = lines[i];
+                    c.size = sizes[j];
+                    c.mode = k;
+                    c.clip = clip;
+                    measure("line", run_line, &c);
+                }
+            }
+        }
+        for(j = 1; j < 3; j++) {
+            c.variant = "zigzag";
+            c.size = sizes[j];
+            c.mode = 64;
+            c.clip = clip;
+            measure("pline", run_pline, &c);
+            for(k = 3; k <= 15; k += 6) {
+                c.variant = "zigzag";
+                c.mode = k;
+                measure("wideline", run_wide, &c);
+            }
+            for(k = 5; k <= 80; k *= 4) {
+                c.variant = "star";
+                c.mode = k;
+                measure("polygon", run_poly, &c);
+                c.variant = "star-spans";
+                measure("polygon", run_poly, &c);
+            }
+            c.variant = "filled";
+            c.mode = 5;
+            measure("ellipse", run_ellipse, &c);
+            c.variant = "arc";
+            c.mode = 6;
+            measure("ellipse", run_ellipse, &c);
+            c.variant = "s-curve";
+            c.mode = 0;
+            measure("bezier", run_bezier, &c);
+        }
+    }
+
+    for(i = 0; i < 4; i++) {
+        for(j = 1; j < 3; j++) {
+            for(k = 0; k < 3; k++) {
+                c.variant = trnfms[i];
+                c.size = sizes[j];
+                c.mode = (i < 2) ? trnfm_planes[k] : trnfm_planes[k + 1];
+                c.clip = 0;
+                if ((i >= 2) || (k < 2))
+                    measure("trnfm", run_trnfm, &c);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * fVDI host benchmark declarations
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+
+/* 16 bit driver kernels (kernels.c) */
+long CDECL c_fill_area(Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style);
+long CDECL c_fill_poly(Virtual *vwk, short points[], long n, short index[], long moves, short *pattern, long colour, long mode, long interior_style);
+long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation, long colour);
+long CDECL c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+long CDECL c_blend_area(Virtual *vwk, MFDB *src, long src_x, long src_y, long dst_x, long dst_y, long w, long h, long mode, long colour);
+long CDECL c_line_draw(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+void CDECL c_set_colours(Virtual *vwk, long start, long entries, unsigned short *requested, Colour palette[]);
+void bench_writeback(Workstation *wk, short *video);
+void bench_flush(void);
+long CDECL clip_line(Virtual *vwk, long *x1, long *y1, long *x2, long *y2);
+
+/* Engine functions without a shared prototype */
+void ellipsearc(Virtual *vwk, long gdp_code, long xc, long yc, long xrad, long yrad, long beg_ang, long end_ang);
+void rounded_box(Virtual *vwk, long gdp_code, short *coords);
+void CDECL retry_line(Virtual *vwk, DrvLine *pars);
+void CDECL c2p_trnfm(Virtual *vwk, MFDB *src, MFDB *dst);
+
+/* host.c */
+long fgbg_colour(Fgbg colour);
+
+#endif
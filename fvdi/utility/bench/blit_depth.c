@@ -0,0 +1,45 @@
+/*
+ * The 16 bit driver blit, built for the host with DEPTH
+ * (given on the command line) bits per pixel, as
+ * c_blit_area_8, c_blit_area_16 or c_blit_area_32.
+ * Only check_blit uses these.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+
+#define FAST		/* Write in FastRAM buffer */
+#define BOTH		/* Write in both FastRAM and on screen */
+#define PIXEL_32 int	/* Pixel pairs, long is too wide on most hosts */
+
+#define BLIT_NAME2(depth)   c_blit_area_ ## depth
+#define BLIT_NAME(depth)    BLIT_NAME2(depth)
+
+#define c_blit_area     BLIT_NAME(DEPTH)
+
+/* No mouse or write-back here */
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2);
+static void dirty_mark(long x1, long y1, long x2, long y2);
+
+#include "../../drivers/16_bit/16b_blit.c"
+
+
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2)
+{
+    (void) wk;
+    (void) x1;
+    (void) y1;
+    (void) x2;
+    (void) y2;
+}
+
+
+static void dirty_mark(long x1, long y1, long x2, long y2)
+{
+    (void) x1;
+    (void) y1;
+    (void) x2;
+    (void) y2;
+}
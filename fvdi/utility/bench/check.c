@@ -0,0 +1,64 @@
+/*
+ * fVDI host check support
+ *
+ * Random numbers (the same sequence every run) and failure counting.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "check.h"
+
+#define MAX_REPORTS 10
+
+static unsigned long seed = 12345;
+static long failures;
+
+
+unsigned long check_random(void)
+{
+    seed = (seed * 1103515245UL + 12345) & 0xffffffffUL;
+
+    return (seed >> 8) & 0xffffff;
+}
+
+
+/*
+ * Random number from low to high, inclusive.
+ */
+long check_range(long low, long high)
+{
+    return low + (long)(check_random() % (unsigned long)(high - low + 1));
+}
+
+
+void check_failed(const char *what, const char *fmt, ...)
+{
+    va_list args;
+
+    if (failures++ < MAX_REPORTS) {
+        va_start(args, fmt);
+        printf("%s: ", what);
+        vprintf(fmt, args);
+        printf("\n");
+        va_end(args);
+    }
+}
+
+
+/*
+ * Report the result, returns the exit status for main().
+ */
+int check_done(const char *what)
+{
+    if (failures) {
+        printf("%s: %ld failures\n", what, failures);
+        return 1;
+    }
+    printf("%s: ok\n", what);
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+/*
+ * fVDI host check declarations
+ *
+ * The check programs run new drawing code against a reference
+ * (usually the code it replaced) on random input, and report
+ * any difference. They are run by 'make check'.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+
+/* Reference implementations */
+void ref_filled_poly(Virtual *vwk, short p[][2], long n, Fgbg colour,
+    short *pattern, short *points, long mode, long interior_style);
+void ref_filled_poly_m(Virtual *vwk, short p[][2], long n, Fgbg colour,
+    short *pattern, short *points, short index[], long moves, long mode, long interior_style);
+
+/* blit_depth.c, built for each pixel size */
+long CDECL c_blit_area_8(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+long CDECL c_blit_area_16(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+long CDECL c_blit_area_32(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+
+/* fill_depth.c, built for each pixel size */
+long CDECL c_fill_poly_8(Virtual *vwk, short points[], long n, short index[], long moves,
+    short *pattern, long colour, long mode, long interior_style);
+long CDECL c_fill_poly_16(Virtual *vwk, short points[], long n, short index[], long moves,
+    short *pattern, long colour, long mode, long interior_style);
+long CDECL c_fill_poly_32(Virtual *vwk, short points[], long n, short index[], long moves,
+    short *pattern, long colour, long mode, long interior_style);
+
+/* line_depth.c, built for each pixel size */
+long CDECL c_line_draw_8(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+long CDECL c_line_draw_16(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+long CDECL c_line_draw_32(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+long CDECL ref_line_draw_8(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+long CDECL ref_line_draw_16(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+long CDECL ref_line_draw_32(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+
+/* check.c */
+unsigned long check_random(void);
+long check_range(long low, long high);
+void check_failed(const char *what, const char *fmt, ...);
+int check_done(const char *what);
+
+#endif
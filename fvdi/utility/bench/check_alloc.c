@@ -0,0 +1,314 @@
+/*
+ * Internal memory pool check
+ *
+ * Replays an allocation trace (alloc.trc by default) against the
+ * arena allocator in engine/memory.c, a few times over, the way
+ * malloc/realloc/free in engine/utility.c use it. After every
+ * operation the arenas and free lists must pass arena_check(), and
+ * the block and byte counts must match what the trace has live.
+ * Block contents are checked when freed. After each replay nothing
+ * may be left in use, every arena must be a single free block again,
+ * and later replays must not need more arenas than the first.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "fvdi.h"
+#include "relocate.h"
+#include "utility.h"
+#include "check.h"
+
+#define MAX_OPS   4096
+#define MAX_IDS   1024
+#define REPLAYS   4
+
+static const char *what = "alloc";
+
+typedef struct {
+    char op;
+    int id;
+    long size;
+} Op;
+
+static Op ops[MAX_OPS];
+static int op_count;
+
+static struct {
+    char *addr;
+    long size;
+    int os;                 /* Not from an arena */
+} live[MAX_IDS];
+
+static long live_blocks, live_bytes, peak_used, arena_capacity;
+
+
+/* What the allocator expects from the rest of fVDI */
+
+short debug = 0;
+char silentx[1] = { 0 };
+
+static long CDECL host_puts(const char *text)
+{
+    return fputs(text, stdout);
+}
+
+static Access host_access = {
+    .funcs = {
+        .puts = host_puts
+    }
+};
+Access *access = &host_access;
+
+
+long DRIVER_EXPORT kprintf(const char *format, ...)
+{
+    va_list args;
+    long ret;
+
+    va_start(args, format);
+    ret = vprintf(format, args);
+    va_end(args);
+
+    return ret;
+}
+
+
+void *fmalloc(long size, long type)
+{
+    (void) type;
+    return malloc(size);
+}
+
+
+static int read_trace(const char *name)
+{
+    FILE *file;
+    char line[128];
+    Op *op;
+
+    if (!(file = fopen(name, "r"))) {
+        printf("%s: can't open %s\n", what, name);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        op = &ops[op_count];
+        op->size = 0;
+        if ((op_count == MAX_OPS) ||
+            (sscanf(line, "%c %d %ld", &op->op, &op->id, &op->size) < 2) ||
+            !strchr("mrf", op->op) || (op->id < 0) || (op->id >= MAX_IDS)) {
+            printf("%s: bad trace line: %s", what, line);
+            fclose(file);
+            return 0;
+        }
+        op_count++;
+    }
+    fclose(file);
+
+    return 1;
+}
+
+
+static void fill(int id)
+{
+    memset(live[id].addr, id & 0xff, live[id].size);
+}
+
+
+static void verify(int id, long size)
+{
+    long i;
+
+    for (i = 0; i < size; i++) {
+        if ((unsigned char)live[id].addr[i] != (id & 0xff)) {
+            check_failed(what, "block %d overwritten at offset %ld", id, i);
+            return;
+        }
+    }
+}
+
+
+/*
+ * As malloc in engine/utility.c
+ */
+static void take(int id, long size)
+{
+    Arena_usage usage;
+
+    if (live[id].addr)
+        check_failed(what, "block %d allocated twice", id);
+
+    if ((live[id].addr = arena_malloc(size)) != NULL) {
+        live[id].os = 0;
+        live_blocks++;
+        live_bytes += size;
+        arena_usage(&usage);            /* realloc peaks before the free */
+        if (usage.used > peak_used)
+            peak_used = usage.used;
+    } else {
+        if (size < 15 * 1024L - 64)        /* Should fit in an arena */
+            check_failed(what, "no block of %ld bytes", size);
+        live[id].addr = malloc(size);
+        live[id].os = 1;
+    }
+    live[id].size = size;
+    fill(id);
+}
+
+
+/*
+ * As free in engine/utility.c
+ */
+static void release(int id)
+{
+    verify(id, live[id].size);
+    if (live[id].os)
+        free(live[id].addr);
+    else {
+        if (arena_requested(live[id].addr) != live[id].size)
+            check_failed(what, "block %d says %ld bytes, not %ld", id,
+                arena_requested(live[id].addr), live[id].size);
+        arena_free(live[id].addr);
+        live_blocks--;
+        live_bytes -= live[id].size;
+    }
+    live[id].addr = 0;
+}
+
+
+/*
+ * As realloc in engine/utility.c
+ */
+static void resize(int id, long size)
+{
+    char *old;
+    long old_size;
+    int old_os;
+
+    old = live[id].addr;
+    old_size = live[id].size;
+    old_os = live[id].os;
+    verify(id, old_size);
+
+    live[id].addr = 0;
+    take(id, size);
+    memcpy(live[id].addr, old, old_size < size ? old_size : size);
+    if (old_os)
+        free(old);
+    else {
+        arena_free(old);
+        live_blocks--;
+        live_bytes -= old_size;
+    }
+}
+
+
+static void check_state(int n)
+{
+    Arena_usage usage;
+
+    if (arena_check())
+        check_failed(what, "inconsistent after operation %d", n);
+
+    arena_usage(&usage);
+    if (usage.blocks != live_blocks || usage.requested != live_bytes)
+        check_failed(what, "%ld blocks of %ld bytes after operation %d, not %ld of %ld",
+            usage.blocks, usage.requested, n, live_blocks, live_bytes);
+    if (usage.used > peak_used)
+        peak_used = usage.used;
+    if (usage.high_water != peak_used)
+        check_failed(what, "high water %ld after operation %d, not %ld", usage.high_water, n, peak_used);
+    if (!arena_capacity && usage.arenas)
+        arena_capacity = (usage.used + usage.free) / usage.arenas;
+    if (usage.used + usage.free != usage.arenas * arena_capacity)
+        check_failed(what, "%ld+%ld bytes in %ld arenas after operation %d",
+            usage.used, usage.free, usage.arenas, n);
+    if (usage.free && usage.largest > usage.free)
+        check_failed(what, "largest free block %ld of %ld after operation %d", usage.largest, usage.free, n);
+}
+
+
+static void replay(int round, long *arenas)
+{
+    Arena_usage usage;
+    long fragmentation, worst;
+    int i;
+
+    worst = 0;
+    for (i = 0; i < op_count; i++) {
+        switch (ops[i].op) {
+        case 'm':
+            take(ops[i].id, ops[i].size);
+            break;
+        case 'r':
+            if (live[ops[i].id].addr)
+                resize(ops[i].id, ops[i].size);
+            else
+                take(ops[i].id, ops[i].size);
+            break;
+        case 'f':
+            if (live[ops[i].id].addr)
+                release(ops[i].id);
+            else
+                check_failed(what, "block %d freed but not allocated", ops[i].id);
+            break;
+        }
+        check_state(i);
+
+        arena_usage(&usage);
+        fragmentation = usage.free ? 1000 - (usage.largest * 1000) / usage.free : 0;
+        if (fragmentation > worst)
+            worst = fragmentation;
+    }
+
+    /* Whatever the trace left, in random order */
+    for (i = 0; i < MAX_IDS; i++) {
+        int id = (int)(check_random() % MAX_IDS);
+
+        if (live[id].addr)
+            release(id);
+    }
+    for (i = 0; i < MAX_IDS; i++) {
+        if (live[i].addr)
+            release(i);
+    }
+    check_state(op_count);
+
+    arena_usage(&usage);
+    printf("%s: replay %d, %ld arenas, high water %ld, worst fragmentation %ld.%ld%%\n",
+        what, round + 1, usage.arenas, usage.high_water, worst / 10, worst % 10);
+
+    if (usage.blocks || usage.used || usage.requested)
+        check_failed(what, "%ld blocks of %ld bytes left after replay %d",
+            usage.blocks, usage.used, round + 1);
+    if (usage.free != usage.arenas * usage.largest)
+        check_failed(what, "free memory not coalesced after replay %d (%ld, largest %ld)",
+            round + 1, usage.free, usage.largest);
+    if (!round)
+        *arenas = usage.arenas;
+    else if (usage.arenas != *arenas)
+        check_failed(what, "replay %d needed %ld arenas, the first %ld",
+            round + 1, usage.arenas, *arenas);
+}
+
+
+int main(int argc, char **argv)
+{
+    long arenas = 0;
+    int round;
+
+    if (!read_trace(argc > 1 ? argv[1] : "alloc.trc"))
+        return 1;
+
+    for (round = 0; round < REPLAYS; round++)
+        replay(round, &arenas);
+
+    return check_done(what);
+}
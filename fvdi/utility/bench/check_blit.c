@@ -0,0 +1,227 @@
+/*
+ * Blit check
+ *
+ * Compares c_blit_area from drivers/16_bit/16b_blit.c, built for 8,
+ * 16 and 32 bit pixels (blit_depth.c), with a plain pixel by pixel
+ * reference, for all 16 operations. Random rectangles are blitted
+ * on the screen (with and without a shadow buffer) and to and from
+ * a memory bitmap, often overlapping in every direction, at any
+ * alignment. Everything outside the destination rectangle must be
+ * left alone.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fvdi.h"
+#include "check.h"
+
+#define SCREEN_W    70          /* Lines of 8 bit pixels are not long aligned */
+#define SCREEN_H    24
+#define MEMORY_W    80          /* Whole words for the MFDB */
+#define MEMORY_H    24
+#define ROUNDS      60000
+
+#define BYTES(w, h) ((w) * (h) * 4 + 16)    /* Room for 32 bit pixels, and some more */
+
+static const char *what = "blit";
+
+typedef long CDECL (*Blit_area)(Virtual *vwk, MFDB *src, long src_x, long src_y,
+                                MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+
+static struct {
+    int depth;
+    Blit_area blit;
+} depths[] = {
+    { 8, c_blit_area_8 },
+    { 16, c_blit_area_16 },
+    { 32, c_blit_area_32 }
+};
+
+/* Actual and expected contents */
+static unsigned int screen[2][BYTES(SCREEN_W, SCREEN_H) / 4];
+static unsigned int shadow[2][BYTES(SCREEN_W, SCREEN_H) / 4];
+static unsigned int memory[2][BYTES(MEMORY_W, MEMORY_H) / 4];
+
+typedef struct {
+    unsigned char *data[2];
+    int w, h;
+    long wrap;
+} Surface;
+
+
+static void randomize(unsigned int *data, long n)
+{
+    for(; n > 0; n--)
+        *data++ = (unsigned int)((check_random() << 8) ^ check_random());
+}
+
+
+/*
+ * Each destination bit from the source and destination bits,
+ * as the operation number says (bit 3 for neither set, bit 0 for both).
+ */
+static unsigned char operate(long operation, unsigned char s, unsigned char d)
+{
+    unsigned char result = 0;
+
+    if (operation & 1)
+        result |= s & d;
+    if (operation & 2)
+        result |= s & ~d;
+    if (operation & 4)
+        result |= ~s & d;
+    if (operation & 8)
+        result |= ~s & ~d;
+
+    return result;
+}
+
+
+static void reference(Surface *src, long src_x, long src_y, Surface *dst, long dst_x, long dst_y,
+                      long w, long h, long operation, int pixel_size)
+{
+    static unsigned char copy[BYTES(MEMORY_W, MEMORY_H)];
+    unsigned char *line, *out;
+    long bytes, x, y;
+
+    bytes = w * pixel_size;
+    for(y = 0; y < h; y++)          /* Source first, it may overlap */
+        memcpy(&copy[y * bytes], src->data[1] + (src_y + y) * src->wrap + src_x * pixel_size, bytes);
+
+    for(y = 0; y < h; y++) {
+        line = &copy[y * bytes];
+        out = dst->data[1] + (dst_y + y) * dst->wrap + dst_x * pixel_size;
+        for(x = 0; x < bytes; x++)
+            out[x] = operate(operation, line[x], out[x]);
+    }
+}
+
+
+/*
+ * A rectangle that fits both surfaces, and usually overlaps
+ * itself on the same surface.
+ */
+static void place(Surface *src, Surface *dst, long *src_x, long *src_y, long *dst_x, long *dst_y, long *w, long *h)
+{
+    int min_w, min_h;
+
+    min_w = src->w < dst->w ? src->w : dst->w;
+    min_h = src->h < dst->h ? src->h : dst->h;
+    *w = check_range(1, check_range(0, 3) ? 24 : min_w);
+    *h = check_range(1, check_range(0, 3) ? 6 : min_h);
+    *src_x = check_range(0, src->w - *w);
+    *src_y = check_range(0, src->h - *h);
+
+    if ((src == dst) && check_range(0, 3)) {
+        *dst_x = *src_x + check_range(-9, 9);
+        *dst_y = *src_y + (check_range(0, 2) ? 0 : check_range(-2, 2));
+        if (*dst_x < 0)
+            *dst_x = 0;
+        if (*dst_x > dst->w - *w)
+            *dst_x = dst->w - *w;
+        if (*dst_y < 0)
+            *dst_y = 0;
+        if (*dst_y > dst->h - *h)
+            *dst_y = dst->h - *h;
+    } else {
+        *dst_x = check_range(0, dst->w - *w);
+        *dst_y = check_range(0, dst->h - *h);
+    }
+}
+
+
+static void compare(const char *name, const void *actual, const void *expected, long n, const char *blit)
+{
+    if (memcmp(actual, expected, n))
+        check_failed(what, "%s differs after %s", name, blit);
+}
+
+
+int main(void)
+{
+    Workstation wk;
+    Virtual vwk;
+    MFDB mfdb, *src_mfdb, *dst_mfdb;
+    Surface screen_surface, memory_surface, *src, *dst;
+    char blit[128];
+    long round, operation, src_x, src_y, dst_x, dst_y, w, h;
+    int d, pixel_size, use_shadow;
+
+    memset(&wk, 0, sizeof(wk));
+    memset(&vwk, 0, sizeof(vwk));
+    vwk.real_address = &wk;
+    wk.screen.mfdb.address = (short *)screen[0];
+
+    memset(&mfdb, 0, sizeof(mfdb));
+    mfdb.address = (short *)memory[0];
+    mfdb.width = MEMORY_W;
+    mfdb.height = MEMORY_H;
+    mfdb.wdwidth = MEMORY_W / 16;
+
+    screen_surface.data[0] = (unsigned char *)screen[0];
+    screen_surface.data[1] = (unsigned char *)screen[1];
+    screen_surface.w = SCREEN_W;
+    screen_surface.h = SCREEN_H;
+    memory_surface.data[0] = (unsigned char *)memory[0];
+    memory_surface.data[1] = (unsigned char *)memory[1];
+    memory_surface.w = MEMORY_W;
+    memory_surface.h = MEMORY_H;
+
+    for(round = 0; round < ROUNDS; round++) {
+        d = check_range(0, 2);
+        pixel_size = depths[d].depth / 8;
+        operation = check_range(0, 15);
+
+        wk.screen.wrap = SCREEN_W * pixel_size;
+        wk.screen.shadow.wrap = wk.screen.wrap;
+        mfdb.bitplanes = depths[d].depth;
+        screen_surface.wrap = wk.screen.wrap;
+        memory_surface.wrap = (long)mfdb.wdwidth * 2 * mfdb.bitplanes;
+
+        switch (check_range(0, 3)) {
+        case 0:
+        case 1:
+            src = dst = &screen_surface;
+            break;
+        case 2:
+            src = check_range(0, 1) ? &screen_surface : &memory_surface;
+            dst = (src == &screen_surface) ? &memory_surface : &screen_surface;
+            break;
+        default:
+            src = dst = &memory_surface;
+            break;
+        }
+        src_mfdb = (src == &memory_surface) ? &mfdb : 0;
+        dst_mfdb = (dst == &memory_surface) ? &mfdb : 0;
+
+        /* With a shadow, the screen is read from it and written to both */
+        use_shadow = check_range(0, 1);
+        randomize(screen[0], sizeof(screen[0]) / 4);
+        randomize(memory[0], sizeof(memory[0]) / 4);
+        memcpy(shadow[0], screen[0], sizeof(shadow[0]));
+        memcpy(screen[1], screen[0], sizeof(screen[0]));
+        memcpy(shadow[1], shadow[0], sizeof(shadow[0]));
+        memcpy(memory[1], memory[0], sizeof(memory[0]));
+        wk.screen.shadow.address = use_shadow ? (short *)shadow[0] : 0;
+
+        place(src, dst, &src_x, &src_y, &dst_x, &dst_y, &w, &h);
+        reference(src, src_x, src_y, dst, dst_x, dst_y, w, h, operation, pixel_size);
+        if (use_shadow && (dst == &screen_surface))
+            memcpy(shadow[1], screen[1], sizeof(shadow[1]));
+
+        depths[d].blit(&vwk, src_mfdb, src_x, src_y, dst_mfdb, dst_x, dst_y, w, h, operation);
+
+        sprintf(blit, "round %ld (%d bit, op %ld, %ldx%ld from %ld,%ld%s to %ld,%ld%s%s)",
+                round, depths[d].depth, operation, w, h, src_x, src_y, src_mfdb ? " in memory" : "",
+                dst_x, dst_y, dst_mfdb ? " in memory" : "", use_shadow ? ", shadow" : "");
+        compare("screen", screen[0], screen[1], sizeof(screen[0]), blit);
+        compare("shadow", shadow[0], shadow[1], sizeof(shadow[0]), blit);
+        compare("memory", memory[0], memory[1], sizeof(memory[0]), blit);
+    }
+
+    return check_done(what);
+}
@@ -0,0 +1,284 @@
+/*
+ * BLiTTER check
+ *
+ * Runs the bitplane driver blits, expands and fills (blit.c and
+ * fill.c, built with BLITTER_MODEL) both on the CPU, with do_blit()
+ * and draw_rect(), and on a model of the BLiTTER chip, through the
+ * same register values that would be written to the real one. The
+ * screens must end up the same.
+ *
+ * The model works a word at a time the way the chip is documented
+ * to: the source is shifted through a 32 bit register that keeps
+ * what it had from before (FXSR reads an extra word first, NFSR
+ * leaves out the last read and shifts in garbage), and the halftone
+ * line counts up or down with the destination.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fvdi.h"
+#include "relocate.h"
+#include "check.h"
+
+#define W           320
+#define H           64
+#define MONO_W      64          /* Expand source */
+#define MONO_H      80
+#define ROUNDS      30000       /* For each number of planes */
+
+/* As in drivers/bitplane/blit.c */
+struct blit
+{
+    short src_x_inc;
+    short src_y_inc;
+    unsigned short *src_addr;
+    short end_1, end_2, end_3;
+    short dst_x_inc, dst_y_inc;
+    unsigned short *dst_addr;
+    unsigned short x_cnt, y_cnt;
+    char hop;
+    unsigned char op;
+    unsigned char status;
+    char skew;
+};
+
+#define FXSR        0x80
+#define NFSR        0x40
+#define SKEW        0x0f
+
+long CDECL c_blit_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+long CDECL c_expand_area(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation, long colour);
+long CDECL c_fill_area(Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style);
+
+static const char *what = "blitter";
+
+/* What the driver code expects from the rest of the driver and fVDI */
+short hardware_blit = 0;
+short no_restore = 0;
+short fix_shape = 0;
+static Access host_access;
+Access *access = &host_access;
+
+/* The chip */
+unsigned short blitter_halftone[16];
+struct blit blitter_registers;
+static unsigned long source_register = 0x5a5aa5a5UL;  /* Not cleared between jobs */
+static long chip_jobs;
+
+/* Screens drawn by the CPU and the chip, and the expand source */
+static unsigned short screen[2][W / 16 * 8 * H];
+static unsigned short mono[MONO_W / 16 * MONO_H];
+
+
+/*
+ * Colour index bits straight through
+ */
+void CDECL c_get_colours(Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background)
+{
+    (void) vwk;
+    *foreground = colour & 0xffff;
+    *background = (colour >> 16) & 0xffff;
+}
+
+
+long CDECL x_get_colour(Workstation *wk, long colour)
+{
+    (void) wk;
+    return colour;
+}
+
+
+/*
+ * Each destination bit from the source and destination bits,
+ * as the operation number says (bit 3 for neither set, bit 0 for both).
+ */
+static unsigned short operate(int op, unsigned short s, unsigned short d)
+{
+    unsigned short result = 0;
+
+    if (op & 1)
+        result |= s & d;
+    if (op & 2)
+        result |= s & ~d;
+    if (op & 4)
+        result |= ~s & d;
+    if (op & 8)
+        result |= ~s & ~d;
+
+    return result;
+}
+
+
+static void shift_in(struct blit *regs, unsigned short word)
+{
+    if (regs->src_x_inc >= 0)
+        source_register = ((source_register << 16) | word) & 0xffffffffUL;
+    else
+        source_register = (source_register >> 16) | ((unsigned long)word << 16);
+}
+
+
+/*
+ * Start the chip on what is in the registers,
+ * as the bset loop in hw_blit() does.
+ */
+void blitter_run(void)
+{
+    struct blit *regs = &blitter_registers;
+    unsigned short *src, *dst;
+    unsigned short s, d, mask;
+    long x, y, x_cnt, y_cnt;
+    int hop, skew, line, reads, read;
+
+    hop = regs->hop & 3;
+    skew = regs->skew & SKEW;
+    line = regs->status & 0x0f;
+    src = regs->src_addr;
+    dst = regs->dst_addr;
+    x_cnt = regs->x_cnt ? regs->x_cnt : 65536L;
+    y_cnt = regs->y_cnt ? regs->y_cnt : 65536L;
+    chip_jobs++;
+
+    reads = x_cnt + ((regs->skew & FXSR) ? 1 : 0) - ((regs->skew & NFSR) ? 1 : 0);
+    for(y = 0; y < y_cnt; y++) {
+        read = 0;
+        for(x = (regs->skew & FXSR) ? 0 : 1; x <= x_cnt; x++) {
+            if (hop & 2) {
+                if ((x == x_cnt) && (regs->skew & NFSR))
+                    shift_in(regs, (unsigned short)check_random());
+                else {
+                    shift_in(regs, *src);
+                    read++;
+                    src = (unsigned short *)((char *)src + (read == reads ? regs->src_y_inc : regs->src_x_inc));
+                }
+            }
+            if (!x)                     /* FXSR */
+                continue;
+
+            s = (unsigned short)(source_register >> skew);
+            switch (hop) {
+            case 0:
+                s = 0xffff;
+                break;
+            case 1:
+                s = blitter_halftone[line];
+                break;
+            case 3:
+                s &= blitter_halftone[line];
+                break;
+            }
+            mask = (x == 1) ? regs->end_1 : (x == x_cnt) ? regs->end_3 : regs->end_2;
+            d = *dst;
+            *dst = (operate(regs->op, s, d) & mask) | (d & ~mask);
+            dst = (unsigned short *)((char *)dst + (x == x_cnt ? regs->dst_y_inc : regs->dst_x_inc));
+        }
+        line = (line + (regs->dst_y_inc >= 0 ? 1 : -1)) & 0x0f;
+    }
+    regs->status = 0;
+    regs->y_cnt = 0;
+}
+
+
+static void randomize(unsigned short *data, long n)
+{
+    for(; n > 0; n--)
+        *data++ = (unsigned short)check_random();
+}
+
+
+int main(void)
+{
+    static const char *kinds[] = { "blit", "expand", "fill" };
+    Workstation wk;
+    Virtual vwk;
+    MFDB src;
+    short pattern[16 * 8];
+    char job[128];
+    long round, x, y, w, h, src_x, src_y, op, colour;
+    int planes, kind, i;
+
+    memset(&wk, 0, sizeof(wk));
+    memset(&vwk, 0, sizeof(vwk));
+    vwk.real_address = &wk;
+    wk.screen.mfdb.width = W;
+    wk.screen.mfdb.height = H;
+
+    memset(&src, 0, sizeof(src));
+    src.address = (short *)mono;
+    src.width = MONO_W;
+    src.height = MONO_H;
+    src.wdwidth = MONO_W / 16;
+    src.bitplanes = 1;
+
+    for(planes = 1; planes <= 8; planes <<= 1) {
+        wk.screen.mfdb.bitplanes = planes;
+        wk.screen.wrap = W / 16 * planes * 2;
+        vwk.fill.user.multiplane = planes;
+
+        for(round = 0; round < ROUNDS; round++) {
+            kind = check_range(0, 2);
+            op = check_range(0, 15);
+            colour = check_range(0, 0xffff) | (check_range(0, 0xffff) << 16);
+            randomize(screen[0], W / 16 * planes * H);
+            memcpy(screen[1], screen[0], sizeof(screen[0]));
+            randomize(mono, sizeof(mono) / 2);
+            randomize((unsigned short *)pattern, 16 * 8);
+
+            w = check_range(1, check_range(0, 1) ? 20 : W);
+            h = check_range(1, check_range(0, 1) ? 3 : H);
+            x = check_range(0, W - w);
+            y = check_range(0, H - h);
+            src_x = check_range(0, W - w);
+            src_y = check_range(0, H - h);
+            if (!check_range(0, 2)) {   /* Overlapping */
+                src_x = x + check_range(-2, 2);
+                src_y = y + check_range(-1, 1);
+                if (src_x < 0)
+                    src_x = 0;
+                if (src_x > W - w)
+                    src_x = W - w;
+                if (src_y < 0)
+                    src_y = 0;
+                if (src_y > H - h)
+                    src_y = H - h;
+            }
+            if (kind == 1) {
+                src_x &= 0x0f;
+                src_y = check_range(0, MONO_H - h);
+                if (w > MONO_W - src_x)
+                    w = MONO_W - src_x;
+            }
+
+            for(i = 0; i < 2; i++) {
+                hardware_blit = i;
+                wk.screen.mfdb.address = (short *)screen[i];
+                switch (kind) {
+                case 0:
+                    c_blit_area(&vwk, 0, src_x, src_y, 0, x, y, w, h, op);
+                    break;
+                case 1:
+                    c_expand_area(&vwk, &src, src_x, src_y, 0, x, y, w, h, (op & 3) + 1, colour);
+                    break;
+                default:
+                    c_fill_area(&vwk, x, y, w, h, pattern, colour & 0xff, (op & 3) + 1, (op & 4) ? 4L << 16 : 2);
+                    break;
+                }
+            }
+
+            if (memcmp(screen[0], screen[1], sizeof(screen[0]))) {
+                sprintf(job, "%s, %d planes, op %ld, %ldx%ld at %ld,%ld from %ld,%ld",
+                        kinds[kind], planes, op, w, h, x, y, src_x, src_y);
+                check_failed(what, "screens differ after round %ld (%s)", round, job);
+            }
+        }
+    }
+
+    if (!chip_jobs)
+        check_failed(what, "the chip model was never used");
+
+    return check_done(what);
+}
@@ -0,0 +1,338 @@
+/*
+ * Chunky <-> planar check
+ *
+ * Compares c2p_trnfm and c2p_transfer from engine/c2p.c with plain
+ * bit by bit references. vr_trnfm is run in both directions for
+ * 1 to 32 planes, on planar and chunky devices, both between two
+ * buffers and in place (also without any memory for the temporary
+ * copy, which makes the in place shuffle rotate instead).
+ * vr_transfer_bits is run between all the packed and interleaved
+ * index formats, also between overlapping areas of one bitmap.
+ * Everything must end up the same, bit for bit.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fvdi.h"
+#include "function.h"
+#include "relocate.h"
+#include "utility.h"
+#include "check.h"
+
+#define MAX_GROUPS  48          /* vr_trnfm images, in groups of 16 pixels */
+#define BM_W        320         /* vr_transfer_bits bitmaps, more than one row call wide */
+#define BM_H        12
+#define ROUNDS      40000
+
+static const char *what = "c2p";
+
+void CDECL c2p_trnfm(Virtual *vwk, MFDB *src, MFDB *dst);
+
+static int no_memory;
+
+/* vr_trnfm source, actual and expected result */
+static unsigned short image[3][MAX_GROUPS * 32 + 16];
+
+/* vr_transfer_bits source, actual and expected destination */
+static unsigned char bitmap[3][BM_W * BM_H + 16];
+
+
+/*
+ * The in place conversion takes a temporary copy if it can.
+ */
+char *allocate_block(long size)
+{
+    if (no_memory)
+        return 0;
+    return malloc(size);
+}
+
+
+void free_block(void *addr)
+{
+    free(addr);
+}
+
+
+static void randomize(unsigned char *data, long n)
+{
+    for(; n > 0; n--)
+        *data++ = (unsigned char)check_random();
+}
+
+
+/*
+ * Where bit k (from the left) of plane p in group g is
+ * in device specific format: as a word and a bit number,
+ * or as a byte and a bit number for 8 bit chunky pixels.
+ */
+static void device_bit(int planes, int chunky, long g, int k, int p, long *index, int *bit, int *bytes)
+{
+    *bytes = 0;
+    if (!chunky) {
+        *index = g * planes + p;
+        *bit = 15 - k;
+    } else if (planes == 8) {
+        *index = g * 16 + k;
+        *bit = p;
+        *bytes = 1;
+    } else if (planes == 16) {
+        *index = g * 16 + k;
+        *bit = 15 - p;
+    } else {
+        *index = g * 32 + k * 2 + (p >> 4);
+        *bit = 15 - (p & 15);
+    }
+}
+
+
+static int get_bit(const unsigned short *area, long index, int bit, int bytes)
+{
+    if (bytes)
+        return (((const unsigned char *)area)[index] >> bit) & 1;
+    return (area[index] >> bit) & 1;
+}
+
+
+static void set_bit(unsigned short *area, long index, int bit, int bytes, int value)
+{
+    if (bytes) {
+        unsigned char *byte = (unsigned char *)area + index;
+        *byte = (*byte & ~(1 << bit)) | (value << bit);
+    } else
+        area[index] = (area[index] & ~(1 << bit)) | (value << bit);
+}
+
+
+/*
+ * vr_trnfm a bit at a time, standard format being
+ * all of plane 0, then all of plane 1 and so on.
+ */
+static void ref_trnfm(const unsigned short *src, unsigned short *dst, long groups, int planes, int chunky, int standard)
+{
+    long g, index;
+    int p, k, bit, bytes, value;
+
+    for(g = 0; g < groups; g++) {
+        for(p = 0; p < planes; p++) {
+            for(k = 0; k < 16; k++) {
+                device_bit(planes, chunky, g, k, p, &index, &bit, &bytes);
+                if (standard) {
+                    value = get_bit(src, p * groups + g, 15 - k, 0);
+                    set_bit(dst, index, bit, bytes, value);
+                } else {
+                    value = get_bit(src, index, bit, bytes);
+                    set_bit(dst, p * groups + g, 15 - k, 0, value);
+                }
+            }
+        }
+    }
+}
+
+
+static void check_trnfm(Virtual *vwk, Device *device, long round)
+{
+    static const int plane_counts[] = { 1, 2, 4, 8, 16, 32 };
+    MFDB src, dst;
+    char trnfm[128];
+    long groups;
+    int planes, chunky, in_place;
+
+    planes = plane_counts[check_range(0, sizeof(plane_counts) / sizeof(plane_counts[0]) - 1)];
+    device->format = check_range(0, 1) ? 2 : 0;
+    chunky = (device->format & 2) && (planes >= 8);
+    in_place = check_range(0, 1);
+    no_memory = in_place && !check_range(0, 2);
+
+    memset(&src, 0, sizeof(src));
+    src.address = (short *)image[0];
+    src.wdwidth = check_range(1, 6);
+    src.width = src.wdwidth * 16;
+    src.height = check_range(1, MAX_GROUPS / src.wdwidth);
+    src.bitplanes = planes;
+    src.standard = check_range(0, 1);
+    groups = (long)src.wdwidth * src.height;
+
+    randomize((unsigned char *)image[0], sizeof(image[0]));
+    randomize((unsigned char *)image[1], sizeof(image[1]));
+    memcpy(image[2], image[1], sizeof(image[2]));
+    if (in_place)
+        memcpy(image[1], image[0], groups * planes * 2);
+    ref_trnfm(image[0], image[2], groups, planes, chunky, src.standard);
+
+    dst = src;
+    dst.address = (short *)image[1];
+    if (in_place)
+        src.address = dst.address;
+    c2p_trnfm(vwk, &src, &dst);
+
+    sprintf(trnfm, "round %ld (%s %d planes, %dx%d, %s%s%s)", round, chunky ? "chunky" : "planar",
+            planes, src.width, src.height, src.standard ? "from standard" : "to standard",
+            in_place ? ", in place" : "", no_memory ? " without memory" : "");
+    if (memcmp(image[1], image[2], sizeof(image[1])))
+        check_failed(what, "image differs after %s", trnfm);
+    if (dst.standard == src.standard)
+        check_failed(what, "standard flag not changed after %s", trnfm);
+}
+
+
+/*
+ * Index pixel format for vr_transfer_bits,
+ * packed or as interleaved planes.
+ */
+static unsigned long px_format(int bits, int planar)
+{
+    return 0x01000000UL | (planar ? 0 : 0x00020000UL) | ((unsigned long)bits << 8) | bits;
+}
+
+
+static int get_pixel(const unsigned char *bm, int bits, int planar, long x, long y)
+{
+    const unsigned char *row;
+    int p, value;
+
+    row = bm + y * (BM_W * bits / 8);
+    if (!planar)
+        return (row[x * bits / 8] >> (8 - bits - (x * bits & 7))) & ((1 << bits) - 1);
+
+    value = 0;
+    for(p = 0; p < bits; p++)
+        value |= get_bit((const unsigned short *)row, (x >> 4) * bits + p, 15 - (x & 15), 0) << p;
+    return value;
+}
+
+
+static void put_pixel(unsigned char *bm, int bits, int planar, long x, long y, int value)
+{
+    unsigned char *row;
+    int p, shift;
+
+    row = bm + y * (BM_W * bits / 8);
+    if (!planar) {
+        shift = 8 - bits - (x * bits & 7);
+        row[x * bits / 8] = (row[x * bits / 8] & ~(((1 << bits) - 1) << shift)) | (value << shift);
+        return;
+    }
+
+    for(p = 0; p < bits; p++)
+        set_bit((unsigned short *)row, (x >> 4) * bits + p, 15 - (x & 15), 0, (value >> p) & 1);
+}
+
+
+static void check_transfer(long round)
+{
+    static const int formats[][2] = {
+        { 1, 0 }, { 2, 0 }, { 4, 0 }, { 8, 0 }, { 2, 1 }, { 4, 1 }, { 8, 1 }
+    };
+    static unsigned char copy[sizeof(bitmap[0])];
+    GCBITMAP src_bm, dst_bm;
+    RECT16 src_rect, dst_rect;
+    char transfer[128];
+    long x, y, w, h, ret;
+    int s, d, same, value;
+
+    same = !check_range(0, 2);
+    s = check_range(0, sizeof(formats) / sizeof(formats[0]) - 1);
+    d = same ? s : check_range(0, sizeof(formats) / sizeof(formats[0]) - 1);
+
+    memset(&src_bm, 0, sizeof(src_bm));
+    src_bm.addr = bitmap[0];
+    src_bm.width = BM_W * formats[s][0] / 8;
+    src_bm.bits = formats[s][0];
+    src_bm.px_format = px_format(formats[s][0], formats[s][1]);
+    src_bm.xmax = BM_W;
+    src_bm.ymax = BM_H;
+    dst_bm = src_bm;
+    dst_bm.addr = bitmap[1];
+    dst_bm.width = BM_W * formats[d][0] / 8;
+    dst_bm.bits = formats[d][0];
+    dst_bm.px_format = px_format(formats[d][0], formats[d][1]);
+
+    w = check_range(1, check_range(0, 1) ? 40 : BM_W);
+    h = check_range(1, BM_H);
+    src_rect.x1 = check_range(0, BM_W - w);
+    src_rect.y1 = check_range(0, BM_H - h);
+    if (same) {
+        dst_rect.x1 = src_rect.x1 + check_range(-20, 20);
+        dst_rect.y1 = src_rect.y1 + (check_range(0, 1) ? 0 : check_range(-2, 2));
+        if (dst_rect.x1 < 0)
+            dst_rect.x1 = 0;
+        if (dst_rect.x1 > BM_W - w)
+            dst_rect.x1 = BM_W - w;
+        if (dst_rect.y1 < 0)
+            dst_rect.y1 = 0;
+        if (dst_rect.y1 > BM_H - h)
+            dst_rect.y1 = BM_H - h;
+    } else {
+        dst_rect.x1 = check_range(0, BM_W - w);
+        dst_rect.y1 = check_range(0, BM_H - h);
+    }
+    src_rect.x2 = src_rect.x1 + w - 1;
+    src_rect.y2 = src_rect.y1 + h - 1;
+    dst_rect.x2 = dst_rect.x1 + w - 1;
+    dst_rect.y2 = dst_rect.y1 + h - 1;
+
+    randomize(bitmap[0], sizeof(bitmap[0]));
+    randomize(bitmap[1], sizeof(bitmap[1]));
+    if (same)
+        memcpy(bitmap[1], bitmap[0], sizeof(bitmap[1]));
+    memcpy(bitmap[2], bitmap[1], sizeof(bitmap[2]));
+    memcpy(copy, bitmap[0], sizeof(copy));
+    if (same)
+        src_bm.addr = bitmap[1];
+
+    /* Supported when the destination has at least as many bits */
+    if (formats[s][0] <= formats[d][0]) {
+        for(y = 0; y < h; y++) {
+            for(x = 0; x < w; x++) {
+                value = get_pixel(copy, formats[s][0], formats[s][1], src_rect.x1 + x, src_rect.y1 + y);
+                if ((formats[s][0] == 1) && (formats[d][0] > 1))
+                    value = value ? (1 << formats[d][0]) - 1 : 0;
+                put_pixel(bitmap[2], formats[d][0], formats[d][1], dst_rect.x1 + x, dst_rect.y1 + y, value);
+            }
+        }
+    }
+
+    ret = c2p_transfer(&src_bm, &dst_bm, &src_rect, &dst_rect);
+
+    sprintf(transfer, "round %ld (%d bit %s to %d bit %s, %ldx%ld from %d,%d to %d,%d%s)",
+            round, formats[s][0], formats[s][1] ? "planes" : "packed",
+            formats[d][0], formats[d][1] ? "planes" : "packed",
+            w, h, src_rect.x1, src_rect.y1, dst_rect.x1, dst_rect.y1, same ? ", same bitmap" : "");
+    if (ret != (formats[s][0] <= formats[d][0]))
+        check_failed(what, "wrong return value %ld after %s", ret, transfer);
+    if (memcmp(bitmap[1], bitmap[2], sizeof(bitmap[1])))
+        check_failed(what, "bitmap differs after %s", transfer);
+}
+
+
+int main(void)
+{
+    Workstation wk;
+    Virtual vwk;
+    Driver driver;
+    Device device;
+    long round;
+
+    memset(&wk, 0, sizeof(wk));
+    memset(&vwk, 0, sizeof(vwk));
+    memset(&driver, 0, sizeof(driver));
+    memset(&device, 0, sizeof(device));
+    vwk.real_address = &wk;
+    wk.driver = &driver;
+    driver.device = &device;
+
+    for(round = 0; round < ROUNDS; round++) {
+        if (check_range(0, 1))
+            check_trnfm(&vwk, &device, round);
+        else
+            check_transfer(round);
+    }
+
+    return check_done(what);
+}
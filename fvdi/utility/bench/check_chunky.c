@@ -0,0 +1,300 @@
+/*
+ * Chunky shadow check
+ *
+ * Runs the bitplane driver with its 'chunky' option (chunky.c, the
+ * 16_bit routines built for 8 bit pixels, with dirty tile write-back)
+ * next to the plain bitplane code (blit.c and fill.c), for 1, 2, 4
+ * and 8 planes. Random fills (also with multi plane user patterns),
+ * expands, blits on the screen and to/from memory and pixels are
+ * drawn by both, and after the dirty tiles have been written back
+ * the real screen must be the same as the one drawn by the bitplane
+ * code, as must any memory destination and pixel read.
+ * Lines are drawn too, but the 16_bit line code does not pick the
+ * same pixels as line.c, so for them (and everything else) the real
+ * screen is only checked against the chunky shadow, bit by bit.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fvdi.h"
+#include "driver.h"
+#include "relocate.h"
+#include "bitplane.h"
+#include "check.h"
+
+#define W           320
+#define H           64
+#define MONO_W      64          /* Expand source */
+#define MONO_H      80
+#define MEM_W       96          /* Blit source/destination in memory */
+#define MEM_H       48
+#define ROUNDS      10000       /* For each number of planes */
+
+static const char *what = "chunky";
+
+/* What the driver code expects from the rest of the driver and fVDI */
+short hardware_blit = 0;
+short no_restore = 0;
+short fix_shape = 0;
+
+long CDECL (*write_pixel_r)(Virtual *vwk, MFDB *mfdb, long x, long y, long colour);
+long CDECL (*read_pixel_r)(Virtual *vwk, MFDB *mfdb, long x, long y);
+long CDECL (*line_draw_r)(Virtual *vwk, long x1, long y1, long x2, long y2, long pattern, long colour, long mode);
+long CDECL (*expand_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation, long colour);
+long CDECL (*fill_area_r)(Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style);
+long CDECL (*blit_area_r)(Virtual *vwk, MFDB *src, long src_x, long src_y, MFDB *dst, long dst_x, long dst_y, long w, long h, long operation);
+long CDECL (*mouse_draw_r)(Workstation *wk, long x, long y, Mouse *mouse);
+
+static Driver driver;
+Driver *me = &driver;
+
+static void *DRIVER_EXPORT check_malloc(long size, long type)
+{
+    (void) type;
+    return malloc(size);
+}
+
+static void DRIVER_EXPORT check_error(const char *text1, const char *text2)
+{
+    check_failed(what, "driver error '%s%s'", text1, text2 ? text2 : "");
+}
+
+static Access check_access = {
+    .funcs = {
+        .malloc = check_malloc,
+        .free = free,
+        .error = check_error
+    }
+};
+Access *access = &check_access;
+
+/* Drawn by the bitplane code, the real screen under the chunky shadow */
+static unsigned short screen[2][W / 16 * 8 * H];
+
+/* Memory blit destinations, drawn from each */
+static unsigned short memory[3][MEM_W / 16 * 8 * MEM_H];
+
+static unsigned short mono[MONO_W / 16 * MONO_H];
+
+static char linea[0x200];       /* Only the mouse flag at -0x153 is used */
+
+
+/*
+ * Colour index bits straight through
+ */
+void CDECL c_get_colours(Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background)
+{
+    (void) vwk;
+    *foreground = colour & 0xffff;
+    *background = (colour >> 16) & 0xffff;
+}
+
+
+long CDECL x_get_colour(Workstation *wk, long colour)
+{
+    (void) wk;
+    return colour;
+}
+
+
+static void randomize(unsigned short *data, long n)
+{
+    for(; n > 0; n--)
+        *data++ = (unsigned short)check_random();
+}
+
+
+/*
+ * The real screen must have the same bits as the shadow
+ * (with plane n being bit n of a pixel).
+ */
+static int written_back(Workstation *wk, unsigned short *video)
+{
+    unsigned char *shadow;
+    unsigned short bits;
+    int planes, x, y, p, i;
+
+    shadow = (unsigned char *)wk->screen.mfdb.address;
+    planes = wk->screen.mfdb.bitplanes;
+    for(y = 0; y < H; y++) {
+        for(x = 0; x < W; x += 16) {
+            for(p = 0; p < planes; p++) {
+                bits = 0;
+                for(i = 0; i < 16; i++)
+                    bits = (bits << 1) | ((shadow[y * W + x + i] >> p) & 1);
+                if (*video++ != bits)
+                    return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+static void set_screen(Workstation *wk, unsigned short *address, int planes)
+{
+    memset(wk, 0, sizeof(*wk));
+    wk->screen.mfdb.address = (short *)address;
+    wk->screen.mfdb.width = W;
+    wk->screen.mfdb.height = H;
+    wk->screen.mfdb.wdwidth = W / 16;
+    wk->screen.mfdb.bitplanes = planes;
+    wk->screen.wrap = W / 16 * planes * 2;
+    wk->screen.linea = linea + sizeof(linea);
+}
+
+
+/*
+ * A random area, sometimes overlapping the other one.
+ */
+static void make_area(long *x, long *y, long *w, long *h, long *src_x, long *src_y, long src_w, long src_h)
+{
+    *w = check_range(1, check_range(0, 1) ? 20 : (src_w < W ? src_w : W));
+    *h = check_range(1, check_range(0, 1) ? 3 : (src_h < H ? src_h : H));
+    *x = check_range(0, W - *w);
+    *y = check_range(0, H - *h);
+    *src_x = check_range(0, src_w - *w);
+    *src_y = check_range(0, src_h - *h);
+    if ((src_w == W) && !check_range(0, 2)) {
+        *src_x = *x + check_range(-2, 2);
+        *src_y = *y + check_range(-1, 1);
+        if (*src_x < 0)
+            *src_x = 0;
+        if (*src_x > W - *w)
+            *src_x = W - *w;
+        if (*src_y < 0)
+            *src_y = 0;
+        if (*src_y > H - *h)
+            *src_y = H - *h;
+    }
+}
+
+
+int main(void)
+{
+    static const char *kinds[] = { "fill", "user fill", "expand", "blit", "blit from memory",
+                                   "blit to memory", "line", "pixel" };
+    Workstation wk[2];
+    Virtual vwk[2];
+    MFDB mono_mfdb, mem_mfdb[3];
+    short pattern[16 * 8];
+    char job[128];
+    long round, x, y, w, h, src_x, src_y, op, colour, pixel[2];
+    int planes, kind, i;
+
+    memset(&mono_mfdb, 0, sizeof(mono_mfdb));
+    mono_mfdb.address = (short *)mono;
+    mono_mfdb.width = MONO_W;
+    mono_mfdb.height = MONO_H;
+    mono_mfdb.wdwidth = MONO_W / 16;
+    mono_mfdb.bitplanes = 1;
+
+    for(planes = 1; planes <= 8; planes <<= 1) {
+        for(i = 0; i < 3; i++) {
+            memset(&mem_mfdb[i], 0, sizeof(mem_mfdb[i]));
+            mem_mfdb[i].address = (short *)memory[i];
+            mem_mfdb[i].width = MEM_W;
+            mem_mfdb[i].height = MEM_H;
+            mem_mfdb[i].wdwidth = MEM_W / 16;
+            mem_mfdb[i].bitplanes = planes;
+        }
+
+        for(round = 0; round < ROUNDS; round++) {
+            kind = check_range(0, 7);
+            op = check_range(0, 15);
+            colour = check_range(0, 0xffff) | (check_range(0, 0xffff) << 16);
+            randomize(screen[0], W / 16 * planes * H);
+            memcpy(screen[1], screen[0], sizeof(screen[0]));
+            randomize(mono, sizeof(mono) / 2);
+            randomize((unsigned short *)pattern, 16 * 8);
+            randomize(memory[0], sizeof(memory[0]) / 2);
+            memcpy(memory[1], memory[0], sizeof(memory[0]));
+            memcpy(memory[2], memory[0], sizeof(memory[0]));
+
+            /* Plain bitplanes, and the same screen with a chunky shadow */
+            memset(vwk, 0, sizeof(vwk));
+            set_screen(&wk[0], screen[0], planes);
+            set_screen(&wk[1], screen[1], planes);
+            for(i = 0; i < 2; i++) {
+                vwk[i].real_address = &wk[i];
+                vwk[i].fill.user.multiplane = planes;
+                vwk[i].clip.rectangle.x1 = check_range(0, 1) ? 0 : check_range(0, W / 2);
+                vwk[i].clip.rectangle.y1 = 0;
+                vwk[i].clip.rectangle.x2 = W - 1;
+                vwk[i].clip.rectangle.y2 = H - 1;
+            }
+            vwk[1].clip = vwk[0].clip;
+            if (!chunky_init(&wk[1])) {
+                check_failed(what, "chunky_init failed");
+                break;
+            }
+
+            make_area(&x, &y, &w, &h, &src_x, &src_y, W, H);
+            switch (kind) {
+            case 0:
+            case 1:
+                c_fill_area(&vwk[0], x, y, w, h, pattern, colour & 0xff, (op & 3) + 1, kind ? 4L << 16 : 2);
+                fill_area_r(&vwk[1], x, y, w, h, pattern, colour & 0xff, (op & 3) + 1, kind ? 4L << 16 : 2);
+                break;
+            case 2:
+                src_x &= 0x0f;
+                src_y = check_range(0, MONO_H - h);
+                if (w > MONO_W - src_x)
+                    w = MONO_W - src_x;
+                c_expand_area(&vwk[0], &mono_mfdb, src_x, src_y, 0, x, y, w, h, (op & 3) + 1, colour);
+                expand_area_r(&vwk[1], &mono_mfdb, src_x, src_y, 0, x, y, w, h, (op & 3) + 1, colour);
+                break;
+            case 3:
+                c_blit_area(&vwk[0], 0, src_x, src_y, 0, x, y, w, h, op);
+                blit_area_r(&vwk[1], 0, src_x, src_y, 0, x, y, w, h, op);
+                break;
+            case 4:
+                make_area(&x, &y, &w, &h, &src_x, &src_y, MEM_W, MEM_H);
+                c_blit_area(&vwk[0], &mem_mfdb[0], src_x, src_y, 0, x, y, w, h, op);
+                blit_area_r(&vwk[1], &mem_mfdb[0], src_x, src_y, 0, x, y, w, h, op);
+                break;
+            case 5:
+                make_area(&src_x, &src_y, &w, &h, &x, &y, MEM_W, MEM_H);
+                c_blit_area(&vwk[0], 0, src_x, src_y, &mem_mfdb[1], x, y, w, h, op);
+                blit_area_r(&vwk[1], 0, src_x, src_y, &mem_mfdb[2], x, y, w, h, op);
+                break;
+            case 6:
+                w = check_range(0, W - 1);
+                h = check_range(0, H - 1);
+                c_line_draw(&vwk[0], x, y, w, h, 0xffff, colour, (op & 3) + 1);
+                line_draw_r(&vwk[1], x, y, w, h, 0xffff, colour, (op & 3) + 1);
+                break;
+            default:
+                c_write_pixel(&vwk[0], &wk[0].screen.mfdb, x, y, colour & 0xff);
+                write_pixel_r(&vwk[1], &wk[1].screen.mfdb, x, y, colour & 0xff);
+                pixel[0] = c_read_pixel(&vwk[0], &wk[0].screen.mfdb, src_x, src_y);
+                pixel[1] = read_pixel_r(&vwk[1], &wk[1].screen.mfdb, src_x, src_y);
+                if (pixel[0] != pixel[1])
+                    check_failed(what, "pixel %ld,%ld read as %ld, not %ld, after round %ld (%d planes)",
+                                 src_x, src_y, pixel[1], pixel[0], round, planes);
+                break;
+            }
+
+            chunky_update();
+
+            sprintf(job, "%s, %d planes, op %ld, %ldx%ld at %ld,%ld from %ld,%ld",
+                    kinds[kind], planes, op, w, h, x, y, src_x, src_y);
+            if ((kind != 6) && memcmp(screen[0], screen[1], sizeof(screen[0])))
+                check_failed(what, "screens differ after round %ld (%s)", round, job);
+            if (!written_back(&wk[1], screen[1]))
+                check_failed(what, "shadow not written back after round %ld (%s)", round, job);
+            if (memcmp(memory[1], memory[2], sizeof(memory[1])))
+                check_failed(what, "memory differs after round %ld (%s)", round, job);
+
+            free(wk[1].screen.shadow.buffer);
+        }
+    }
+
+    return check_done(what);
+}
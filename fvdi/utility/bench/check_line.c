@@ -0,0 +1,150 @@
+/*
+ * Line check
+ *
+ * Compares c_line_draw from drivers/16_bit/16b_line.c, which draws
+ * solid lines near the axes a run at a time, with the Bresenham code
+ * it had before (ref_line.c), both built for 8, 16 and 32 bit pixels
+ * (line_depth.c). Random lines, mostly near horizontal or vertical,
+ * are clipped to random rectangles and drawn in all four modes with
+ * the solid, predefined and some user line styles, with and without
+ * a shadow buffer. The screens must end up the same.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fvdi.h"
+#include "check.h"
+
+#define W           90          /* Lines of 8 bit pixels are not long aligned */
+#define H           60
+#define MARGIN      40
+#define ROUNDS      200000
+
+static const char *what = "line";
+
+typedef long CDECL (*Line_draw)(Virtual *vwk, long x1, long y1, long x2, long y2,
+                                long pattern, long colour, long mode);
+
+static struct {
+    int depth;
+    Line_draw line, ref;
+} depths[] = {
+    { 8, c_line_draw_8, ref_line_draw_8 },
+    { 16, c_line_draw_16, ref_line_draw_16 },
+    { 32, c_line_draw_32, ref_line_draw_32 }
+};
+
+/* Solid, the predefined line styles, and then a user style */
+static unsigned short styles[] = {
+    0xffff, 0xfff0, 0xc0c0, 0xff18, 0xff00, 0xf191, 0
+};
+
+/* Drawn, reference and shadow */
+static unsigned int screen[3][W * H];
+
+
+static void randomize(unsigned int *data, long n)
+{
+    for(; n > 0; n--)
+        *data++ = (unsigned int)((check_random() << 8) ^ check_random());
+}
+
+
+static void set_clip(Virtual *vwk)
+{
+    if (check_range(0, 1)) {
+        vwk->clip.rectangle.x1 = 0;
+        vwk->clip.rectangle.y1 = 0;
+        vwk->clip.rectangle.x2 = W - 1;
+        vwk->clip.rectangle.y2 = H - 1;
+    } else {
+        vwk->clip.rectangle.x1 = check_range(0, W / 2);
+        vwk->clip.rectangle.y1 = check_range(0, H / 2);
+        vwk->clip.rectangle.x2 = check_range(W / 2, W - 1);
+        vwk->clip.rectangle.y2 = check_range(H / 2, H - 1);
+    }
+}
+
+
+/*
+ * Mostly lines that are at most a quarter as steep
+ * as a diagonal, which are drawn a run at a time.
+ */
+static void make_line(long *x1, long *y1, long *x2, long *y2)
+{
+    long slope;
+
+    *x1 = check_range(-MARGIN, W + MARGIN);
+    *y1 = check_range(-MARGIN, H + MARGIN);
+    slope = check_range(0, 3) ? check_range(0, 4) : 0;
+    switch (check_range(0, 3)) {
+    case 0:
+    case 1:                     /* Near horizontal */
+        *x2 = check_range(-MARGIN, W + MARGIN);
+        *y2 = *y1 + check_range(-slope, slope) * (*x2 - *x1) / 16;
+        break;
+    case 2:                     /* Near vertical */
+        *y2 = check_range(-MARGIN, H + MARGIN);
+        *x2 = *x1 + check_range(-slope, slope) * (*y2 - *y1) / 16;
+        break;
+    default:
+        *x2 = check_range(-MARGIN, W + MARGIN);
+        *y2 = check_range(-MARGIN, H + MARGIN);
+        break;
+    }
+}
+
+
+int main(void)
+{
+    Workstation wk[2];
+    Virtual vwk[2];
+    char line[128];
+    long round, x1, y1, x2, y2, pattern, colour, mode;
+    int d, use_shadow;
+
+    memset(wk, 0, sizeof(wk));
+    memset(vwk, 0, sizeof(vwk));
+    vwk[0].real_address = &wk[0];
+    vwk[1].real_address = &wk[1];
+    wk[0].screen.mfdb.address = (short *)screen[0];
+    wk[1].screen.mfdb.address = (short *)screen[1];
+
+    for(round = 0; round < ROUNDS; round++) {
+        d = check_range(0, 2);
+        wk[0].screen.wrap = W * depths[d].depth / 8;
+        wk[1].screen.wrap = wk[0].screen.wrap;
+        wk[0].screen.shadow.wrap = wk[0].screen.wrap;
+
+        set_clip(&vwk[0]);
+        vwk[1].clip = vwk[0].clip;
+        make_line(&x1, &y1, &x2, &y2);
+        mode = check_range(1, 4);
+        pattern = check_range(0, 1) ? 0xffff : styles[check_range(0, sizeof(styles) / sizeof(styles[0]) - 1)];
+        if (!pattern)
+            pattern = check_range(0, 0xffff);
+        colour = check_range(0, 0xffff) | (check_range(0, 0xffff) << 16);
+
+        use_shadow = check_range(0, 1);
+        randomize(screen[0], W * H);
+        memcpy(screen[1], screen[0], sizeof(screen[0]));
+        memcpy(screen[2], screen[0], sizeof(screen[0]));
+        wk[0].screen.shadow.address = use_shadow ? (short *)screen[2] : 0;
+
+        depths[d].line(&vwk[0], x1, y1, x2, y2, pattern, colour, mode);
+        depths[d].ref(&vwk[1], x1, y1, x2, y2, pattern, colour, mode);
+
+        sprintf(line, "round %ld (%d bit, %ld,%ld to %ld,%ld, style %04lx, mode %ld%s)",
+                round, depths[d].depth, x1, y1, x2, y2, pattern, mode, use_shadow ? ", shadow" : "");
+        if (memcmp(screen[0], screen[1], sizeof(screen[0])))
+            check_failed(what, "screen differs after %s", line);
+        if (use_shadow && memcmp(screen[2], screen[1], sizeof(screen[0])))
+            check_failed(what, "shadow differs after %s", line);
+    }
+
+    return check_done(what);
+}
@@ -0,0 +1,335 @@
+/*
+ * Polygon fill check
+ *
+ * Compares the active edge table filled_poly/filled_poly_m in
+ * engine/polygon.c with the per-scanline versions they replaced
+ * (ref_polygon.c), on random single and multi-contour polygons,
+ * with and without clipping. Every pixel must be filled the same
+ * number of times (once or not at all) by both. The work area is
+ * sometimes made too small for the edge table, to check the
+ * fallback code as well.
+ * The driver's own polygon fill, c_fill_poly in 16b_fill.c (built
+ * for 8, 16 and 32 bit pixels by fill_depth.c), copies the engine's
+ * edge setup and sort. It is run on half of the same polygons, in
+ * all four modes with random patterns, with and without a shadow
+ * buffer, and the screen must end up as the engine's spans say.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fvdi.h"
+#include "function.h"
+#include "relocate.h"
+#include "utility.h"
+#include "check.h"
+
+#define W        320
+#define H        200
+#define MARGIN   200
+#define POINTS   64
+#define ROUNDS   40000
+
+typedef long CDECL (*Fill_poly)(Virtual *vwk, short points[], long n, short index[], long moves,
+                                short *pattern, long colour, long mode, long interior_style);
+
+static struct {
+    int depth;
+    Fill_poly fill_poly;
+} depths[] = {
+    { 8, c_fill_poly_8 },
+    { 16, c_fill_poly_16 },
+    { 32, c_fill_poly_32 }
+};
+
+static unsigned char filled[2][H][W];
+static int target;                      /* Which of the above to fill */
+static short work[32768];
+static long work_room;                  /* As reported by block_room() */
+
+/* c_fill_poly drawn, shadow and expected screens */
+static unsigned char screen[3][H * W * 4];
+
+/* Only the memory block functions are used by c_fill_poly */
+static Access check_access = {
+    .funcs = {
+        .allocate_block = allocate_block,
+        .free_block = free_block
+    }
+};
+Access *access = &check_access;
+
+
+char *allocate_block(long size)
+{
+    return malloc(size);
+}
+
+
+void free_block(void *addr)
+{
+    free(addr);
+}
+
+
+long block_room(const void *addr)
+{
+    long used = (const char *)addr - (const char *)work;
+
+    return (used < work_room) ? work_room - used : 0;
+}
+
+
+void fill_rect(Virtual *vwk, long x1, long y1, long x2, long y2, Fgbg colour, short *pattern, long mode, long interior_style)
+{
+    long x, y;
+
+    (void) colour;
+    (void) pattern;
+    (void) mode;
+    (void) interior_style;
+    for(y = y1; y <= y2; y++) {
+        for(x = x1; x <= x2; x++) {
+            if ((x < vwk->clip.rectangle.x1) || (x > vwk->clip.rectangle.x2) ||
+                (y < vwk->clip.rectangle.y1) || (y > vwk->clip.rectangle.y2))
+                check_failed("poly", "pixel %ld,%ld outside clip", x, y);
+            else
+                filled[target][y][x]++;
+        }
+    }
+}
+
+
+void fill_spans(void *vwk, short *spans, long n, Fgbg colour, short *pattern, long mode, long interior_style)
+{
+    for(; n > 0; n--, spans += 3)
+        fill_rect(vwk, spans[1], spans[0], spans[2], spans[0], colour, pattern, mode, interior_style);
+}
+
+
+/*
+ * Some closed contours after each other, with the start
+ * point of each in index[] (in the VDI ptsin offset form,
+ * last contour first). filled_poly_m expects at least two.
+ */
+static long make_contours(short p[][2], short *index, long *moves, int min_contours, int max_contours)
+{
+    long n, start, i, count, contours;
+    int big;
+
+    n = 0;
+    contours = check_range(min_contours, max_contours);
+    big = check_range(0, 3) == 0;
+    *moves = contours;
+    while (contours--) {
+        start = n;
+        index[contours] = (short)(2 * start - 4);
+        count = check_range(2, POINTS / 3 - 1);
+        for(i = 0; i < count; i++) {
+            if (big) {
+                p[n][0] = check_range(-MARGIN, W + MARGIN);
+                p[n][1] = check_range(-MARGIN, H + MARGIN);
+            } else {
+                p[n][0] = check_range(0, W / 3) + (start ? W / 2 : 20);
+                p[n][1] = check_range(0, H / 3) + 20;
+            }
+            n++;
+        }
+        p[n][0] = p[start][0];          /* Closed */
+        p[n][1] = p[start][1];
+        n++;
+    }
+
+    return n;
+}
+
+
+static void set_clip(Virtual *vwk)
+{
+    if (check_range(0, 1)) {
+        vwk->clip.rectangle.x1 = 0;
+        vwk->clip.rectangle.y1 = 0;
+        vwk->clip.rectangle.x2 = W - 1;
+        vwk->clip.rectangle.y2 = H - 1;
+    } else {
+        vwk->clip.rectangle.x1 = check_range(0, W / 2);
+        vwk->clip.rectangle.y1 = check_range(0, H / 2);
+        vwk->clip.rectangle.x2 = check_range(W / 2, W - 1);
+        vwk->clip.rectangle.y2 = check_range(H / 2, H - 1);
+    }
+}
+
+
+/*
+ * Some screen contents that vary from round to round,
+ * without a check_random() call for every byte.
+ */
+static void randomize(unsigned char *data, long n)
+{
+    unsigned long seed;
+    long i;
+
+    seed = check_random();
+    for(i = 0; i < n; i++)
+        data[i] = (unsigned char)(((i + seed) * 0x9e3779b1UL) >> 19);
+}
+
+
+static unsigned long get_pixel(const unsigned char *area, int depth, long x, long y)
+{
+    const unsigned char *addr = area + (y * W + x) * (depth / 8);
+
+    if (depth == 8)
+        return *addr;
+    else if (depth == 16)
+        return *(const unsigned short *)addr;
+    return *(const unsigned int *)addr;
+}
+
+
+static void put_pixel(unsigned char *area, int depth, long x, long y, unsigned long value)
+{
+    unsigned char *addr = area + (y * W + x) * (depth / 8);
+
+    if (depth == 8)
+        *addr = (unsigned char)value;
+    else if (depth == 16)
+        *(unsigned short *)addr = (unsigned short)value;
+    else
+        *(unsigned int *)addr = (unsigned int)value;
+}
+
+
+/*
+ * Run c_fill_poly on what the engine has just filled (filled[1]),
+ * and check that the pixels inside were drawn as the mode and
+ * pattern say, and that nothing else was touched.
+ */
+static void check_driver(Virtual *vwk, short p[][2], long n, short *index, long moves, long round)
+{
+    static const char *modes[] = { 0, "replace", "transparent", "xor", "reverse transparent" };
+    Workstation *wk = vwk->real_address;
+    short pattern[16];
+    char poly[128];
+    unsigned long foreground, background, old, mask;
+    long colour, mode, size, x, y;
+    int d, depth, use_shadow, i, bit;
+
+    d = check_range(0, 2);
+    depth = depths[d].depth;
+    mask = (depth == 32) ? 0xffffffffUL : (1UL << depth) - 1;
+    wk->screen.wrap = W * depth / 8;
+    wk->screen.shadow.wrap = wk->screen.wrap;
+
+    mode = check_range(1, 4);
+    for(i = 0; i < 16; i++)
+        pattern[i] = check_range(0, 3) ? (short)check_range(0, 0xffff) : -1;
+    if (check_range(0, 1))
+        memset(pattern, 0xff, sizeof(pattern));
+    colour = check_range(0, 0xffff) | (check_range(0, 0xffff) << 16);
+    foreground = ((unsigned long)(colour & 0xffff) * 0x9e3779b1UL) & mask;
+    background = ((unsigned long)((colour >> 16) & 0xffff) * 0x9e3779b1UL) & mask;
+
+    use_shadow = check_range(0, 1);
+    size = (long)W * H * depth / 8;
+    randomize(screen[0], size);
+    memcpy(screen[1], screen[0], size);
+    memcpy(screen[2], screen[0], size);
+    wk->screen.shadow.address = use_shadow ? (short *)screen[1] : 0;
+
+    for(y = 0; y < H; y++) {
+        for(x = 0; x < W; x++) {
+            if (!filled[1][y][x])
+                continue;
+            bit = (pattern[y & 15] >> (15 - (x & 15))) & 1;
+            old = get_pixel(screen[2], depth, x, y);
+            switch (mode) {
+            case 1:
+                put_pixel(screen[2], depth, x, y, bit ? foreground : background);
+                break;
+            case 2:
+                if (bit)
+                    put_pixel(screen[2], depth, x, y, foreground);
+                break;
+            case 3:             /* Twice where spans meet */
+                if (bit && (filled[1][y][x] & 1))
+                    put_pixel(screen[2], depth, x, y, ~old & mask);
+                break;
+            default:
+                if (!bit)
+                    put_pixel(screen[2], depth, x, y, foreground);
+                break;
+            }
+        }
+    }
+
+    depths[d].fill_poly(vwk, (short *)p, n, moves ? index : 0, moves, pattern, colour, mode, 0x10001L);
+
+    sprintf(poly, "round %ld (%d bit, %s, %ld points, %s%s)", round, depth, moves ? "multi" : "single",
+            n, modes[mode], use_shadow ? ", shadow" : "");
+    if (memcmp(screen[0], screen[2], size))
+        check_failed("poly", "c_fill_poly screen differs after %s", poly);
+    if (use_shadow && memcmp(screen[1], screen[2], size))
+        check_failed("poly", "c_fill_poly shadow differs after %s", poly);
+}
+
+
+int main(void)
+{
+    static short solid[16] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+    static Fgbg colour = { 0, 1 };
+    short p[POINTS][2], index[POINTS];
+    Workstation wk;
+    Virtual vwk;
+    long round, n, moves;
+    int multi;
+
+    memset(&wk, 0, sizeof(wk));
+    memset(&vwk, 0, sizeof(vwk));
+    vwk.real_address = &wk;
+    wk.screen.mfdb.address = (short *)screen[0];
+    for(round = 0; round < ROUNDS; round++) {
+        set_clip(&vwk);
+        multi = check_range(0, 1);
+        n = make_contours(p, index, &moves, multi ? 2 : 1, multi ? 3 : 1);
+        switch (check_range(0, 3)) {
+        case 0:
+            work_room = 200;            /* No room for the edge table */
+            break;
+        case 1:
+            work_room = n * 16 + 200;   /* Small span table */
+            break;
+        default:
+            work_room = sizeof(work);
+            break;
+        }
+
+        memset(filled, 0, sizeof(filled));
+        for(target = 0; target < 2; target++) {
+            if (multi) {
+                if (target)
+                    filled_poly_m(&vwk, p, n, colour, solid, work, index, moves, 1, 0x10001L);
+                else
+                    ref_filled_poly_m(&vwk, p, n, colour, solid, work, index, moves, 1, 0x10001L);
+            } else {
+                if (target)
+                    filled_poly(&vwk, p, n, colour, solid, work, 1, 0x10001L);
+                else
+                    ref_filled_poly(&vwk, p, n, colour, solid, work, 1, 0x10001L);
+            }
+        }
+
+        if (memcmp(filled[0], filled[1], sizeof(filled[0])))
+            check_failed("poly", "round %ld (%s, %ld points, room %ld) differs", round,
+                         multi ? "multi" : "single", n, work_room);
+
+        if (check_range(0, 1))
+            check_driver(&vwk, p, n, index, multi ? moves : 0, round);
+    }
+
+    return check_done("poly");
+}
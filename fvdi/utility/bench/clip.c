@@ -0,0 +1,72 @@
+/*
+ * fVDI host line clipping
+ *
+ * A C stand-in for clip_line, for the benchmark and check_line.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+#include "bench.h"
+
+
+/*
+ * Cohen-Sutherland replacement for clip_line in clip.s
+ * Always clips, just like the original.
+ */
+static int outcode(Virtual *vwk, long x, long y)
+{
+    int code = 0;
+
+    if (x < vwk->clip.rectangle.x1)
+        code |= 1;
+    else if (x > vwk->clip.rectangle.x2)
+        code |= 2;
+    if (y < vwk->clip.rectangle.y1)
+        code |= 4;
+    else if (y > vwk->clip.rectangle.y2)
+        code |= 8;
+
+    return code;
+}
+
+
+long CDECL clip_line(Virtual *vwk, long *x1, long *y1, long *x2, long *y2)
+{
+    int code1, code2, code;
+    long x, y;
+
+    vwk = (Virtual *)((long)vwk & ~1L);
+    code1 = outcode(vwk, *x1, *y1);
+    code2 = outcode(vwk, *x2, *y2);
+    while (code1 | code2) {
+        if (code1 & code2)
+            return 0;
+        code = code1 ? code1 : code2;
+        if (code & 8) {
+            y = vwk->clip.rectangle.y2;
+            x = *x1 + (*x2 - *x1) * (y - *y1) / (*y2 - *y1);
+        } else if (code & 4) {
+            y = vwk->clip.rectangle.y1;
+            x = *x1 + (*x2 - *x1) * (y - *y1) / (*y2 - *y1);
+        } else if (code & 2) {
+            x = vwk->clip.rectangle.x2;
+            y = *y1 + (*y2 - *y1) * (x - *x1) / (*x2 - *x1);
+        } else {
+            x = vwk->clip.rectangle.x1;
+            y = *y1 + (*y2 - *y1) * (x - *x1) / (*x2 - *x1);
+        }
+        if (code == code1) {
+            *x1 = x;
+            *y1 = y;
+            code1 = outcode(vwk, x, y);
+        } else {
+            *x2 = x;
+            *y2 = y;
+            code2 = outcode(vwk, x, y);
+        }
+    }
+
+    return 1;
+}
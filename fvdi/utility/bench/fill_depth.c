@@ -0,0 +1,57 @@
+/*
+ * The 16 bit driver fill, built for the host with DEPTH (given
+ * on the command line) bits per pixel, as c_fill_poly_8/16/32.
+ * Only check_poly uses these.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+
+#define FAST		/* Write in FastRAM buffer */
+#define BOTH		/* Write in both FastRAM and on screen */
+#define PIXEL_32 int	/* Pixel pairs, long is too wide on most hosts */
+
+#define DEPTH_NAME2(name, depth)    name ## _ ## depth
+#define DEPTH_NAME(name, depth)     DEPTH_NAME2(name, depth)
+
+#define c_fill_area     DEPTH_NAME(c_fill_area, DEPTH)
+#define c_fill_poly     DEPTH_NAME(c_fill_poly, DEPTH)
+#define c_get_colours   DEPTH_NAME(fill_colours, DEPTH)
+
+/* No mouse or write-back here */
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2);
+static void dirty_mark(long x1, long y1, long x2, long y2);
+
+#include "../../drivers/16_bit/16b_fill.c"
+
+
+/*
+ * The same colours as check_poly expects, for each index
+ */
+void CDECL c_get_colours(Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background)
+{
+    (void) vwk;
+    *foreground = (unsigned long)(colour & 0xffff) * 0x9e3779b1UL;
+    *background = (unsigned long)((colour >> 16) & 0xffff) * 0x9e3779b1UL;
+}
+
+
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2)
+{
+    (void) wk;
+    (void) x1;
+    (void) y1;
+    (void) x2;
+    (void) y2;
+}
+
+
+static void dirty_mark(long x1, long y1, long x2, long y2)
+{
+    (void) x1;
+    (void) y1;
+    (void) x2;
+    (void) y2;
+}
@@ -0,0 +1,298 @@
+/*
+ * fVDI host benchmark glue
+ *
+ * C stand-ins for the assembly glue (draw.s, vdi_misc.s, c_common.s)
+ * and memory pool that the engine drawing code calls into (clip_line
+ * is in clip.c).
+ * They follow the assembly versions closely enough that the kernels
+ * see the same calls (including table operations) as on the Atari,
+ * but are written for clarity rather than speed.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include <stdlib.h>
+
+#include "fvdi.h"
+#include "function.h"
+#include "globals.h"
+#include "relocate.h"
+#include "utility.h"
+#include "bench.h"
+
+#define MAX_BLOCKS 16
+
+void call_draw_line(Virtual *vwk, DrvLine *line);
+
+extern short line_types[];
+
+short fix_shape = 0;       /* For 16b_mouse.c */
+short no_restore = 0;
+short lazy_hide = 0;
+
+long block_size = 10 * 1024L;
+short arc_split = 16384;
+short arc_min = 16;
+short arc_max = 256;
+
+static struct {
+    char *start;
+    long size;
+} pool[MAX_BLOCKS];
+
+/* Only the memory block functions are used by the driver kernels */
+static Access host_access = {
+    .funcs = {
+        .allocate_block = allocate_block,
+        .free_block = free_block
+    }
+};
+Access *access = &host_access;
+
+
+/*
+ * Fgbg as the assembly code sees it, background in the high word.
+ */
+long fgbg_colour(Fgbg colour)
+{
+    return ((long)colour.background << 16) | (colour.foreground & 0xffffL);
+}
+
+
+/*
+ * Memory blocks are plain malloc'ed, but remembered so that
+ * block_room() can answer questions about them.
+ */
+char *allocate_block(long size)
+{
+    char *addr;
+    int i;
+
+    if (!size)
+        size = block_size;
+
+    for(i = 0; i < MAX_BLOCKS; i++) {
+        if (!pool[i].start)
+            break;
+    }
+    if (i == MAX_BLOCKS)
+        return 0;
+
+    if ((addr = malloc(size)) == NULL)
+        return 0;
+
+    pool[i].start = addr;
+    pool[i].size = size;
+    *(long *)addr = size;       /* Make size info available */
+
+    return addr;
+}
+
+
+void free_block(void *addr)
+{
+    int i;
+
+    for(i = 0; i < MAX_BLOCKS; i++) {
+        if (pool[i].start == addr) {
+            pool[i].start = 0;
+            break;
+        }
+    }
+    free(addr);
+}
+
+
+long block_room(const void *addr)
+{
+    const char *p = addr;
+    int i;
+
+    for(i = 0; i < MAX_BLOCKS; i++) {
+        if (pool[i].start && (p >= pool[i].start) && (p < pool[i].start + pool[i].size))
+            return pool[i].size - (p - pool[i].start);
+    }
+
+    return 0;
+}
+
+
+/*
+ * As clip_rect in vdi_misc.s
+ * Returns zero if nothing is left.
+ */
+static int clip_rect(Virtual *vwk, long *x1, long *y1, long *x2, long *y2)
+{
+    if (!vwk->clip.on)
+        return 1;
+
+    if (*x1 < vwk->clip.rectangle.x1)
+        *x1 = vwk->clip.rectangle.x1;
+    if (*y1 < vwk->clip.rectangle.y1)
+        *y1 = vwk->clip.rectangle.y1;
+    if (*x2 > vwk->clip.rectangle.x2)
+        *x2 = vwk->clip.rectangle.x2;
+    if (*y2 > vwk->clip.rectangle.y2)
+        *y2 = vwk->clip.rectangle.y2;
+
+    return (*x1 <= *x2) && (*y1 <= *y2);
+}
+
+
+/*
+ * Calls the driver fill in the way c_common.s does,
+ * including the span expansion when a table operation is refused.
+ */
+static void driver_fill(Virtual *vwk, long x, long y, long w, long h, short *pattern, long colour, long mode, long interior_style)
+{
+    short *table;
+    long n;
+
+    if (c_fill_area(vwk, x, y, w, h, pattern, colour, mode, interior_style) >= 0)
+        return;
+    if (!((long)vwk & 1) || (y & 0xffff))
+        return;
+
+    vwk = (Virtual *)((long)vwk - 1);
+    table = (short *)x;
+    for(n = (y >> 16) & 0xffff; n > 0; n--) {
+        y = *table++;
+        x = *table++;
+        w = *table++ - x + 1;
+        c_fill_area(vwk, x, y, w, 1, pattern, colour, mode, interior_style);
+    }
+}
+
+
+void fill_rect(Virtual *vwk, long x1, long y1, long x2, long y2, Fgbg colour, short *pattern, long mode, long interior_style)
+{
+    if (!clip_rect(vwk, &x1, &y1, &x2, &y2))
+        return;
+
+    driver_fill(vwk, x1, y1, x2 - x1 + 1, y2 - y1 + 1, pattern, fgbg_colour(colour), mode, interior_style);
+}
+
+
+void hline(Virtual *vwk, long x1, long y1, long x2, Fgbg colour, short *pattern, long mode, long interior_style)
+{
+    fill_rect(vwk, x1, y1, x2, y1, colour, pattern, mode, interior_style);
+}
+
+
+void fill_spans(void *vwk, short *spans, long n, Fgbg colour, short *pattern, long mode, long interior_style)
+{
+    driver_fill((Virtual *)((long)vwk + 1), (long)spans, n << 16, 1, 1, pattern, fgbg_colour(colour), mode, interior_style);
+}
+
+
+/*
+ * As _fill_poly in draw.s, with the 16 bit driver routine installed.
+ */
+void fill_poly(Virtual *vwk, short *p, long n, Fgbg colour, short *pattern, short *points, long mode, long interior_style)
+{
+    (void) points;
+    if (n <= 0)
+        return;
+
+    c_fill_poly(vwk, p, n, 0, 0, pattern, fgbg_colour(colour), mode, interior_style);
+}
+
+
+void call_draw_line(Virtual *vwk, DrvLine *line)
+{
+    if (c_line_draw(vwk, line->x1, line->y1, line->x2, line->y2, line->pattern, line->colour, line->mode) < 0)
+        retry_line(vwk, line);
+}
+
+
+static long line_pattern(Virtual *vwk)
+{
+    if (vwk->line.type == 7)
+        return vwk->line.user_mask & 0xffffL;
+
+    return line_types[vwk->line.type - 1] & 0xffffL;
+}
+
+
+/*
+ * As c_v_pline in draw.s, minus the arrow heads on single lines.
+ */
+void c_pline(Virtual *vwk, long num_pts, Fgbg colour, short *points)
+{
+    DrvLine line;
+    short *block;
+
+    if ((vwk->line.width > 1) && (block = (short *)allocate_block(0)) != NULL) {
+        wide_line(vwk, points, num_pts, colour, block, vwk->mode);
+        free_block(block);
+        return;
+    }
+
+    if (num_pts < 2)
+        return;
+
+    line.pattern = line_pattern(vwk);
+    line.colour = fgbg_colour(colour);
+    line.mode = vwk->mode;
+    line.draw_last = 1;
+    if (num_pts == 2) {
+        line.x1 = points[0];
+        line.y1 = points[1];
+        line.x2 = points[2];
+        line.y2 = points[3];
+        call_draw_line(vwk, &line);
+    } else {
+        line.x1 = (long)points;
+        line.y1 = num_pts << 16;
+        line.x2 = line.y2 = 0;
+        call_draw_line((Virtual *)((long)vwk + 1), &line);
+    }
+}
+
+
+void lib_v_pline(Virtual *vwk, struct v_bez_pars *par)
+{
+    c_pline(vwk, par->num_pts, vwk->line.colour, par->points);
+}
+
+
+void v_bez_accel(long vwk, short *points, long num_points, long totmoves, short *xmov, long pattern, Fgbg colour, long mode)
+{
+    DrvLine line;
+
+    line.x1 = (long)points;
+    line.y1 = num_points;
+    line.x2 = totmoves;
+    line.y2 = (long)xmov;
+    line.pattern = pattern;
+    line.colour = fgbg_colour(colour);
+    line.mode = mode;
+    line.draw_last = 1;
+    call_draw_line((Virtual *)((vwk & ~1L) + 1), &line);
+}
+
+
+/*
+ * Only needed to link default.c, vr_transfer_bits is not measured.
+ */
+void CDECL lib_vdi_spppp(void *func, Virtual *vwk, long subfunction, void *p1, void *p2, void *p3, void *p4)
+{
+    (void) func;
+    (void) vwk;
+    (void) subfunction;
+    (void) p1;
+    (void) p2;
+    (void) p3;
+    (void) p4;
+}
+
+
+void lib_vro_cpyfm(Virtual *vwk, short mode, short *pxy, MFDB *src, MFDB *dst)
+{
+    (void) vwk;
+    (void) mode;
+    (void) pxy;
+    (void) src;
+    (void) dst;
+}
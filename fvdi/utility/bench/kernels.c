@@ -0,0 +1,37 @@
+/*
+ * The 16 bit driver drawing kernels, built for the host.
+ *
+ * The shadow (FAST/BOTH) code is always compiled in, and is
+ * used whenever the workstation has a shadow address set.
+ * Write-back is turned on through bench_writeback().
+ */
+
+#define FAST		/* Write in FastRAM buffer */
+#define BOTH		/* Write in both FastRAM and on screen */
+#define PIXEL_32 int	/* Pixel pairs, long is too wide on most hosts */
+
+#include "../../drivers/16_bit/16b_dirty.c"
+#include "../../drivers/16_bit/16b_exp.c"
+#include "../../drivers/16_bit/16b_blend.c"
+#include "../../drivers/16_bit/16b_blit.c"
+#include "../../drivers/16_bit/16b_line.c"
+#include "../../drivers/16_bit/16b_fill.c"
+#include "../../drivers/16_bit/16b_scr.c"
+#include "../../drivers/16_bit/16b_pal.c"
+#include "../../drivers/16_bit/16b_mouse.c"
+
+
+/*
+ * Draw only into the workstation screen, which is copied
+ * to the video buffer on bench_flush().
+ */
+void bench_writeback(Workstation *wk, short *video)
+{
+    dirty_init(wk, video);
+}
+
+
+void bench_flush(void)
+{
+    dirty_update();
+}
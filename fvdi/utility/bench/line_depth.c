@@ -0,0 +1,59 @@
+/*
+ * The 16 bit driver line drawing and the Bresenham code it
+ * replaced (ref_line.c), built for the host with DEPTH (given on
+ * the command line) bits per pixel, as c_line_draw_8/16/32 and
+ * ref_line_draw_8/16/32. Only check_line uses these.
+ *
+ * This software is licensed under the GNU General Public License.
+ * Please, see LICENSE.TXT for further information.
+ */
+
+#include "fvdi.h"
+
+#define FAST		/* Write in FastRAM buffer */
+#define BOTH		/* Write in both FastRAM and on screen */
+#define PIXEL_32 int	/* Pixel pairs, long is too wide on most hosts */
+
+#define DEPTH_NAME2(name, depth)    name ## _ ## depth
+#define DEPTH_NAME(name, depth)     DEPTH_NAME2(name, depth)
+
+#define c_line_draw     DEPTH_NAME(c_line_draw, DEPTH)
+#define ref_line_draw   DEPTH_NAME(ref_line_draw, DEPTH)
+#define c_get_colours   DEPTH_NAME(line_colours, DEPTH)
+
+/* No mouse or write-back here */
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2);
+static void dirty_mark(long x1, long y1, long x2, long y2);
+
+#include "../../drivers/16_bit/16b_line.c"
+#include "ref_line.c"
+
+
+/*
+ * Some colour for each index, with all bits in use at any depth
+ */
+void CDECL c_get_colours(Virtual *vwk, long colour, unsigned long *foreground, unsigned long *background)
+{
+    (void) vwk;
+    *foreground = (unsigned long)(colour & 0xffff) * 0x9e3779b1UL;
+    *background = (unsigned long)((colour >> 16) & 0xffff) * 0x9e3779b1UL;
+}
+
+
+static void mouse_keep_out(Workstation *wk, long x1, long y1, long x2, long y2)
+{
+    (void) wk;
+    (void) x1;
+    (void) y1;
+    (void) x2;
+    (void) y2;
+}
+
+
+static void dirty_mark(long x1, long y1, long x2, long y2)
+{
+    (void) x1;
+    (void) y1;
+    (void) x2;
+    (void) y2;
+}